@@ -0,0 +1,69 @@
+BINDIR=$1
+
+# --defline-seq / --defline-qual: an optional group is printed only if one
+# of its variables has a value, text alone does not count but $ac always
+# does. [[, ]] and $$ are copied to the defline as they are. The same
+# templates are used on a run with spot names and on one loaded without
+# them, where $sn is empty.
+
+SEQ='@$ac.$si[ name=$sn] [$ac:]$si [[x]]$$'
+QUAL='+$sn[ [[$sn]]][ $rl]'
+DIR=defline
+
+write_fastq()
+{
+    for n in spotA spotB spotC; do
+        echo "@$n"
+        echo "ACGTACGT"
+        echo "+"
+        echo "IIIIIIII"
+    done
+}
+
+RESULT=0
+rm -rf $DIR ; mkdir -p $DIR
+write_fastq > $DIR/in.fastq
+NCBI_SETTINGS=/ $BINDIR/latf-load $DIR/in.fastq -o $DIR/named --quality PHRED_33
+NCBI_SETTINGS=/ $BINDIR/latf-load $DIR/in.fastq -o $DIR/unnamed --quality PHRED_33 --no-readnames
+
+cat > $DIR/named.expected <<'END'
+@ACC1.1 name=spotA ACC1:1 [[x]]$$
+ACGTACGT
++spotA [[spotA]] 8
+IIIIIIII
+@ACC1.2 name=spotB ACC1:2 [[x]]$$
+ACGTACGT
++spotB [[spotB]] 8
+IIIIIIII
+@ACC1.3 name=spotC ACC1:3 [[x]]$$
+ACGTACGT
++spotC [[spotC]] 8
+IIIIIIII
+END
+
+cat > $DIR/unnamed.expected <<'END'
+@ACC1.1 ACC1:1 [[x]]$$
+ACGTACGT
++ 8
+IIIIIIII
+@ACC1.2 ACC1:2 [[x]]$$
+ACGTACGT
++ 8
+IIIIIIII
+@ACC1.3 ACC1:3 [[x]]$$
+ACGTACGT
++ 8
+IIIIIIII
+END
+
+for RUN in named unnamed; do
+    NCBI_SETTINGS=/ $BINDIR/fastq-dump -Z -A ACC1 --defline-seq "$SEQ" --defline-qual "$QUAL" \
+        $DIR/$RUN > $DIR/$RUN.actual 2> /dev/null
+    if ! diff $DIR/$RUN.expected $DIR/$RUN.actual; then
+        echo "fastq-dump --defline-seq/--defline-qual on $RUN spots failed"
+        RESULT=1
+    fi
+done
+
+rm -rf $DIR
+exit $RESULT
@@ -0,0 +1,274 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/*))
+ //  Prefetch of remote cache against local range-server.py, which
+ \\  delays every request and logs it to REQUEST-LOG:
+ //    - a read which is not prefetched completes while prefetch
+ \\      is in flight
+ //    - prefetched blocks are read from cache, without requests
+ \\      to the server
+ //    - everything read equals the local copy of the file
+((*/
+
+#include "../../tools/fuse/remote-cache.c"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#define _T_BLOCK_SIZE ( 64 * 1024 )
+#define _T_BLOCK_QTY 16
+
+    /*) Reads block and compares it with local copy
+     (*/
+static
+rc_t CC
+_TReadBlock (
+            struct RCacheEntry * Entry,
+            const char * Local,
+            uint32_t Block
+)
+{
+    rc_t RCt;
+    size_t NumRead;
+    uint64_t Size;
+    char Remote [ _T_BLOCK_SIZE ];
+
+    RCt = 0;
+    NumRead = 0;
+    Size = 0;
+
+    RCt = RCacheEntryRead (
+                        Entry,
+                        Remote,
+                        sizeof ( Remote ),
+                        ( uint64_t ) Block * _T_BLOCK_SIZE,
+                        & NumRead,
+                        & Size
+                        );
+    if ( RCt == 0 ) {
+        if ( NumRead != sizeof ( Remote )
+            || memcmp ( Remote, Local + ( size_t ) Block * _T_BLOCK_SIZE, NumRead ) != 0
+        ) {
+            KOutMsg ( "FAILED: block %u differs from local copy\n", Block );
+            RCt = RC ( rcExe, rcFile, rcReading, rcData, rcCorrupt );
+        }
+    }
+
+    return RCt;
+}   /* _TReadBlock () */
+
+    /*) Number of requests server has received: one line per request
+     (*/
+static
+size_t CC
+_TRequestQty ( const char * Log )
+{
+    FILE * File;
+    size_t Qty;
+    int Ch;
+
+    Qty = 0;
+
+    File = fopen ( Log, "r" );
+    if ( File != NULL ) {
+        while ( ( Ch = fgetc ( File ) ) != EOF ) {
+            if ( Ch == '\n' ) {
+                Qty ++;
+            }
+        }
+        fclose ( File );
+    }
+
+    return Qty;
+}   /* _TRequestQty () */
+
+    /*) Waits until prefetch threads have nothing queued or in work
+     (*/
+static
+rc_t CC
+_TWaitPrefetch ()
+{
+    rc_t RCt;
+    struct _PfQueue * Queue;
+    bool Idle;
+
+    RCt = 0;
+    Queue = & _sPfQueue;
+    Idle = false;
+
+    while ( RCt == 0 && ! Idle ) {
+        RCt = KLockAcquire ( Queue -> mutabor );
+        if ( RCt == 0 ) {
+            Idle = Queue -> qty == 0 && Queue -> busy == 0;
+
+            KLockUnlock ( Queue -> mutabor );
+        }
+
+        if ( ! Idle ) {
+            usleep ( 10 * 1000 );
+        }
+    }
+
+    return RCt;
+}   /* _TWaitPrefetch () */
+
+static
+rc_t CC
+_TRun (
+        const char * Url,
+        const char * Local,
+        const char * CacheDir,
+        const char * Log
+)
+{
+    rc_t RCt;
+    struct RCacheEntry * Entry;
+    size_t Requests;
+    uint32_t llp;
+
+    RCt = 0;
+    Entry = NULL;
+    Requests = 0;
+
+    RemoteCacheSetHttpBlockSize ( _T_BLOCK_SIZE );
+    RemoteCacheSetPrefetchWindow ( 4 );
+
+    RCt = RemoteCacheInitialize ( CacheDir );
+    if ( RCt == 0 ) {
+        RCt = RemoteCacheCreate ();
+    }
+    if ( RCt == 0 ) {
+        RCt = RemoteCacheFindOrCreateEntry ( Url, & Entry );
+    }
+    if ( RCt == 0 ) {
+        RCt = RCacheEntryAddRef ( Entry );
+    }
+    if ( RCt != 0 ) {
+        return RCt;
+    }
+
+        /*) Two sequential reads start prefetch of blocks 2 ... 6
+         (*/
+    for ( llp = 0; RCt == 0 && llp < 2; llp ++ ) {
+        RCt = _TReadBlock ( Entry, Local, llp );
+    }
+
+        /*) Not prefetched: read while prefetch requests are
+         (  still in flight
+         (*/
+    if ( RCt == 0 ) {
+        RCt = _TReadBlock ( Entry, Local, _T_BLOCK_QTY - 1 );
+    }
+
+        /*) Prefetched blocks are served by cache: server does not
+         (  get any request for them
+         (*/
+    if ( RCt == 0 ) {
+        RCt = _TWaitPrefetch ();
+    }
+    if ( RCt == 0 ) {
+        Requests = _TRequestQty ( Log );
+    }
+    for ( llp = 2; RCt == 0 && llp <= 6; llp ++ ) {
+        RCt = _TReadBlock ( Entry, Local, llp );
+        if ( RCt == 0 && _TRequestQty ( Log ) != Requests ) {
+            KOutMsg ( "FAILED: block %u was requested, it was not prefetched\n", llp );
+            RCt = RC ( rcExe, rcFile, rcReading, rcData, rcNotFound );
+        }
+    }
+
+        /*) The rest is read as usual
+         (*/
+    for ( llp = 7; RCt == 0 && llp < _T_BLOCK_QTY - 1; llp ++ ) {
+        RCt = _TReadBlock ( Entry, Local, llp );
+    }
+
+    RCacheEntryRelease ( Entry );
+    RemoteCacheDispose ();
+
+    return RCt;
+}   /* _TRun () */
+
+static
+rc_t CC
+_TReadLocal ( const char * Path, char ** Data )
+{
+    rc_t RCt;
+    FILE * File;
+    size_t Size;
+
+    RCt = 0;
+    Size = ( size_t ) _T_BLOCK_SIZE * _T_BLOCK_QTY;
+
+    * Data = ( char * ) malloc ( Size );
+    if ( * Data == NULL ) {
+        return RC ( rcExe, rcFile, rcReading, rcMemory, rcExhausted );
+    }
+
+    File = fopen ( Path, "rb" );
+    if ( File == NULL || fread ( * Data, 1, Size, File ) != Size ) {
+        KOutMsg ( "FAILED: can not read %lu bytes of %s\n", Size, Path );
+        RCt = RC ( rcExe, rcFile, rcReading, rcFile, rcInsufficient );
+    }
+
+    if ( File != NULL ) {
+        fclose ( File );
+    }
+
+    return RCt;
+}   /* _TReadLocal () */
+
+ver_t CC KAppVersion ( void ) { return 0; }
+
+const char UsageDefaultName[] = "test-remote-cache";
+rc_t CC UsageSummary ( const char * progname ) { return 0; }
+rc_t CC Usage ( const Args * args ) { return 0; }
+
+rc_t CC KMain ( int argc, char * argv [] )
+{
+    rc_t RCt;
+    char * Local;
+
+    RCt = 0;
+    Local = NULL;
+
+    if ( argc != 5 ) {
+        KOutMsg ( "usage: %s URL LOCAL-COPY CACHE-DIR REQUEST-LOG\n", argv [ 0 ] );
+        return RC ( rcExe, rcArgv, rcParsing, rcParam, rcInsufficient );
+    }
+
+    RCt = _TReadLocal ( argv [ 2 ], & Local );
+    if ( RCt == 0 ) {
+        RCt = _TRun ( argv [ 1 ], Local, argv [ 3 ], argv [ 4 ] );
+    }
+
+    free ( Local );
+
+    KOutMsg ( "remote cache prefetch test %s\n", RCt == 0 ? "passed" : "FAILED" );
+
+    return RCt;
+}
@@ -0,0 +1,124 @@
+import os
+import sys
+import time
+import random
+import hashlib
+import argparse
+import subprocess
+
+'''---------------------------------------------------------------------
+    remote-I/O throughput benchmark for "vdb-get --workers N"
+
+    creates a data-file, serves it with range-server.py on localhost,
+    downloads it with different numbers of workers, verifies the md5
+    of each download and prints throughput and latency per run
+---------------------------------------------------------------------'''
+
+def make_data( fname, size, seed = 42 ) :
+    rnd = random.Random( seed )
+    with open( fname, "wb" ) as f :
+        while size > 0 :
+            n = min( size, 1024 * 1024 )
+            f.write( rnd.getrandbits( n * 8 ).to_bytes( n, "little" ) )
+            size -= n
+
+def md5( fname ) :
+    hasher = hashlib.md5()
+    with open( fname, "rb" ) as f :
+        buf = f.read( 65536 )
+        while len( buf ) > 0 :
+            hasher.update( buf )
+            buf = f.read( 65536 )
+    return hasher.hexdigest()
+
+'''---------------------------------------------------------------------
+    calls "vdb-get URL DST --workers N ..."
+    returns the "total" and the last "latency" line of the output
+---------------------------------------------------------------------'''
+def kget_workers( url, dst, workers, args ) :
+    cmd = [ 'vdb-get', url, dst, '--workers', str( workers ), '--block-size', args.block ]
+    if args.random :
+        cmd.append( '--random' )
+    if args.cache :
+        cmd += [ '--cache', dst + ".cache" ]
+    print ( "running: '%s'"%( " ".join( cmd ) ) )
+    process = subprocess.run( cmd, check=True, stdout=subprocess.PIPE, universal_newlines=True )
+    total, latency = None, None
+    for line in process.stdout.split( "\n" ) :
+        if line.startswith( "total" ) :
+            total = line
+        elif line.startswith( "latency" ) :
+            latency = line
+    return total, latency
+
+'''---------------------------------------------------------------------
+    waits until range-server.py has written the port it listens on
+    returns None if it exits or is not ready within timeout seconds
+---------------------------------------------------------------------'''
+def wait_port( server, port_file, timeout = 30 ) :
+    deadline = time.time() + timeout
+    while time.time() < deadline and server.poll() is None :
+        if os.path.exists( port_file ) :
+            with open( port_file ) as f :
+                return int( f.read() )
+        time.sleep( 0.1 )
+    return None
+
+parser = argparse.ArgumentParser()
+parser.add_argument( "--size", type=int, default=64, help="size of the data-file in MB" )
+parser.add_argument( "--workers", default="1,2,4,8", help="comma-separated numbers of workers" )
+parser.add_argument( "--block", default="128k", help="block-size given to vdb-get" )
+parser.add_argument( "--delay", type=int, default=0, help="ms the server waits per request" )
+parser.add_argument( "--port", type=int, default=0, help="port of the server, 0 for any free one" )
+parser.add_argument( "--random", action="store_true", help="fetch blocks in random order" )
+parser.add_argument( "--cache", action="store_true", help="fetch through a cache-tee-file" )
+args = parser.parse_args()
+
+DIR = "bench.tmp"
+SRC = "bench.dat"
+DST = os.path.join( DIR, "download.dat" )
+
+os.makedirs( DIR, exist_ok = True )
+make_data( os.path.join( DIR, SRC ), args.size * 1024 * 1024 )
+EXP_MD5 = md5( os.path.join( DIR, SRC ) )
+
+PORT_FILE = os.path.join( DIR, "port" )
+server = subprocess.Popen( [ sys.executable,
+                             os.path.join( os.path.dirname( os.path.abspath( __file__ ) ), "range-server.py" ),
+                             DIR, str( args.port ), str( args.delay ), "--port-file", PORT_FILE ] )
+port = wait_port( server, PORT_FILE )
+if port is None :
+    print ( "range-server did not start" )
+    server.terminate()
+    server.wait()
+    sys.exit( -1 )
+
+res = 0
+results = []
+try :
+    url = "http://127.0.0.1:%d/%s"%( port, SRC )
+    for workers in [ int( w ) for w in args.workers.split( "," ) ] :
+        for f in [ DST, DST + ".cache" ] :
+            if os.path.exists( f ) :
+                os.remove( f )
+        total, latency = kget_workers( url, DST, workers, args )
+        if md5( DST ) != EXP_MD5 :
+            print ( "md5 diff with %d workers"%( workers ) )
+            res = -1
+        results.append( ( workers, total, latency ) )
+except Exception as ex :
+    print ( ex )
+    res = -1
+finally :
+    server.terminate()
+    server.wait()
+
+print ( "-" * 80 )
+for workers, total, latency in results :
+    print ( "%2d workers | %s | %s"%( workers, total, latency ) )
+print ( "-" * 80 )
+
+for f in os.listdir( DIR ) :
+    os.remove( os.path.join( DIR, f ) )
+os.rmdir( DIR )
+sys.exit( res )
@@ -0,0 +1,140 @@
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+
+
+'''---------------------------------------------------------------------
+    local HTTP server for files of a directory, answering HEAD and
+    ( ranged ) GET requests, keeps connections alive.
+
+    usage: range-server.py DIR PORT [DELAY-MS] [--log FILE] [--port-file FILE]
+
+    DELAY-MS is added to every request to imitate a remote server.
+    --log appends a line 'METHOD RANGE' for every request to FILE,
+    before it is answered.
+    PORT 0 binds any free port, --port-file writes the port bound to
+    FILE once the server accepts connections.
+---------------------------------------------------------------------'''
+
+import argparse
+import os
+import re
+import sys
+import threading
+import time
+
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+class RangeHandler( BaseHTTPRequestHandler ) :
+    protocol_version = "HTTP/1.1"
+    root = "."
+    delay = 0.0
+    log = None
+    log_lock = threading.Lock()
+
+    def log_request_line( self ) :
+        if self.log :
+            with self.log_lock :
+                with open( self.log, "a" ) as f :
+                    f.write( "%s %s\n"%( self.command, self.headers.get( "Range", "-" ) ) )
+
+    def send_head( self ) :
+        path = os.path.join( self.root, os.path.basename( self.path.split( "?" )[ 0 ] ) )
+        if not os.path.isfile( path ) :
+            self.send_response( 404 )
+            self.send_header( "Content-Length", "0" )
+            self.end_headers()
+            return None
+        size = os.path.getsize( path )
+        start, end = 0, size - 1
+        m = re.match( r"bytes=(\d+)-(\d*)$", self.headers.get( "Range", "" ) )
+        if m :
+            start = int( m.group( 1 ) )
+            if m.group( 2 ) :
+                end = min( int( m.group( 2 ) ), size - 1 )
+            if start >= size :
+                self.send_response( 416 )
+                self.send_header( "Content-Range", "bytes */%d"%( size ) )
+                self.send_header( "Content-Length", "0" )
+                self.end_headers()
+                return None
+            self.send_response( 206 )
+            self.send_header( "Content-Range", "bytes %d-%d/%d"%( start, end, size ) )
+        else :
+            self.send_response( 200 )
+        self.send_header( "Accept-Ranges", "bytes" )
+        self.send_header( "Content-Type", "application/octet-stream" )
+        self.send_header( "Content-Length", str( end - start + 1 ) )
+        self.end_headers()
+        return ( path, start, end - start + 1 )
+
+    def do_HEAD( self ) :
+        self.log_request_line()
+        if self.delay > 0 :
+            time.sleep( self.delay )
+        self.send_head()
+
+    def do_GET( self ) :
+        self.log_request_line()
+        if self.delay > 0 :
+            time.sleep( self.delay )
+        r = self.send_head()
+        if r :
+            path, start, count = r
+            with open( path, "rb" ) as f :
+                f.seek( start )
+                while count > 0 :
+                    buf = f.read( min( count, 65536 ) )
+                    if not buf :
+                        break
+                    self.wfile.write( buf )
+                    count -= len( buf )
+
+    def log_message( self, format, *args ) :
+        pass
+
+def serve( root, port, delay_ms = 0, log = None ) :
+    RangeHandler.root = root
+    RangeHandler.delay = delay_ms / 1000.0
+    RangeHandler.log = log
+    server = ThreadingHTTPServer( ( "127.0.0.1", port ), RangeHandler )
+    server.daemon_threads = True
+    return server
+
+if __name__ == "__main__" :
+    parser = argparse.ArgumentParser( description = "local HTTP server answering ranged requests" )
+    parser.add_argument( "dir" )
+    parser.add_argument( "port", type=int )
+    parser.add_argument( "delay", type=int, nargs="?", default=0 )
+    parser.add_argument( "--log" )
+    parser.add_argument( "--port-file" )
+    args = parser.parse_args()
+
+    server = serve( args.dir, args.port, args.delay, args.log )
+    if args.port_file :
+        # written aside and renamed, so readers never see a partial port
+        tmp = args.port_file + ".tmp"
+        with open( tmp, "w" ) as f :
+            f.write( "%d\n"%( server.server_address[ 1 ] ) )
+        os.rename( tmp, args.port_file )
+    server.serve_forever()
@@ -107,6 +107,28 @@ FIXTURE_TEST_CASE ( SingleReference_Slice, NGSPileupFixture )
     REQUIRE_EQ ( expected, Run () );
 }
 
+FIXTURE_TEST_CASE ( SingleReference_OverlappingSlices, NGSPileupFixture )
+{
+    ps . AddInput ( "ERR247027" ); 
+    ps . AddReferenceSlice ( "AL844509.2", 1212494, 1 );  
+    ps . AddReferenceSlice ( "Pf3D7_13", 1212492, 2 );  /* same reference by common name, overlaps the first one */
+    string expected = 
+        "AL844509.2\t1212494\t1\n"
+        "AL844509.2\t1212495\t1\n";
+    REQUIRE_EQ ( expected, Run () );
+}
+
+FIXTURE_TEST_CASE ( SingleReference_Threads, NGSPileupFixture )
+{
+    ps . AddInput ( "ERR247027" ); 
+    ps . AddReference ( "AL844509.2" );  
+    string expected = Run ();
+    
+    m_str . str ( string () );
+    ps . threads = 4;
+    REQUIRE_EQ ( expected, Run () );
+}
+
 #if 0
 FIXTURE_TEST_CASE ( MultipleReferences, NGSPileupFixture )
 {   
@@ -0,0 +1,38 @@
+BINDIR=$1
+
+# Redacts non-adjacent spots and the last spot of a 20 spot run:
+# READ_FILTER of exactly those spots has to become REDACTED ( 3 ),
+# all other rows have to stay as they were
+
+RUN=tmp-redact-spots
+SPOTS="3 7 12 20"
+
+rm -rf $RUN $RUN.fastq $RUN.in $RUN.before $RUN.after $RUN.expected
+
+for i in `seq 1 20`; do
+    echo "@R$i"
+    echo "ACGTACGTACGTACGTACGT"
+    echo "+"
+    echo "IIIIIIIIIIIIIIIIIIII"
+done > $RUN.fastq
+for s in $SPOTS; do echo $s; done > $RUN.in
+
+$BINDIR/latf-load $RUN.fastq -o $RUN --quality PHRED_33 || exit 1
+$BINDIR/vdb-dump -C READ_FILTER --without_sra -f tab $RUN > $RUN.before || exit 2
+$BINDIR/read-filter-redact -F$RUN.in $RUN > /dev/null 2>&1 || exit 3
+$BINDIR/vdb-dump -C READ_FILTER --without_sra -f tab $RUN > $RUN.after || exit 4
+
+awk -v spots="$SPOTS" 'BEGIN { n = split( spots, s, " " ); for ( i = 1; i <= n; ++i ) r[ s[ i ] ] = 1 }
+    { if ( NR in r ) gsub( /[0-9]+/, "3" ); print }' $RUN.before > $RUN.expected
+
+RESULT=0
+if ! diff $RUN.expected $RUN.after; then
+    echo "test (redact spots $SPOTS) failed for $BINDIR/read-filter-redact"
+    RESULT=5
+else
+    echo "test (redact spots $SPOTS) passed for $BINDIR/read-filter-redact"
+fi
+
+rm -rf $RUN $RUN.fastq $RUN.in $RUN.before $RUN.after $RUN.expected
+
+exit $RESULT
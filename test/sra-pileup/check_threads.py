@@ -0,0 +1,53 @@
+#!/usr/bin/env python
+
+import subprocess
+import sys
+import os.path
+
+TOOL = sys.argv [ 1 ]
+
+def check_if_tool_exits( tool ) :
+    if not os.path.exists ( tool ):
+        print ( "\nERROR: Can not find tool : '" + tool + "'\n" )
+        exit ( 1 )
+
+def run_tool( tool, args ) :
+    a = [ tool ]
+    for arg in args :
+        a.append( arg )
+    p = subprocess.Popen ( a, stdout = subprocess.PIPE, stderr = subprocess.PIPE )
+    res  = "".join( chr( x ) for x in p.stdout.read() )
+    if p.wait() != 0 :
+        print ( "error executing tool" )
+        exit( 1 )
+    return res
+
+if sys.version_info[ 0 ] < 3 :
+    print( "does not work with python version < 3!" )
+    sys.exit( 3 )
+
+check_if_tool_exits( TOOL )
+
+# --threads must not change the output of any function:
+# the range covers 3 slices of 200k bases in a parallel pileup
+ACCESSION = "SRR5486177"
+SLICE = "chr1:3000000-3500000"
+FUNCTIONS = [ None, "count", "stat", "mismatch", "index" ]
+
+step = 0
+for func in FUNCTIONS :
+    args = [ ACCESSION, "-r", SLICE ]
+    if func is not None :
+        args += [ "--function", func ]
+    name = "pileup" if func is None else func
+
+    step += 1
+    print( "running step " + str( step ) + " ( " + name + " )" )
+    out1 = run_tool( TOOL, args + [ "--threads", "1" ] )
+    out2 = run_tool( TOOL, args + [ "--threads", "4" ] )
+    if out1 != out2 :
+        print ( "error comparison " + str( step ) + ": '" + name + "' differs with --threads 4" )
+        exit( 1 )
+
+print ( "[" + os.path.basename ( __file__ ) + "] test passed for tool '" + TOOL + "'" )
+exit( 0 )
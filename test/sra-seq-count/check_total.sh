@@ -0,0 +1,30 @@
+BINDIR=$1
+
+# total is every primary alignment of the references in the gtf-file, not
+# only the ones inside of the features: one 10-base exon per reference has
+# to report as many as the PRIMARY_ALIGNMENT table has rows
+
+RUN=../align-cache/CSRA_file
+GTF=tmp-check-total.gtf
+
+$BINDIR/vdb-dump -T REFERENCE -C NAME -f tab $RUN | uniq | \
+    awk '{ printf "%s\ttest\texon\t1\t10\t.\t+\t.\tgene_id \"G%d\";\n", $1, NR }' > $GTF || exit 1
+
+EXPECTED=`$BINDIR/vdb-dump --id_range -T PRIMARY_ALIGNMENT $RUN | sed -n 's/.*row-count = //p' | tr -d ,`
+
+RESULT=0
+for THREADS in 1 4; do
+    TOTAL=`$BINDIR/sra-seq-count -t $THREADS $RUN $GTF | sed -n 's/^total\t//p'`
+    if [ -z "$EXPECTED" ] || [ "$TOTAL" != "$EXPECTED" ]; then
+        echo "test (total, $THREADS threads) failed for $BINDIR/sra-seq-count: $TOTAL instead of $EXPECTED"
+        RESULT=2
+    fi
+done
+
+rm -f $GTF
+
+if [ $RESULT -eq 0 ]; then
+    echo "test (total) passed for $BINDIR/sra-seq-count"
+fi
+
+exit $RESULT
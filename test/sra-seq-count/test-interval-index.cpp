@@ -0,0 +1,164 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../../tools/sra-seq-count/range.hpp"
+
+#include <ktst/unit_test.hpp> // TEST_SUITE
+
+using namespace seq_ranges;
+
+TEST_SUITE ( TestIntervalIndex );
+
+/* the values of all ranges intersecting r, sorted */
+static std::vector< size_t > Query ( const interval_index & index, const range & r ) {
+    std::vector< size_t > res;
+    index . query ( r, res );
+    std::sort ( res . begin (), res . end () );
+    return res;
+}
+
+/* the same by scanning all ranges */
+static std::vector< size_t > Scan ( const std::vector< range > & ranges, const range & r ) {
+    std::vector< size_t > res;
+    for ( size_t i = 0; i < ranges . size (); ++ i )
+        if ( ranges [ i ] . intersect ( r ) )
+            res . push_back ( i );
+    return res;
+}
+
+/* every query from 1 to max must agree with the scan */
+static bool AllQueriesMatch ( const std::vector< range > & ranges, long max ) {
+    interval_index index;
+    for ( size_t i = 0; i < ranges . size (); ++ i )
+        index . add ( ranges [ i ], i );
+    index . build ();
+    for ( long start = 1; start <= max; ++ start )
+        for ( long end = start; end <= max; ++ end )
+            if ( Query ( index, range ( start, end ) ) != Scan ( ranges, range ( start, end ) ) )
+                return false;
+    return true;
+}
+
+TEST_CASE ( empty ) {
+    interval_index index;
+    index . build ();
+    REQUIRE ( index . empty () );
+    REQUIRE ( Query ( index, range ( 1, 100 ) ) . empty () );
+}
+
+TEST_CASE ( nested ) {
+    std::vector< range > r;
+    r . push_back ( range ( 10, 100 ) );
+    r . push_back ( range ( 20, 80 ) );
+    r . push_back ( range ( 30, 40 ) );
+    r . push_back ( range ( 35, 36 ) );
+    r . push_back ( range ( 60, 70 ) );
+    REQUIRE ( AllQueriesMatch ( r, 110 ) );
+}
+
+TEST_CASE ( long_feature ) {
+    /* a gene spanning the whole chromosome, followed by many short exons */
+    std::vector< range > r;
+    r . push_back ( range ( 1, 1000 ) );
+    for ( long i = 0; i < 90; ++ i )
+        r . push_back ( range ( 10 + i * 10, 12 + i * 10 ) );
+    REQUIRE ( AllQueriesMatch ( r, 1000 ) );
+
+    interval_index index;
+    for ( size_t i = 0; i < r . size (); ++ i )
+        index . add ( r [ i ], i );
+    index . build ();
+    std::vector< size_t > expected;
+    expected . push_back ( 0 );
+    expected . push_back ( 51 );
+    REQUIRE ( Query ( index, range ( 511, 511 ) ) == expected );
+}
+
+TEST_CASE ( adjacent ) {
+    std::vector< range > r;
+    r . push_back ( range ( 1, 10 ) );
+    r . push_back ( range ( 11, 20 ) );
+    r . push_back ( range ( 21, 30 ) );
+    REQUIRE ( AllQueriesMatch ( r, 40 ) );
+
+    interval_index index;
+    for ( size_t i = 0; i < r . size (); ++ i )
+        index . add ( r [ i ], i );
+    index . build ();
+    REQUIRE_EQ ( Query ( index, range ( 10, 11 ) ) . size (), ( size_t ) 2 );
+    REQUIRE_EQ ( Query ( index, range ( 11, 11 ) ) . size (), ( size_t ) 1 );
+}
+
+TEST_CASE ( no_overlap ) {
+    std::vector< range > r;
+    r . push_back ( range ( 5, 10 ) );
+    r . push_back ( range ( 50, 60 ) );
+    r . push_back ( range ( 100, 120 ) );
+    REQUIRE ( AllQueriesMatch ( r, 130 ) );
+
+    interval_index index;
+    for ( size_t i = 0; i < r . size (); ++ i )
+        index . add ( r [ i ], i );
+    index . build ();
+    REQUIRE ( Query ( index, range ( 11, 49 ) ) . empty () );
+    REQUIRE ( Query ( index, range ( 121, 130 ) ) . empty () );
+    REQUIRE ( Query ( index, range ( 1, 4 ) ) . empty () );
+}
+
+TEST_CASE ( same_start ) {
+    std::vector< range > r;
+    r . push_back ( range ( 10, 20 ) );
+    r . push_back ( range ( 10, 12 ) );
+    r . push_back ( range ( 10, 50 ) );
+    r . push_back ( range ( 15, 15 ) );
+    REQUIRE ( AllQueriesMatch ( r, 60 ) );
+}
+
+TEST_CASE ( spans ) {
+    interval_index index;
+    index . add ( range ( 30, 40 ), 0 );
+    index . add ( range ( 1, 10 ), 1 );
+    index . add ( range ( 5, 20 ), 2 );
+    index . build ();
+    std::vector< range > s;
+    index . spans ( s );
+    REQUIRE_EQ ( s . size (), ( size_t ) 2 );
+    REQUIRE_EQ ( s [ 0 ] . get_start (), 1L );
+    REQUIRE_EQ ( s [ 0 ] . get_end (), 20L );
+    REQUIRE_EQ ( s [ 1 ] . get_start (), 30L );
+    REQUIRE_EQ ( s [ 1 ] . get_end (), 40L );
+}
+
+extern "C" {
+    ver_t CC KAppVersion ( void ) { return 0; }
+    rc_t CC KMain ( int argc, char * argv [] ) {
+        return TestIntervalIndex ( argc, argv );
+    }
+}
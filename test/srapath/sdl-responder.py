@@ -0,0 +1,88 @@
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+
+'''---------------------------------------------------------------------
+    local stand-in for SDL resolver:
+        usage sdl-responder.py PORT LOG [PORT-FILE]
+
+    PORT 0 binds any free port, the port bound is written to PORT-FILE
+    once the responder accepts connections.
+
+    SRR-accessions are resolved to a single remote file, SRR000002
+    to an SRA Lite file and a Normalized Format one,
+    any other accession is not found.
+    Accessions are answered in reverse order of the request,
+    every request is logged as a line of requested accessions.
+---------------------------------------------------------------------'''
+
+import json
+import os
+import sys
+
+from http.server import BaseHTTPRequestHandler, HTTPServer
+from urllib.parse import parse_qs
+
+def sra_file( acc, name, noqual ) :
+    return { "object" : "srapub|%s"%( name ), "type" : "sra",
+             "name" : name, "size" : 1000, "noqual" : noqual,
+             "md5" : "00112233445566778899aabbccddeeff",
+             "modificationDate" : "2020-01-01T00:00:00Z",
+             "locations" : [ {
+                  "link" : "https://sdl-stub.test/%s/%s.1"%( acc, name ),
+                  "service" : "sra-ncbi", "region" : "be-md" } ] }
+
+def resolve( acc ) :
+    if not acc.startswith( "SRR" ) :
+        return { "bundle" : acc, "status" : 404,
+                 "msg" : "No data at given location.region" }
+    files = [ sra_file( acc, acc, False ) ]
+    if acc == "SRR000002" :
+        files.insert( 0, sra_file( acc, acc + ".lite", True ) )
+    return { "bundle" : acc, "status" : 200, "msg" : "ok", "files" : files }
+
+class Responder( BaseHTTPRequestHandler ) :
+    def do_POST( self ) :
+        size = int( self.headers.get( 'Content-Length', 0 ) )
+        form = parse_qs( self.rfile.read( size ).decode() )
+        accs = form.get( "acc", [] )
+        with open( sys.argv[ 2 ], "a" ) as log :
+            log.write( " ".join( accs ) + "\n" )
+        body = json.dumps( { "version" : "2",
+                             "result" : [ resolve( a ) for a in reversed( accs ) ] } )
+        self.send_response( 200 )
+        self.send_header( "Content-Type", "application/json" )
+        self.send_header( "Content-Length", str( len( body ) ) )
+        self.end_headers()
+        self.wfile.write( body.encode() )
+
+    def log_message( self, format, *args ) :
+        pass
+
+server = HTTPServer( ( "127.0.0.1", int( sys.argv[ 1 ] ) ), Responder )
+if len( sys.argv ) > 3 :
+    # written aside and renamed, so readers never see a partial port
+    with open( sys.argv[ 3 ] + ".tmp", "w" ) as f :
+        f.write( "%d\n"%( server.server_address[ 1 ] ) )
+    os.rename( sys.argv[ 3 ] + ".tmp", sys.argv[ 3 ] )
+server.serve_forever()
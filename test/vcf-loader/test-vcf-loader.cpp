@@ -609,6 +609,68 @@ FIXTURE_TEST_CASE(VcfReader_Parse_Errors, VcfReaderFixture)
     REQUIRE_EQ(string("line 4 column 31: one or more of the 8 mandatory columns are missing"), string(msg));
 }
 
+FIXTURE_TEST_CASE(VcfReader_Parse_Threads, VcfReaderFixture)
+{   
+    string text = 
+        "##fileformat=VCFv4.2\n"
+        "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n";
+    const uint32_t lineCount = 1000;
+    for (uint32_t i = 0; i < lineCount; ++i)
+    {
+        ostringstream line;
+        line << "20\t" << ( i + 1 ) << "\t.\tG\tA\t" << ( i % 100 ) << "\tPASS\tNS=3\tGT\t" << i << ( i % 2 == 0 ? "\n" : "\r\n" );
+        text += line.str();
+    }
+    REQUIRE_RC(CreateFile(GetName(), text.c_str()));
+    REQUIRE_RC(VcfReaderSetThreads(reader, 4, 0)); 
+    REQUIRE_RC(ParseFile(GetName())); 
+        
+    uint32_t count;
+    REQUIRE_RC(VcfReaderGetDataLineCount(reader, &count));
+    REQUIRE_EQ(lineCount, count);
+    
+    for (uint32_t i = 0; i < lineCount; ++i)
+    {   // in input order
+        const VcfDataLine* line;
+        REQUIRE_RC(VcfReaderGetDataLine(reader, i, &line));
+        REQUIRE_NOT_NULL(line);
+        REQUIRE_EQ(i + 1,           line->position);   
+        REQUIRE_EQ(i % 100,         (unsigned int)line->quality);   
+        REQUIRE_EQ(string("NS=3"),  StringToSTL(line->info));
+        
+        uint32_t fieldCount;
+        REQUIRE_RC( VNameListCount(line->genotypeFields, &fieldCount) );    
+        REQUIRE_EQ(2u, fieldCount);
+        const char* name;
+        REQUIRE_RC(VNameListGet ( line->genotypeFields, 1, &name ));
+        ostringstream expected;
+        expected << i;
+        REQUIRE_EQ(expected.str(), string(name));
+    }
+}
+
+FIXTURE_TEST_CASE(VcfReader_Parse_Threads_Errors, VcfReaderFixture)
+{   
+    REQUIRE_RC(CreateFile(GetName(), 
+        "##fileformat=VCFv4.2\n"
+        "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\n"
+        "20\t14370\trs6054257\tG\tA\t29\tPASS\tNS=3;DP=14;AF=0.5;DB;H2\n"
+        "20\t14370\trs6054257\tG\tA\t10\tPASS\n"
+        "20\t17330\t.\tT\tA\t3\tq10\tNS=3;DP=11;AF=0.017\n"
+        "20\t1x\t.\tT\tA\t3\tq10\tNS=3;DP=11;AF=0.017\n"
+        "20\t17330\t.\tT\tA\t3\tq10\tNS=3;DP=11;AF=0.017\n"
+        )); // 1. not all mandatory fields present
+            // 2. not a number as position
+    REQUIRE_RC(VcfReaderSetThreads(reader, 3, 0)); 
+    REQUIRE_RC_FAIL(ParseFile(GetName())); 
+    REQUIRE_EQ(2u, messageCount);
+    const char* msg;
+    REQUIRE_RC(VNameListGet ( messages, 0, &msg ));
+    REQUIRE_EQ(string("line 4 column 31: one or more of the 8 mandatory columns are missing"), string(msg));
+    REQUIRE_RC(VNameListGet ( messages, 1, &msg ));
+    REQUIRE_EQ(string("line 6 column 4: invalid numeric value for 'position'"), string(msg));
+}
+
 // VcfDatabase
 class VcfDatabaseFixture : public VcfReaderFixture
 {
@@ -0,0 +1,56 @@
+BINDIR=$1
+
+# READ is computed from the physical columns .READ and .ALTREAD:
+# replacing a base by N changes .ALTREAD, and leaves .READ unchanged
+# for the base N is stored as in 2na. Try every base, --blobs must
+# find the difference in all cases.
+
+write_fastq()
+{
+    for i in 1 2 3 4 5 6 7 8 9 10; do
+        echo "@R$i"
+        if [ $i -eq 5 ]; then echo "$1"; else echo "ACGTACGTACGTACGTACGT"; fi
+        echo "+"
+        echo "IIIIIIIIIIIIIIIIIIII"
+    done
+}
+
+RESULT=0
+for BASE in A C G T; do
+    rm -rf B1 B2 B1.fastq B2.fastq
+    write_fastq "ACGTACGTA${BASE}GTACGTACGT" > B1.fastq
+    write_fastq "ACGTACGTANGTACGTACGT" > B2.fastq
+    $BINDIR/latf-load B1.fastq -o B1 --quality PHRED_33
+    $BINDIR/latf-load B2.fastq -o B2 --quality PHRED_33
+    for MODE in "" "-c" "-c -t 2"; do
+        $BINDIR/vdb-diff -b $MODE -C READ B1 B2
+        if [ $? -eq 0 ]; then
+            echo "test (compare --blobs $MODE, $BASE vs. N) failed for $BINDIR/vdb-diff"
+            RESULT=3
+        fi
+    done
+done
+
+# identical blobs have to be skipped, not decoded: in every mode each
+# summary has to report identical blobs and no decoded ones
+cp -r B1 B3
+for MODE in "" "-c" "-c -t 2"; do
+    OUT=`$BINDIR/vdb-diff -b $MODE B1 B3`
+    if [ $? -ne 0 ]; then
+        echo "test (compare --blobs $MODE, identical tables) failed for $BINDIR/vdb-diff"
+        RESULT=3
+    fi
+    STATS=`echo "$OUT" | grep "blobs identical"`
+    if [ -z "$STATS" ] || echo "$STATS" | grep -qv "^[1-9][0-9,]* blobs identical, 0 blobs decoded$"; then
+        echo "test (compare --blobs $MODE, identical blobs skipped) failed for $BINDIR/vdb-diff"
+        echo "$STATS"
+        RESULT=3
+    fi
+done
+rm -rf B1 B2 B3 B1.fastq B2.fastq
+
+if [ $RESULT -eq 0 ]; then
+    echo "test (compare --blobs computed column) passed for $BINDIR/vdb-diff"
+fi
+
+exit $RESULT
@@ -43,12 +43,15 @@ struct SrapathParams final : CmnOptAndAccessions
     ncbi::String url;
     ncbi::String param;
     ncbi::String project;
+    ncbi::U32 batch_count;
+    ncbi::U32 batch_value;
     bool print_raw, print_json, resolve_cache, print_path;
 
 
     explicit SrapathParams(WhatImposter const &what)
     : CmnOptAndAccessions(what)
     , timeout_count( 0 ), timeout_value( 0 )
+    , batch_count( 0 ), batch_value( 0 )
     , print_raw( false )
     , print_json( false )
     , resolve_cache( false )
@@ -81,6 +84,9 @@ struct SrapathParams final : CmnOptAndAccessions
 
         cmdline . addOption ( print_path, "P", "path", "print path of object: names function-only" );
 
+        cmdline . addOption ( batch_value, &batch_count, "b", "batch", "<count>",
+            "resolve accessions with one request per <count> of them: resolve function-only" );
+
         CmnOptAndAccessions::add(cmdline);
     }
 
@@ -97,6 +103,7 @@ struct SrapathParams final : CmnOptAndAccessions
         if ( !project.isEmpty() ) ss << "project: " << project << std::endl;
         if ( resolve_cache ) ss << "resolve cache-file" << std::endl;
         if ( print_path ) ss << "print path" << std::endl;
+        if ( batch_count > 0 ) ss << "batch: " << batch_value << std::endl;
         return CmnOptAndAccessions::show(ss);
     }
 
@@ -117,6 +124,7 @@ struct SrapathParams final : CmnOptAndAccessions
         if ( !project.isEmpty() ) builder . add_option( "-d", project );
         if ( resolve_cache ) builder . add_option( "-c" );
         if ( print_path ) builder . add_option( "-P" );
+        if ( batch_count > 0 ) builder . add_option( "-b", batch_value );
 
         // srapath get perm and location
         if (!perm_file.isEmpty()) builder.add_option("--perm", perm_file);
@@ -0,0 +1,256 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/*)))
+ ///    Microbenchmark : FastFormatter against the former path, which
+ \\\    streamed each piece of a record separately through kout.
+ ///    Reads are synthetic, so it runs without NGS and klib.
+ \\\
+ ///    bench-formatter [ reads [ read-length [ fasta-width ] ] ]
+(((*/
+
+#include "formatter.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+using namespace ngs;
+
+/*))
+ // Discards output, but buffers like basic_koutbuf does
+((*/
+class NullBuf : public std :: streambuf {
+public :
+    NullBuf () : _M_buffer ( 4096 * 32 ), _M_total ( 0 )
+        { setp ( & _M_buffer [ 0 ], & _M_buffer [ 0 ] + _M_buffer . size () ); };
+
+    uint64_t total () { sync (); return _M_total; };
+
+protected :
+    int sync ()
+        {
+            _M_total += pptr () - pbase ();
+            setp ( & _M_buffer [ 0 ], & _M_buffer [ 0 ] + _M_buffer . size () );
+            return 0;
+        };
+
+    int_type overflow ( int_type C )
+        {
+            sync ();
+            if ( ! traits_type :: eq_int_type ( C, traits_type :: eof () ) ) {
+                * pptr () = traits_type :: to_char_type ( C );
+                pbump ( 1 );
+            }
+            return traits_type :: not_eof ( C );
+        };
+
+private :
+    std :: vector < char > _M_buffer;
+    uint64_t _M_total;
+};
+
+struct Read {
+    int64_t _M_spotId;
+    std :: string _M_name;
+    std :: string _M_bases;
+    std :: string _M_quals;
+};
+
+    /*) That is how dumpFastQ () was written before FastFormatter
+     (*/
+static
+void
+legacyFastQ ( std :: ostream & Out, const std :: string & CollectionName, const Read & R )
+{
+    Out << "@" << CollectionName << '.' << R . _M_spotId << ' ' << R . _M_name
+        << " length=" << R . _M_bases . size () << '\n';
+    Out << R . _M_bases << '\n';
+    Out << '+' << CollectionName << '.' << R . _M_spotId << ' ' << R . _M_name
+        << " length=" << R . _M_quals . size () << '\n';
+    Out << R . _M_quals << '\n';
+}
+
+    /*) That is how dumpFastA () was written before FastFormatter
+     (*/
+static
+void
+legacyFastA ( std :: ostream & Out, const std :: string & CollectionName, const Read & R, uint64_t Width )
+{
+    uint64_t __l = R . _M_bases . size ();
+
+    Out << '>' << CollectionName << '.' << R . _M_spotId << ' ' << R . _M_name
+        << " length=" << __l << '\n';
+
+    uint64_t __p = 0;
+    const char * __s = R . _M_bases . c_str ();
+
+    if ( 0 < Width ) {
+        while ( __p < __l ) {
+            uint64_t __t = std :: min ( Width, __l - __p );
+            Out << std :: string ( __s, ( std :: string :: size_type ) __p, ( std :: string :: size_type ) __t ) << "\n" ;
+            __p += __t;
+        }
+    }
+    else {
+        Out << __s << "\n" ;
+    }
+}
+
+static
+void
+makeReads ( std :: vector < Read > & Reads, size_t Count, size_t Length )
+{
+    static const char __acgt [] = "ACGT";
+    uint64_t __x = 88172645463325252ULL;
+
+    Reads . resize ( Count );
+    for ( size_t i = 0; i < Count; i ++ ) {
+        Read & R = Reads [ i ];
+        std :: ostringstream __n;
+        __n << "HWI-ST1234:8:1101:" << ( 1000 + i % 20000 ) << ':' << ( 2000 + i % 7919 );
+
+        R . _M_spotId = ( int64_t ) i + 1;
+        R . _M_name = __n . str ();
+        R . _M_bases . resize ( Length );
+        R . _M_quals . resize ( Length );
+        for ( size_t j = 0; j < Length; j ++ ) {
+            __x ^= __x << 13; __x ^= __x >> 7; __x ^= __x << 17;
+            R . _M_bases [ j ] = __acgt [ __x & 3 ];
+            R . _M_quals [ j ] = ( char ) ( 33 + 2 + ( __x >> 8 ) % 39 );
+        }
+    }
+}
+
+static
+double
+seconds ()
+{
+    struct timespec __t;
+    clock_gettime ( CLOCK_MONOTONIC, & __t );
+    return __t . tv_sec + __t . tv_nsec * 1e-9;
+}
+
+static
+void
+dumpLegacy ( std :: ostream & Out, const std :: string & Name, const std :: vector < Read > & Reads, bool Fasta, uint64_t Width )
+{
+    for ( size_t i = 0; i < Reads . size (); i ++ ) {
+        if ( Fasta ) {
+            legacyFastA ( Out, Name, Reads [ i ], Width );
+        }
+        else {
+            legacyFastQ ( Out, Name, Reads [ i ] );
+        }
+    }
+    Out . flush ();
+}
+
+static
+void
+dumpFormatter ( std :: ostream & Out, const std :: string & Name, const std :: vector < Read > & Reads, bool Fasta, uint64_t Width )
+{
+    FastFormatter __f ( Out, Name );
+    for ( size_t i = 0; i < Reads . size (); i ++ ) {
+        const Read & R = Reads [ i ];
+        if ( Fasta ) {
+            __f . fastA ( R . _M_spotId,
+                        R . _M_name . data (), R . _M_name . size (),
+                        R . _M_bases . data (), R . _M_bases . size (),
+                        Width );
+        }
+        else {
+            __f . fastQ ( R . _M_spotId,
+                        R . _M_name . data (), R . _M_name . size (),
+                        R . _M_bases . data (), R . _M_bases . size (),
+                        R . _M_quals . data (), R . _M_quals . size () );
+        }
+    }
+    __f . flush ();
+    Out . flush ();
+}
+
+int
+main ( int argc, char * argv [] )
+{
+    size_t __count = argc > 1 ? strtoul ( argv [ 1 ], NULL, 10 ) : 1000000;
+    size_t __length = argc > 2 ? strtoul ( argv [ 2 ], NULL, 10 ) : 150;
+    uint64_t __width = argc > 3 ? strtoul ( argv [ 3 ], NULL, 10 ) : 70;
+    const std :: string __name = "SRR0000001";
+
+    std :: vector < Read > __reads;
+    makeReads ( __reads, __count, __length );
+
+    std :: cout << "format\tpath\treads\tbytes\tseconds\tMB/s\n";
+
+    for ( int __fasta = 0; __fasta < 2; __fasta ++ ) {
+        const char * __format = __fasta ? "fasta" : "fastq";
+
+            /*) Both paths must produce identical output
+             (*/
+        {
+            std :: vector < Read > __some ( __reads . begin (), __reads . begin () + std :: min ( __reads . size (), ( size_t ) 10000 ) );
+            std :: ostringstream __a, __b;
+            dumpLegacy ( __a, __name, __some, __fasta != 0, __width );
+            dumpFormatter ( __b, __name, __some, __fasta != 0, __width );
+            if ( __a . str () != __b . str () ) {
+                std :: cerr << "ERROR: " << __format << " output differs\n";
+                return 1;
+            }
+        }
+
+        for ( int __path = 0; __path < 2; __path ++ ) {
+            NullBuf __buf;
+            std :: ostream __out ( & __buf );
+
+            double __start = seconds ();
+            if ( __path == 0 ) {
+                dumpLegacy ( __out, __name, __reads, __fasta != 0, __width );
+            }
+            else {
+                dumpFormatter ( __out, __name, __reads, __fasta != 0, __width );
+            }
+            double __elapsed = seconds () - __start;
+            uint64_t __bytes = __buf . total ();
+
+            std :: cout << __format << '\t'
+                        << ( __path == 0 ? "stream" : "formatter" ) << '\t'
+                        << __reads . size () << '\t'
+                        << __bytes << '\t'
+                        << __elapsed << '\t'
+                        << ( __bytes / 1e6 ) / __elapsed << '\n';
+        }
+    }
+
+    return 0;
+}
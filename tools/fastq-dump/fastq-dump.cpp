@@ -13,10 +13,18 @@
 
 #include <string.h>         /* strcmp () */
 
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+
+#include <sstream>
+#include <vector>
+
 #include <algorithm>
 
 #include "args.hpp"
 #include "filters.hpp"
+#include "formatter.hpp"
 
 #include "koutstream"
 
@@ -35,6 +43,8 @@ public :
     static const char * _sM_categoryName;
     static const char * _sM_fastaName;
     static const char * _sM_legacyReportName;
+    static const char * _sM_threadsName;
+    static const char * _sM_offsetName;
 
     static const int64_t _sM_minSpotIdDefValue = 1;
     static const int64_t _sM_maxSpotIdDefValue = 0;
@@ -70,6 +80,12 @@ public :
     inline bool legacyReport () const
                 { return _M_legacyReport; };
 
+    inline uint32_t threads () const
+                { return _M_threads; };
+
+    inline int qualityOffset () const
+                { return _M_offset; };
+
 protected :
     void __customInit ();
     void __customParse ();
@@ -86,6 +102,8 @@ private :
     ReadCategory _M_category;   /* -Y | --category */
     uint64_t _M_fasta;          /* -A | --fasta */
     bool _M_legacyReport;       /* -L | --legacy-report */
+    uint32_t _M_threads;        /* --threads <count> */
+    int _M_offset;              /* -Q | --offset <integer> */
 };
 
 /*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*/
@@ -99,6 +117,8 @@ const char * DumpArgs :: _sM_minReadLengthName = "minReadLength";
 const char * DumpArgs :: _sM_categoryName = "category";
 const char * DumpArgs :: _sM_fastaName = "fasta";
 const char * DumpArgs :: _sM_legacyReportName = "legacy-report";
+const char * DumpArgs :: _sM_threadsName = "threads";
+const char * DumpArgs :: _sM_offsetName = "offset";
 
 DumpArgs :: DumpArgs ()
 :   AArgs ()
@@ -109,6 +129,8 @@ DumpArgs :: DumpArgs ()
 ,   _M_category ( Read :: all )
 ,   _M_fasta ( 0 )
 ,   _M_legacyReport ( false )
+,   _M_threads ( 1 )
+,   _M_offset ( 33 )
 {
 }   /* DumpArgs :: DumpArgs () */
 
@@ -217,6 +239,33 @@ DumpArgs :: __customInit ()
 
         addOpt ( TheOpt );
     }
+
+    {
+        AOptDef TheOpt;
+
+        TheOpt . setName ( _sM_threadsName );
+        TheOpt . setParam ( "count" );
+        TheOpt . setNeedValue ( true );
+        TheOpt . setRequired ( false );
+        TheOpt . setHlp ( "Number of threads dumping chunks of spots, output keeps the spot order. Optional, default value 1, works with category <all> only" );
+        TheOpt . setMaxCount ( 1 );
+
+        addOpt ( TheOpt );
+    }
+
+    {
+        AOptDef TheOpt;
+
+        TheOpt . setName ( _sM_offsetName );
+        TheOpt . setAliases ( "Q" );
+        TheOpt . setParam ( "integer" );
+        TheOpt . setNeedValue ( true );
+        TheOpt . setRequired ( false );
+        TheOpt . setHlp ( "Offset to use for quality conversion. Accepts values from 33 to 64. Optional, default value 33" );
+        TheOpt . setMaxCount ( 1 );
+
+        addOpt ( TheOpt );
+    }
 }   /* DumpArgs :: __customInit () */
 
 void
@@ -229,6 +278,8 @@ DumpArgs :: __customDispose ()
     _M_category = Read :: all;
     _M_fasta = 0;
     _M_legacyReport = false;
+    _M_threads = 1;
+    _M_offset = 33;
 }   /* DumpArgs :: __customDispose () */
 
 void
@@ -352,6 +403,36 @@ DumpArgs :: __customParse ()
 
     _M_legacyReport = optVal ( _sM_legacyReportName ) . exist ();
 
+    _M_threads = 1;
+    optV = optVal ( _sM_threadsName );
+    if ( optV . exist () ) {
+        if ( optV . valCount () != 1 ) {
+            throw ErrorMsg ( String ( "__custromParse: ERROR: Too many \"" ) + _sM_threadsName + "\" values");
+        }
+
+        uint64_t __t = optV . uint64Val ();
+        if ( __t == 0 || 256 < __t ) {
+            throw ErrorMsg ( String ( "__customParse: ERROR: Invalid value for option \"" ) + _sM_threadsName + "\"" );
+        }
+
+        _M_threads = ( uint32_t ) __t;
+    }
+
+    _M_offset = 33;
+    optV = optVal ( _sM_offsetName );
+    if ( optV . exist () ) {
+        if ( optV . valCount () != 1 ) {
+            throw ErrorMsg ( String ( "__custromParse: ERROR: Too many \"" ) + _sM_offsetName + "\" values");
+        }
+
+        int64_t __o = optV . int64Val ();
+        if ( __o < 33 || 64 < __o ) {
+            throw ErrorMsg ( String ( "__customParse: ERROR: Invalid value for option \"" ) + _sM_offsetName + "\"" );
+        }
+
+        _M_offset = ( int ) __o;
+    }
+
 }   /* DumpArgs :: __customParse () */
 
 }; /* namespace ngs */
@@ -478,8 +559,8 @@ setupFilters ( AFilters & Filters, const DumpArgs & TheArgs )
 static
 void
 dumpFastQ (
+        FastFormatter & Out,
         int64_t SpotId,
-        const ngs :: String & CollectionName,
         const ReadIterator & Iterator
 )
 {
@@ -489,50 +570,22 @@ dumpFastQ (
     StringRef Bases = Iterator . getReadBases ();
     StringRef Qualities = Iterator . getReadQualities ();
 
-        /*)  First, we are doint base header
-         (*/
-    kout << "@"
-        << CollectionName
-        << '.'
-        << SpotId
-        << ' '
-        << ReadName
-        << " length="
-        << Bases . size ()
-        << '\n'
-        ;
-
-        /*)  Second is going base itsefl
-         (*/
-    kout << Bases
-        << '\n'
-        ;
-
-        /*)  Third, header for qualities
-         (*/
-    kout << '+'
-        << CollectionName
-        << '.'
-        << SpotId
-        << ' '
-        << ReadName
-        << " length="
-        << Qualities . size ()
-        << '\n'
-        ;
-
-        /*)  Finally there are qualities
-         (*/
-    kout << Qualities
-        << '\n'
-        ;
+        /*)  Deflines, bases and qualities go straight into the
+         (   buffer of formatter
+         */
+    Out . fastQ (
+                SpotId,
+                ReadName . data (), ReadName . size (),
+                Bases . data (), Bases . size (),
+                Qualities . data (), Qualities . size ()
+                );
 }   /* dumpFastQ () */
 
 static
 void
 dumpFastA (
+        FastFormatter & Out,
         int64_t SpotId,
-        const ngs :: String & CollectionName,
         const ReadIterator & Iterator,
         uint64_t Width
 )
@@ -542,42 +595,339 @@ dumpFastA (
     StringRef ReadName = Iterator . getReadName ();
     StringRef Bases = Iterator . getReadBases ();
 
-    uint64_t __l = Bases . size ();
+    Out . fastA (
+                SpotId,
+                ReadName . data (), ReadName . size (),
+                Bases . data (), Bases . size (),
+                Width
+                );
+}   /* dumpFastA () */
 
-        /*)  First, we are doing base header
-         (*/
-    kout << '>'
-        << CollectionName
-        << '.'
-        << SpotId
-        << ' '
-        << ReadName
-        << " length="
-        << __l
-        << '\n'
-        ;
-
-        /*)  Second is going base itself by width
-         (*/
+static
+void
+dumpRead (
+        FastFormatter & Out,
+        int64_t SpotId,
+        const ReadIterator & Iterator,
+        const DumpArgs & TheArgs
+)
+{
+    if ( TheArgs . fastaDump () ) {
+        dumpFastA ( Out, SpotId, Iterator, TheArgs . fastaDumpWidth () );
+    }
+    else { 
+        dumpFastQ ( Out, SpotId, Iterator );
+    }
+}   /* dumpRead () */
 
-    uint64_t __p = 0;
-    const char * __s = Bases . data ();
+/*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*/
+/* Multithreaded dumping                                         */
+/*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*/
 
+/*))
+ //     The spot range is cut into chunks. Each worker opens its own
+ //     ReadCollection, takes the next chunk, and dumps it through its
+ //     own read iterator and AFilters into a string. The main thread
+ //     writes the chunks to kout in spot order.
+((*/
+class DumpChunks {
+public :
+    DumpChunks (
+                const DumpArgs & TheArgs,
+                int64_t MinSpot,
+                int64_t MaxSpot
+                );
+    ~DumpChunks ();
+
+        /* Runs workers, writes chunks, and merges the workers'
+         * filters into 'Filters'
+         */
+    void run ( uint32_t Threads, AFilters & Filters );
+
+private :
+    struct Chunk {
+        int64_t _M_first;       /* first spot of chunk */
+        uint64_t _M_count;      /* amount of spots in chunk */
+        String _M_output;
+        String _M_error;
+        bool _M_done;
+    };
+
+    static rc_t CC __worker ( const KThread * Self, void * Data );
+    void __work ();
+    void __dump ( ReadCollection & RCol, const String & Name, Chunk & TheChunk, AFilters & Filters );
+    Chunk * __next ();
+    void __done ( Chunk & TheChunk );
+    void __abort ();
+    void __write ();
+
+private :
+        /* 64K spots makes about 20M of FASTQ for short reads,
+         * workers stay not more than two chunks each ahead of kout
+         */
+    static const uint64_t _cM_chunkSize = 65536;
+
+    const DumpArgs & _M_args;
+    std :: vector < Chunk > _M_chunks;
+    size_t _M_nextChunk;
+    size_t _M_nextWrite;
+    size_t _M_maxAhead;
+    bool _M_abort;
+
+    AFilters * _M_filters;
+
+    KLock * _M_lock;
+    KCondition * _M_chunkDone;
+    KCondition * _M_chunkWritten;
+};  /* class DumpChunks */
+
+const uint64_t DumpChunks :: _cM_chunkSize;
+
+DumpChunks :: DumpChunks (
+                        const DumpArgs & TheArgs,
+                        int64_t MinSpot,
+                        int64_t MaxSpot
+)
+:   _M_args ( TheArgs )
+,   _M_chunks ()
+,   _M_nextChunk ( 0 )
+,   _M_nextWrite ( 0 )
+,   _M_maxAhead ( 0 )
+,   _M_abort ( false )
+,   _M_filters ( NULL )
+,   _M_lock ( NULL )
+,   _M_chunkDone ( NULL )
+,   _M_chunkWritten ( NULL )
+{
+    for ( int64_t __f = MinSpot; __f <= MaxSpot; __f += _cM_chunkSize ) {
+        Chunk __c;
+        __c . _M_first = __f;
+        __c . _M_count = std :: min ( _cM_chunkSize, ( uint64_t ) ( MaxSpot - __f + 1 ) );
+        __c . _M_done = false;
+        _M_chunks . push_back ( __c );
+    }
 
-    if ( 0 < Width ) {
-        while ( __p < __l ) {
-            uint64_t __t = std :: min ( Width, __l - __p );
+    if ( KLockMake ( & _M_lock ) != 0
+        || KConditionMake ( & _M_chunkDone ) != 0
+        || KConditionMake ( & _M_chunkWritten ) != 0
+    ) {
+        throw ErrorMsg ( "DumpChunks: can not make lock or condition" );
+    }
+}   /* DumpChunks :: DumpChunks () */
 
-            kout << std :: string ( __s, ( std :: string :: size_type ) __p, ( std :: string :: size_type ) __t ) << "\n" ;
+DumpChunks :: ~DumpChunks ()
+{
+    if ( _M_chunkWritten != NULL ) {
+        KConditionRelease ( _M_chunkWritten );
+    }
+    if ( _M_chunkDone != NULL ) {
+        KConditionRelease ( _M_chunkDone );
+    }
+    if ( _M_lock != NULL ) {
+        KLockRelease ( _M_lock );
+    }
+}   /* DumpChunks :: ~DumpChunks () */
 
-            __p += __t;
+void
+DumpChunks :: run ( uint32_t Threads, AFilters & Filters )
+{
+    _M_filters = & Filters;
+    _M_maxAhead = Threads * 2;
+
+    std :: vector < KThread * > __workers;
+    for ( uint32_t __i = 0; __i < Threads; __i ++ ) {
+        KThread * __t = NULL;
+        if ( KThreadMake ( & __t, __worker, this ) != 0 ) {
+            break;
         }
+        __workers . push_back ( __t );
+    }
+
+    String __error;
+    if ( __workers . empty () ) {
+        __error = "DumpChunks: can not start threads";
     }
     else {
-        kout << __s << "\n" ;
+        try {
+            __write ();
+        }
+        catch ( std :: exception & E ) {
+            __error = E . what ();
+        }
+        catch ( ... ) {
+            __error = "DumpChunks: can not write chunk";
+        }
     }
 
-}   /* dumpFastA () */
+    if ( ! __error . empty () ) {
+        __abort ();
+    }
+
+    for ( size_t __i = 0; __i < __workers . size (); __i ++ ) {
+        rc_t __s;
+        KThreadWait ( __workers [ __i ], & __s );
+        KThreadRelease ( __workers [ __i ] );
+    }
+
+    if ( ! __error . empty () ) {
+        throw ErrorMsg ( __error );
+    }
+}   /* DumpChunks :: run () */
+
+rc_t CC
+DumpChunks :: __worker ( const KThread * Self, void * Data )
+{
+    ( ( DumpChunks * ) Data ) -> __work ();
+
+    return 0;
+}   /* DumpChunks :: __worker () */
+
+void
+DumpChunks :: __work ()
+{
+    AFilters __filters ( _M_args . accession () );
+    setupFilters ( __filters, _M_args );
+
+    try {
+        ngs :: String __acc ( _M_args . accession () . c_str () );
+        ReadCollection __rcol = ncbi :: NGS :: openReadCollection ( __acc );
+        ngs :: String __name = __rcol . getName ();
+
+        for ( Chunk * __c = __next (); __c != NULL; __c = __next () ) {
+            try {
+                __dump ( __rcol, __name, * __c, __filters );
+            }
+            catch ( std :: exception & E ) {
+                __c -> _M_error = E . what ();
+            }
+            catch ( ... ) {
+                __c -> _M_error = "UNKNOWN exception while dumping chunk";
+            }
+
+            __done ( * __c );
+        }
+    }
+    catch ( ... ) {
+            /*) Can not open collection: nothing is taken, so the
+             (  main thread will not wait for this worker
+             */
+        __abort ();
+    }
+
+    KLockAcquire ( _M_lock );
+    _M_filters -> merge ( __filters );
+    KLockUnlock ( _M_lock );
+}   /* DumpChunks :: __work () */
+
+void
+DumpChunks :: __dump (
+                    ReadCollection & RCol,
+                    const String & Name,
+                    Chunk & TheChunk,
+                    AFilters & Filters
+)
+{
+    std :: ostringstream __out;
+    FastFormatter __formatter ( __out, Name );
+    __formatter . setQualityOffset ( _M_args . qualityOffset () );
+
+    ReadIterator Iterator = RCol . getReadRange (
+                                            TheChunk . _M_first,
+                                            TheChunk . _M_count,
+                                            Read :: all
+                                            );
+
+        /*) Spot ids are numbered from '--minSpotId' like serial
+         (  dumping does
+         */
+    int64_t llp = _M_args . minSpotId ()
+                + ( TheChunk . _M_first - _M_chunks [ 0 ] . _M_first );
+
+    for ( ; Iterator . nextRead (); llp ++ ) {
+        if ( Filters . checkIt ( Iterator ) ) {
+            dumpRead ( __formatter, llp, Iterator, _M_args );
+        }
+    }
+
+    __formatter . flush ();
+    TheChunk . _M_output = __out . str ();
+}   /* DumpChunks :: __dump () */
+
+DumpChunks :: Chunk *
+DumpChunks :: __next ()
+{
+    Chunk * __c = NULL;
+
+    KLockAcquire ( _M_lock );
+
+    while ( ! _M_abort
+            && _M_nextChunk < _M_chunks . size ()
+            && _M_nextWrite + _M_maxAhead <= _M_nextChunk
+    ) {
+        KConditionWait ( _M_chunkWritten, _M_lock );
+    }
+
+    if ( ! _M_abort && _M_nextChunk < _M_chunks . size () ) {
+        __c = & _M_chunks [ _M_nextChunk ++ ];
+    }
+
+    KLockUnlock ( _M_lock );
+
+    return __c;
+}   /* DumpChunks :: __next () */
+
+void
+DumpChunks :: __done ( Chunk & TheChunk )
+{
+    KLockAcquire ( _M_lock );
+
+    TheChunk . _M_done = true;
+    KConditionBroadcast ( _M_chunkDone );
+
+    KLockUnlock ( _M_lock );
+}   /* DumpChunks :: __done () */
+
+void
+DumpChunks :: __abort ()
+{
+    KLockAcquire ( _M_lock );
+
+    _M_abort = true;
+    KConditionBroadcast ( _M_chunkWritten );
+    KConditionBroadcast ( _M_chunkDone );
+
+    KLockUnlock ( _M_lock );
+}   /* DumpChunks :: __abort () */
+
+void
+DumpChunks :: __write ()
+{
+    for ( size_t __i = 0; __i < _M_chunks . size (); __i ++ ) {
+        Chunk & __c = _M_chunks [ __i ];
+
+        KLockAcquire ( _M_lock );
+        while ( ! __c . _M_done && ! ( _M_abort && _M_nextChunk <= __i ) ) {
+            KConditionWait ( _M_chunkDone, _M_lock );
+        }
+        KLockUnlock ( _M_lock );
+
+        if ( ! __c . _M_done ) {
+            throw ErrorMsg ( "DumpChunks: can not open read collection" );
+        }
+
+        if ( ! __c . _M_error . empty () ) {
+            throw ErrorMsg ( __c . _M_error );
+        }
+
+        kout << __c . _M_output;
+        String () . swap ( __c . _M_output );
+
+        KLockAcquire ( _M_lock );
+        _M_nextWrite = __i + 1;
+        KConditionBroadcast ( _M_chunkWritten );
+        KLockUnlock ( _M_lock );
+    }
+}   /* DumpChunks :: __write () */
 
 /*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*/
 /*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*_*/
@@ -610,27 +960,36 @@ run ( const DumpArgs & TheArgs )
         maxSpot = Id;
     }
 
-    ReadIterator Iterator = RCol.getReadRange (
-                                            minSpot,
-                                            maxSpot - minSpot + 1,
-                                            TheArgs . category ()
-                                            );
-
-    ngs :: String ReadCollectionName = RCol.getName ();
-
     AFilters Filters ( TheArgs . accession () );
     setupFilters ( Filters, TheArgs );
 
-    for ( int64_t llp = TheArgs . minSpotId () ; Iterator.nextRead (); llp ++ ) {
+        /*) With categories other than <all> the spot numbers depend
+         (  on the amount of reads passed before, so it stays serial
+         */
+    if ( 1 < TheArgs . threads () && TheArgs . category () == Read :: all ) {
+        DumpChunks Chunks ( TheArgs, minSpot, maxSpot );
+        Chunks . run ( TheArgs . threads (), Filters );
+    }
+    else {
+        ReadIterator Iterator = RCol.getReadRange (
+                                                minSpot,
+                                                maxSpot - minSpot + 1,
+                                                TheArgs . category ()
+                                                );
 
-        if ( Filters . checkIt ( Iterator ) ) {
-            if ( TheArgs . fastaDump () ) {
-                dumpFastA ( llp, ReadCollectionName, Iterator, TheArgs . fastaDumpWidth () );
-            }
-            else { 
-                dumpFastQ ( llp, ReadCollectionName, Iterator );
+        ngs :: String ReadCollectionName = RCol.getName ();
+
+        FastFormatter Formatter ( kout, ReadCollectionName );
+        Formatter . setQualityOffset ( TheArgs . qualityOffset () );
+
+        for ( int64_t llp = TheArgs . minSpotId () ; Iterator.nextRead (); llp ++ ) {
+
+            if ( Filters . checkIt ( Iterator ) ) {
+                dumpRead ( Formatter, llp, Iterator, TheArgs );
             }
         }
+
+        Formatter . flush ();
     }
 
     kout.flush ();
@@ -639,3 +998,4 @@ run ( const DumpArgs & TheArgs )
 
 }   /* run () */
 
+
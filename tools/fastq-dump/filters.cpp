@@ -273,6 +273,22 @@ AFilters :: addLengthFilter ( uint64_t minLength )
     addFilter ( new __SpotLengthFilter ( minLength ) );
 }   /* AFilters :: addLengthFilter () */
 
+void
+AFilters :: merge ( const AFilters & other )
+{
+    if ( _M_filters . size () != other . _M_filters . size () ) {
+        throw ErrorMsg ( ":: merge() - filters are set up differently" );
+    }
+
+    for ( size_t __i = 0; __i < _M_filters . size (); __i ++ ) {
+        if ( _M_filters [ __i ] != NULL && other . _M_filters [ __i ] != NULL ) {
+            _M_filters [ __i ] -> merge ( * other . _M_filters [ __i ] );
+        }
+    }
+
+    _M_confirmed += other . _M_confirmed;
+}   /* AFilters :: merge () */
+
 String
 AFilters :: report ( bool legacyStyle ) const
 {
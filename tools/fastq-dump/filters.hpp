@@ -54,6 +54,12 @@ public :
 
     virtual String report () const;
 
+        /* Adds the counters of the same filter, which was used
+         * by another thread
+         */
+    inline void merge ( const AFilter & other )
+                { _M_rejected += other . _M_rejected; };
+
 protected :
         /* That method should be called from 'checkIt()' for stat
          */
@@ -93,6 +99,11 @@ public :
 
     String report ( bool legacyStyle = false ) const;
 
+        /* Adds the counters of filters set up the same way,
+         * which were used by another thread
+         */
+    void merge ( const AFilters & other );
+
 private :
     void init ();
     void dispose ();
@@ -0,0 +1,226 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "formatter.hpp"
+
+#include <string.h>         /* memcpy () */
+
+/*)))   Namespace
+ (((*/
+namespace ngs {
+
+const size_t FastFormatter :: _cM_defaultBufferSize;
+const size_t FastFormatter :: _cM_deflineSlack;
+
+FastFormatter :: FastFormatter (
+                            std :: ostream & Out,
+                            const std :: string & CollectionName,
+                            size_t BufferSize
+)
+:   _M_out ( Out )
+,   _M_name ( CollectionName )
+,   _M_buffer ( BufferSize == 0 ? _cM_defaultBufferSize : BufferSize )
+,   _M_used ( 0 )
+,   _M_qualityDelta ( 0 )
+{
+}   /* FastFormatter :: FastFormatter () */
+
+FastFormatter :: ~FastFormatter ()
+{
+    try {
+        flush ();
+    }
+    catch ( ... ) {
+        /* Ha! */
+    }
+}   /* FastFormatter :: ~FastFormatter () */
+
+void
+FastFormatter :: setQualityOffset ( int Offset )
+{
+    _M_qualityDelta = Offset - 33;
+}   /* FastFormatter :: setQualityOffset () */
+
+void
+FastFormatter :: flush ()
+{
+    if ( _M_used != 0 ) {
+        _M_out . write ( & _M_buffer [ 0 ], _M_used );
+        _M_used = 0;
+    }
+}   /* FastFormatter :: flush () */
+
+char *
+FastFormatter :: __reserve ( size_t Size )
+{
+    if ( _M_buffer . size () - _M_used < Size ) {
+        flush ();
+
+        if ( _M_buffer . size () < Size ) {
+            _M_buffer . resize ( Size );
+        }
+    }
+
+    return & _M_buffer [ _M_used ];
+}   /* FastFormatter :: __reserve () */
+
+char *
+FastFormatter :: __number ( char * To, uint64_t Value )
+{
+    char __d [ 24 ];
+    size_t __n = 0;
+
+    do {
+        __d [ __n ++ ] = ( char ) ( '0' + Value % 10 );
+        Value /= 10;
+    } while ( Value != 0 );
+
+    while ( __n != 0 ) {
+        * To ++ = __d [ -- __n ];
+    }
+
+    return To;
+}   /* FastFormatter :: __number () */
+
+    /*) Writes "<Mark><Collection>.<SpotId> <Name> length=<Length>\n"
+     (*/
+char *
+FastFormatter :: __defline (
+                        char * To,
+                        char Mark,
+                        int64_t SpotId,
+                        const char * Name, size_t NameLen,
+                        uint64_t Length
+) const
+{
+    * To ++ = Mark;
+
+    memcpy ( To, _M_name . data (), _M_name . size () );
+    To += _M_name . size ();
+
+    * To ++ = '.';
+    if ( SpotId < 0 ) {
+        * To ++ = '-';
+        To = __number ( To, ( uint64_t ) ( - ( SpotId + 1 ) ) + 1 );
+    }
+    else {
+        To = __number ( To, ( uint64_t ) SpotId );
+    }
+
+    * To ++ = ' ';
+    memcpy ( To, Name, NameLen );
+    To += NameLen;
+
+    memcpy ( To, " length=", 8 );
+    To += 8;
+    To = __number ( To, Length );
+
+    * To ++ = '\n';
+
+    return To;
+}   /* FastFormatter :: __defline () */
+
+void
+FastFormatter :: fastQ (
+                    int64_t SpotId,
+                    const char * Name, size_t NameLen,
+                    const char * Bases, size_t BasesLen,
+                    const char * Quals, size_t QualsLen
+)
+{
+    size_t __need = 2 * ( _M_name . size () + NameLen + _cM_deflineSlack )
+                  + BasesLen + QualsLen + 2;
+
+    char * __b = __reserve ( __need );
+    char * __p = __b;
+
+    __p = __defline ( __p, '@', SpotId, Name, NameLen, BasesLen );
+
+    memcpy ( __p, Bases, BasesLen );
+    __p += BasesLen;
+    * __p ++ = '\n';
+
+    __p = __defline ( __p, '+', SpotId, Name, NameLen, QualsLen );
+
+    if ( _M_qualityDelta == 0 ) {
+        memcpy ( __p, Quals, QualsLen );
+        __p += QualsLen;
+    }
+    else {
+        for ( size_t __i = 0; __i < QualsLen; __i ++ ) {
+            * __p ++ = ( char ) ( Quals [ __i ] + _M_qualityDelta );
+        }
+    }
+    * __p ++ = '\n';
+
+    _M_used += __p - __b;
+}   /* FastFormatter :: fastQ () */
+
+void
+FastFormatter :: fastA (
+                    int64_t SpotId,
+                    const char * Name, size_t NameLen,
+                    const char * Bases, size_t BasesLen,
+                    uint64_t Width
+)
+{
+    size_t __lines = 1;
+    if ( 0 < Width ) {
+        __lines = ( size_t ) ( ( BasesLen + Width - 1 ) / Width );
+    }
+
+    size_t __need = _M_name . size () + NameLen + _cM_deflineSlack
+                  + BasesLen + __lines;
+
+    char * __b = __reserve ( __need );
+    char * __p = __b;
+
+    __p = __defline ( __p, '>', SpotId, Name, NameLen, BasesLen );
+
+    if ( 0 < Width ) {
+        for ( size_t __o = 0; __o < BasesLen; __o += ( size_t ) Width ) {
+            size_t __t = BasesLen - __o;
+            if ( Width < __t ) {
+                __t = ( size_t ) Width;
+            }
+
+            memcpy ( __p, Bases + __o, __t );
+            __p += __t;
+            * __p ++ = '\n';
+        }
+    }
+    else {
+        memcpy ( __p, Bases, BasesLen );
+        __p += BasesLen;
+        * __p ++ = '\n';
+    }
+
+    _M_used += __p - __b;
+}   /* FastFormatter :: fastA () */
+
+/*)))   Namespace
+ (((*/
+}; /* namespace ngs */
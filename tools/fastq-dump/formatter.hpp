@@ -0,0 +1,107 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_outpost_formatter_
+#define _h_outpost_formatter_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+/*)))   Namespace
+ (((*/
+namespace ngs {
+
+/*))
+ // Formats FASTQ/FASTA records straight into a large reusable buffer,
+ // which is written to the stream in big chunks. No temporaries are
+ // created per record. It does not depend on NGS or klib, so the
+ // microbenchmark ( bench-formatter.cpp ) can use it standalone.
+((*/
+class FastFormatter {
+public :
+    FastFormatter (
+                std :: ostream & Out,
+                const std :: string & CollectionName,
+                size_t BufferSize = _cM_defaultBufferSize
+                );
+    ~FastFormatter ();
+
+        /* Qualities come as Phred+33 ASCII, other offsets are
+         * converted while copying
+         */
+    void setQualityOffset ( int Offset );
+
+    void fastQ (
+                int64_t SpotId,
+                const char * Name, size_t NameLen,
+                const char * Bases, size_t BasesLen,
+                const char * Quals, size_t QualsLen
+                );
+
+        /* Width 0 means no line wrapping
+         */
+    void fastA (
+                int64_t SpotId,
+                const char * Name, size_t NameLen,
+                const char * Bases, size_t BasesLen,
+                uint64_t Width
+                );
+
+    void flush ();
+
+private :
+    static const size_t _cM_defaultBufferSize = 4 * 1024 * 1024;
+
+        /* Longest text for the numbers and fixed parts of a defline
+         */
+    static const size_t _cM_deflineSlack = 64;
+
+    char * __reserve ( size_t Size );
+    char * __defline (
+                    char * To,
+                    char Mark,
+                    int64_t SpotId,
+                    const char * Name, size_t NameLen,
+                    uint64_t Length
+                    ) const;
+    static char * __number ( char * To, uint64_t Value );
+
+private :
+    std :: ostream & _M_out;
+    std :: string _M_name;
+    std :: vector < char > _M_buffer;
+    size_t _M_used;
+    int _M_qualityDelta;
+};  /* class FastFormatter */
+
+/*)))   Namespace
+ (((*/
+}; /* namespace ngs */
+
+#endif /* _h_outpost_formatter_ */
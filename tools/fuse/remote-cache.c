@@ -37,6 +37,8 @@
 #include <kfs/file.h>
 #include <kfs/cacheteefile.h>
 #include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/thread.h>
 #include <vfs/path.h>
 #include <vfs/manager.h>
 #include <kapp/main.h>
@@ -51,6 +53,10 @@
 
 #include "log.h"
 
+typedef struct _PfSrcFile _PfSrcFile;
+#define KFILE_IMPL _PfSrcFile
+#include <kfs/impl.h>
+
 /*)))
  /// Some unusual macroses
 (((*/
@@ -261,9 +267,25 @@ struct _CnPool {
     size_t max_qty;
 };
 
+/*))
+ //  Cache index and connection pools are split into shards by Url
+ \\  hash, so lookups and connection bookkeeping for different files
+ //  do not wait on each other.
+((*/
+#define _CACHE_SHARD_QTY 16
+
+struct _RcShard {
+    BSTree tree;
+    KLock * mutabor;
+
+    struct _CnPool pool;
+};
+
 struct RCacheEntry {
     BSTNode AsIs;
 
+    struct _RcShard * shard;
+
     KRefcount refcount;
     KLock * mutabor;
 
@@ -278,12 +300,24 @@ struct RCacheEntry {
 
     const struct KFile * file;
 
+        /*) Source of cachetee file, prefetched blocks are handed
+         (  over through it. NULL for local file and in diskless mode
+         (*/
+    struct _PfSrcFile * src;
+
     struct _CnEnt * cn_entry;
+
+        /*) Sequential read detection and prefetch window, guarded
+         (  by mutabor
+         (*/
+    uint64_t seq_end;
+    uint32_t seq_qty;
+    uint64_t prefetch_end;
 };
 
 // static const size_t _sConPoolMaxQty = 1024;
 static const size_t _sConPoolMaxQty = 512;
-static struct _CnPool _sConPool;
+static struct _RcShard _sShards [ _CACHE_SHARD_QTY ];
 
 rc_t CC RCacheEntryAddRef ( struct RCacheEntry * self );
 rc_t CC RCacheEntryRelease ( struct RCacheEntry * self );
@@ -351,41 +385,47 @@ _CnEntDispose ( struct RCacheEntry * Entry )
 
 static
 rc_t CC
-_CnPoolWhack ()
+_CnPoolWhack ( struct _CnPool * Pool )
 {
-    if ( _sConPool . mutabor != NULL ) {
+    if ( Pool -> mutabor != NULL ) {
 /*
-RmOutMsg ( "[KLockRelease] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE__ );
+RmOutMsg ( "[KLockRelease] [%p] [ %d]\n", ( void * ) Pool -> mutabor, __LINE__ );
 */
-        KLockRelease ( _sConPool . mutabor );
-        _sConPool . mutabor = NULL;
+        KLockRelease ( Pool -> mutabor );
+        Pool -> mutabor = NULL;
     }
 
-    _sConPool . head = NULL;
-    _sConPool . tail = NULL;
-    _sConPool . qty = 0;
-    _sConPool . max_qty = _sConPoolMaxQty;
+    Pool -> head = NULL;
+    Pool -> tail = NULL;
+    Pool -> qty = 0;
+    Pool -> max_qty = _sConPoolMaxQty / _CACHE_SHARD_QTY;
 
     return 0;
 }   /* _CnPoolWhack () */
 
+    /*) MaxQty is for all shards together
+     (*/
 static
 rc_t CC
-_CnPoolInit ( size_t MaxQty )
+_CnPoolInit ( struct _CnPool * Pool, size_t MaxQty )
 {
     rc_t RCt;
 
     RCt = 0;
 
-    RCt = KLockMake ( & ( _sConPool . mutabor ) );
+    RCt = KLockMake ( & ( Pool -> mutabor ) );
 /*
-RmOutMsg ( "[KLockMake] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE__ );
+RmOutMsg ( "[KLockMake] [%p] [ %d]\n", ( void * ) Pool -> mutabor, __LINE__ );
 */
     if ( RCt == 0 ) {
-        _sConPool . head = NULL;
-        _sConPool . tail = NULL;
-        _sConPool . qty = 0;
-        _sConPool . max_qty = MaxQty == 0 ? _sConPoolMaxQty : MaxQty;
+        Pool -> head = NULL;
+        Pool -> tail = NULL;
+        Pool -> qty = 0;
+        Pool -> max_qty = ( MaxQty == 0 ? _sConPoolMaxQty : MaxQty )
+                                                    / _CACHE_SHARD_QTY;
+        if ( Pool -> max_qty == 0 ) {
+            Pool -> max_qty = 1;
+        }
     }
 
     return RCt;
@@ -396,12 +436,12 @@ RmOutMsg ( "[KLockMake] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE__
   |\     I made that comment to show that DLList is not used for
   |/     purpose
   |\*/
-static rc_t CC _CnPoolToFront_NoLock ( struct _CnEnt * entry );
-static rc_t CC _CnPoolDrop_NoLock ( struct _CnEnt * entry );
-static rc_t CC _CnPoolPrune_NoLock ( size_t PruneS );
+static rc_t CC _CnPoolToFront_NoLock ( struct _CnPool * Pool, struct _CnEnt * entry );
+static rc_t CC _CnPoolDrop_NoLock ( struct _CnPool * Pool, struct _CnEnt * entry );
+static rc_t CC _CnPoolPrune_NoLock ( struct _CnPool * Pool, size_t PruneS );
 
 rc_t CC
-_CnPoolToFront_NoLock ( struct _CnEnt * Entry )
+_CnPoolToFront_NoLock ( struct _CnPool * Pool, struct _CnEnt * Entry )
 {
     rc_t RCt = 0;
 
@@ -409,7 +449,7 @@ _CnPoolToFront_NoLock ( struct _CnEnt * Entry )
         return RC ( rcExe, rcData, rcInserting, rcParam, rcNull );
     }
 
-    if ( Entry == _sConPool . head ) {
+    if ( Entry == Pool -> head ) {
         return 0;
     }
 
@@ -418,22 +458,22 @@ RmOutMsg ( "[_CnPoolToFront_ ] [%p] [ %d]\n", Entry, __LINE__ );
 */
 
         /* First we should drop Entry without disconnecting */
-    RCt = _CnPoolDrop_NoLock ( Entry );
+    RCt = _CnPoolDrop_NoLock ( Pool, Entry );
     if ( RCt == 0 ) {
             /* Second we should Prune old connections */
-        RCt = _CnPoolPrune_NoLock ( 1 );
+        RCt = _CnPoolPrune_NoLock ( Pool, 1 );
         if ( RCt == 0 ) {
                 /* Second we should put Entry at front */
-            if ( _sConPool . head != NULL ) {
-                Entry -> next = _sConPool . head;
+            if ( Pool -> head != NULL ) {
+                Entry -> next = Pool -> head;
                 Entry -> next -> prev = Entry;
-                _sConPool . head = Entry;
+                Pool -> head = Entry;
             }
             else {
-                _sConPool . tail = Entry;
+                Pool -> tail = Entry;
             }
-            _sConPool . head  = Entry;
-            _sConPool . qty ++;
+            Pool -> head  = Entry;
+            Pool -> qty ++;
         }
     }
 
@@ -448,17 +488,19 @@ _CnPoolToFront ( struct RCacheEntry * Entry )
 
     if ( Entry != NULL ) {
         if ( Entry -> cn_entry != NULL ) {
+            struct _CnPool * Pool = & ( Entry -> shard -> pool );
+
 /*
-RmOutMsg ( "[KLockAcquire] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE__ );
+RmOutMsg ( "[KLockAcquire] [%p] [ %d]\n", ( void * ) Pool -> mutabor, __LINE__ );
 */
-            RCt = KLockAcquire ( _sConPool . mutabor );
+            RCt = KLockAcquire ( Pool -> mutabor );
             if ( RCt == 0 ) {
-                RCt = _CnPoolToFront_NoLock ( Entry -> cn_entry );
+                RCt = _CnPoolToFront_NoLock ( Pool, Entry -> cn_entry );
 
 /*
-RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE__ );
+RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) Pool -> mutabor, __LINE__ );
 */
-                KLockUnlock ( _sConPool . mutabor );
+                KLockUnlock ( Pool -> mutabor );
             }
         }
     }
@@ -467,7 +509,7 @@ RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE_
 }   /* _CnPoolToFront () */
 
 rc_t CC
-_CnPoolDrop_NoLock ( struct _CnEnt * Entry )
+_CnPoolDrop_NoLock ( struct _CnPool * Pool, struct _CnEnt * Entry )
 {
     rc_t RCt;
 
@@ -484,42 +526,42 @@ RmOutMsg ( "[_CnPoolDrop_] [%p] [ %d]\n", Entry, __LINE__ );
     if ( Entry -> next == NULL &&  Entry -> prev == NULL ) {
             /* Entry is the only member in pool
              */
-        if ( _sConPool . head == Entry ) {
-            _sConPool . head = _sConPool . tail = NULL;
-            _sConPool . qty = 0;
+        if ( Pool -> head == Entry ) {
+            Pool -> head = Pool -> tail = NULL;
+            Pool -> qty = 0;
         } 
     }
     else {
         if ( Entry -> prev == NULL ) {
                 /* Entry is at the head of pool
                  */
-            if ( _sConPool . head != Entry ) {
+            if ( Pool -> head != Entry ) {
                 return RC ( rcExe, rcData, rcRemoving, rcParam, rcInvalid );
             }
 
             if ( Entry -> next != NULL ) {
                 Entry -> next -> prev = NULL;
-                _sConPool . head = Entry -> next;
+                Pool -> head = Entry -> next;
             }
             else {
-                _sConPool . head = _sConPool . tail = NULL;
+                Pool -> head = Pool -> tail = NULL;
             }
         }
         else {
             if ( Entry -> next == NULL ) {
                     /* Entry is at the tail of pool
                      */
-                if ( _sConPool . tail != Entry ) {
+                if ( Pool -> tail != Entry ) {
                     return RC ( rcExe, rcData, rcRemoving, rcParam, rcInvalid );
 
                 }
 
                 if ( Entry -> prev != NULL ) {
                     Entry -> prev -> next = NULL;
-                    _sConPool . tail = Entry -> prev;
+                    Pool -> tail = Entry -> prev;
                 }
                 else {
-                    _sConPool . head = _sConPool . tail = NULL;
+                    Pool -> head = Pool -> tail = NULL;
                 }
             }
             else {
@@ -530,7 +572,7 @@ RmOutMsg ( "[_CnPoolDrop_] [%p] [ %d]\n", Entry, __LINE__ );
             }
         }
 
-        _sConPool . qty --;
+        Pool -> qty --;
         Entry -> next = Entry -> prev = NULL;
     }
 
@@ -545,17 +587,19 @@ _CnPoolDrop ( struct RCacheEntry * Entry )
 
     if ( Entry != NULL ) {
         if ( Entry -> cn_entry != NULL ) {
+            struct _CnPool * Pool = & ( Entry -> shard -> pool );
+
 /*
-RmOutMsg ( "[KLockAcquire] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE__ );
+RmOutMsg ( "[KLockAcquire] [%p] [ %d]\n", ( void * ) Pool -> mutabor, __LINE__ );
 */
-            RCt = KLockAcquire ( _sConPool . mutabor );
+            RCt = KLockAcquire ( Pool -> mutabor );
             if ( RCt == 0 ) {
-                RCt = _CnPoolDrop_NoLock ( Entry -> cn_entry );
+                RCt = _CnPoolDrop_NoLock ( Pool, Entry -> cn_entry );
 
 /*
-RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE__ );
+RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) Pool -> mutabor, __LINE__ );
 */
-                KLockUnlock ( _sConPool . mutabor );
+                KLockUnlock ( Pool -> mutabor );
             }
         }
     }
@@ -564,14 +608,14 @@ RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) _sConPool . mutabor, __LINE_
 }   /* _CnPoolDrop () */
 
 rc_t CC
-_CnPoolPrune_NoLock ( size_t PruneS )
+_CnPoolPrune_NoLock ( struct _CnPool * Pool, size_t PruneS )
 {
     rc_t RCt = 0;
 
-    size_t max_qty = _sConPool . max_qty - PruneS;
+    size_t max_qty = Pool -> max_qty - PruneS;
 
-    while ( max_qty < _sConPool . qty ) {
-        RCt = _CnPoolDrop_NoLock ( _sConPool . tail );
+    while ( max_qty < Pool -> qty ) {
+        RCt = _CnPoolDrop_NoLock ( Pool, Pool -> tail );
         if ( RCt != 0 ) {
             break;
         }
@@ -584,18 +628,747 @@ _CnPoolPrune_NoLock ( size_t PruneS )
  ///  Cache ... hmmm
 (((*/
 static KNSManager * _ManagerOfKNS = NULL;
-static BSTree _Cache;
-    /* That lock will be used for adding/searching cache entries */
-static KLock * _CacheLock = NULL;
+    /* Shards are used for adding/searching cache entries */
+static bool _ShardsReady = false;
 
 const char * _CacheEntryClassName = "RCacheEntry_class";
 const char * _CacheDirName = ".cache";
 static char _CacheRoot [ 4096 ];
 static char * _PCacheRoot = NULL;
-static size_t _CacheEntryNo = 0;
+    /* Entries of different shards are numbered concurrently */
+static atomic32_t _CacheEntryNo;
 static uint32_t _HttpBlockSize = 0;
 static bool _DisklessMode = false;
 
+/*))
+ //  Prefetch: once reads of cache entry become sequential, the
+ \\  blocks following the last read are fetched into cache by
+ //  background threads, up to _PrefetchWindow blocks ahead
+((*/
+#define _PREFETCH_SEQ_MIN 2
+#define _PREFETCH_THREAD_QTY 4
+#define _PREFETCH_QUEUE_MAX 256
+static const uint32_t _sPrefetchBlockSizeDflt = 128 * 1024;
+
+struct _PfJob {
+    struct _PfJob * next;
+
+    struct RCacheEntry * entry;
+    uint64_t offset;
+    size_t size;
+};
+
+struct _PfQueue {
+    KLock * mutabor;
+    KCondition * posted;
+
+    struct _PfJob * head;
+    struct _PfJob * tail;
+    size_t qty;
+
+        /*) Jobs taken by threads and not yet done
+         (*/
+    size_t busy;
+
+    bool quit;
+
+    KThread * threads [ _PREFETCH_THREAD_QTY ];
+};
+
+static uint32_t _PrefetchWindow = 4;
+static struct _PfQueue _sPfQueue;
+
+/*))
+ //  Shards
+((*/
+void CC _RcAcHeEnTrYwHaCk ( BSTNode * Node, void * UnusedParam );
+
+static
+struct _RcShard * CC
+_RcShardOf ( const char * Url )
+{
+        /* FNV-1a */
+    uint32_t Hash = 2166136261u;
+
+    if ( Url != NULL ) {
+        for ( ; * Url != 0; Url ++ ) {
+            Hash ^= ( unsigned char ) * Url;
+            Hash *= 16777619u;
+        }
+    }
+
+    return _sShards + ( Hash % _CACHE_SHARD_QTY );
+}   /* _RcShardOf () */
+
+static
+rc_t CC
+_RcShardsWhack ()
+{
+    size_t llp;
+
+    if ( ! _ShardsReady ) {
+        return 0;
+    }
+
+    for ( llp = 0; llp < _CACHE_SHARD_QTY; llp ++ ) {
+        struct _RcShard * Shard = _sShards + llp;
+
+        BSTreeWhack ( & ( Shard -> tree ), _RcAcHeEnTrYwHaCk, NULL );
+        _CnPoolWhack ( & ( Shard -> pool ) );
+
+        if ( Shard -> mutabor != NULL ) {
+            ReleaseComplain ( KLockRelease, Shard -> mutabor );
+            Shard -> mutabor = NULL;
+        }
+    }
+
+    _ShardsReady = false;
+
+    return 0;
+}   /* _RcShardsWhack () */
+
+static
+rc_t CC
+_RcShardsInit ( size_t MaxQty )
+{
+    rc_t RCt;
+    size_t llp;
+
+    RCt = 0;
+
+    memset ( _sShards, 0, sizeof ( _sShards ) );
+    _ShardsReady = true;
+
+    for ( llp = 0; llp < _CACHE_SHARD_QTY; llp ++ ) {
+        struct _RcShard * Shard = _sShards + llp;
+
+        BSTreeInit ( & ( Shard -> tree ) );
+
+        RCt = KLockMake ( & ( Shard -> mutabor ) );
+        if ( RCt == 0 ) {
+            RCt = _CnPoolInit ( & ( Shard -> pool ), MaxQty );
+        }
+
+        if ( RCt != 0 ) {
+            _RcShardsWhack ();
+            break;
+        }
+    }
+
+    return RCt;
+}   /* _RcShardsInit () */
+
+/*))
+ //  Prefetch
+((*/
+static
+uint32_t CC
+_PfBlockSize ()
+{
+    return _HttpBlockSize == 0 ? _sPrefetchBlockSizeDflt : _HttpBlockSize;
+}   /* _PfBlockSize () */
+
+/*))
+ //  Source file of cachetee: reads remote file, but serves block
+ \\  which prefetch has fetched already. Block is installed only
+ //  under entry lock, as cachetee is read under that lock too
+((*/
+struct _PfSrcFile {
+    KFile dad;
+
+    const struct KFile * http;
+
+    const char * block;
+    uint64_t block_offset;
+    size_t block_size;
+};
+
+static
+rc_t CC
+_PfSrcFileDestroy ( _PfSrcFile * self )
+{
+    ReleaseComplain ( KFileRelease, self -> http );
+    free ( self );
+
+    return 0;
+}   /* _PfSrcFileDestroy () */
+
+static
+struct KSysFile * CC
+_PfSrcFileGetSysFile ( const _PfSrcFile * self, uint64_t * Offset )
+{
+    * Offset = 0;
+    return NULL;
+}   /* _PfSrcFileGetSysFile () */
+
+static
+rc_t CC
+_PfSrcFileRandomAccess ( const _PfSrcFile * self )
+{
+    return 0;
+}   /* _PfSrcFileRandomAccess () */
+
+static
+uint32_t CC
+_PfSrcFileType ( const _PfSrcFile * self )
+{
+    return KFileType ( self -> http );
+}   /* _PfSrcFileType () */
+
+static
+rc_t CC
+_PfSrcFileSize ( const _PfSrcFile * self, uint64_t * Size )
+{
+    return KFileSize ( self -> http, Size );
+}   /* _PfSrcFileSize () */
+
+static
+rc_t CC
+_PfSrcFileSetSize ( _PfSrcFile * self, uint64_t Size )
+{
+    return RC ( rcExe, rcFile, rcUpdating, rcInterface, rcUnsupported );
+}   /* _PfSrcFileSetSize () */
+
+static
+rc_t CC
+_PfSrcFileRead (
+                const _PfSrcFile * self,
+                uint64_t Offset,
+                void * Buffer,
+                size_t SizeToRead,
+                size_t * NumRead
+)
+{
+    rc_t RCt;
+    size_t Copied, Rest;
+
+    RCt = 0;
+    Copied = Rest = 0;
+
+    if ( self -> block == NULL
+        || Offset < self -> block_offset
+        || self -> block_offset + self -> block_size <= Offset
+    ) {
+        return KFileRead ( self -> http, Offset, Buffer, SizeToRead, NumRead );
+    }
+
+    Copied = self -> block_offset + self -> block_size - Offset;
+    if ( SizeToRead < Copied ) {
+        Copied = SizeToRead;
+    }
+    memmove (
+            Buffer,
+            self -> block + ( Offset - self -> block_offset ),
+            Copied
+            );
+
+        /*) Rest of request is past prefetched block
+         (*/
+    if ( Copied < SizeToRead ) {
+        RCt = KFileReadAll (
+                        self -> http,
+                        Offset + Copied,
+                        ( char * ) Buffer + Copied,
+                        SizeToRead - Copied,
+                        & Rest
+                        );
+    }
+
+    * NumRead = RCt == 0 ? Copied + Rest : 0;
+
+    return RCt;
+}   /* _PfSrcFileRead () */
+
+static
+rc_t CC
+_PfSrcFileWrite (
+                _PfSrcFile * self,
+                uint64_t Offset,
+                const void * Buffer,
+                size_t Size,
+                size_t * NumWrit
+)
+{
+    return RC ( rcExe, rcFile, rcWriting, rcInterface, rcUnsupported );
+}   /* _PfSrcFileWrite () */
+
+static KFile_vt_v1 _sPfSrcFile_vt = {
+    1, 1,
+    _PfSrcFileDestroy,
+    _PfSrcFileGetSysFile,
+    _PfSrcFileRandomAccess,
+    _PfSrcFileSize,
+    _PfSrcFileSetSize,
+    _PfSrcFileRead,
+    _PfSrcFileWrite,
+    _PfSrcFileType
+};
+
+static
+rc_t CC
+_PfSrcFileMake ( _PfSrcFile ** Src, const struct KFile * Http )
+{
+    rc_t RCt;
+    _PfSrcFile * Ret;
+
+    RCt = 0;
+    * Src = NULL;
+
+    Ret = ( _PfSrcFile * ) calloc ( 1, sizeof ( _PfSrcFile ) );
+    if ( Ret == NULL ) {
+        return RC ( rcExe, rcFile, rcConstructing, rcMemory, rcExhausted );
+    }
+
+    RCt = KFileInit (
+                    & ( Ret -> dad ),
+                    ( const KFile_vt * ) & _sPfSrcFile_vt,
+                    "_PfSrcFile",
+                    "no-name",
+                    true,
+                    false
+                    );
+    if ( RCt == 0 ) {
+        RCt = KFileAddRef ( Http );
+        if ( RCt == 0 ) {
+            Ret -> http = Http;
+            * Src = Ret;
+        }
+    }
+
+    if ( RCt != 0 ) {
+        free ( Ret );
+    }
+
+    return RCt;
+}   /* _PfSrcFileMake () */
+
+    /*) Prefetch thread reads remote file through its own Http
+     (  file, kept open while it prefetches blocks of same Url
+     (*/
+struct _PfWorker {
+    char * block;
+    char * scratch;
+
+    char * url;
+    const struct KFile * http;
+};
+
+static
+void CC
+_PfWorkerDropHttp ( struct _PfWorker * self )
+{
+    if ( self -> http != NULL ) {
+        ReleaseComplain ( KFileRelease, self -> http );
+        self -> http = NULL;
+    }
+
+    if ( self -> url != NULL ) {
+        free ( self -> url );
+        self -> url = NULL;
+    }
+}   /* _PfWorkerDropHttp () */
+
+static
+rc_t CC
+_PfWorkerOpenHttp ( struct _PfWorker * self, const char * Url )
+{
+    rc_t RCt = 0;
+
+    if ( self -> http != NULL && strcmp ( self -> url, Url ) == 0 ) {
+        return 0;
+    }
+
+    _PfWorkerDropHttp ( self );
+
+    self -> url = string_dup_measure ( Url, NULL );
+    if ( self -> url == NULL ) {
+        return RC ( rcExe, rcFile, rcOpening, rcMemory, rcExhausted );
+    }
+
+    RCt = KNSManagerMakeHttpFile (
+                                _ManagerOfKNS,
+                                & ( self -> http ),
+                                NULL, /* no open connections */
+                                0x01010000,
+                                "%s",
+                                Url
+                                );
+    if ( RCt != 0 ) {
+        self -> http = NULL;
+        _PfWorkerDropHttp ( self );
+    }
+
+    return RCt;
+}   /* _PfWorkerOpenHttp () */
+
+    /*) Should be called under entry lock
+     (*/
+static
+bool CC
+_RCacheEntryNeedsPrefetch ( struct RCacheEntry * self )
+{
+    return self -> file != NULL
+            && self -> src != NULL
+            && ! self -> is_local
+            && ! self -> is_complete
+            ;
+}   /* _RCacheEntryNeedsPrefetch () */
+
+    /*) Reads block from remote file without holding entry lock,
+     (  so foreground reads are not blocked by it. Then installs
+     (  block in source of cachetee file and reads it through
+     (  cachetee under lock, so it will be stored in cache.
+     (  Does nothing if file was closed or completed meanwhile
+     (*/
+static
+rc_t CC
+_RCacheEntryPrefetch (
+                struct RCacheEntry * self,
+                struct _PfWorker * Worker,
+                size_t SizeToRead,
+                uint64_t Offset
+)
+{
+    rc_t RCt;
+    size_t NumRead, NumCached;
+    bool Needed;
+
+    RCt = 0;
+    NumRead = NumCached = 0;
+    Needed = false;
+
+    RCt = KLockAcquire ( self -> mutabor );
+    if ( RCt == 0 ) {
+        Needed = _RCacheEntryNeedsPrefetch ( self );
+
+        KLockUnlock ( self -> mutabor );
+    }
+
+    if ( RCt != 0 || ! Needed ) {
+        return RCt;
+    }
+
+        /*) Url does not change while entry exists
+         (*/
+    RCt = _PfWorkerOpenHttp ( Worker, self -> Url );
+    if ( RCt == 0 ) {
+        RCt = KFileReadAll (
+                        Worker -> http,
+                        Offset,
+                        Worker -> block,
+                        SizeToRead,
+                        & NumRead
+                        );
+        if ( RCt != 0 ) {
+            _PfWorkerDropHttp ( Worker );
+        }
+    }
+
+    if ( RCt != 0 || NumRead == 0 ) {
+        return RCt;
+    }
+
+    RCt = KLockAcquire ( self -> mutabor );
+    if ( RCt == 0 ) {
+        if ( _RCacheEntryNeedsPrefetch ( self ) ) {
+            self -> src -> block = Worker -> block;
+            self -> src -> block_offset = Offset;
+            self -> src -> block_size = NumRead;
+
+            RCt = KFileReadAll (
+                            self -> file,
+                            Offset,
+                            Worker -> scratch,
+                            NumRead,
+                            & NumCached
+                            );
+
+            self -> src -> block = NULL;
+        }
+
+        KLockUnlock ( self -> mutabor );
+    }
+
+    return RCt;
+}   /* _RCacheEntryPrefetch () */
+
+static
+rc_t CC
+_PfThread ( const KThread * Thread, void * Data )
+{
+    rc_t RCt;
+    struct _PfQueue * Queue;
+    struct _PfJob * Job;
+    struct _PfWorker Worker;
+
+    RCt = 0;
+    Queue = ( struct _PfQueue * ) Data;
+    Job = NULL;
+
+    memset ( & Worker, 0, sizeof ( Worker ) );
+    Worker . block = ( char * ) malloc ( _PfBlockSize () );
+    Worker . scratch = ( char * ) malloc ( _PfBlockSize () );
+    if ( Worker . block == NULL || Worker . scratch == NULL ) {
+        free ( Worker . block );
+        free ( Worker . scratch );
+        return RC ( rcExe, rcFile, rcReading, rcMemory, rcExhausted );
+    }
+
+    RCt = KLockAcquire ( Queue -> mutabor );
+    while ( RCt == 0 && ! Queue -> quit ) {
+        Job = Queue -> head;
+        if ( Job == NULL ) {
+            RCt = KConditionWait ( Queue -> posted, Queue -> mutabor );
+            continue;
+        }
+
+        Queue -> head = Job -> next;
+        if ( Queue -> head == NULL ) {
+            Queue -> tail = NULL;
+        }
+        Queue -> qty --;
+        Queue -> busy ++;
+
+        KLockUnlock ( Queue -> mutabor );
+
+        if ( _RCacheEntryPrefetch (
+                                Job -> entry,
+                                & Worker,
+                                Job -> size,
+                                Job -> offset
+                                ) != 0 ) {
+PLOGMSG ( klogWarn, ( klogWarn, "|||<- Failed to prefetch file $(n) [$(u)] at $(o)", PLOG_3(PLOG_S(n),PLOG_S(u),PLOG_U64(o)), Job -> entry -> Name, Job -> entry -> Url, Job -> offset ) );
+        }
+
+        RCacheEntryRelease ( Job -> entry );
+        free ( Job );
+
+        RCt = KLockAcquire ( Queue -> mutabor );
+        if ( RCt == 0 ) {
+            Queue -> busy --;
+        }
+    }
+
+    if ( RCt == 0 ) {
+        KLockUnlock ( Queue -> mutabor );
+    }
+
+    _PfWorkerDropHttp ( & Worker );
+    free ( Worker . block );
+    free ( Worker . scratch );
+
+    return RCt;
+}   /* _PfThread () */
+
+static
+rc_t CC
+_PfQueueWhack ()
+{
+    struct _PfQueue * Queue = & _sPfQueue;
+    struct _PfJob * Job;
+    size_t llp;
+
+    if ( Queue -> mutabor != NULL ) {
+        if ( KLockAcquire ( Queue -> mutabor ) == 0 ) {
+            Queue -> quit = true;
+            KConditionBroadcast ( Queue -> posted );
+            KLockUnlock ( Queue -> mutabor );
+        }
+    }
+
+    for ( llp = 0; llp < _PREFETCH_THREAD_QTY; llp ++ ) {
+        if ( Queue -> threads [ llp ] != NULL ) {
+            KThreadWait ( Queue -> threads [ llp ], NULL );
+            ReleaseComplain ( KThreadRelease, Queue -> threads [ llp ] );
+            Queue -> threads [ llp ] = NULL;
+        }
+    }
+
+    while ( Queue -> head != NULL ) {
+        Job = Queue -> head;
+        Queue -> head = Job -> next;
+
+        RCacheEntryRelease ( Job -> entry );
+        free ( Job );
+    }
+
+    if ( Queue -> posted != NULL ) {
+        ReleaseComplain ( KConditionRelease, Queue -> posted );
+    }
+
+    if ( Queue -> mutabor != NULL ) {
+        ReleaseComplain ( KLockRelease, Queue -> mutabor );
+    }
+
+    memset ( Queue, 0, sizeof ( struct _PfQueue ) );
+
+    return 0;
+}   /* _PfQueueWhack () */
+
+static
+rc_t CC
+_PfQueueInit ()
+{
+    rc_t RCt;
+    struct _PfQueue * Queue;
+    size_t llp;
+
+    RCt = 0;
+    Queue = & _sPfQueue;
+
+    memset ( Queue, 0, sizeof ( struct _PfQueue ) );
+
+    if ( _PrefetchWindow == 0 ) {
+        return 0;
+    }
+
+    RCt = KLockMake ( & ( Queue -> mutabor ) );
+    if ( RCt == 0 ) {
+        RCt = KConditionMake ( & ( Queue -> posted ) );
+    }
+
+    for ( llp = 0; RCt == 0 && llp < _PREFETCH_THREAD_QTY; llp ++ ) {
+        RCt = KThreadMake ( & ( Queue -> threads [ llp ] ), _PfThread, Queue );
+    }
+
+    if ( RCt != 0 ) {
+        _PfQueueWhack ();
+    }
+
+    return RCt;
+}   /* _PfQueueInit () */
+
+    /*) Called under entry lock, so AddRef is safe
+     (*/
+static
+rc_t CC
+_PfQueuePost (
+            struct RCacheEntry * Entry,
+            uint64_t Offset,
+            size_t Size
+)
+{
+    rc_t RCt;
+    struct _PfQueue * Queue;
+    struct _PfJob * Job;
+
+    RCt = 0;
+    Queue = & _sPfQueue;
+    Job = NULL;
+
+    if ( Queue -> mutabor == NULL ) {
+        return 0;
+    }
+
+    Job = ( struct _PfJob * ) calloc ( 1, sizeof ( struct _PfJob ) );
+    if ( Job == NULL ) {
+        return RC ( rcExe, rcFile, rcReading, rcMemory, rcExhausted );
+    }
+
+    RCt = RCacheEntryAddRef ( Entry );
+    if ( RCt == 0 ) {
+        Job -> entry = Entry;
+        Job -> offset = Offset;
+        Job -> size = Size;
+
+        RCt = KLockAcquire ( Queue -> mutabor );
+        if ( RCt == 0 ) {
+            if ( Queue -> quit || _PREFETCH_QUEUE_MAX <= Queue -> qty ) {
+                    /*) Too much in flight, it is just a hint anyway
+                     (*/
+                RCt = RC ( rcExe, rcFile, rcReading, rcQueue, rcExhausted );
+            }
+            else {
+                if ( Queue -> tail != NULL ) {
+                    Queue -> tail -> next = Job;
+                }
+                else {
+                    Queue -> head = Job;
+                }
+                Queue -> tail = Job;
+                Queue -> qty ++;
+
+                KConditionSignal ( Queue -> posted );
+            }
+
+            KLockUnlock ( Queue -> mutabor );
+        }
+
+        if ( RCt != 0 ) {
+                /*) Can not drop last reference here: we are under lock
+                 (  and caller holds reference anyway
+                 (*/
+            KRefcountDrop ( & ( Entry -> refcount ), _CacheEntryClassName );
+        }
+    }
+
+    if ( RCt != 0 ) {
+        free ( Job );
+    }
+
+    return RCt;
+}   /* _PfQueuePost () */
+
+    /*) Called under entry lock after file was checked
+     (  Tracks sequential reads and posts blocks following Offset
+     (  which are not yet in flight
+     (*/
+static
+void CC
+_RCacheEntryPrefetchAhead (
+                struct RCacheEntry * self,
+                size_t SizeToRead,
+                uint64_t Offset
+)
+{
+    uint64_t ReadEnd, From, To;
+    uint32_t BlockSize;
+
+    ReadEnd = Offset + SizeToRead;
+
+    if ( Offset == self -> seq_end ) {
+        self -> seq_qty ++;
+    }
+    else {
+        self -> seq_qty = 0;
+        self -> prefetch_end = 0;
+    }
+    self -> seq_end = ReadEnd;
+
+    if ( _PrefetchWindow == 0
+        || self -> seq_qty < _PREFETCH_SEQ_MIN
+        || self -> is_local
+        || RemoteCacheIsDisklessMode ()
+    ) {
+        return;
+    }
+
+    BlockSize = _PfBlockSize ();
+
+        /*) Aligning to block boundaries, as cachetee does
+         (*/
+    From = self -> prefetch_end < ReadEnd ? ReadEnd : self -> prefetch_end;
+    From = ( From / BlockSize ) * BlockSize;
+    if ( From < ReadEnd ) {
+        From += BlockSize;
+    }
+    To = ( ReadEnd / BlockSize + _PrefetchWindow + 1 ) * BlockSize;
+    if ( self -> actual_size < To ) {
+        To = self -> actual_size;
+    }
+
+    while ( From < To ) {
+        size_t Size = To - From < BlockSize ? To - From : BlockSize;
+
+        if ( _PfQueuePost ( self, From, Size ) != 0 ) {
+            break;
+        }
+
+        From += Size;
+        self -> prefetch_end = From;
+    }
+}   /* _RCacheEntryPrefetchAhead () */
+
 /*))
  //  Some extremely useful methods
 ((*/
@@ -797,6 +1570,21 @@ RemoteCacheSetHttpBlockSize ( uint32_t HttpBlockSize )
     return RetVal;
 }   /* RemoteCacheSetHttpBlockSize () */
 
+/*
+ *  Lyrics: This method will set amount of blocks to prefetch ahead
+ *  of sequential reader and return previous value. 0 disables it.
+ *  Same as above, it should be set before cache creation
+ */
+uint32_t CC
+RemoteCacheSetPrefetchWindow ( uint32_t BlockQty )
+{
+    uint32_t RetVal = _PrefetchWindow;
+
+    _PrefetchWindow = BlockQty;
+
+    return RetVal;
+}   /* RemoteCacheSetPrefetchWindow () */
+
 /*
  * Lyrics: Cache initialising: keeping in memory cache path 
  *         cache path could be a NULL, and in that case no cacheing
@@ -939,7 +1727,7 @@ RemoteCacheCreate ()
     LOGMSG( klogInfo, "[RemoteCache] creating\n" );
 
         /* we shoud do it here */
-    RCt = _CnPoolInit ( 0 ); /* Not sure about 0 8-| */
+    RCt = _RcShardsInit ( 0 ); /* Not sure about 0 8-| */
     if ( RCt != 0 ) {
         return RCt;
     }
@@ -973,14 +1761,7 @@ RemoteCacheCreate ()
 
         RCt = _InitKNSManager ();
         if ( RCt == 0 ) {
-
-                /* Initializing BSTree */
-            BSTreeInit ( & _Cache );
-                /* Initializing _CacheLock */
-            RCt = KLockMake ( & _CacheLock );
-/*
-RmOutMsg ( "[KLockMake] [%p] [ %d]\n", ( void * ) _CacheLock, __LINE__ );
-*/
+            RCt = _PfQueueInit ();
         }
     }
 
@@ -1037,23 +1818,15 @@ RemoteCacheDispose ()
         _PCacheRoot = NULL;
     }
 
-        /* Releasing Lock */
-    if ( _CacheLock != NULL ) {
-/*
-RmOutMsg ( "[KLockRelease] [%p] [ %d]\n", ( void * ) _CacheLock, __LINE__ );
-*/
-        ReleaseComplain ( KLockRelease, _CacheLock );
-        _CacheLock = NULL;
-    }
+        /* Prefetchers are holding entries, stopping them first */
+    _PfQueueWhack ();
 
     _DisposeKNSManager ();
 
-    BSTreeWhack ( & _Cache, _RcAcHeEnTrYwHaCk, NULL );
-
         /* Who does need that check? */
-    _CnPoolWhack ();
+    _RcShardsWhack ();
 
-    _CacheEntryNo = 0;
+    atomic32_set ( & _CacheEntryNo, 0 );
 
     * _CacheRoot = 0;
     _PCacheRoot = NULL;
@@ -1095,7 +1868,7 @@ _RCacheEntryGenerateNameAndPath ( char ** Name, char ** Path )
                         sizeof ( Buffer ),
                         & NumWritten,
                         "etwas.%d",
-                        _CacheEntryNo + 1
+                        atomic32_read_and_add ( & _CacheEntryNo, 1 ) + 1
                         );
     if ( RCt == 0 ) {
         TheName = string_dup_measure ( Buffer, NULL );
@@ -1168,6 +1941,12 @@ KOutMsg ( "[GGU] [DestroyEnty] [%s]\n", self -> Name );
 */
             ReleaseComplain ( KFileRelease, self -> file );
             self -> file = 0;
+        }
+            /*) Source of cachetee file
+             (*/
+        if ( self -> src != NULL ) {
+            ReleaseComplain ( KFileRelease, & ( self -> src -> dad ) );
+            self -> src = NULL;
         }
             /*) Url
              (*/
@@ -1280,9 +2059,9 @@ RmOutMsg ( "[KLockMake] [%p] [ %d]\n", ( void * ) Entry -> mutabor, __LINE__ );
                 }
                 if ( RCt == 0 ) {
                         /*) File will be opened on demand
-                         /  Increasing count and assigning value
+                         /  Assigning value
                         (*/
-                    _CacheEntryNo ++;
+                    Entry -> shard = _RcShardOf ( Url );
                     * RetEntry = Entry;
                 }
             }
@@ -1359,9 +2138,11 @@ RemoteCacheFindOrCreateEntry (
 {
     rc_t RCt;
     struct RCacheEntry * RetEntry;
+    struct _RcShard * Shard;
 
     RCt = 0;
     RetEntry = NULL;
+    Shard = NULL;
 
     if ( Url == NULL || Entry == NULL ) {
         return RC ( rcExe, rcPath, rcInitializing, rcParam, rcNull );
@@ -1384,14 +2165,15 @@ RmOutMsg ( "++++++DL CREATE [0x%p][%s] entry\n", RetEntry, Url );
         /*)  Here we are locking
          (*/
 /*
-RmOutMsg ( "[KLockAcquire] [%p] [ %d]\n", ( void * ) _CacheLock, __LINE__ );
+RmOutMsg ( "[KLockAcquire] [%p] [ %d]\n", ( void * ) Shard -> mutabor, __LINE__ );
 */
-    RCt = KLockAcquire ( _CacheLock );
+    Shard = _RcShardOf ( Url );
+    RCt = KLockAcquire ( Shard -> mutabor );
     if ( RCt == 0 ) {
             /*)  Here we are 'looking for' and 'fooking lor'
              (*/
         RetEntry = ( struct RCacheEntry * ) BSTreeFind (
-                                                    & _Cache,
+                                                    & ( Shard -> tree ),
                                                     Url,
                                                     _RcEnTrYcMp
                                                     );
@@ -1402,7 +2184,7 @@ RmOutMsg ( "++++++ %s entry\n", RetEntry == NULL ? "Creating" : "Loading" );
             RCt = _RCacheEntryMake ( Url, & RetEntry );
             if ( RCt == 0 ) {
                 RCt = BSTreeInsert (
-                                & _Cache,
+                                & ( Shard -> tree ),
                                 ( BSTNode * ) RetEntry,
                                 _RcNoDeCmP
                                 );
@@ -1416,9 +2198,9 @@ RmOutMsg ( "++++++ %s entry\n", RetEntry == NULL ? "Creating" : "Loading" );
             /*)  First we are trying to find appropriate entry
              (*/
 /*
-RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) _CacheLock, __LINE__ );
+RmOutMsg ( "[KLockUnlock] [%p] [ %d]\n", ( void * ) Shard -> mutabor, __LINE__ );
 */
-        KLockUnlock ( _CacheLock );
+        KLockUnlock ( Shard -> mutabor );
     }
 
     return RCt;
@@ -1483,6 +2265,11 @@ RmOutMsg ( "|||<-- Releasing [%s][%s]\n", self -> Name, self -> Url );
         self -> file = NULL;
     }
 
+    if ( self -> src != NULL ) {
+        ReleaseComplain ( KFileRelease, & ( self -> src -> dad ) );
+        self -> src = NULL;
+    }
+
     return 0;
 }   /*  _RCacheEntryReleaseWithoutLock () */
 
@@ -1596,13 +2383,19 @@ RmOutMsg ( "  |<-- Cache Entry [%s]\n", self -> Path );
         else {
             RCt = KDirectoryNativeDir ( & Directory );
             if ( RCt == 0 ) {
-                RCt = KDirectoryMakeCacheTeePromote (
-                                    Directory,
-                                    & TeeFile,
-                                    HttpFile,
-                                    _HttpBlockSize, /* blocksize */
-                                    self -> Path
-                                    );
+                    /*  Cachetee reads remote file through prefetch
+                     *  source, see _RCacheEntryPrefetch ()
+                     */
+                RCt = _PfSrcFileMake ( & ( self -> src ), HttpFile );
+                if ( RCt == 0 ) {
+                    RCt = KDirectoryMakeCacheTeePromote (
+                                        Directory,
+                                        & TeeFile,
+                                        & ( self -> src -> dad ),
+                                        _HttpBlockSize, /* blocksize */
+                                        self -> Path
+                                        );
+                }
                 if ( RCt == 0 ) {
                     self -> file = ( KFile * ) TeeFile;
 
@@ -1618,10 +2411,7 @@ RmOutMsg ( "  |<-- Cache Entry [%s]\n", self -> Path );
     }
 
     if ( RCt != 0 ) {
-        if ( self -> file != NULL ) {
-            ReleaseComplain ( KFileRelease, self -> file );
-            self -> file = NULL;
-        }
+        _RCacheEntryReleaseWithoutLock ( self );
 
         _CnEntDispose ( self );
     }
@@ -1902,6 +2692,8 @@ RmOutMsg ( "[KLockAcquire] [%p] [ %d]\n", ( void * ) self -> mutabor, __LINE__ )
                                         & Synchronized
                                         );
         if ( RCt == 0 ) {
+            _RCacheEntryPrefetchAhead ( self, SizeToRead, Offset );
+
             if ( ! Synchronized ) {
                     /*) do not need synchronisation to read local file
                      (*/
@@ -105,6 +105,13 @@ rc_t CC RCacheEntryRead (
     ((*/
 uint32_t CC RemoteCacheSetHttpBlockSize ( uint32_t HttpBlockSize );
 
+    /*))
+     //  This method will set amount of blocks which are fetched
+     \\  into cache ahead of sequential reader by background
+     //  threads. 0 disables prefetch. Will return previous value
+    ((*/
+uint32_t CC RemoteCacheSetPrefetchWindow ( uint32_t BlockQty );
+
     /*))
      //  This method will set path for local cache dir
      \\
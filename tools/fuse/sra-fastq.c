@@ -25,6 +25,8 @@
 #include <klib/rc.h>
 #include <kfs/file.h>
 #include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/thread.h>
 #include <kdb/table.h>
 #include <kdb/index.h>
 
@@ -40,39 +42,94 @@
 #include "sra-fastq.h"
 #include "zlib-simple.h"
 
+/* formatted blocks kept per open file */
+#define SRAFASTQ_CACHE_SLOTS 8
+/* blocks formatted ahead of a sequential reader */
+#define SRAFASTQ_READAHEAD 2
+/* background threads doing the read ahead */
+#define SRAFASTQ_THREADS 2
+
 typedef struct SRAFastqFile SRAFastqFile;
 #define KFILE_IMPL SRAFastqFile
 #include <kfs/impl.h>
 
+enum ESRAFastqBlockState {
+    eBlockEmpty = 0,
+    eBlockQueued,   /* waits for a read ahead thread */
+    eBlockLoading,  /* being formatted by exactly one thread, no lock held */
+    eBlockReady,
+    eBlockFailed
+};
+
+typedef struct SRAFastqBlock {
+    /* block position and size in file, as found in index */
+    uint64_t from;
+    uint64_t extent;
+    int64_t id;
+    uint64_t id_qty;
+    /* bytes formatted into buf */
+    uint64_t size;
+    uint64_t used;
+    /* readers pinning the block, it is not reused while > 0 */
+    uint32_t refs;
+    enum ESRAFastqBlockState state;
+    rc_t rc;
+    KCondition* loaded;
+    const FastqReader* reader;
+    char* buf;
+    char* gzipped; /* serves as flag and a buffer */
+} SRAFastqBlock;
+
 struct SRAFastqFile {
     KFile dad;
     uint32_t buffer_sz;
     uint64_t file_sz;
-    char* gzipped; /* serves as flag and a buffer */
+    bool gzip;
+    /* guards slots bookkeeping only, blocks are formatted and copied outside of it */
     KLock* lock;
+    KCondition* released;
+    KCondition* queued;
     const SRATable* stbl;
     const KTable* ktbl;
     const KIndex* kidx;
-    const FastqReader* reader;
-    /* current buf content */
-    uint64_t from;
-    uint64_t size;
-    char* buf;
+    FileOptions opt;
+    uint64_t tick;
+    bool quit;
+    SRAFastqBlock slots[SRAFASTQ_CACHE_SLOTS];
+    KThread* threads[SRAFASTQ_THREADS];
 };
 
 static
 rc_t SRAFastqFile_Destroy(SRAFastqFile *self)
 {
-    if( KLockAcquire(self->lock) == 0 ) {
-        ReleaseComplain(FastqReaderWhack, self->reader);
-        ReleaseComplain(KIndexRelease, self->kidx);
-        ReleaseComplain(KTableRelease, self->ktbl);
-        ReleaseComplain(SRATableRelease, self->stbl);
-        FREE(self->buf < self->gzipped ? self->buf : self->gzipped);
+    uint32_t i;
+
+    if( self->lock != NULL && KLockAcquire(self->lock) == 0 ) {
+        self->quit = true;
+        if( self->queued != NULL ) {
+            KConditionBroadcast(self->queued);
+        }
         ReleaseComplain(KLockUnlock, self->lock);
-        ReleaseComplain(KLockRelease, self->lock);
-        FREE(self);
     }
+    for(i = 0; i < SRAFASTQ_THREADS; i++) {
+        if( self->threads[i] != NULL ) {
+            KThreadWait(self->threads[i], NULL);
+            ReleaseComplain(KThreadRelease, self->threads[i]);
+        }
+    }
+    for(i = 0; i < SRAFASTQ_CACHE_SLOTS; i++) {
+        SRAFastqBlock* b = &self->slots[i];
+        ReleaseComplain(FastqReaderWhack, b->reader);
+        ReleaseComplain(KConditionRelease, b->loaded);
+        FREE(b->buf < b->gzipped ? b->buf : b->gzipped);
+    }
+    ReleaseComplain(KIndexRelease, self->kidx);
+    ReleaseComplain(KTableRelease, self->ktbl);
+    ReleaseComplain(SRATableRelease, self->stbl);
+    ReleaseComplain(KConditionRelease, self->queued);
+    ReleaseComplain(KConditionRelease, self->released);
+    ReleaseComplain(KLockRelease, self->lock);
+    FREE(self);
     return 0;
 }
 
@@ -109,59 +166,264 @@ rc_t SRAFastqFile_SetSize(SRAFastqFile *self, uint64_t size)
 }
 
 static
-rc_t SRAFastqFile_Read(const SRAFastqFile* self, uint64_t pos, void *buffer, size_t size, size_t *num_read)
+rc_t SRAFastqFile_ReaderMake(const SRAFastqFile* self, const FastqReader** reader)
+{
+    const FileOptions* opt = &self->opt;
+    return FastqReaderMake(reader, self->stbl,
+                           opt->f.fastq.accession, opt->f.fastq.colorSpace,
+                           opt->f.fastq.origFormat, false, opt->f.fastq.printLabel,
+                           opt->f.fastq.printReadId, !opt->f.fastq.clipQuality, false,
+                           opt->f.fastq.minReadLen, opt->f.fastq.qualityOffset,
+                           opt->f.fastq.colorSpaceKey,
+                           opt->f.fastq.minSpotId, opt->f.fastq.maxSpotId);
+}
+
+/* formats block's spots into its buffer, caller must own the block in eBlockLoading state */
+static
+rc_t SRAFastqFile_Format(const SRAFastqFile* self, SRAFastqBlock* blk)
 {
     rc_t rc = 0;
+    uint64_t id_qty = blk->id_qty;
 
-    if( pos >= self->file_sz ) {
-        *num_read = 0;
-    } else if( (rc = KLockAcquire(self->lock)) == 0 ) {
+    blk->size = 0;
+    if( blk->reader == NULL ) {
+        rc = SRAFastqFile_ReaderMake(self, &blk->reader);
+    }
+    DEBUG_MSG(10, ("Caching from %lu:%lu, %lu bytes\n", blk->from, blk->from + blk->extent - 1, blk->extent));
+    DEBUG_MSG(10, ("Caching spot %ld, %lu spots\n", blk->id, blk->id_qty));
+    if( rc == 0 && (rc = FastqReaderSeekSpot(blk->reader, blk->id)) == 0 ) {
+        size_t inbuf = 0, w = 0;
+        char* b = blk->buf;
+        uint64_t left = self->buffer_sz;
         do {
-            if( pos < self->from || pos >= (self->from + self->size) ) {
-                int64_t id = 0;
-                uint64_t id_qty = 0;
-                DEBUG_MSG(10, ("Caching for pos %lu %lu bytes\n", pos, size - *num_read));
-                if( (rc = KIndexFindU64(self->kidx, pos, &((SRAFastqFile*)self)->from, &((SRAFastqFile*)self)->size, &id, &id_qty)) == 0 ) {
-                    DEBUG_MSG(10, ("Caching from %lu:%lu, %lu bytes\n", self->from, self->from + self->size - 1, self->size));
-                    DEBUG_MSG(10, ("Caching spot %ld, %lu spots\n", id, id_qty));
-                    if( (rc = FastqReaderSeekSpot(self->reader, id)) == 0 ) {
-                        size_t inbuf = 0, w = 0;
-                        char* b = self->buf;
-                        uint64_t left = self->buffer_sz;
-                        do {
-                            if( (rc = FastqReader_GetCurrentSpotSplitData(self->reader, b, left, &w)) != 0 ) {
-                                break;
-                            }
-                            b += w; left -= w; inbuf += w; --id_qty;
-                        } while( id_qty > 0 && (rc = FastqReaderNextSpot(self->reader)) == 0);
-                        if( GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted ) {
-                            DEBUG_MSG(10, ("No more rows\n"));
-                            rc = 0;
-                        }
-                        DEBUG_MSG(8, ("Cached %u bytes\n", inbuf));
-                        if( self->gzipped != NULL ) {
-                            size_t compressed = 0;
-                            if( (rc = ZLib_DeflateBlock(self->buf, inbuf, self->gzipped, self->buffer_sz, &compressed)) == 0 ) {
-                                char* b = self->buf;
-                                ((SRAFastqFile*)self)->buf = self->gzipped;
-                                ((SRAFastqFile*)self)->gzipped = b;
-                                ((SRAFastqFile*)self)->size = compressed;
-                                DEBUG_MSG(10, ("gzipped %lu bytes\n", self->size));
-                            }
-                        }
-                    }
+            if( (rc = FastqReader_GetCurrentSpotSplitData(blk->reader, b, left, &w)) != 0 ) {
+                break;
+            }
+            b += w; left -= w; inbuf += w; --id_qty;
+        } while( id_qty > 0 && (rc = FastqReaderNextSpot(blk->reader)) == 0);
+        if( GetRCObject(rc) == rcRow && GetRCState(rc) == rcExhausted ) {
+            DEBUG_MSG(10, ("No more rows\n"));
+            rc = 0;
+        }
+        DEBUG_MSG(8, ("Cached %u bytes\n", inbuf));
+        blk->size = inbuf;
+        if( rc == 0 && blk->gzipped != NULL ) {
+            size_t compressed = 0;
+            if( (rc = ZLib_DeflateBlock(blk->buf, inbuf, blk->gzipped, self->buffer_sz, &compressed)) == 0 ) {
+                char* b = blk->buf;
+                blk->buf = blk->gzipped;
+                blk->gzipped = b;
+                blk->size = compressed;
+                DEBUG_MSG(10, ("gzipped %lu bytes\n", blk->size));
+            }
+        }
+    }
+    return rc;
+}
+
+/* all functions below, but the thread, expect self->lock to be held */
+
+static
+SRAFastqBlock* SRAFastqFile_Find(const SRAFastqFile* self, uint64_t pos)
+{
+    uint32_t i;
+    for(i = 0; i < SRAFASTQ_CACHE_SLOTS; i++) {
+        const SRAFastqBlock* b = &self->slots[i];
+        if( b->state != eBlockEmpty && b->state != eBlockFailed &&
+            pos >= b->from && pos < b->from + b->extent ) {
+            return (SRAFastqBlock*)b;
+        }
+    }
+    return NULL;
+}
+
+/* takes least recently used unpinned slot for block at pos, *blk is NULL if all slots are busy */
+static
+rc_t SRAFastqFile_Claim(SRAFastqFile* self, uint64_t pos, enum ESRAFastqBlockState state, SRAFastqBlock** blk)
+{
+    rc_t rc = 0;
+    uint32_t i;
+    SRAFastqBlock* victim = NULL;
+
+    for(i = 0; i < SRAFASTQ_CACHE_SLOTS; i++) {
+        SRAFastqBlock* b = &self->slots[i];
+        if( b->refs == 0 && b->state != eBlockLoading && (victim == NULL || b->used < victim->used) ) {
+            victim = b;
+        }
+    }
+    *blk = NULL;
+    if( victim != NULL ) {
+        if( (rc = KIndexFindU64(self->kidx, pos, &victim->from, &victim->extent, &victim->id, &victim->id_qty)) == 0 ) {
+            victim->state = state;
+            victim->used = ++self->tick;
+            victim->rc = 0;
+            *blk = victim;
+        } else {
+            victim->state = eBlockEmpty;
+        }
+    }
+    return rc;
+}
+
+/* queue blocks following blk if it continues a block which is still cached */
+static
+void SRAFastqFile_ReadAhead(SRAFastqFile* self, const SRAFastqBlock* blk)
+{
+    uint32_t i, q = 0;
+    uint64_t next;
+
+    for(i = 0; i < SRAFASTQ_CACHE_SLOTS; i++) {
+        const SRAFastqBlock* b = &self->slots[i];
+        if( b != blk && b->state != eBlockEmpty && b->state != eBlockFailed && b->from + b->extent == blk->from ) {
+            break;
+        }
+    }
+    if( i == SRAFASTQ_CACHE_SLOTS ) {
+        return;
+    }
+    next = blk->from + blk->extent;
+    for(i = 0; i < SRAFASTQ_READAHEAD && next < self->file_sz; i++) {
+        SRAFastqBlock* b = SRAFastqFile_Find(self, next);
+        if( b == NULL ) {
+            if( SRAFastqFile_Claim(self, next, eBlockQueued, &b) != 0 || b == NULL ) {
+                break;
+            }
+            DEBUG_MSG(10, ("Read ahead queued %lu\n", b->from));
+            q++;
+        }
+        next = b->from + b->extent;
+    }
+    if( q > 0 ) {
+        KConditionBroadcast(self->queued);
+    }
+}
+
+static
+void SRAFastqFile_Loaded(SRAFastqFile* self, SRAFastqBlock* blk, rc_t rc)
+{
+    blk->rc = rc;
+    blk->state = rc == 0 ? eBlockReady : eBlockFailed;
+    KConditionBroadcast(blk->loaded);
+}
+
+static
+void SRAFastqFile_Unpin(SRAFastqFile* self, SRAFastqBlock* blk)
+{
+    if( --blk->refs == 0 ) {
+        KConditionBroadcast(self->released);
+    }
+}
+
+static
+rc_t CC SRAFastqFile_Thread(const KThread* t, void* data)
+{
+    SRAFastqFile* self = data;
+    rc_t rc = KLockAcquire(self->lock);
+
+    while( rc == 0 && !self->quit ) {
+        uint32_t i;
+        SRAFastqBlock* blk = NULL;
+        for(i = 0; i < SRAFASTQ_CACHE_SLOTS; i++) {
+            SRAFastqBlock* b = &self->slots[i];
+            if( b->state == eBlockQueued && (blk == NULL || b->from < blk->from) ) {
+                blk = b;
+            }
+        }
+        if( blk == NULL ) {
+            rc = KConditionWait(self->queued, self->lock);
+        } else {
+            rc_t r;
+            blk->state = eBlockLoading;
+            blk->refs++;
+            ReleaseComplain(KLockUnlock, self->lock);
+            r = SRAFastqFile_Format(self, blk);
+            if( r != 0 ) {
+                PLOGERR(klogWarn, (klogWarn, r, "read ahead at $(p)", PLOG_U64(p), blk->from));
+            }
+            if( (rc = KLockAcquire(self->lock)) == 0 ) {
+                SRAFastqFile_Loaded(self, blk, r);
+                SRAFastqFile_Unpin(self, blk);
+            }
+        }
+    }
+    if( rc == 0 ) {
+        ReleaseComplain(KLockUnlock, self->lock);
+    }
+    return rc;
+}
+
+static
+rc_t SRAFastqFile_Read(const SRAFastqFile* cself, uint64_t pos, void *buffer, size_t size, size_t *num_read)
+{
+    rc_t rc = 0;
+    SRAFastqFile* self = (SRAFastqFile*)cself;
+
+    *num_read = 0;
+    while( rc == 0 && *num_read < size && pos < self->file_sz ) {
+        bool load = false;
+        SRAFastqBlock* blk = NULL;
+
+        if( (rc = KLockAcquire(self->lock)) != 0 ) {
+            break;
+        }
+        while( rc == 0 && (blk = SRAFastqFile_Find(self, pos)) == NULL ) {
+            DEBUG_MSG(10, ("Caching for pos %lu %lu bytes\n", pos, size - *num_read));
+            if( (rc = SRAFastqFile_Claim(self, pos, eBlockLoading, &blk)) == 0 ) {
+                if( blk != NULL ) {
+                    load = true;
+                    break;
+                }
+                /* every slot is pinned by other readers */
+                rc = KConditionWait(self->released, self->lock);
+            }
+        }
+        if( rc == 0 ) {
+            if( blk->state == eBlockQueued ) {
+                /* read ahead did not get to it yet */
+                blk->state = eBlockLoading;
+                load = true;
+            }
+            blk->refs++;
+            blk->used = ++self->tick;
+            SRAFastqFile_ReadAhead(self, blk);
+            if( load ) {
+                rc_t r;
+                ReleaseComplain(KLockUnlock, self->lock);
+                r = SRAFastqFile_Format(self, blk);
+                if( (rc = KLockAcquire(self->lock)) != 0 ) {
+                    break;
                 }
+                SRAFastqFile_Loaded(self, blk, r);
+            }
+            while( rc == 0 && blk->state == eBlockLoading ) {
+                rc = KConditionWait(blk->loaded, self->lock);
             }
-            if( rc == 0 ) {
-                off_t from = pos - self->from;
-                size_t q = (self->size - from) > (size - *num_read) ? (size - *num_read) : (self->size - from);
+            if( rc == 0 && blk->state == eBlockFailed ) {
+                rc = blk->rc;
+            }
+            ReleaseComplain(KLockUnlock, self->lock);
+        }
+        if( blk == NULL ) {
+            ReleaseComplain(KLockUnlock, self->lock);
+            break;
+        }
+        if( rc == 0 ) {
+            /* block is pinned and immutable while ready */
+            uint64_t from = pos - blk->from;
+            if( from >= blk->size ) {
+                rc = RC(rcExe, rcFile, rcReading, rcData, rcCorrupt);
+            } else {
+                size_t q = (blk->size - from) > (size - *num_read) ? (size - *num_read) : (blk->size - from);
                 DEBUG_MSG(10, ("Copying from %lu %u bytes\n", from, q));
-                memmove(&((char*)buffer)[*num_read], &self->buf[from], q);
+                memmove(&((char*)buffer)[*num_read], &blk->buf[from], q);
                 *num_read = *num_read + q;
                 pos += q;
             }
-        } while( rc == 0 && *num_read < size && pos < self->file_sz );
-        ReleaseComplain(KLockUnlock, self->lock);
+        }
+        if( KLockAcquire(self->lock) == 0 ) {
+            SRAFastqFile_Unpin(self, blk);
+            ReleaseComplain(KLockUnlock, self->lock);
+        }
     }
     return rc;
 }
@@ -197,39 +459,43 @@ rc_t SRAFastqFile_Open(const KFile** cself, const SRAListNode* sra, const FileOp
     {
         if ( ( rc = KFileInit( &self->dad, (const KFile_vt*)&SRAFastqFile_vtbl, "SRAFastqFile", "no-name", true, false ) ) == 0 )
         {
-            if ( ( rc = SRAListNode_TableOpen( sra, &self->stbl ) ) == 0 )
+            self->opt = *opt;
+            self->file_sz = opt->file_sz;
+            self->buffer_sz = opt->buffer_sz;
+            self->gzip = opt->f.fastq.gzip;
+            if ( ( rc = SRAListNode_TableOpen( sra, &self->stbl ) ) == 0 &&
+                 ( rc = SRATableGetKTableRead( self->stbl, &self->ktbl ) ) == 0 &&
+                 ( rc = KTableOpenIndexRead( self->ktbl, &self->kidx, opt->index ) ) == 0 &&
+                 ( rc = KLockMake( &self->lock ) ) == 0 &&
+                 ( rc = KConditionMake( &self->released ) ) == 0 &&
+                 ( rc = KConditionMake( &self->queued ) ) == 0 )
             {
-                if ( ( rc = SRATableGetKTableRead( self->stbl, &self->ktbl ) ) == 0 )
+                uint32_t i;
+                for ( i = 0; rc == 0 && i < SRAFASTQ_CACHE_SLOTS; i++ )
                 {
-                    if ( ( rc = KTableOpenIndexRead( self->ktbl, &self->kidx, opt->index ) ) == 0 )
+                    SRAFastqBlock* b = &self->slots[ i ];
+                    if ( ( rc = KConditionMake( &b->loaded ) ) == 0 )
                     {
-                        if ( ( rc = KLockMake( &self->lock ) ) == 0 )
+                        MALLOC( b->buf, opt->buffer_sz * ( self->gzip ? 2 : 1 ) );
+                        if ( b->buf == NULL )
+                        {
+                            rc = RC( rcExe, rcFile, rcOpening, rcMemory, rcExhausted );
+                        }
+                        else if ( self->gzip )
                         {
-                            MALLOC( self->buf, opt->buffer_sz * ( opt->f.fastq.gzip ? 2 : 1 ) );
-                            if ( self->buf == NULL )
-                            {
-                                rc = RC( rcExe, rcFile, rcOpening, rcMemory, rcExhausted );
-                            }
-                            else
-                            {
-                                self->file_sz = opt->file_sz;
-                                self->buffer_sz = opt->buffer_sz;
-                                if ( opt->f.fastq.gzip )
-                                {
-                                    self->gzipped = &self->buf[ opt->buffer_sz ];
-                                }
-                                self->from = ~0; /* reset position beyond file end */
-                                rc = FastqReaderMake( &self->reader, self->stbl,
-                                                      opt->f.fastq.accession, opt->f.fastq.colorSpace,
-                                                      opt->f.fastq.origFormat, false, opt->f.fastq.printLabel,
-                                                      opt->f.fastq.printReadId, !opt->f.fastq.clipQuality, false,
-                                                      opt->f.fastq.minReadLen, opt->f.fastq.qualityOffset,
-                                                      opt->f.fastq.colorSpaceKey,
-                                                      opt->f.fastq.minSpotId, opt->f.fastq.maxSpotId );
-                            }
+                            b->gzipped = &b->buf[ opt->buffer_sz ];
                         }
                     }
                 }
+                if ( rc == 0 )
+                {
+                    /* other slots make their readers on first use */
+                    rc = SRAFastqFile_ReaderMake( self, &self->slots[ 0 ].reader );
+                }
+                for ( i = 0; rc == 0 && i < SRAFASTQ_THREADS; i++ )
+                {
+                    rc = KThreadMake( &self->threads[ i ], SRAFastqFile_Thread, self );
+                }
             }
             if ( rc == 0 )
             {
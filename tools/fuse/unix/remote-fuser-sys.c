@@ -461,6 +461,9 @@ void CoreUsage(int fd, const char *progName, bool showHelp, bool showVersion, bo
                 "                                       level is an integer value from 1 to 10,\n"
                 "                                       which correspond to block sizes:\n"
                 "                                       32K,64K,128K,256K,512K,1M,2M,4M,8M,16M\n"
+                "    -P|--prefetch <blocks>             Amount of blocks to fetch into cache ahead\n"
+                "                                       of sequential reader, default: 4,\n"
+                "                                       0 - no prefetch.\n"
                 );
             KOutMsg(
                 "    --SRA-check <secs>                 Check SRA config and runs for update\n"
@@ -516,7 +519,7 @@ rc_t CC KMain(int argc, char *argv[])
     char** fargs = (char**)calloc(argc, sizeof(char*));
     uint32_t heart_beat_check = 30, log_sync = 0, sra_sync = 0;
     int log_fd = STDOUT_FILENO;
-    uint32_t block_level = 0, block_size = 0;
+    uint32_t block_level = 0, block_size = 0, prefetch = 4;
 
 #ifdef SRAFUSER_LOGLOCALTIME
     KLogFmtFlagsSet(klogFmtLocalTimestamp);
@@ -540,6 +543,8 @@ rc_t CC KMain(int argc, char *argv[])
             xml_root = argv[++i];
         } else if(!strcmp(argv[i], "-B") || !strcmp(argv[i], "--Blevel")) {
             block_level = AsciiToU32(argv[++i], NULL, NULL);
+        } else if(!strcmp(argv[i], "-P") || !strcmp(argv[i], "--prefetch")) {
+            prefetch = AsciiToU32(argv[++i], NULL, NULL);
         } else if(!strcmp(argv[i], "-ds") || !strcmp(argv[i], "--SRA-check")) {
             sra_sync = AsciiToU32(argv[++i], NULL, NULL);
         } else if(!strcmp(argv[i], "-u") || !strcmp (argv[i], "--unmount")) {
@@ -626,6 +631,7 @@ rc_t CC KMain(int argc, char *argv[])
     else {
         block_size = 0;
     }
+    RemoteCacheSetPrefetchWindow ( prefetch );
     if( i != argc ) {
         LOGERR(klogErr, RC(rcExe, rcArgv, rcValidating, rcParam, rcExcessive), argv[i]);
         CoreUsage(log_fd, argv[0], true, false, true);
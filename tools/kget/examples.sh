@@ -55,6 +55,15 @@ echo "example number 10: download the remote file, no buffering, no cachefile"
 echo "                  in 32k blocks, but requests are made in random order"
 execute "time kget $URL --random"
 
+echo "example number 11: download the remote file, no buffering, no cachefile"
+echo "                  in 128k blocks, fetched by 8 concurrent workers"
+execute "time kget $URL --block-size 128k --workers 8"
+
+echo "example number 12: download the remote file, using a cache-file"
+echo "                  in 128k blocks, fetched by 8 concurrent workers in random order"
+execute "rm -f $CACHEFILE"
+execute "time kget $URL --cache $CACHEFILE --block-size 128k --workers 8 --random"
+
 #enable this example only after updating the PROXY-variable
 #and actually having a running proxy there!
 #echo "example number X: download the remote file, using a proxy"
@@ -45,6 +45,8 @@
 #include <kns/stream.h>
 
 #include <kproc/timeout.h>
+#include <kproc/lock.h>
+#include <kproc/thread.h>
 
 #include <os-native.h>
 #include <sysalloc.h>
@@ -53,6 +55,10 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if ! WINDOWS
+#include <time.h>
+#endif
+
 /*===========================================================================
 
     kget is a works like a simple version of wget
@@ -142,6 +148,10 @@ static const char * ccompl_usage[]      = { "check completeness on open cachetee
 #define ALIAS_FULL "f"
 static const char * full_usage[]        = { "download via one http-request, not partial requests in a loop", NULL };
 
+#define OPTION_WORKERS "workers"
+static const char * workers_usage[]     = { "fetch blocks concurrently with this many threads, report throughput and latency", NULL };
+#define MAX_WORKERS 64
+
 OptDef MyOptions[] =
 {
 /*    name              alias           fkt    usage-txt,       cnt, needs value, required */
@@ -164,7 +174,8 @@ OptDef MyOptions[] =
     { OPTION_COUNT,     NULL,           NULL, count_usage,      1,  true,        false },
     { OPTION_PROGRESS,  NULL,           NULL, progress_usage,   1,  false,       false },
     { OPTION_RELIABLE,  NULL,           NULL, reliable_usage,   1,  false,       false },
-    { OPTION_FULL,      ALIAS_FULL,     NULL, full_usage,       1,  false,       false }
+    { OPTION_FULL,      ALIAS_FULL,     NULL, full_usage,       1,  false,       false },
+    { OPTION_WORKERS,   NULL,           NULL, workers_usage,    1,  true,        false }
 };
 
 rc_t CC Usage ( const Args * args )
@@ -205,6 +216,8 @@ typedef struct fetch_ctx
     size_t sleep_time;
     size_t timeout_time;
     size_t cache_blk;
+    size_t workers;
+    struct KNSManager * kns_mgr;
     bool verbose;
     bool show_filesize;
     bool random;
@@ -276,6 +289,32 @@ static uint32_t randr( uint32_t min, uint32_t max )
 }
 
 
+static uint32_t * make_block_vector( uint32_t block_count, bool random )
+{
+    uint32_t * block_vector = malloc( block_count * ( sizeof * block_vector ) );
+    if ( block_vector != NULL )
+    {
+        uint32_t loop;
+
+        /* fill the block_vector with ascending numbers */
+        for ( loop = 0; loop < block_count; loop++ )
+            block_vector[ loop ] = loop;
+
+        /* randomize them */
+        for ( loop = 0; random && loop < block_count; loop++ )
+        {
+            uint32_t src_idx = randr( 0, block_count - 1 );
+            uint32_t dst_idx = randr( 0, block_count - 1 );
+            /* swap it... */
+            uint32_t tmp = block_vector[ dst_idx ];
+            block_vector[ dst_idx ] = block_vector[ src_idx ];
+            block_vector[ src_idx ] = tmp;
+        }
+    }
+    return block_vector;
+}
+
+
 static rc_t block_loop_random( const KFile *src, KFile *dst, char * buffer,
                                uint64_t *bytes_copied, fetch_ctx * ctx )
 {
@@ -288,25 +327,10 @@ static rc_t block_loop_random( const KFile *src, KFile *dst, char * buffer,
         if ( rc == 0 )
         {
             uint32_t block_count = ( src_size / ctx->blocksize ) + 1;
-            uint32_t * block_vector = malloc( block_count * ( sizeof * block_vector ) );
+            uint32_t * block_vector = make_block_vector( block_count, true );
             if ( block_vector != NULL )
             {
                 uint32_t loop;
-                
-                /* fill the block_vector with ascending numbers */
-                for ( loop = 0; loop < block_count; loop++ )
-                    block_vector[ loop ] = loop;
-                
-                /* randomize them */
-                for ( loop = 0; loop < block_count; loop++ )
-                {
-                    uint32_t src_idx = randr( 0, block_count - 1 );
-                    uint32_t dst_idx = randr( 0, block_count - 1 );
-                    /* swap it... */
-                    uint32_t tmp = block_vector[ dst_idx ];
-                    block_vector[ dst_idx ] = block_vector[ src_idx ];
-                    block_vector[ src_idx ] = tmp;
-                }
 
                 for ( loop = 0; rc == 0 && loop < block_count; loop++ )
                 {
@@ -329,6 +353,258 @@ static rc_t block_loop_random( const KFile *src, KFile *dst, char * buffer,
 }
 
 
+/* -------------------------------------------------------------------------------------------------------------------- */
+
+/* --workers: the block-indices are put into a queue, each worker-thread takes the
+   next one from it and fetches that block. Without a cache-file every worker has its
+   own remote-file ( and therefore its own connection ), with a cache-file all workers
+   go through the same cache-tee-file. The time each block takes is recorded to report
+   throughput and latency per worker and for all of them together. */
+
+static uint64_t now_us( void )
+{
+#if ! WINDOWS
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( ( uint64_t )ts.tv_sec * 1000000 ) + ( ts.tv_nsec / 1000 );
+#else
+    return ( uint64_t )KTimeMsStamp() * 1000;
+#endif
+}
+
+
+typedef struct block_queue
+{
+    KLock * lock;
+    uint32_t * blocks;      /* block-index to fetch, per slot */
+    uint32_t * latency;     /* how many microseconds it took, per slot */
+    uint8_t * owner;        /* which worker fetched it, per slot */
+    uint32_t count;
+    uint32_t next;
+    rc_t rc;                /* the first error stops all workers */
+    bool show_progress;
+} block_queue;
+
+
+static bool block_queue_next( block_queue * q, uint32_t * slot )
+{
+    bool res = false;
+    if ( KLockAcquire( q->lock ) == 0 )
+    {
+        if ( q->rc == 0 && q->next < q->count )
+        {
+            *slot = q->next++;
+            if ( q->show_progress && ( ( *slot & 0x0F ) == 0 ) ) KOutMsg( "." );
+            res = true;
+        }
+        KLockUnlock( q->lock );
+    }
+    return res;
+}
+
+
+static void block_queue_fail( block_queue * q, rc_t rc )
+{
+    if ( KLockAcquire( q->lock ) == 0 )
+    {
+        if ( q->rc == 0 )
+            q->rc = rc;
+        KLockUnlock( q->lock );
+    }
+}
+
+
+typedef struct block_worker
+{
+    KThread * thread;
+    block_queue * queue;
+    const KFile * src;
+    KFile * dst;
+    fetch_ctx * ctx;
+    char * buffer;
+    uint64_t bytes;
+    uint64_t elapsed;       /* microseconds from start to end of this worker */
+    uint32_t blocks;
+    uint8_t id;
+    bool own_src;
+} block_worker;
+
+
+static rc_t CC block_worker_run( const KThread * self, void * data )
+{
+    block_worker * w = data;
+    block_queue * q = w->queue;
+    uint64_t started = now_us();
+    uint32_t slot;
+    rc_t rc = 0;
+
+    while ( rc == 0 && block_queue_next( q, &slot ) )
+    {
+        size_t num_read = 0;
+        uint64_t pos = w->ctx->blocksize;
+        uint64_t t;
+
+        pos *= q->blocks[ slot ];
+        t = now_us();
+        rc = src_2_dst( w->src, w->dst, w->buffer, pos, &num_read, w->ctx );
+        q->latency[ slot ] = ( uint32_t )( now_us() - t );
+        q->owner[ slot ] = w->id;
+        if ( rc == 0 )
+        {
+            w->blocks++;
+            w->bytes += num_read;
+        }
+        else
+            block_queue_fail( q, rc );
+        if ( w->ctx->sleep_time > 0 ) KSleepMs( w->ctx->sleep_time );
+    }
+    w->elapsed = now_us() - started;
+    return rc;
+}
+
+
+static int CC cmp_latency( const void * a, const void * b )
+{
+    uint32_t va = *( const uint32_t * )a;
+    uint32_t vb = *( const uint32_t * )b;
+    return va < vb ? -1 : ( va > vb ? 1 : 0 );
+}
+
+
+static double mb_per_sec( uint64_t bytes, uint64_t us )
+{
+    return us == 0 ? 0.0 : ( ( double )bytes / ( 1024.0 * 1024.0 ) ) / ( ( double )us / 1000000.0 );
+}
+
+
+/* sorts the given latencies and prints percentiles of them */
+static void report_latency( uint32_t * latency, uint32_t n )
+{
+    if ( n == 0 )
+        KOutMsg( "latency  : -\n" );
+    else
+    {
+        qsort( latency, n, sizeof *latency, cmp_latency );
+        KOutMsg( "latency  : p50 = %u us, p90 = %u us, p99 = %u us, max = %u us\n",
+                 latency[ ( ( n - 1 ) * 50 ) / 100 ], latency[ ( ( n - 1 ) * 90 ) / 100 ],
+                 latency[ ( ( n - 1 ) * 99 ) / 100 ], latency[ n - 1 ] );
+    }
+}
+
+
+static void report_workers( block_queue * q, block_worker * w, uint32_t n, uint64_t wall )
+{
+    uint32_t * tmp = malloc( q->count * sizeof *tmp );
+    uint64_t bytes = 0;
+    uint32_t i, j, k;
+
+    for ( i = 0; i < n; ++i )
+    {
+        KOutMsg( "worker #%u : %u blocks, %lu bytes in %lu ms = %.2f MB/s\n",
+                 i, w[ i ].blocks, w[ i ].bytes, w[ i ].elapsed / 1000,
+                 mb_per_sec( w[ i ].bytes, w[ i ].elapsed ) );
+        if ( tmp != NULL )
+        {
+            for ( j = k = 0; j < q->next; ++j )
+                if ( q->owner[ j ] == i ) tmp[ k++ ] = q->latency[ j ];
+            report_latency( tmp, k );
+        }
+        bytes += w[ i ].bytes;
+    }
+    KOutMsg( "total : %u blocks, %lu bytes in %lu ms = %.2f MB/s\n",
+             q->next, bytes, wall / 1000, mb_per_sec( bytes, wall ) );
+    report_latency( q->latency, q->next );
+    free( tmp );
+}
+
+
+static rc_t make_remote_file( struct KNSManager * kns_mgr, const KFile ** src, fetch_ctx * ctx );
+
+static rc_t block_loop_workers( const KFile *src, KFile *dst, uint64_t *bytes_copied, fetch_ctx * ctx )
+{
+    uint64_t src_size;
+    rc_t rc = KFileSize ( src, &src_size );
+    KOutMsg( "copy-mode : %u workers, %s blocks\n", ( uint32_t )ctx->workers, ctx->random ? "random" : "linear" );
+    if ( rc == 0 )
+        rc = KFileSetSize ( dst, src_size );
+    if ( rc == 0 )
+    {
+        block_queue q;
+        block_worker * w = calloc( ctx->workers, sizeof *w );
+
+        memset( &q, 0, sizeof q );
+        q.count = ( uint32_t )( ( src_size + ctx->blocksize - 1 ) / ctx->blocksize );
+        q.show_progress = ctx->show_progress;
+        q.blocks = make_block_vector( q.count, ctx->random );
+        q.latency = calloc( q.count + 1, sizeof *q.latency );
+        q.owner = calloc( q.count + 1, sizeof *q.owner );
+        if ( w == NULL || ( q.blocks == NULL && q.count > 0 ) || q.latency == NULL || q.owner == NULL )
+            rc = RC( rcExe, rcFile, rcPacking, rcMemory, rcExhausted );
+        else
+            rc = KLockMake( &q.lock );
+        if ( rc == 0 )
+        {
+            uint32_t i, started = 0;
+            uint64_t wall = now_us();
+
+            for ( i = 0; rc == 0 && i < ctx->workers; ++i )
+            {
+                w[ i ].queue = &q;
+                w[ i ].dst = dst;
+                w[ i ].ctx = ctx;
+                w[ i ].id = ( uint8_t )i;
+                w[ i ].src = src;
+                if ( i > 0 && ctx->cache_file == NULL && ctx->kns_mgr != NULL )
+                {
+                    rc = make_remote_file( ctx->kns_mgr, &w[ i ].src, ctx );
+                    w[ i ].own_src = ( rc == 0 );
+                }
+                if ( rc == 0 )
+                {
+                    w[ i ].buffer = malloc( ctx->blocksize );
+                    if ( w[ i ].buffer == NULL )
+                        rc = RC( rcExe, rcFile, rcPacking, rcMemory, rcExhausted );
+                }
+                if ( rc == 0 )
+                    rc = KThreadMake( &w[ i ].thread, block_worker_run, &w[ i ] );
+                if ( rc == 0 )
+                    started++;
+                else
+                    block_queue_fail( &q, rc );
+            }
+
+            for ( i = 0; i < started; ++i )
+            {
+                rc_t rc_w;
+                rc_t rc2 = KThreadWait( w[ i ].thread, &rc_w );
+                if ( rc2 == 0 ) rc2 = rc_w;
+                if ( rc == 0 ) rc = rc2;
+                KThreadRelease( w[ i ].thread );
+            }
+            wall = now_us() - wall;
+            if ( rc == 0 ) rc = q.rc;
+
+            if ( ctx->show_progress ) KOutMsg( "\n" );
+            for ( i = 0; i < ctx->workers; ++i )
+                *bytes_copied += w[ i ].bytes;
+            report_workers( &q, w, started, wall );
+
+            for ( i = 0; i < ctx->workers; ++i )
+            {
+                if ( w[ i ].own_src ) KFileRelease( w[ i ].src );
+                free( w[ i ].buffer );
+            }
+            KLockRelease( q.lock );
+        }
+        free( q.owner );
+        free( q.latency );
+        free( q.blocks );
+        free( w );
+    }
+    return rc;
+}
+
+
 static rc_t copy_file( const KFile * src, KFile * dst, fetch_ctx * ctx )
 {
     rc_t rc = 0;
@@ -342,7 +618,9 @@ static rc_t copy_file( const KFile * src, KFile * dst, fetch_ctx * ctx )
     else
     {
         uint64_t bytes_copied = 0;
-        if ( ctx->count == 0 )
+        if ( ctx->count == 0 && ctx->workers > 0 )
+            rc = block_loop_workers( src, dst, &bytes_copied, ctx );
+        else if ( ctx->count == 0 )
         {
             if ( ctx->random )
                 rc = block_loop_random( src, dst, buffer, &bytes_copied, ctx );
@@ -505,7 +783,9 @@ static rc_t fetch( KDirectory *dir, fetch_ctx *ctx )
             rc = make_remote_file( kns_mgr, &remote, ctx );
             if ( rc == 0 )
             {
+                ctx->kns_mgr = kns_mgr; /* the workers make their own remote-files */
                 rc = fetch_from( dir, ctx, outfile, remote );
+                ctx->kns_mgr = NULL;
                 KFileRelease( remote );
             }
         }
@@ -899,6 +1179,9 @@ rc_t get_fetch_ctx( Args * args, fetch_ctx * ctx )
     if ( rc == 0 ) rc = get_bool( args, OPTION_PROGRESS, &ctx->show_progress );
     if ( rc == 0 ) rc = get_bool( args, OPTION_RELIABLE, &ctx->reliable );
     if ( rc == 0 ) rc = get_bool( args, OPTION_FULL, &ctx->full_download );
+    if ( rc == 0 ) rc = get_size_t( args, OPTION_WORKERS, &ctx->workers, 0 );
+    if ( rc == 0 && ctx->workers > MAX_WORKERS ) ctx->workers = MAX_WORKERS;
+    ctx->kns_mgr = NULL;
     
     return rc;
 }
@@ -35,6 +35,7 @@
 
 #include <sysalloc.h>
 #include <string.h>
+#include <stdlib.h> /* strtoull */
 
 #include <iostream>
 
@@ -48,12 +49,20 @@ const char * ref_usage[] = { "Filter by position on genome.",
                              "Name can either be file specific or canonical",
                              "(ex: \"chr1\" or \"1\").",
                              "\"from\" and \"to\" are 1-based coordinates",
+                             "(ex: \"chr1:1000-2000\"), can be repeated",
                              NULL };
+
+#define OPTION_THREADS "threads"
+#define ALIAS_THREADS  "t"
+const char * threads_usage[] = { "Number of worker threads, 1 by default.",
+                                 "The output is the same for any number of threads",
+                                 NULL };
                              
 OptDef options[] =
 {   /*name,           alias,         hfkt, usage-help,    maxcount, needs value, required */
     { OPTION_REF,     ALIAS_REF,     NULL, ref_usage,     0,        true,        false },
     { OPTION_NGC,     ALIAS_NGC,     NULL, ngc_usage,     0,        true,        false },
+    { OPTION_THREADS, ALIAS_THREADS, NULL, threads_usage, 1,        true,        false },
 };
 
 
@@ -96,7 +105,9 @@ rc_t CC Usage ( const Args * args )
         const char *param = NULL;
         if (alias != NULL) {
             if (strcmp(alias, ALIAS_REF) == 0)
-                param = "region";
+                param = "name[:from-to]";
+            else if (strcmp(alias, ALIAS_THREADS) == 0)
+                param = "count";
         }
         else if (strcmp(opt->name, OPTION_NGC) == 0)
             param = "PATH";
@@ -111,6 +122,44 @@ rc_t CC Usage ( const Args * args )
     return rc;
 }
 
+/* name[:from-to], from and to are 1-based and inclusive; "name:from" means up to the end */
+static
+void AddRegion ( NGS_Pileup::Settings & settings, const std::string & region )
+{
+    std :: string :: size_type colon = region . rfind ( ':' );
+    if ( colon == std :: string :: npos )
+    {
+        settings . AddReference ( region );
+        return;
+    }
+    
+    const char * start = region . c_str () + colon + 1;
+    char * end;
+    unsigned long long from = strtoull ( start, & end, 10 );
+    unsigned long long to = 0;
+    if ( end == start || from == 0 )
+    {
+        throw ngs :: ErrorMsg ( "invalid region: " + region );
+    }
+    if ( * end == '-' )
+    {
+        start = end + 1;
+        to = strtoull ( start, & end, 10 );
+        if ( end == start || to < from )
+        {
+            throw ngs :: ErrorMsg ( "invalid region: " + region );
+        }
+    }
+    if ( * end != 0 )
+    {
+        throw ngs :: ErrorMsg ( "invalid region: " + region );
+    }
+    
+    settings . AddReferenceSlice ( region . substr ( 0, colon ), 
+                                   ( int64_t ) from - 1, 
+                                   to == 0 ? 0 : ( uint64_t ) ( to - from + 1 ) );
+}
+
 rc_t CC KMain( int argc, char *argv [] )
 {
     Args * args;
@@ -127,18 +176,30 @@ rc_t CC KMain( int argc, char *argv [] )
             void const *value = NULL;
 
             rc = ArgsOptionCount ( args, OPTION_REF, &pcount );
-            if ( pcount > 1 )
+            for ( uint32_t i = 0; i < pcount; ++ i )
             {
-                throw ngs :: ErrorMsg ( "multiple positions are not supported at this point" );
+                rc = ArgsOptionValue ( args, OPTION_REF, i, & value );
+                if ( rc != 0 )
+                {
+                    throw ngs :: ErrorMsg ( "ArgsOptionValue (" OPTION_REF ") failed" );
+                }
+                AddRegion ( settings, static_cast <char const*> (value) );
             }
+            
+            rc = ArgsOptionCount ( args, OPTION_THREADS, &pcount );
             if ( pcount == 1 )
             {
-                rc = ArgsOptionValue ( args, OPTION_REF, 0, & value );
+                rc = ArgsOptionValue ( args, OPTION_THREADS, 0, & value );
                 if ( rc != 0 )
                 {
-                    throw ngs :: ErrorMsg ( "ArgsOptionValue (" OPTION_REF ") failed" );
+                    throw ngs :: ErrorMsg ( "ArgsOptionValue (" OPTION_THREADS ") failed" );
+                }
+                unsigned long threads = strtoul ( static_cast <char const*> (value), NULL, 10 );
+                if ( threads == 0 || threads > 256 )
+                {
+                    throw ngs :: ErrorMsg ( "invalid number of threads" );
                 }
-                settings . AddReference ( static_cast <char const*> (value) );
+                settings . threads = ( unsigned int ) threads;
             }
             
 /* OPTION_NGC */
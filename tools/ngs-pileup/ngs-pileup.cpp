@@ -27,37 +27,38 @@
 #include "ngs-pileup.hpp"
 
 #include <iostream>
+#include <sstream>
+#include <algorithm>
 
 #include <ngs/ncbi/NGS.hpp>
+#include <ngs/ErrorMsg.hpp>
 #include <ngs/ReadCollection.hpp>
 #include <ngs/PileupIterator.hpp>
 
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+
 using namespace std;
 
 struct NGS_Pileup::TargetReference
 {
-    typedef pair < int64_t, int64_t >       Slice;
+    typedef pair < int64_t, int64_t >       Slice;  /* first, last; 0-based, inclusive */
     typedef vector < Slice >                Slices;
     typedef vector < ngs :: Reference >     Targets;
+    typedef pair < size_t, string >         Source; /* index of the input, common name of the reference in it */
+    typedef vector < Source >               Sources;
     typedef vector < ngs :: PileupIterator> Pileups;
     
     string  m_canonicalName;
     Slices  m_slices;
     Targets m_targets;
-    Pileups m_pileups;
+    Sources m_sources;
     bool    m_complete;
     
-    TargetReference ( ngs :: Reference p_ref )
-    : m_canonicalName ( p_ref . getCanonicalName() ), m_complete ( true )
-    {
-        AddReference ( p_ref );
-    }
-    TargetReference ( ngs :: Reference p_ref, 
-                      int64_t p_first, 
-                      int64_t p_last )
-    : m_canonicalName ( p_ref . getCanonicalName() ), m_complete ( false )
+    TargetReference ( const string & p_canonicalName )
+    : m_canonicalName ( p_canonicalName ), m_complete ( false )
     {
-        AddReference ( p_ref );
     }
     ~TargetReference ()
     {
@@ -65,6 +66,10 @@ struct NGS_Pileup::TargetReference
     
     void AddSlice ( int64_t p_first, int64_t p_last )
     {
+        if ( ! m_complete )
+        {
+            m_slices . push_back ( Slice ( p_first, p_last ) );
+        }
     }
     void MakeComplete ()
     {
@@ -72,27 +77,72 @@ struct NGS_Pileup::TargetReference
         m_slices . clear();
     }
     
-    void AddReference ( ngs :: Reference p_ref )
+    void AddReference ( ngs :: Reference p_ref, size_t p_input )
     {
         m_targets. push_back ( p_ref );
+        m_sources . push_back ( Source ( p_input, p_ref . getCommonName () ) );
     }
     
-    void Process ( ostream& out )
+    int64_t Length () const
     {
-        int64_t firstPos = 0;
-        int64_t lastPos = m_targets . front () . getLength () - 1;
-
+        return m_targets . front () . getLength ();
+    }
+    
+    /* sorts the slices and merges the overlapping and adjacent ones, so that every position is reported once */
+    void Normalize ()
+    {
+        int64_t lastPos = Length () - 1;
+        if ( m_complete )
+        {
+            m_slices . assign ( 1, Slice ( 0, lastPos ) );
+            return;
+        }
+        
+        sort ( m_slices . begin (), m_slices . end () );
+        
+        Slices merged;
+        for ( Slices :: const_iterator i = m_slices . begin (); i != m_slices . end (); ++i )
+        {
+            Slice s ( max ( i -> first, ( int64_t ) 0 ), min ( i -> second, lastPos ) );
+            if ( s . first > s . second )
+            {
+                continue;
+            }
+            if ( ! merged . empty () && s . first <= merged . back () . second + 1 )
+            {
+                merged . back () . second = max ( merged . back () . second, s . second );
+            }
+            else
+            {
+                merged . push_back ( s );
+            }
+        }
+        m_slices . swap ( merged );
+    }
+    
+    void Process ( ostream& out ) const
+    {
+        for ( Slices :: const_iterator i = m_slices . begin (); i != m_slices . end (); ++i )
+        {
+            Process ( out, m_targets, i -> first, i -> second );
+        }
+    }
+    
+    void Process ( ostream& out, const Targets & p_targets, int64_t firstPos, int64_t lastPos ) const
+    {
+        Pileups pileups;
+        
         // create pileup iterators 
-        for ( Targets::iterator i = m_targets.begin(); i != m_targets.end(); ++i ) 
+        for ( Targets::const_iterator i = p_targets.begin(); i != p_targets.end(); ++i ) 
         {
-            m_pileups . push_back ( i -> getPileups ( ngs::Alignment::all ) );
+            pileups . push_back ( i -> getPileupSlice ( firstPos, lastPos - firstPos + 1, ngs::Alignment::all ) );
         }
         
         int64_t curPos = firstPos;
         while ( curPos <= lastPos ) 
         {
             uint32_t total_depth = 0;
-            for ( Pileups :: iterator i = m_pileups . begin (); i != m_pileups. end (); ++i )
+            for ( Pileups :: iterator i = pileups . begin (); i != pileups. end (); ++i )
             {
                 bool next = i -> nextPileup ();
                 assert ( next );
@@ -101,10 +151,11 @@ struct NGS_Pileup::TargetReference
         
             if ( total_depth > 0 )
             {
+                // no endl here: flushing on every line dominates the run time
                 out << m_canonicalName
                     << '\t' << ( curPos + 1 ) // convert to 1-based position to emulate samtools
                     << '\t' << total_depth
-                    << endl;
+                    << '\n';
             }
             
             ++ curPos;
@@ -115,21 +166,282 @@ struct NGS_Pileup::TargetReference
 class NGS_Pileup::TargetReferences : public vector < TargetReference >
 {
 public :
-    void AddComplete ( ngs :: Reference ref )
+    TargetReference & Add ( ngs :: Reference ref, size_t input )
     {
         string name = ref . getCanonicalName ();
         for ( iterator i = begin(); i != end (); ++ i )
         {   
             if ( i -> m_canonicalName == name )
             {
-                i -> AddReference ( ref );
-                return;
+                i -> AddReference ( ref, input );
+                return * i;
             }
         }
         // not found - add new reference
-        push_back ( TargetReference ( ref ) );
+        push_back ( TargetReference ( name ) );
+        back () . AddReference ( ref, input );
+        return back ();
     }
 };
+
+/* a piece of one target reference, piled up by one of the workers */
+struct NGS_Pileup::Job
+{
+    Job ( size_t p_target, int64_t p_first, int64_t p_last )
+    : m_target ( p_target ), m_first ( p_first ), m_last ( p_last ), m_done ( false )
+    {
+    }
+    
+    size_t  m_target;
+    int64_t m_first;
+    int64_t m_last;
+    string  m_output;
+    string  m_error;
+    bool    m_done;
+};
+
+/* Workers take the jobs in order, each one with its own read collections; 
+   the main thread writes the results in the same order. 
+   Workers stay not more than two jobs each ahead of the output. */
+class NGS_Pileup::JobQueue
+{
+public:
+    JobQueue ( const Settings :: Inputs & p_inputs, const TargetReferences & p_references, unsigned int p_threads )
+    :   m_inputs ( p_inputs ),
+        m_references ( p_references ),
+        m_threads ( p_threads ),
+        m_next ( 0 ),
+        m_nextWrite ( 0 ),
+        m_abort ( false ),
+        m_lock ( 0 ),
+        m_jobDone ( 0 ),
+        m_jobWritten ( 0 )
+    {
+        for ( size_t t = 0; t < m_references . size (); ++ t )
+        {
+            const TargetReference :: Slices & slices = m_references [ t ] . m_slices;
+            for ( TargetReference :: Slices :: const_iterator i = slices . begin (); i != slices . end (); ++i )
+            {
+                for ( int64_t first = i -> first; first <= i -> second; first += ChunkSize )
+                {
+                    m_jobs . push_back ( Job ( t, first, min ( first + ChunkSize - 1, i -> second ) ) );
+                }
+            }
+        }
+        
+        if ( KLockMake ( & m_lock ) != 0 || 
+             KConditionMake ( & m_jobDone ) != 0 || 
+             KConditionMake ( & m_jobWritten ) != 0 )
+        {
+            Release ();
+            throw ngs :: ErrorMsg ( "JobQueue: cannot make lock or condition" );
+        }
+    }
+    ~JobQueue ()
+    {
+        Release ();
+    }
+    
+    void Run ( ostream & out )
+    {
+        vector < KThread * > workers;
+        for ( unsigned int i = 0; i < m_threads; ++ i )
+        {
+            KThread * t = 0;
+            if ( KThreadMake ( & t, Worker, this ) != 0 )
+            {
+                break;
+            }
+            workers . push_back ( t );
+        }
+        
+        string error;
+        if ( workers . empty () )
+        {
+            error = "JobQueue: cannot start threads";
+        }
+        else
+        {
+            try
+            {
+                Write ( out );
+            }
+            catch ( exception & ex )
+            {
+                error = ex . what ();
+            }
+        }
+        
+        if ( ! error . empty () )
+        {
+            Abort ();
+        }
+        
+        for ( size_t i = 0; i < workers . size (); ++ i )
+        {
+            rc_t status;
+            KThreadWait ( workers [ i ], & status );
+            KThreadRelease ( workers [ i ] );
+        }
+        
+        if ( ! error . empty () )
+        {
+            throw ngs :: ErrorMsg ( error );
+        }
+    }
+    
+private:
+    static const int64_t ChunkSize = 1024 * 1024; /* reference positions per job */
+    
+    static rc_t CC Worker ( const KThread * self, void * data )
+    {
+        static_cast < JobQueue * > ( data ) -> Work ();
+        return 0;
+    }
+    
+    void Work ()
+    {
+        vector < ngs :: ReadCollection > cols;
+        try
+        {
+            for ( Settings :: Inputs :: const_iterator i = m_inputs . begin (); i != m_inputs . end (); ++i )
+            {
+                cols . push_back ( ncbi :: NGS :: openReadCollection ( *i ) );
+            }
+        }
+        catch ( ... )
+        {   // nothing is taken yet, so the writer does not wait for this worker
+            Abort ();
+            return;
+        }
+        
+        for ( Job * job = Next (); job != 0; job = Next () )
+        {
+            try
+            {
+                const TargetReference & target = m_references [ job -> m_target ];
+                
+                TargetReference :: Targets refs;
+                for ( TargetReference :: Sources :: const_iterator i = target . m_sources . begin (); 
+                      i != target . m_sources . end (); 
+                      ++i )
+                {
+                    refs . push_back ( cols [ i -> first ] . getReference ( i -> second ) );
+                }
+                
+                ostringstream out;
+                target . Process ( out, refs, job -> m_first, job -> m_last );
+                job -> m_output = out . str ();
+            }
+            catch ( exception & ex )
+            {
+                job -> m_error = ex . what ();
+            }
+            catch ( ... )
+            {
+                job -> m_error = "unknown exception in pileup worker";
+            }
+            
+            Done ( * job );
+        }
+    }
+    
+    Job * Next ()
+    {
+        Job * ret = 0;
+        KLockAcquire ( m_lock );
+        while ( ! m_abort && m_next < m_jobs . size () && m_nextWrite + m_threads * 2 <= m_next )
+        {
+            KConditionWait ( m_jobWritten, m_lock );
+        }
+        if ( ! m_abort && m_next < m_jobs . size () )
+        {
+            ret = & m_jobs [ m_next ++ ];
+        }
+        KLockUnlock ( m_lock );
+        return ret;
+    }
+    
+    void Done ( Job & job )
+    {
+        KLockAcquire ( m_lock );
+        job . m_done = true;
+        KConditionBroadcast ( m_jobDone );
+        KLockUnlock ( m_lock );
+    }
+    
+    void Abort ()
+    {
+        KLockAcquire ( m_lock );
+        m_abort = true;
+        KConditionBroadcast ( m_jobWritten );
+        KConditionBroadcast ( m_jobDone );
+        KLockUnlock ( m_lock );
+    }
+    
+    void Write ( ostream & out )
+    {
+        for ( size_t i = 0; i < m_jobs . size (); ++ i )
+        {
+            Job & job = m_jobs [ i ];
+            
+            KLockAcquire ( m_lock );
+            while ( ! job . m_done && ! ( m_abort && m_next <= i ) )
+            {
+                KConditionWait ( m_jobDone, m_lock );
+            }
+            KLockUnlock ( m_lock );
+            
+            if ( ! job . m_done )
+            {
+                throw ngs :: ErrorMsg ( "JobQueue: cannot open read collection" );
+            }
+            if ( ! job . m_error . empty () )
+            {
+                throw ngs :: ErrorMsg ( job . m_error );
+            }
+            
+            out << job . m_output;
+            string () . swap ( job . m_output );
+            
+            KLockAcquire ( m_lock );
+            m_nextWrite = i + 1;
+            KConditionBroadcast ( m_jobWritten );
+            KLockUnlock ( m_lock );
+        }
+    }
+    
+    void Release ()
+    {
+        if ( m_jobWritten != 0 )
+        {
+            KConditionRelease ( m_jobWritten );
+            m_jobWritten = 0;
+        }
+        if ( m_jobDone != 0 )
+        {
+            KConditionRelease ( m_jobDone );
+            m_jobDone = 0;
+        }
+        if ( m_lock != 0 )
+        {
+            KLockRelease ( m_lock );
+            m_lock = 0;
+        }
+    }
+    
+    const Settings :: Inputs &  m_inputs;
+    const TargetReferences &    m_references;
+    unsigned int                m_threads;
+    vector < Job >              m_jobs;
+    size_t                      m_next;
+    size_t                      m_nextWrite;
+    bool                        m_abort;
+    
+    KLock *                     m_lock;
+    KCondition *                m_jobDone;
+    KCondition *                m_jobWritten;
+};
  
 NGS_Pileup::NGS_Pileup ( const Settings& p_settings )
 : m_settings( p_settings )
@@ -137,18 +449,9 @@ NGS_Pileup::NGS_Pileup ( const Settings& p_settings )
 }
 
 static
-bool FindReference ( const NGS_Pileup :: Settings :: References & requested, const ngs :: Reference & ref )
+bool MatchReference ( const NGS_Pileup :: Settings :: ReferenceSlice & requested, const ngs :: Reference & ref )
 {
-    for ( NGS_Pileup :: Settings :: References :: const_iterator i = requested . begin(); 
-          i != requested . end (); 
-          ++i )
-    {   
-        if ( i->m_name == ref . getCanonicalName () || i->m_name == ref . getCommonName () )
-        {
-            return true;
-        }
-    }
-    return false;
+    return requested . m_name == ref . getCanonicalName () || requested . m_name == ref . getCommonName ();
 }
     
 void 
@@ -157,35 +460,69 @@ NGS_Pileup::Run () const
     TargetReferences references;
     
     // build the set of target references
-    for ( Settings :: Inputs :: const_iterator i = m_settings . inputs . begin(); 
-          i != m_settings . inputs . end (); 
-          ++i )
+    for ( size_t input = 0; input < m_settings . inputs . size (); ++ input )
     {   
-        ngs :: ReadCollection col = ncbi :: NGS :: openReadCollection ( *i );
+        ngs :: ReadCollection col = ncbi :: NGS :: openReadCollection ( m_settings . inputs [ input ] );
         ngs :: ReferenceIterator refIt = col . getReferences ();
         while ( refIt . nextReference () )
         {
+            TargetReference * target = 0;
             if ( m_settings . references . empty () ) // all references requested
             {
                 /* need to create a Reference object that is not attached to the iterator, so as
                     it is not invalidated on the next call to refIt.NextReference() */
-                references . AddComplete ( col . getReference ( refIt. getCommonName () ) );
+                target = & references . Add ( col . getReference ( refIt. getCommonName () ), input );
+                target -> MakeComplete ();
+                continue;
             }
-            else if ( FindReference ( m_settings . references, refIt ) )
-            {
-                //TODO: handle slices
-                references . AddComplete ( col . getReference ( refIt. getCommonName () ) );
+            
+            for ( Settings :: References :: const_iterator i = m_settings . references . begin(); 
+                  i != m_settings . references . end (); 
+                  ++i )
+            {   
+                if ( ! MatchReference ( * i, refIt ) )
+                {
+                    continue;
+                }
+                if ( target == 0 )
+                {
+                    target = & references . Add ( col . getReference ( refIt. getCommonName () ), input );
+                }
+                if ( i -> m_full )
+                {
+                    target -> MakeComplete ();
+                }
+                else
+                {
+                    int64_t last = i -> m_length == 0 ? 
+                        target -> Length () - 1 : 
+                        i -> m_firstPos + ( int64_t ) i -> m_length - 1;
+                    target -> AddSlice ( i -> m_firstPos, last );
+                }
             }
         }
     }
     
-    ostream & out ( m_settings . output != (ostream*)0 ? * m_settings . output : cout );
-    
-    // walk the references and output pileups
     for ( TargetReferences :: iterator i = references . begin(); i != references . end (); ++i )
     {   
-        i -> Process ( out );
+        i -> Normalize ();
+    }
+    
+    ostream & out ( m_settings . output != (ostream*)0 ? * m_settings . output : cout );
+    
+    if ( m_settings . threads > 1 )
+    {
+        JobQueue ( m_settings . inputs, references, m_settings . threads ) . Run ( out );
+    }
+    else
+    {
+        // walk the references and output pileups
+        for ( TargetReferences :: const_iterator i = references . begin(); i != references . end (); ++i )
+        {   
+            i -> Process ( out );
+        }
     }
+    out . flush ();
 }
 
 //// NGS_Pileup::Settings
@@ -199,8 +536,8 @@ NGS_Pileup::Settings::AddReference ( const string& commonOrCanonicalName )
 void 
 NGS_Pileup::Settings::AddReferenceSlice ( const string& commonOrCanonicalName, 
                                         int64_t firstPos, 
-                                        int64_t lastPos )
+                                        uint64_t length )
 { 
-    references . push_back ( ReferenceSlice ( commonOrCanonicalName, firstPos, lastPos ) ); 
+    references . push_back ( ReferenceSlice ( commonOrCanonicalName, firstPos, length ) ); 
 }
 
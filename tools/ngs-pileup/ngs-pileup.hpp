@@ -47,31 +47,37 @@ public:
             ReferenceSlice( const std::string& p_name ) /* entire reference */
             :   m_name ( p_name ), 
                 m_firstPos ( 0 ),
-                m_lastPos ( 0 ),
+                m_length ( 0 ),
                 m_full ( true )
             {
             }
             ReferenceSlice( const std::string& p_name, 
                             int64_t p_firstPos, 
-                            int64_t p_lastPos )
+                            uint64_t p_length )
             :   m_name ( p_name ), 
                 m_firstPos ( p_firstPos ),
-                m_lastPos ( p_lastPos ),
+                m_length ( p_length ),
                 m_full ( false )
             {
             }
             
             std::string m_name;
-            int64_t     m_firstPos; 
-            int64_t     m_lastPos;
+            int64_t     m_firstPos;     /* 0-based */
+            uint64_t    m_length;       /* 0 = up to the end of the reference */
             bool        m_full;
         };
         
+        Settings ()
+        :   output ( 0 ),
+            threads ( 1 )
+        {
+        }
+        
         void AddInput ( const std::string& accession ) { inputs . push_back ( accession ); }
         void AddReference ( const std::string& commonOrCanonicalName );
         void AddReferenceSlice ( const std::string& commonOrCanonicalName, 
                                  int64_t firstPos, 
-                                 int64_t lastPos );
+                                 uint64_t length );
                                  
                                  
         typedef std::vector < std::string > Inputs;
@@ -80,6 +86,7 @@ public:
         Inputs inputs;
         std::ostream* output;
         References references;
+        unsigned int threads;   /* references ( or parts of them ) are piled up in parallel, output keeps the order */
     };
     
 public:
@@ -90,6 +97,8 @@ public:
 private:
     struct TargetReference;
     class TargetReferences;
+    struct Job;
+    class JobQueue;
     
     Settings            m_settings;
 };
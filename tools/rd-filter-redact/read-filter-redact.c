@@ -77,12 +77,22 @@ typedef struct SpotIterator {
     char buffer[256];
     size_t inBuffer; /* characters in buffer */
 
+    char block[64 * 1024]; /* file is read by blocks */
+    size_t inBlock;
+    size_t blockPos;
+
     size_t filePos;
     bool eof;
     size_t line;
 
     bool hasCh;
     char ch;
+
+    /* sorted list of spots to redact */
+    spotid_t* spots;
+    size_t spotQty;
+    size_t spotMax;
+    size_t nextSpot;
 } SpotIterator;
 typedef struct Db {
     const char* table;
@@ -160,13 +170,22 @@ static rc_t SpotIteratorFileReadCharWithEof(SpotIterator* self,
         buffer[0] = self->ch;
         self->hasCh = false;
     }
+    else if (self->blockPos < self->inBlock) {
+        buffer[0] = self->block[self->blockPos++];
+    }
     else {
-        rc = KFileRead(self->file, self->filePos, buffer, 1, &num_read);
+        rc = KFileRead(self->file, self->filePos,
+            self->block, sizeof self->block, &num_read);
         if (rc == 0) {
             if (num_read == 0) {
                 self->eof = true;
             }
-            else { self->filePos += num_read; }
+            else {
+                self->filePos += num_read;
+                self->inBlock = num_read;
+                self->blockPos = 0;
+                buffer[0] = self->block[self->blockPos++];
+            }
         }
         else {
             PLOGERR(klogErr, (klogErr, rc,
@@ -374,6 +393,46 @@ static rc_t SpotIteratorReadSpotToRedact(SpotIterator* self)
     return rc;
 }
 
+/** Add a spot to the list of spots to redact */
+static rc_t SpotIteratorAddSpot(SpotIterator* self, spotid_t spot)
+{
+    assert(self);
+
+    if (self->spotQty == self->spotMax) {
+        size_t max = self->spotMax == 0 ? 1024 : self->spotMax * 2;
+        spotid_t* spots = realloc(self->spots, max * sizeof *spots);
+        if (spots == NULL) {
+            rc_t rc = RC(rcExe, rcFile, rcReading, rcMemory, rcExhausted);
+            LOGERR(klogErr, rc, "while reading spots to redact");
+            return rc;
+        }
+        self->spots = spots;
+        self->spotMax = max;
+    }
+
+    self->spots[self->spotQty++] = spot;
+
+    return 0;
+}
+
+/** Read all spots from input file, they are checked to be sorted */
+static rc_t SpotIteratorReadSpotsToRedact(SpotIterator* self)
+{
+    rc_t rc = 0;
+
+    assert(self);
+
+    while (rc == 0 && !self->eof) {
+        spotid_t last = self->spotToReduct;
+        rc = SpotIteratorReadSpotToRedact(self);
+        if (rc == 0 && self->spotToReduct != last) {
+            rc = SpotIteratorAddSpot(self, self->spotToReduct);
+        }
+    }
+
+    return rc;
+}
+
 
 static rc_t SpotIteratorInit(const char* redactFileName,
     const Db* db, SpotIterator* self)
@@ -408,7 +467,7 @@ static rc_t SpotIteratorInit(const char* redactFileName,
     }
 
     if (rc == 0) {
-        rc = SpotIteratorReadSpotToRedact(self);
+        rc = SpotIteratorReadSpotsToRedact(self);
     }
 
     return rc;
@@ -424,8 +483,13 @@ static rc_t SpotIteratorDestroy(SpotIterator* it)
 
     it->file = NULL;
     it->inBuffer = 0;
+    it->inBlock = 0;
     it->hasCh = false;
 
+    free(it->spots);
+    it->spots = NULL;
+    it->spotQty = it->spotMax = 0;
+
     {
         rc_t rc2 = KDirectoryRelease(__SpotIteratorDirectory);
         if (rc == 0)
@@ -438,30 +502,27 @@ static rc_t SpotIteratorDestroy(SpotIterator* it)
 
 /** Get next spot id, check whether it should be redacted.
 Returns false if maxSpotId reached */
-static bool SpotIteratorNext(SpotIterator* self, rc_t* rc,
+static bool SpotIteratorNext(SpotIterator* self,
     int64_t* spot, bool* toRedact)
 {
-    bool hasNext = false;
+    assert(self && spot && toRedact);
 
-    assert(self && rc && spot && toRedact);
-
-    *rc = 0;
     *toRedact = false;
 
-    if (self->crnSpotId <= self->maxSpotId) {
-        hasNext = true;
-        *spot = self->crnSpotId++;
+    if (self->crnSpotId > self->maxSpotId) {
+        return false;
     }
 
-    if (*spot == self->spotToReduct) {
+    *spot = self->crnSpotId++;
+
+    if (self->nextSpot < self->spotQty
+        && self->spots[self->nextSpot] == *spot)
+    {
         *toRedact = true;
-        *rc = SpotIteratorReadSpotToRedact(self);
-        if (*rc != 0) {
-            hasNext = false;
-        }
+        ++self->nextSpot;
     }
 
-    return hasNext;
+    return true;
 }
 
 static rc_t DbInit(rc_t rc, const CmdLine* args, Db* db)
@@ -617,6 +678,47 @@ static rc_t DbDestroy(Db* db)
     return rc;
 }
 
+/** Write the same READ_FILTER to count consecutive rows */
+static rc_t DbWriteRows(Db* db,
+    const void* buffer, uint8_t nreads, uint64_t count)
+{
+    rc_t rc = 0;
+
+    assert(db);
+
+    while (rc == 0 && count > 0) {
+        rc = VCursorOpenRow(db->wCursor);
+        DISP_RC(rc, "while opening row to write");
+        if (rc == 0) {
+            rc = VCursorWrite
+                (db->wCursor, db->wIdx, 8 * nreads, buffer, 0, 1);
+            DISP_RC(rc, "while writing READ_FILTER");
+            if (rc == 0) {
+                rc = VCursorCommitRow(db->wCursor);
+                DISP_RC(rc, "while committing row");
+            }
+            if (rc == 0 && --count > 0) {
+                /* threshold is detected in CommitRow but executed on CloseRow,
+                   so do not repeat too many at once */
+                uint64_t cnt = count < 0x10000000U ? count : 0x10000000U;
+                rc = VCursorRepeatRow(db->wCursor, cnt);
+                DISP_RC(rc, "while repeating row");
+                if (rc == 0) {
+                    count -= cnt;
+                }
+            }
+            {
+                rc_t rc2 = VCursorCloseRow(db->wCursor);
+                DISP_RC(rc2, "while closing row");
+                if (rc == 0)
+                {   rc = rc2; }
+            }
+        }
+    }
+
+    return rc;
+}
+
 static rc_t Work(Db* db, SpotIterator* it)
 {
     rc_t rc = 0;
@@ -625,12 +727,17 @@ static rc_t Work(Db* db, SpotIterator* it)
     spotid_t nSpots = 0;
     spotid_t redactedSpots = 0;
 
+    /* consecutive rows with the same READ_FILTER are written at once */
+    uint8_t pending[64];
+    uint8_t pendingReads = 0;
+    uint64_t pendingRows = 0;
+
     uint8_t filter[64];
     memset(filter, SRA_READ_FILTER_REDACTED, sizeof filter);
 
     assert(it);
 
-    while (rc == 0 && SpotIteratorNext(it, &rc, &row_id, &toRedact)) {
+    while (rc == 0 && SpotIteratorNext(it, &row_id, &toRedact)) {
         uint8_t nreads = 0;
         char bufferIn[64];
         void* buffer = NULL;
@@ -657,24 +764,24 @@ static rc_t Work(Db* db, SpotIterator* it)
             buffer = bufferIn;
         }
         if (rc == 0) {
-            rc = VCursorOpenRow(db->wCursor);
-            DISP_RC(rc, "while opening row to write");
-            if (rc == 0) {
-                rc = VCursorWrite
-                    (db->wCursor, db->wIdx, 8 * nreads, buffer, 0, 1);
-                DISP_RC(rc, "while writing READ_FILTER");
-            }
-            if (rc == 0) {
-                rc = VCursorCommitRow(db->wCursor);
-                DISP_RC(rc, "while committing row");
+            if (pendingRows > 0 && (nreads != pendingReads
+                || memcmp(pending, buffer, nreads) != 0))
+            {
+                rc = DbWriteRows(db, pending, pendingReads, pendingRows);
+                pendingRows = 0;
             }
-            if (rc == 0) {
-                rc = VCursorCloseRow(db->wCursor);
-                DISP_RC(rc, "while closing row");
+            if (pendingRows == 0) {
+                memmove(pending, buffer, nreads);
+                pendingReads = nreads;
             }
+            ++pendingRows;
         }
     }
 
+    if (rc == 0 && pendingRows > 0) {
+        rc = DbWriteRows(db, pending, pendingReads, pendingRows);
+    }
+
     db->nSpots = nSpots;
     db->redactedSpots = redactedSpots;
 
@@ -857,6 +964,8 @@ static rc_t Run(const CmdLine* args)
 
     assert(args);
 
+    memset(&it, 0, sizeof it);
+
     if (!SpotIteratorFileExists(args->file)) {
         rc = RC(rcExe, rcFile, rcOpening, rcFile, rcNotFound);
         PLOGERR(klogErr,
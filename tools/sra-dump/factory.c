@@ -45,6 +45,7 @@
 #define DUMPER_MAX_KEY_LENGTH 63
 #define DUMPER_MAX_TREE_DEPTH 100
 #define DUMPER_MAX_OPEN_FILES 100
+#define DUMPER_FILE_HASH_SIZE 256
 
 #define OUTPUT_BUFFER_SIZE ( 128 * 1024 )
 
@@ -54,11 +55,16 @@ bool g_legacy_report = false;
 
 typedef struct SRASplitterFile_struct {
     SLNode dad;
+    /* chain in filer hash bucket */
+    struct SRASplitterFile_struct* hnext;
+    uint32_t hash;
+    /* position in open files list, most recently used first */
+    struct SRASplitterFile_struct* lru_prev;
+    struct SRASplitterFile_struct* lru_next;
     char* key;
     KDirectory* dir;
     char* name;
     KFile* file;
-    time_t opened;
     uint64_t pos;
     /* keep track of number of spots written to file */
     spotid_t curr_spot;
@@ -76,16 +82,21 @@ typedef struct SRASplitterFiler_struct {
     const char* arc_extension;
     KDirectory* dir;
 
-    /* TBD - this should be a BSTree */
+    /* all files in creation order, indexed by key hash */
     SLList files;
+    SRASplitterFile** hash;
+    uint32_t hash_size;
+    uint32_t file_qty;
 
     /* list of keys to construct a path */
     int path_tail; /* count of elements in path array */
     int path_len; /* cumulative length of path in array */
     const char* path[DUMPER_MAX_TREE_DEPTH];
     char key_buf[DUMPER_MAX_TREE_DEPTH * (DUMPER_MAX_KEY_LENGTH + 3) + 10];
-    /* holds opened files */
-    SRASplitterFile* open[DUMPER_MAX_OPEN_FILES];
+    /* opened files, most recently used at head */
+    SRASplitterFile* lru_head;
+    SRASplitterFile* lru_tail;
+    uint32_t open_qty;
     /* keep track of number of spots written to file */
     spotid_t curr_spot;
     uint64_t spot_qty;
@@ -93,6 +104,39 @@ typedef struct SRASplitterFiler_struct {
 
 SRASplitterFiler* g_filer = NULL;
 
+/* output key recorded by a capturing splitter tree, bound to a file on replay */
+typedef struct SRASplitterStream_struct {
+    SLNode dad;
+    /* resolved and used by replay only */
+    SRASplitterFile* file;
+    /* copy of the key path at the time the stream was activated */
+    int path_tail;
+    char** path;
+} SRASplitterStream;
+
+struct SRASplitterCapture {
+    /* key path of the capturing tree, used in place of the filer path */
+    int path_tail;
+    const char* path[DUMPER_MAX_TREE_DEPTH];
+    /* streams activated by the tree */
+    SLList streams;
+    /* receives output */
+    SRASplitterChunk* chunk;
+};
+
+/* output of a spot range as records: header followed by 8-byte padded data */
+typedef struct SRASplitterRecord_struct {
+    SRASplitterStream* stream;
+    spotid_t spot;
+    size_t size;
+} SRASplitterRecord;
+
+struct SRASplitterChunk {
+    uint8_t* buf;
+    size_t used;
+    size_t size;
+};
+
 static
 void CC SRASplitterFiler_WhackFile( SLNode *node, void *data )
 {
@@ -137,6 +181,7 @@ void SRASplitterFiler_Release(void)
 {
     if( g_filer != NULL ) {
         SLListWhack(&g_filer->files, SRASplitterFiler_WhackFile, &g_filer->keep_empty);
+        free(g_filer->hash);
         KFileRelease(g_filer->kf_stdout);
         KDirectoryRelease(g_filer->dir);
         free(g_filer->prefix);
@@ -187,6 +232,63 @@ rc_t SRASplitterFiler_PopKey(void)
     return 0;
 }
 
+static
+void SRASplitterFiler_LRUUnlink(SRASplitterFile* file)
+{
+    if( file->lru_prev != NULL ) {
+        file->lru_prev->lru_next = file->lru_next;
+    } else {
+        g_filer->lru_head = file->lru_next;
+    }
+    if( file->lru_next != NULL ) {
+        file->lru_next->lru_prev = file->lru_prev;
+    } else {
+        g_filer->lru_tail = file->lru_prev;
+    }
+    file->lru_prev = file->lru_next = NULL;
+}
+
+static
+void SRASplitterFiler_LRUPushHead(SRASplitterFile* file)
+{
+    file->lru_prev = NULL;
+    file->lru_next = g_filer->lru_head;
+    if( g_filer->lru_head != NULL ) {
+        g_filer->lru_head->lru_prev = file;
+    } else {
+        g_filer->lru_tail = file;
+    }
+    g_filer->lru_head = file;
+}
+
+/* close least recently used file if the pool is full;
+   compressed streams cannot be reopened without starting a new
+   gzip member or bzip2 stream, and KFile cannot park the compressor
+   state apart from its file: with compression more than
+   DUMPER_MAX_OPEN_FILES output files is an error */
+static
+rc_t SRASplitterFiler_Evict(void)
+{
+    rc_t rc = 0;
+    SRASplitterFile* victim = g_filer->lru_tail;
+
+    if( g_filer->open_qty < DUMPER_MAX_OPEN_FILES || g_filer->kf_stdout ) {
+        return 0;
+    }
+    if( g_filer->do_gzip || g_filer->do_bzip2 ) {
+        rc = RC(rcExe, rcFile, rcOpening, rcFile, rcExcessive);
+        PLOGERR(klogErr, (klogErr, rc, "more than $(n) compressed output files, "
+            "split into fewer files or dump without compression", PLOG_U32(n), DUMPER_MAX_OPEN_FILES));
+    } else if( victim != NULL ) {
+        SRA_DUMP_DBG(5, ("Close file: '%s%s'\n", victim->key, g_filer->arc_extension));
+        SRASplitterFiler_LRUUnlink(victim);
+        KFileRelease(victim->file);
+        victim->file = NULL;
+        g_filer->open_qty--;
+    }
+    return rc;
+}
+
 static
 rc_t SRASplitterFiler_OpenFile(SRASplitterFile* file, bool initial)
 {
@@ -194,27 +296,13 @@ rc_t SRASplitterFiler_OpenFile(SRASplitterFile* file, bool initial)
 
     if( file == NULL || (initial && file->file != NULL) ) {
         rc = RC(rcExe, rcFile, rcOpening, rcParam, rcInvalid);
-    } else if( initial || file->file == NULL ) {
-        int i, vacancy = -1;
-        time_t oldest = 0;
-
-        for(i = 0; i < DUMPER_MAX_OPEN_FILES; i++) {
-            if(g_filer->open[i] == NULL ) {
-                vacancy = i;
-                break;
-            }
-            if(g_filer->open[i]->opened < oldest || oldest == 0 ) {
-                oldest = g_filer->open[i]->opened;
-                vacancy = i;
-            }
-        }
-        if( g_filer->open[vacancy] != NULL ) {
-            SRA_DUMP_DBG(5, ("Close file[%i]: %lu '%s%s'\n", vacancy,
-                g_filer->open[vacancy]->opened, g_filer->open[vacancy]->key, g_filer->arc_extension));
-            KFileRelease(g_filer->open[vacancy]->file);
-            g_filer->open[vacancy]->file = NULL;
-            g_filer->open[vacancy] = NULL;
+    } else if( !initial && file->file != NULL ) {
+        /* already open: mark as most recently used */
+        if( g_filer->lru_head != file ) {
+            SRASplitterFiler_LRUUnlink(file);
+            SRASplitterFiler_LRUPushHead(file);
         }
+    } else if( (rc = SRASplitterFiler_Evict()) == 0 ) {
         if( g_filer->kf_stdout ) {
             SRA_DUMP_DBG(5, ("attach to pre-opened stdout: '%s'\n", file->key));
             rc = KFileAddRef(g_filer->kf_stdout);
@@ -283,26 +371,72 @@ rc_t SRASplitterFiler_OpenFile(SRASplitterFile* file, bool initial)
         }
 #endif
         if( rc == 0 ) {
-            g_filer->open[vacancy] = file;
-            file->opened = time(NULL);
-            SRA_DUMP_DBG(5, ("Opened file[%i]: %lu '%s%s'\n",
-                vacancy, file->opened, file->key, g_filer->arc_extension));
+            SRASplitterFiler_LRUPushHead(file);
+            g_filer->open_qty++;
+            SRA_DUMP_DBG(5, ("Opened file[%u]: '%s%s'\n",
+                g_filer->open_qty, file->key, g_filer->arc_extension));
         }
     }
     return rc;
 }
 
 static
-bool CC SRASplitterFiler_GetCurrFile_FindByKey( SLNode *node, void *data )
+uint32_t SRASplitterFiler_Hash(const char* key, size_t len)
 {
-    SRASplitterFile** d = (SRASplitterFile**)data;
-    SRASplitterFile* file = (SRASplitterFile*)node;
+    /* FNV-1a */
+    uint32_t h = 2166136261U;
+    while( len-- > 0 ) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static
+SRASplitterFile* SRASplitterFiler_FindFile(const char* key, uint32_t hash)
+{
+    SRASplitterFile* file = NULL;
+
+    if( g_filer->hash != NULL ) {
+        file = g_filer->hash[hash & (g_filer->hash_size - 1)];
+        while( file != NULL && (file->hash != hash || strcmp(file->key, key) != 0) ) {
+            file = file->hnext;
+        }
+    }
+    return file;
+}
+
+static
+rc_t SRASplitterFiler_AddFile(SRASplitterFile* file)
+{
+    SRASplitterFile** bucket;
 
-    if( strcmp(file->key, g_filer->key_buf) == 0 ) {
-        *d = file;
-        return true;
+    if( g_filer->file_qty >= g_filer->hash_size ) {
+        /* keep load factor at most 1 */
+        uint32_t i, sz = g_filer->hash_size ? g_filer->hash_size * 2 : DUMPER_FILE_HASH_SIZE;
+        SRASplitterFile** h = calloc(sz, sizeof(*h));
+
+        if( h == NULL ) {
+            return RC(rcExe, rcFile, rcInserting, rcMemory, rcExhausted);
+        }
+        for(i = 0; i < g_filer->hash_size; i++) {
+            while( g_filer->hash[i] != NULL ) {
+                SRASplitterFile* f = g_filer->hash[i];
+                g_filer->hash[i] = f->hnext;
+                f->hnext = h[f->hash & (sz - 1)];
+                h[f->hash & (sz - 1)] = f;
+            }
+        }
+        free(g_filer->hash);
+        g_filer->hash = h;
+        g_filer->hash_size = sz;
     }
-    return false;
+    bucket = &g_filer->hash[file->hash & (g_filer->hash_size - 1)];
+    file->hnext = *bucket;
+    *bucket = file;
+    g_filer->file_qty++;
+    SLListPushTail(&g_filer->files, &file->dad);
+    return 0;
 }
 
 static
@@ -331,36 +465,36 @@ rc_t SRASplitterFiler_GetCurrFile(const SRASplitterFile** out_file)
     rc_t rc = 0;
     int i;
     char* key = g_filer->key_buf; /* shortcut */
+    size_t key_len = 0;
+    uint32_t hash;
     SRASplitterFile* file = NULL;
 
     if( out_file == NULL ) {
         return RC(rcExe, rcFile, rcOpening, rcParam, rcInvalid);
     } else if( g_filer->kf_stdout ) {
         strcpy(key, "stdout");
+        key_len = 6;
     } else {
         /* prepare the key
            if key_as_dir true, key will be prefix/path[i]/(path[i+1]..)/suffix
            otherwise key will be prefix_path[i](_path[i+1]..)_?suffix
          */
-        key[0] = '\0';
         for(i = 0; i < g_filer->path_tail; i++ ) {
+            size_t len;
             if( g_filer->path[i][0] == '\0' ) {
                 continue;
             }
-            if( g_filer->key_as_dir ) {
-                if( i != 0 ) {
-                    strcat(key, "/");
-                }
-                strcat(key, g_filer->path[i]);
-            } else {
-                if( i != 0 && isalnum(g_filer->path[i][0]) ) {
-                    strcat(key, "_");
-                }
-                strcat(key, g_filer->path[i]);
+            if( i != 0 && (g_filer->key_as_dir || isalnum(g_filer->path[i][0])) ) {
+                key[key_len++] = g_filer->key_as_dir ? '/' : '_';
             }
+            len = strlen(g_filer->path[i]);
+            memmove(&key[key_len], g_filer->path[i], len);
+            key_len += len;
         }
+        key[key_len] = '\0';
     }
-    if( !SLListDoUntil( &g_filer->files, SRASplitterFiler_GetCurrFile_FindByKey, &file ) ) {
+    hash = SRASplitterFiler_Hash(key, key_len);
+    if( (file = SRASplitterFiler_FindFile(key, hash)) == NULL ) {
         SRA_DUMP_DBG(5, ("New file: '%s'\n", key));
         file = calloc(1, sizeof(*file));
         key = strdup(key);
@@ -370,6 +504,7 @@ rc_t SRASplitterFiler_GetCurrFile(const SRASplitterFile** out_file)
             rc = RC(rcExe, rcFile, rcResolving, rcMemory, rcExhausted);
         } else {
             file->key = key;
+            file->hash = hash;
             if( g_filer->key_as_dir ) {
                 KDirectory* sub = g_filer->dir;
                 for(i = 0; rc == 0 && i < (g_filer->path_tail - 1); i++ ) {
@@ -393,9 +528,14 @@ rc_t SRASplitterFiler_GetCurrFile(const SRASplitterFile** out_file)
                 rc = SRASplitterFiler_FixFSName(file->key, &file->name);
             }
             if( rc == 0 && (rc = SRASplitterFiler_OpenFile(file, true)) == 0 ) {
-                SLListPushTail(&g_filer->files, &file->dad);
-            } else {
+                if( (rc = SRASplitterFiler_AddFile(file)) != 0 ) {
+                    SRASplitterFiler_LRUUnlink(file);
+                    g_filer->open_qty--;
+                }
+            }
+            if( rc != 0 ) {
                 SRASplitterFiler_WhackFile(&file->dad, &g_filer->keep_empty);
+                file = NULL;
             }
         }
     } else {
@@ -406,6 +546,50 @@ rc_t SRASplitterFiler_GetCurrFile(const SRASplitterFile** out_file)
     return rc;
 }
 
+static
+rc_t SRASplitterFiler_Write(SRASplitterFile* f, spotid_t spot, const void* buf, size_t size)
+{
+    size_t writ = 0;
+    rc_t rc = KFileWrite(f->file, f->pos, buf, size, &writ);
+
+    if( rc == 0 ) {
+        f->pos += writ;
+        if( f->curr_spot != spot && spot != 0 ) {
+            f->curr_spot = spot;
+            f->spot_qty = f->spot_qty + 1;
+        }
+        if( g_filer->curr_spot != spot && spot != 0 ) {
+            g_filer->curr_spot = spot;
+            g_filer->spot_qty = g_filer->spot_qty + 1;
+        }
+    }
+    return rc;
+}
+
+/* find or create file for stream using its recorded key path */
+static
+rc_t SRASplitterFiler_ResolveStream(SRASplitterStream* stream)
+{
+    rc_t rc = 0;
+    int i, tail = g_filer->path_tail, len = g_filer->path_len;
+    const char* path[DUMPER_MAX_TREE_DEPTH];
+    const SRASplitterFile* file = NULL;
+
+    memmove(path, g_filer->path, sizeof(path[0]) * tail);
+    g_filer->path_len = 0;
+    for(i = 0; i < stream->path_tail; i++) {
+        g_filer->path[i] = stream->path[i];
+        g_filer->path_len += strlen(stream->path[i]) + 1;
+    }
+    g_filer->path_tail = stream->path_tail;
+    rc = SRASplitterFiler_GetCurrFile(&file);
+    memmove(g_filer->path, path, sizeof(path[0]) * tail);
+    g_filer->path_tail = tail;
+    g_filer->path_len = len;
+    stream->file = (SRASplitterFile*)file;
+    return rc;
+}
+
 rc_t SRASplitterFactory_FilerPrefix(const char* prefix)
 {
     rc_t rc = 0;
@@ -530,8 +714,11 @@ struct SRASplitter {
     SRASplitter_GetKeySet_Func* GetKeySet;
     SRASplitter_Dump_Func* Dump;
     SRASplitter_Release_Func* Release;
+    SRASplitter_Merge_Func* Merge;
     BSTree children;
     SRASplitter_Child* last_found;
+    /* output is recorded instead of written if not NULL */
+    SRASplitterCapture* capture;
 };
 
 struct SRASplitter_Child {
@@ -543,6 +730,8 @@ struct SRASplitter_Child {
         const SRASplitter* splitter;
         /* file object for self type of eSplitterFormat */
         const SRASplitterFile* file;
+        /* recorded output for self type of eSplitterFormat in capturing tree */
+        SRASplitterStream* stream;
     } child;
 };
 
@@ -620,6 +809,202 @@ int64_t CC SRASplitter_Child_Find(const void* item, const BSTNode* node)
     return strcmp(key, n->key);
 }
 
+static
+rc_t SRASplitter_ResolveSelf(const SRASplitter* self, enum RCContext ctx, SRASplitter** resolved);
+
+static
+rc_t SRASplitterChunk_Append(SRASplitterChunk* self, SRASplitterStream* stream,
+                             spotid_t spot, const void* buf, size_t size)
+{
+    SRASplitterRecord* r;
+    size_t need = sizeof(*r) + ((size + 7) & ~(size_t)7);
+
+    if( self == NULL ) {
+        return RC(rcExe, rcFile, rcWriting, rcSelf, rcNull);
+    }
+    if( self->used + need > self->size ) {
+        size_t sz = self->size ? self->size * 2 : OUTPUT_BUFFER_SIZE;
+        uint8_t* b;
+        while( sz < self->used + need ) {
+            sz *= 2;
+        }
+        if( (b = realloc(self->buf, sz)) == NULL ) {
+            return RC(rcExe, rcFile, rcWriting, rcMemory, rcExhausted);
+        }
+        self->buf = b;
+        self->size = sz;
+    }
+    r = (SRASplitterRecord*)&self->buf[self->used];
+    r->stream = stream;
+    r->spot = spot;
+    r->size = size;
+    if( size > 0 ) {
+        memmove(r + 1, buf, size);
+    }
+    self->used += need;
+    return 0;
+}
+
+static
+rc_t SRASplitterCapture_PushKey(SRASplitterCapture* self, const char* key)
+{
+    if( key == NULL ) {
+        return RC(rcExe, rcFile, rcAttaching, rcParam, rcNull);
+    }
+    if( self->path_tail == DUMPER_MAX_TREE_DEPTH - 1 ) {
+        return RC(rcExe, rcFile, rcAttaching, rcDirEntry, rcTooLong);
+    }
+    if( g_filer->key_as_dir ) {
+        /* same as SRASplitterFiler_PushKey */
+        while( !isalnum(*key) && *key != '\0' ) {
+            ++key;
+        }
+    }
+    self->path[self->path_tail++] = key;
+    return 0;
+}
+
+static
+rc_t SRASplitterCapture_PopKey(SRASplitterCapture* self)
+{
+    if( self->path_tail == 0 ) {
+        return RC(rcExe, rcFile, rcDetaching, rcDirEntry, rcTooShort);
+    }
+    self->path_tail--;
+    return 0;
+}
+
+/* snapshot current key path into new stream; activation is recorded
+   so files are created in the same order as without capturing */
+static
+rc_t SRASplitterCapture_NewStream(SRASplitterCapture* self, SRASplitterStream** stream)
+{
+    int i;
+    size_t sz = 0;
+    char* p;
+    SRASplitterStream* s;
+
+    for(i = 0; i < self->path_tail; i++) {
+        sz += strlen(self->path[i]) + 1;
+    }
+    s = calloc(1, sizeof(*s) + sizeof(char*) * self->path_tail + sz);
+    if( s == NULL ) {
+        return RC(rcExe, rcFile, rcAllocating, rcMemory, rcExhausted);
+    }
+    s->path_tail = self->path_tail;
+    s->path = (char**)(s + 1);
+    p = (char*)&s->path[s->path_tail];
+    for(i = 0; i < self->path_tail; i++) {
+        size_t l = strlen(self->path[i]) + 1;
+        memmove(p, self->path[i], l);
+        s->path[i] = p;
+        p += l;
+    }
+    SLListPushTail(&self->streams, &s->dad);
+    *stream = s;
+    return SRASplitterChunk_Append(self->chunk, s, 0, NULL, 0);
+}
+
+static
+rc_t SRASplitter_PushKey(const SRASplitter* self, const char* key)
+{
+    return self->capture ? SRASplitterCapture_PushKey(self->capture, key) : SRASplitterFiler_PushKey(key);
+}
+
+static
+rc_t SRASplitter_PopKey(const SRASplitter* self)
+{
+    return self->capture ? SRASplitterCapture_PopKey(self->capture) : SRASplitterFiler_PopKey();
+}
+
+rc_t SRASplitterCapture_Make(SRASplitterCapture** self)
+{
+    SRASplitterCapture* obj;
+
+    if( self == NULL || g_filer == NULL ) {
+        return RC(rcExe, rcType, rcAllocating, rcParam, rcNull);
+    }
+    if( (obj = calloc(1, sizeof(*obj))) == NULL ) {
+        return RC(rcExe, rcType, rcAllocating, rcMemory, rcExhausted);
+    }
+    /* start from current filer path: output prefix */
+    memmove(obj->path, g_filer->path, sizeof(obj->path[0]) * g_filer->path_tail);
+    obj->path_tail = g_filer->path_tail;
+    SLListInit(&obj->streams);
+    *self = obj;
+    return 0;
+}
+
+static
+void CC SRASplitterCapture_WhackStream(SLNode* node, void* data)
+{
+    free(node);
+}
+
+void SRASplitterCapture_Release(SRASplitterCapture* self)
+{
+    if( self != NULL ) {
+        SLListWhack(&self->streams, SRASplitterCapture_WhackStream, NULL);
+        free(self);
+    }
+}
+
+void SRASplitterCapture_SetChunk(SRASplitterCapture* self, SRASplitterChunk* chunk)
+{
+    if( self != NULL ) {
+        self->chunk = chunk;
+    }
+}
+
+rc_t SRASplitterChunk_Make(SRASplitterChunk** self)
+{
+    if( self == NULL ) {
+        return RC(rcExe, rcType, rcAllocating, rcParam, rcNull);
+    }
+    if( (*self = calloc(1, sizeof(**self))) == NULL ) {
+        return RC(rcExe, rcType, rcAllocating, rcMemory, rcExhausted);
+    }
+    return 0;
+}
+
+void SRASplitterChunk_Reset(SRASplitterChunk* self)
+{
+    if( self != NULL ) {
+        self->used = 0;
+    }
+}
+
+rc_t SRASplitterChunk_Replay(const SRASplitterChunk* self)
+{
+    rc_t rc = 0;
+    size_t off = 0;
+
+    if( self == NULL || g_filer == NULL ) {
+        return RC(rcExe, rcFile, rcWriting, rcSelf, rcNull);
+    }
+    while( rc == 0 && off < self->used ) {
+        const SRASplitterRecord* r = (const SRASplitterRecord*)&self->buf[off];
+
+        if( r->stream->file == NULL ) {
+            rc = SRASplitterFiler_ResolveStream(r->stream);
+        }
+        if( rc == 0 && r->size > 0 &&
+            (rc = SRASplitterFiler_OpenFile(r->stream->file, false)) == 0 ) {
+            rc = SRASplitterFiler_Write(r->stream->file, r->spot, r + 1, r->size);
+        }
+        off += sizeof(*r) + ((r->size + 7) & ~(size_t)7);
+    }
+    return rc;
+}
+
+void SRASplitterChunk_Release(SRASplitterChunk* self)
+{
+    if( self != NULL ) {
+        free(self->buf);
+        free(self);
+    }
+}
+
 static /* not virtual, self is direct pointer to base type here !!! */
 rc_t SRASplitter_FindNextSplitter(SRASplitter* self, const char* key)
 {
@@ -632,6 +1017,10 @@ rc_t SRASplitter_FindNextSplitter(SRASplitter* self, const char* key)
             const SRASplitter* splitter = NULL;
             SRA_DUMP_DBG(5, ("New splitter on key '%s'\n", key));
             if( (rc = SRASplitterFactory_NewObj(self->next_fact, &splitter)) == 0 ) {
+                SRASplitter* sp = NULL;
+                if( SRASplitter_ResolveSelf(splitter, rcConstructing, &sp) == 0 ) {
+                    sp->capture = self->capture;
+                }
                 if( (rc = SRASplitter_Child_MakeSplitter(&self->last_found, key, splitter)) == 0 ) {
                     if( (rc = BSTreeInsertUnique(&self->children, &self->last_found->node, NULL, SRASplitter_Child_Cmp)) != 0 ) {
                         SRASplitter_Child_Whack(&self->last_found->node, NULL);
@@ -653,7 +1042,20 @@ rc_t SRASplitter_FindNextFile(SRASplitter* self, const char* key)
 
     if( self->last_found == NULL || strcmp(self->last_found->key, key) != 0 ) {
         self->last_found = (SRASplitter_Child*)BSTreeFind(&self->children, key, SRASplitter_Child_Find);
-        if( self->last_found == NULL ) {
+        if( self->last_found == NULL && self->capture != NULL ) {
+            SRASplitterStream* stream = NULL;
+            SRA_DUMP_DBG(5, ("New stream on key '%s'\n", key));
+            if( (rc = SRASplitterCapture_NewStream(self->capture, &stream)) == 0 &&
+                (rc = SRASplitter_Child_Make(&self->last_found, key)) == 0 ) {
+                self->last_found->is_splitter = false;
+                self->last_found->child.stream = stream;
+                if( (rc = BSTreeInsertUnique(&self->children, &self->last_found->node, NULL, SRASplitter_Child_Cmp)) != 0 ) {
+                    SRASplitter_Child_Whack(&self->last_found->node, NULL);
+                    self->last_found = NULL;
+                }
+            }
+            return rc;
+        } else if( self->last_found == NULL ) {
             /* create new child using global filer */
             const SRASplitterFile* file = NULL;
             SRA_DUMP_DBG(5, ("New file on key '%s'\n", key));
@@ -667,7 +1069,7 @@ rc_t SRASplitter_FindNextFile(SRASplitter* self, const char* key)
             }
         }
     }
-    if( rc == 0 ) {
+    if( rc == 0 && self->capture == NULL ) {
         /* make sure file is opened */
         rc = SRASplitterFiler_OpenFile((SRASplitterFile*)(self->last_found->child.file), false);
     }
@@ -768,13 +1170,13 @@ rc_t SRASplitter_AddSpot( const SRASplitter * cself, spotid_t spot, readmask_t *
                         if ( rc == 0 )
                         {
                             /* push spot to next splitter in chain */
-                            rc = SRASplitterFiler_PushKey( self->last_found->key );
+                            rc = SRASplitter_PushKey( self, self->last_found->key );
                             if ( rc == 0 )
                             {
                                 /* here comes RECURSION!!! */
                                 rc_t rc2;
                                 rc = SRASplitter_AddSpot( self->last_found->child.splitter, spot, local_readmask );
-                                rc2 = SRASplitterFiler_PopKey();
+                                rc2 = SRASplitter_PopKey( self );
                                 rc = rc ? rc : rc2;
                             }
                         }
@@ -808,13 +1210,13 @@ rc_t SRASplitter_AddSpot( const SRASplitter * cself, spotid_t spot, readmask_t *
                     if ( rc == 0 )
                     {
                         /* push spot to next splitter in chain */
-                        rc = SRASplitterFiler_PushKey( self->last_found->key );
+                        rc = SRASplitter_PushKey( self, self->last_found->key );
                         if ( rc == 0 )
                         {
                             /* here comes RECURSION!!! */
                             rc_t rc2;
                             rc = SRASplitter_AddSpot( self->last_found->child.splitter, spot, readmask );
-                            rc2 = SRASplitterFiler_PopKey();
+                            rc2 = SRASplitter_PopKey( self );
                             rc = rc ? rc : rc2;
                         }
                     }
@@ -851,16 +1253,64 @@ rc_t SRASplitter_Release(const SRASplitter* cself)
     return rc;
 }
 
+rc_t SRASplitter_SetMerge(const SRASplitter* cself, SRASplitter_Merge_Func* merge)
+{
+    SRASplitter* self = NULL;
+    rc_t rc = SRASplitter_ResolveSelf(cself, rcConstructing, &self);
+
+    if( rc == 0 ) {
+        self->Merge = merge;
+    }
+    return rc;
+}
+
+rc_t SRASplitter_Merge(const SRASplitter* cself, const SRASplitter* cother)
+{
+    SRASplitter* self = NULL;
+    SRASplitter* other = NULL;
+    rc_t rc = SRASplitter_ResolveSelf(cself, rcUpdating, &self);
+
+    if( rc == 0 && (rc = SRASplitter_ResolveSelf(cother, rcUpdating, &other)) == 0 ) {
+        SRASplitter_Child* child;
+
+        if( self->type != other->type ) {
+            return RC(rcExe, rcType, rcUpdating, rcType, rcInconsistent);
+        }
+        if( self->Merge != NULL ) {
+            self->Merge(cself, cother);
+        }
+        other->last_found = NULL;
+        while( rc == 0 && (child = (SRASplitter_Child*)BSTreeFirst(&other->children)) != NULL ) {
+            SRASplitter_Child* mine = (SRASplitter_Child*)BSTreeFind(&self->children, child->key, SRASplitter_Child_Find);
+
+            BSTreeUnlink(&other->children, &child->node);
+            if( mine == NULL ) {
+                /* key seen only by other tree: adopt whole branch */
+                rc = BSTreeInsertUnique(&self->children, &child->node, NULL, SRASplitter_Child_Cmp);
+                if( rc != 0 ) {
+                    SRASplitter_Child_Whack(&child->node, NULL);
+                }
+            } else {
+                if( mine->is_splitter && child->is_splitter ) {
+                    rc = SRASplitter_Merge(mine->child.splitter, child->child.splitter);
+                }
+                SRASplitter_Child_Whack(&child->node, NULL);
+            }
+        }
+    }
+    return rc;
+}
+
 rc_t SRASplitter_FileActivate(const SRASplitter* cself, const char* key)
 {
     rc_t rc = 0, rc2 = 0;
     SRASplitter* self = NULL;
 
     if( (rc = SRASplitter_ResolveSelf(cself, rcExecuting, &self)) == 0 ) {
-        if( (rc = SRASplitterFiler_PushKey(key)) == 0 ) {
+        if( (rc = SRASplitter_PushKey(self, key)) == 0 ) {
             /* sets self->last_found */
             rc = SRASplitter_FindNextFile(self, key);
-            rc2 = SRASplitterFiler_PopKey();
+            rc2 = SRASplitter_PopKey(self);
             rc = rc ? rc : rc2;
         }
     }
@@ -880,22 +1330,13 @@ rc_t SRASplitter_FileWrite( const SRASplitter* cself, spotid_t spot, const void*
         }
         else if ( buf != NULL && size > 0 )
         {
-            size_t writ = 0;
-            SRASplitterFile* f = ( SRASplitterFile* )( self->last_found->child.file );
-            rc = KFileWrite( f->file, f->pos, buf, size, &writ );
-            if ( rc == 0 )
+            if ( self->capture != NULL )
             {
-                f->pos += writ;
-                if ( f->curr_spot != spot && spot != 0 )
-                {
-                     f->curr_spot = spot;
-                     f->spot_qty = f->spot_qty + 1;
-                }
-                if ( g_filer->curr_spot != spot && spot != 0 )
-                {
-                    g_filer->curr_spot = spot;
-                    g_filer->spot_qty = g_filer->spot_qty + 1;
-                }
+                rc = SRASplitterChunk_Append( self->capture->chunk, self->last_found->child.stream, spot, buf, size );
+            }
+            else
+            {
+                rc = SRASplitterFiler_Write( ( SRASplitterFile* )( self->last_found->child.file ), spot, buf, size );
             }
         }
     }
@@ -914,6 +1355,11 @@ rc_t SRASplitter_FileWritePos( const SRASplitter* cself, spotid_t spot,
         {
             rc = RC( rcExe, rcFile, rcWriting, rcDirEntry, rcUnknown );
         }
+        else if ( self->capture != NULL )
+        {
+            /* recorded output is appended only */
+            rc = RC( rcExe, rcFile, rcWriting, rcInterface, rcUnsupported );
+        }
         else if ( buf != NULL && size > 0 )
         {
             const SRASplitterFile* f = self->last_found->child.file;
@@ -1067,3 +1513,18 @@ rc_t SRASplitterFactory_NewObj(const SRASplitterFactory* cself, const SRASplitte
     }
     return rc;
 }
+
+rc_t SRASplitterFactory_NewCaptureObj(const SRASplitterFactory* self, SRASplitterCapture* capture, const SRASplitter** splitter)
+{
+    rc_t rc = 0;
+
+    if( capture == NULL ) {
+        rc = RC(rcExe, rcType, rcConstructing, rcParam, rcNull);
+    } else if( (rc = SRASplitterFactory_NewObj(self, splitter)) == 0 ) {
+        SRASplitter* sp = NULL;
+        if( (rc = SRASplitter_ResolveSelf(*splitter, rcConstructing, &sp)) == 0 ) {
+            sp->capture = capture;
+        }
+    }
+    return rc;
+}
@@ -98,6 +98,10 @@ typedef rc_t (SRASplitter_Dump_Func)(const SRASplitter* self, spotid_t spot, con
 /* optional method to free splitter resources, object distruction is handled automatically, do NOT free self! */
 typedef rc_t (SRASplitter_Release_Func)(const SRASplitter* self);
 
+/* optional method to add counters of other, a splitter of the same kind from another tree, to self
+   and reset them in other, so that only self reports them on release */
+typedef void (SRASplitter_Merge_Func)(const SRASplitter* self, const SRASplitter* other);
+
 /**
   * Base type constructor, must be called when constructing custom splitter type
   */
@@ -115,6 +119,17 @@ rc_t SRASplitter_Make(const SRASplitter** self, size_t type_size, /* sizeof(deri
   */
 rc_t SRASplitter_Release(const SRASplitter* self);
 
+/**
+  * Set optional merge method, call after SRASplitter_Make
+  */
+rc_t SRASplitter_SetMerge(const SRASplitter* self, SRASplitter_Merge_Func* merge);
+
+/**
+  * Merge tree of other into self: counters are combined and branches for keys
+  * not known to self are moved over; other must still be released
+  */
+rc_t SRASplitter_Merge(const SRASplitter* self, const SRASplitter* other);
+
 /**
   * Add spot to processing chain
   */
@@ -191,4 +206,27 @@ rc_t SRASplitterFactory_Init(const SRASplitterFactory* self);
   */
 rc_t SRASplitterFactory_NewObj(const SRASplitterFactory* self, const SRASplitter** splitter);
 
+/**
+  * Parallel dumping support.
+  * A splitter tree made by SRASplitterFactory_NewCaptureObj does not touch files:
+  * its output is recorded into the capture's current chunk and written to files
+  * later by SRASplitterChunk_Replay, which must be called from one thread only,
+  * with chunks replayed in spot order.
+  */
+typedef struct SRASplitterCapture SRASplitterCapture;
+typedef struct SRASplitterChunk SRASplitterChunk;
+
+/* captures key path of the filer at the time of the call, i.e. call after SRASplitterFactory_FilerPrefix */
+rc_t SRASplitterCapture_Make(SRASplitterCapture** self);
+/* call after all trees using capture are released and their chunks replayed */
+void SRASplitterCapture_Release(SRASplitterCapture* self);
+void SRASplitterCapture_SetChunk(SRASplitterCapture* self, SRASplitterChunk* chunk);
+
+rc_t SRASplitterFactory_NewCaptureObj(const SRASplitterFactory* self, SRASplitterCapture* capture, const SRASplitter** splitter);
+
+rc_t SRASplitterChunk_Make(SRASplitterChunk** self);
+void SRASplitterChunk_Reset(SRASplitterChunk* self);
+rc_t SRASplitterChunk_Replay(const SRASplitterChunk* self);
+void SRASplitterChunk_Release(SRASplitterChunk* self);
+
 #endif /* _h_tools_dump_factory */
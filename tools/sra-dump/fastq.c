@@ -133,8 +133,6 @@ typedef struct DefNode_struct
 
 typedef struct DeflineData_struct
 {
-    rc_t rc;
-    bool optional;
     union
     {
         spotid_t* id;
@@ -145,120 +143,127 @@ typedef struct DeflineData_struct
         } str;
         uint32_t* u32;
     } values[ DefNode_Last ];
-    char* buf;
-    size_t buf_sz;
-    size_t* writ;
 } DeflineData;
 
 
-static bool CC Defline_Builder( SLNode *node, void *data )
+/* a parsed defline compiled into a flat program: literal text, including
+   the accession, is pooled and merged, optional groups know their length */
+typedef enum DeflineOpCode_enum
 {
-    DefNode* n = ( DefNode* )node;
-    DeflineData* d = ( DeflineData* )data;
-    char s[ 256 ];
-    size_t w;
-    int x = 0;
+    DeflineOp_Text = 0,
+    DeflineOp_Str,
+    DeflineOp_Id,
+    DeflineOp_U32,
+    DeflineOp_Optional
+} DeflineOpCode;
 
-    s[ 0 ] = '\0';
-    switch ( n->type )
+
+typedef struct DeflineOp_struct
+{
+    uint8_t code;
+    uint8_t var;    /* DefNodeType of value for Str, Id and U32 */
+    bool always;    /* Optional: group contains constant text which counts as value */
+    uint32_t arg;   /* Text: offset in pool, Optional: number of ops in group */
+    uint32_t len;   /* Text: length */
+} DeflineOp;
+
+
+typedef struct DeflineProg_struct
+{
+    DeflineOp* op;
+    uint32_t op_qty;
+    uint32_t op_max;
+    /* text is not merged into ops before this one */
+    uint32_t merge_from;
+    char* text;
+    size_t text_sz;
+    size_t text_max;
+} DeflineProg;
+
+
+static const char Defline_Digits[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+
+/* formats value at the end of s[ 24 ], returns pointer to first digit */
+static char* Defline_FormatU64( char* s, uint64_t value )
+{
+    char* p = &s[ 24 ];
+
+    while ( value >= 100 )
     {
-        case DefNode_Optional :
-            d->optional = true;
-            w = *d->writ;
-            *d->writ = 0;
-            SLListDoUntil( n->data.optional, Defline_Builder, data );
-            x = ( *d->writ == 0 ) ? 0 : 1;
-            d->optional = false;
-            *d->writ = w;
-            if ( x > 0 )
-            {
-                SLListDoUntil( n->data.optional, Defline_Builder, data );
-            }
-            break;
+        const char* d = &Defline_Digits[ ( value % 100 ) * 2 ];
+        value /= 100;
+        *--p = d[ 1 ];
+        *--p = d[ 0 ];
+    }
+    if ( value >= 10 )
+    {
+        const char* d = &Defline_Digits[ value * 2 ];
+        *--p = d[ 1 ];
+        *--p = d[ 0 ];
+    }
+    else
+    {
+        *--p = '0' + ( char )value;
+    }
+    return p;
+}
 
-        case DefNode_Text :
-            if ( d->optional )
-            {
-                break;
-            }
-            d->values[n->type].str.s = n->data.text;
-            d->values[n->type].str.sz = strlen( n->data.text );
 
-        case DefNode_Accession :
-        case DefNode_SpotName :
-        case DefNode_SpotGroup :
-        case DefNode_ReadName :
-            if ( d->values[n->type].str.s != NULL )
-            {
-                x = d->values[ n->type ].str.sz;
-                if ( x < sizeof( s ) )
-                {
-                    strncpy( s, d->values[ n->type ].str.s, x );
-                    s[ x ] = '\0';
-                    *d->writ = *d->writ + x;
-                }
-                else
-                {
-                    d->rc = RC( rcExe, rcNamelist, rcExecuting, rcBuffer, rcInsufficient );
-                }
-            }
-            break;
+static char* Defline_FormatI64( char* s, int64_t value )
+{
+    char* p;
 
-        case DefNode_SpotId :
-            if ( d->values[ n->type ].id != NULL &&
-                ( !d->optional || *d->values[ n->type ].id > 0 ) )
-            {
-                x = snprintf( s, sizeof( s ), "%ld", *d->values[ n->type ].id );
-                if ( x < 0 || x >= sizeof( s ) )
-                {
-                    d->rc = RC( rcExe, rcNamelist, rcExecuting, rcBuffer, rcInsufficient );
-                }
-                else
+    if ( value >= 0 )
+    {
+        return Defline_FormatU64( s, value );
+    }
+    p = Defline_FormatU64( s, ( uint64_t )( -( value + 1 ) ) + 1 );
+    *--p = '-';
+    return p;
+}
+
+
+/* optional group is printed only if any of its variables has a value */
+static bool Defline_IsEmpty( const DeflineOp* op, uint32_t qty, const DeflineData* data )
+{
+    uint32_t i;
+
+    for ( i = 0; i < qty; i++ )
+    {
+        switch ( op[ i ].code )
+        {
+            case DeflineOp_Str :
+                if ( data->values[ op[ i ].var ].str.s != NULL && data->values[ op[ i ].var ].str.sz > 0 )
                 {
-                    *d->writ = *d->writ + x;
+                    return false;
                 }
-            }
-            break;
+                break;
 
-        case DefNode_ReadId :
-        case DefNode_SpotLen :
-        case DefNode_ReadLen :
-            if ( d->values[ n->type] .u32 != NULL &&
-                 ( !d->optional || *d->values[ n->type ].u32 > 0 ) )
-            {
-                x = snprintf( s, sizeof( s ), "%u", *d->values[ n->type ].u32 );
-                if ( x < 0 || x >= sizeof( s ) )
+            case DeflineOp_Id :
+                if ( data->values[ op[ i ].var ].id != NULL && *data->values[ op[ i ].var ].id > 0 )
                 {
-                    d->rc = RC( rcExe, rcNamelist, rcExecuting, rcBuffer, rcInsufficient );
+                    return false;
                 }
-                else
+                break;
+
+            case DeflineOp_U32 :
+                if ( data->values[ op[ i ].var ].u32 != NULL && *data->values[ op[ i ].var ].u32 > 0 )
                 {
-                    *d->writ = *d->writ + x;
+                    return false;
                 }
-            }
-            break;
-
-        default:
-            d->rc = RC( rcExe, rcNamelist, rcExecuting, rcId, rcInvalid );
-    } /* switch */
-
-    if ( d->rc == 0 && !d->optional && n->type != DefNode_Optional )
-    {
-        if ( *d->writ < d->buf_sz )
-        {
-            strcat( d->buf, s );
-        }
-        else
-        {
-            d->rc = RC( rcExe, rcNamelist, rcExecuting, rcBuffer, rcInsufficient );
+                break;
         }
     }
-    return d->rc != 0;
+    return true;
 }
 
 
-static rc_t Defline_Bind( DeflineData* data, const char* accession,
-            spotid_t* spotId, const char* spot_name, size_t spotname_sz,
+static rc_t Defline_Bind( DeflineData* data, spotid_t* spotId,
+            const char* spot_name, size_t spotname_sz,
             const char* spot_group, size_t sgrp_sz, uint32_t* spot_len,
             uint32_t* readId, const char* read_name, INSDC_coord_len rlabel_sz,
             INSDC_coord_len* read_len )
@@ -267,11 +272,6 @@ static rc_t Defline_Bind( DeflineData* data, const char* accession,
     {
         return RC( rcExe, rcNamelist, rcExecuting, rcMemory, rcInsufficient );
     }
-    data->values[ DefNode_Unknown ].str.s = NULL;
-    data->values[ DefNode_Text ].str.s = NULL;
-    data->values[ DefNode_Optional ].str.s = NULL;
-    data->values[ DefNode_Accession ].str.s = accession;
-    data->values[ DefNode_Accession ].str.sz = strlen( accession );
     data->values[ DefNode_SpotId ].id = spotId;
     data->values[ DefNode_SpotName ].str.s = spot_name;
     data->values[ DefNode_SpotName ].str.sz = spotname_sz;
@@ -286,25 +286,76 @@ static rc_t Defline_Bind( DeflineData* data, const char* accession,
 }
 
 
-static rc_t Defline_Build( const SLList* def, DeflineData* data, char* buf,
+/* on insufficient buffer writ is set to full defline length */
+static rc_t Defline_Build( const DeflineProg* prog, const DeflineData* data, char* buf,
                            size_t buf_sz, size_t* writ )
 {
-    if ( data == NULL )
+    uint32_t i;
+    size_t w = 0;
+
+    if ( prog == NULL || data == NULL )
     {
         return RC( rcExe, rcNamelist, rcExecuting, rcMemory, rcInsufficient );
     }
 
-    data->rc = 0;
-    data->optional = false;
-    data->buf = buf;
-    data->buf_sz = buf_sz;
-    data->writ = writ;
+    for ( i = 0; i < prog->op_qty; i++ )
+    {
+        const DeflineOp* op = &prog->op[ i ];
+        const char* s = NULL;
+        size_t sz = 0;
+        char num[ 24 ];
+
+        switch ( op->code )
+        {
+            case DeflineOp_Optional :
+                if ( !op->always && Defline_IsEmpty( &op[ 1 ], op->arg, data ) )
+                {
+                    i += op->arg;
+                }
+                continue;
+
+            case DeflineOp_Text :
+                s = &prog->text[ op->arg ];
+                sz = op->len;
+                break;
+
+            case DeflineOp_Str :
+                s = data->values[ op->var ].str.s;
+                sz = s == NULL ? 0 : data->values[ op->var ].str.sz;
+                break;
+
+            case DeflineOp_Id :
+                if ( data->values[ op->var ].id != NULL )
+                {
+                    s = Defline_FormatI64( num, *data->values[ op->var ].id );
+                    sz = &num[ sizeof( num ) ] - s;
+                }
+                break;
 
-    data->buf[ 0 ] = '\0';
-    *data->writ = 0;
+            case DeflineOp_U32 :
+                if ( data->values[ op->var ].u32 != NULL )
+                {
+                    s = Defline_FormatU64( num, *data->values[ op->var ].u32 );
+                    sz = &num[ sizeof( num ) ] - s;
+                }
+                break;
 
-    SLListDoUntil( def, Defline_Builder, data );
-    return data->rc;
+            default:
+                return RC( rcExe, rcNamelist, rcExecuting, rcId, rcInvalid );
+        }
+        if ( w + sz < buf_sz )
+        {
+            memmove( &buf[ w ], s, sz );
+        }
+        w += sz;
+    }
+    *writ = w;
+    if ( w >= buf_sz )
+    {
+        return RC( rcExe, rcNamelist, rcExecuting, rcBuffer, rcInsufficient );
+    }
+    buf[ w ] = '\0';
+    return 0;
 }
 
 
@@ -586,6 +637,162 @@ static rc_t Defline_Parse( SLList** def, const char* line )
     return rc;
 }
 
+static rc_t DeflineProg_AddOp( DeflineProg* prog, DeflineOpCode code, uint8_t var )
+{
+    if ( prog->op_qty == prog->op_max )
+    {
+        uint32_t max = prog->op_max == 0 ? 16 : prog->op_max * 2;
+        DeflineOp* op = realloc( prog->op, max * sizeof( *op ) );
+        if ( op == NULL )
+        {
+            return RC( rcExe, rcNamelist, rcConstructing, rcMemory, rcExhausted );
+        }
+        prog->op = op;
+        prog->op_max = max;
+    }
+    memset( &prog->op[ prog->op_qty ], 0, sizeof( prog->op[ 0 ] ) );
+    prog->op[ prog->op_qty ].code = code;
+    prog->op[ prog->op_qty++ ].var = var;
+    return 0;
+}
+
+
+static rc_t DeflineProg_AddText( DeflineProg* prog, const char* text, size_t text_sz )
+{
+    rc_t rc = 0;
+    DeflineOp* last = prog->op_qty > prog->merge_from ? &prog->op[ prog->op_qty - 1 ] : NULL;
+
+    if ( text_sz == 0 )
+    {
+        return 0;
+    }
+    if ( prog->text_sz + text_sz > prog->text_max )
+    {
+        size_t max = ( prog->text_sz + text_sz ) * 2;
+        char* t = realloc( prog->text, max );
+        if ( t == NULL )
+        {
+            return RC( rcExe, rcNamelist, rcConstructing, rcMemory, rcExhausted );
+        }
+        prog->text = t;
+        prog->text_max = max;
+    }
+    memmove( &prog->text[ prog->text_sz ], text, text_sz );
+
+    if ( last == NULL || last->code != DeflineOp_Text )
+    {
+        rc = DeflineProg_AddOp( prog, DeflineOp_Text, DefNode_Text );
+        if ( rc == 0 )
+        {
+            last = &prog->op[ prog->op_qty - 1 ];
+            last->arg = prog->text_sz;
+        }
+    }
+    if ( rc == 0 )
+    {
+        last->len += text_sz;
+        prog->text_sz += text_sz;
+    }
+    return rc;
+}
+
+
+static rc_t DeflineProg_Compile( DeflineProg* prog, const SLList* def, const char* accession,
+                                 uint32_t group )
+{
+    rc_t rc = 0;
+    const SLNode* node;
+
+    for ( node = SLListHead( def ); rc == 0 && node != NULL; node = SLNodeNext( node ) )
+    {
+        const DefNode* n = ( const DefNode* )node;
+        switch ( n->type )
+        {
+            case DefNode_Text :
+                rc = DeflineProg_AddText( prog, n->data.text, strlen( n->data.text ) );
+                break;
+
+            case DefNode_Accession :
+                rc = DeflineProg_AddText( prog, accession, strlen( accession ) );
+                if ( rc == 0 && group > 0 && accession[ 0 ] != '\0' )
+                {
+                    prog->op[ group - 1 ].always = true;
+                }
+                break;
+
+            case DefNode_Optional :
+                rc = DeflineProg_AddOp( prog, DeflineOp_Optional, DefNode_Optional );
+                if ( rc == 0 )
+                {
+                    uint32_t start = prog->merge_from = prog->op_qty;
+                    rc = DeflineProg_Compile( prog, n->data.optional, accession, start );
+                    prog->op[ start - 1 ].arg = prog->op_qty - start;
+                    prog->merge_from = prog->op_qty;
+                }
+                break;
+
+            case DefNode_SpotName :
+            case DefNode_SpotGroup :
+            case DefNode_ReadName :
+                rc = DeflineProg_AddOp( prog, DeflineOp_Str, n->type );
+                break;
+
+            case DefNode_SpotId :
+                rc = DeflineProg_AddOp( prog, DeflineOp_Id, n->type );
+                break;
+
+            case DefNode_ReadId :
+            case DefNode_SpotLen :
+            case DefNode_ReadLen :
+                rc = DeflineProg_AddOp( prog, DeflineOp_U32, n->type );
+                break;
+
+            default:
+                rc = RC( rcExe, rcNamelist, rcConstructing, rcId, rcInvalid );
+        }
+    }
+    return rc;
+}
+
+
+static void DeflineProg_Release( DeflineProg* prog )
+{
+    if ( prog != NULL )
+    {
+        free( prog->op );
+        free( prog->text );
+        free( prog );
+    }
+}
+
+
+/* compiles parsed defline for a given accession */
+static rc_t DeflineProg_Make( DeflineProg** prog, const SLList* def, const char* accession )
+{
+    rc_t rc = 0;
+
+    *prog = NULL;
+    if ( def != NULL )
+    {
+        *prog = calloc( 1, sizeof( **prog ) );
+        if ( *prog == NULL )
+        {
+            rc = RC( rcExe, rcNamelist, rcConstructing, rcMemory, rcExhausted );
+        }
+        else
+        {
+            rc = DeflineProg_Compile( *prog, def, accession, 0 );
+            if ( rc != 0 )
+            {
+                DeflineProg_Release( *prog );
+                *prog = NULL;
+            }
+        }
+    }
+    return rc;
+}
+
+
 /* ### ALIGNMENT_COUNT based filtering ##################################################### */
 
 typedef struct AlignedFilter_struct
@@ -634,6 +841,16 @@ static rc_t AlignedFilter_GetKey( const SRASplitter* cself, const char** key,
 }
 
 
+static void AlignedFilter_Merge( const SRASplitter* cself, const SRASplitter* cother )
+{
+    AlignedFilter* self = ( AlignedFilter* )cself;
+    AlignedFilter* other = ( AlignedFilter* )cother;
+
+    self->rejected_reads += other->rejected_reads;
+    other->rejected_reads = 0;
+}
+
+
 static rc_t AlignedFilter_Release( const SRASplitter* cself )
 {
     rc_t rc = 0;
@@ -704,6 +921,7 @@ static rc_t AlignedFilterFactory_NewObj( const SRASplitterFactory* cself, const
         if ( rc == 0 )
         {
             AlignedFilter * filter = ( AlignedFilter * )( * splitter );
+            SRASplitter_SetMerge( *splitter, AlignedFilter_Merge );
             filter->col = self->col;
             filter->aligned = self->aligned;
             filter->unaligned = self->unaligned;
@@ -845,6 +1063,16 @@ static rc_t AlignRegionFilter_GetKey( const SRASplitter* cself, const char** key
 }
 
 
+static void AlignRegionFilter_Merge( const SRASplitter* cself, const SRASplitter* cother )
+{
+    AlignRegionFilter* self = ( AlignRegionFilter* )cself;
+    AlignRegionFilter* other = ( AlignRegionFilter* )cother;
+
+    self->rejected_spots += other->rejected_spots;
+    other->rejected_spots = 0;
+}
+
+
 static rc_t AlignRegionFilter_Release( const SRASplitter* cself )
 {
     rc_t rc = 0;
@@ -969,6 +1197,7 @@ static rc_t AlignRegionFilterFactory_NewObj( const SRASplitterFactory* cself, co
         if ( rc == 0 )
         {
             AlignRegionFilter * filter = ( AlignRegionFilter * )( * splitter );
+            SRASplitter_SetMerge( *splitter, AlignRegionFilter_Merge );
             filter->col_pos = self->col_pos;
             filter->col_name = self->col_name;
             filter->col_seqid = self->col_seqid;
@@ -1075,6 +1304,16 @@ static rc_t AlignPairDistanceFilter_GetKey( const SRASplitter* cself,
 }
 
 
+static void AlignPairDistanceFilter_Merge( const SRASplitter* cself, const SRASplitter* cother )
+{
+    AlignPairDistanceFilter* self = ( AlignPairDistanceFilter* )cself;
+    AlignPairDistanceFilter* other = ( AlignPairDistanceFilter* )cother;
+
+    self->rejected_reads += other->rejected_reads;
+    other->rejected_reads = 0;
+}
+
+
 static rc_t AlignPairDistanceFilter_Release( const SRASplitter* cself )
 {
     rc_t rc = 0;
@@ -1153,6 +1392,7 @@ static rc_t AlignPairDistanceFilterFactory_NewObj( const SRASplitterFactory* cse
         if ( rc == 0 )
         {
             AlignPairDistanceFilter * filter = ( AlignPairDistanceFilter * )( * splitter );
+            SRASplitter_SetMerge( *splitter, AlignPairDistanceFilter_Merge );
             filter->col_tlen = self->col_tlen;
             filter->mp_dist_unknown = self->mp_dist_unknown;
             filter->mp_dist = self->mp_dist;
@@ -1271,6 +1511,16 @@ static rc_t FastqBioFilter_GetKey( const SRASplitter* cself, const char** key,
 }
 
 
+static void FastqBioFilter_Merge( const SRASplitter* cself, const SRASplitter* cother )
+{
+    FastqBioFilter* self = ( FastqBioFilter* )cself;
+    FastqBioFilter* other = ( FastqBioFilter* )cother;
+
+    self->rejected_reads += other->rejected_reads;
+    other->rejected_reads = 0;
+}
+
+
 static rc_t FastqBioFilter_Release( const SRASplitter * cself )
 {
     rc_t rc = 0;
@@ -1332,6 +1582,7 @@ static rc_t FastqBioFilterFactory_NewObj( const SRASplitterFactory* cself, const
         if ( rc == 0 )
         {
             FastqBioFilter * filter = ( FastqBioFilter * )( * splitter );
+            SRASplitter_SetMerge( *splitter, FastqBioFilter_Merge );
             filter->reader = self->reader;
             filter->rejected_reads = 0;
         }
@@ -1439,6 +1690,16 @@ static rc_t FastqRNumberFilter_GetKey( const SRASplitter* cself, const char** ke
 }
 
 
+static void FastqRNumberFilter_Merge( const SRASplitter* cself, const SRASplitter* cother )
+{
+    FastqRNumberFilter* self = ( FastqRNumberFilter* )cself;
+    FastqRNumberFilter* other = ( FastqRNumberFilter* )cother;
+
+    self->rejected_reads += other->rejected_reads;
+    other->rejected_reads = 0;
+}
+
+
 static rc_t FastqRNumberFilter_Release( const SRASplitter* cself )
 {
     rc_t rc = 0;
@@ -1501,6 +1762,7 @@ static rc_t FastqRNumberFilterFactory_NewObj( const SRASplitterFactory* cself, c
         if ( rc == 0 )
         {
             FastqRNumberFilter * filter = ( FastqRNumberFilter * )( * splitter );
+            SRASplitter_SetMerge( *splitter, FastqRNumberFilter_Merge );
             filter->reader = self->reader;
             filter->rejected_reads = 0;
         }
@@ -1759,6 +2021,18 @@ static rc_t FastqQFilter_GetKey( const SRASplitter* cself, const char** key,
 }
 
 
+static void FastqQFilter_Merge( const SRASplitter* cself, const SRASplitter* cother )
+{
+    FastqQFilter* self = ( FastqQFilter* )cself;
+    FastqQFilter* other = ( FastqQFilter* )cother;
+
+    self->rejected_spots += other->rejected_spots;
+    other->rejected_spots = 0;
+    self->rejected_reads += other->rejected_reads;
+    other->rejected_reads = 0;
+}
+
+
 static rc_t FastqQFilter_Release( const SRASplitter * cself )
 {
     rc_t rc = 0;
@@ -1832,6 +2106,7 @@ static rc_t FastqQFilterFactory_NewObj( const SRASplitterFactory* cself, const S
         if ( rc == 0 )
         {
             FastqQFilter * filter = ( FastqQFilter * )( * splitter );
+            SRASplitter_SetMerge( *splitter, FastqQFilter_Merge );
             filter->reader = self->reader;
             filter->buffer_for_read_column = &self->kdbuf;
             filter->buffer_for_quality = &self->kdbuf2;
@@ -1963,6 +2238,18 @@ static rc_t FastqReadLenFilter_GetKey( const SRASplitter* cself, const char** ke
 }
 
 
+static void FastqReadLenFilter_Merge( const SRASplitter* cself, const SRASplitter* cother )
+{
+    FastqReadLenFilter* self = ( FastqReadLenFilter* )cself;
+    FastqReadLenFilter* other = ( FastqReadLenFilter* )cother;
+
+    self->rejected_spots += other->rejected_spots;
+    other->rejected_spots = 0;
+    self->rejected_reads += other->rejected_reads;
+    other->rejected_reads = 0;
+}
+
+
 static rc_t FastqReadLenFilter_Release( const SRASplitter * cself )
 {
     rc_t rc = 0;
@@ -2026,6 +2313,7 @@ static rc_t FastqReadLenFilterFactory_NewObj( const SRASplitterFactory* cself, c
         if ( rc == 0 )
         {
             FastqReadLenFilter * filter = ( FastqReadLenFilter* )( *splitter );
+            SRASplitter_SetMerge( *splitter, FastqReadLenFilter_Merge );
             filter->reader = self->reader;
             filter->rejected_spots = 0;
             filter->rejected_reads = 0;
@@ -2076,6 +2364,54 @@ static rc_t FastqReadLenFilterFactory_Make( const SRASplitterFactory** cself,
 
 char* FastqReadSplitter_key_buf = NULL;
 
+/* key_offset of the read splitters below */
+#define READ_SPLITTER_KEY_OFFSET 5
+
+
+/* shared by all splitters, made in factory init so parallel splitter trees do not race on it */
+static rc_t ReadSplitter_MakeKeyBuf( char** key_buf, const size_t key_offset )
+{
+    rc_t rc = 0;
+
+    /* initial alloc key_buf: "  1\0  2\0...\0  9\0 10\0 11\0...\03220..\08192\0" */
+    if ( nreads_max > 9999 )
+    {
+        /* key_offset and sprintf format size are insufficient for keys longer than 4 digits */
+        rc = RC( rcExe, rcNode, rcExecuting, rcBuffer, rcInsufficient );
+    }
+    else
+    {
+        char* buf = malloc( nreads_max * key_offset );
+        if ( buf == NULL )
+        {
+            rc = RC( rcExe, rcNode, rcExecuting, rcMemory, rcExhausted );
+        }
+        else
+        {
+            /* fill buffer w/keys */
+            int i;
+            char* p = buf;
+            for ( i = 1; rc == 0 && i <= nreads_max; i++ )
+            {
+                if ( sprintf( p, "%4u", i ) <= 0 )
+                {
+                    rc = RC( rcExe, rcNode, rcExecuting, rcTransfer, rcIncomplete );
+                }
+                p += key_offset;
+            }
+            if ( rc == 0 )
+            {
+                *key_buf = buf;
+            }
+            else
+            {
+                free( buf );
+            }
+        }
+    }
+    return rc;
+}
+
 
 typedef struct FastqReadSplitter_struct
 {
@@ -2090,7 +2426,7 @@ static rc_t FastqReadSplitter_GetKeySet( const SRASplitter* cself, const SRASpli
 {
     rc_t rc = 0;
     FastqReadSplitter* self = ( FastqReadSplitter* )cself;
-    const size_t key_offset = 5;
+    const size_t key_offset = READ_SPLITTER_KEY_OFFSET;
 
     if ( self == NULL || key == NULL )
     {
@@ -2103,34 +2439,7 @@ static rc_t FastqReadSplitter_GetKeySet( const SRASplitter* cself, const SRASpli
         *keys = 0;
         if ( FastqReadSplitter_key_buf == NULL )
         {
-            /* initial alloc key_buf: "  1\0  2\0...\0  9\0 10\0 11\0...\03220..\08192\0" */
-            if ( nreads_max > 9999 )
-            {
-                /* key_offset and sprintf format size are insufficient for keys longer than 4 digits */
-                rc = RC( rcExe, rcNode, rcExecuting, rcBuffer, rcInsufficient );
-            }
-            else
-            {
-                FastqReadSplitter_key_buf = malloc( nreads_max * key_offset );
-                if ( FastqReadSplitter_key_buf == NULL )
-                {
-                    rc = RC( rcExe, rcNode, rcExecuting, rcMemory, rcExhausted );
-                }
-                else
-                {
-                    /* fill buffer w/keys */
-                    int i;
-                    char* p = FastqReadSplitter_key_buf;
-                    for ( i = 1; rc == 0 && i <= nreads_max; i++ )
-                    {
-                        if ( sprintf( p, "%4u", i ) <= 0 )
-                        {
-                            rc = RC( rcExe, rcNode, rcExecuting, rcTransfer, rcIncomplete );
-                        }
-                        p += key_offset;
-                    }
-                }
-            }
+            rc = ReadSplitter_MakeKeyBuf( &FastqReadSplitter_key_buf, key_offset );
         }
 
         if ( rc == 0 )
@@ -2234,6 +2543,10 @@ static rc_t FastqReadSplitterFactory_Init( const SRASplitterFactory* cself )
                               FastqArgs.is_platform_cs_native, false, FastqArgs.fasta > 0, false, 
                               false, !FastqArgs.applyClip, FastqArgs.SuppressQualForCSKey, 0,
                               FastqArgs.offset, '\0', 0, 0 );
+        if ( rc == 0 && FastqReadSplitter_key_buf == NULL )
+        {
+            rc = ReadSplitter_MakeKeyBuf( &FastqReadSplitter_key_buf, READ_SPLITTER_KEY_OFFSET );
+        }
     }
     return rc;
 }
@@ -2317,7 +2630,7 @@ static rc_t Fastq3ReadSplitter_GetKeySet( const SRASplitter* cself, const SRASpl
 {
     rc_t rc = 0;
     Fastq3ReadSplitter* self = ( Fastq3ReadSplitter* )cself;
-    const size_t key_offset = 5;
+    const size_t key_offset = READ_SPLITTER_KEY_OFFSET;
 
     if ( self == NULL || key == NULL )
     {
@@ -2330,34 +2643,7 @@ static rc_t Fastq3ReadSplitter_GetKeySet( const SRASplitter* cself, const SRASpl
         *keys = 0;
         if ( Fastq3ReadSplitter_key_buf == NULL )
         {
-            /* initial alloc key_buf: "  1\0  2\0...\0  9\0 10\0 11\0...\03220..\08192\0" */
-            if ( nreads_max > 9999 )
-            {
-                /* key_offset and sprintf format size are insufficient for keys longer than 4 digits */
-                rc = RC( rcExe, rcNode, rcExecuting, rcBuffer, rcInsufficient );
-            }
-            else
-            {
-                Fastq3ReadSplitter_key_buf = malloc( nreads_max * key_offset );
-                if ( Fastq3ReadSplitter_key_buf == NULL )
-                {
-                    rc = RC( rcExe, rcNode, rcExecuting, rcMemory, rcExhausted );
-                }
-                else
-                {
-                    /* fill buffer w/keys */
-                    int i;
-                    char* p = Fastq3ReadSplitter_key_buf;
-                    for ( i = 1; rc == 0 && i <= nreads_max; i++ )
-                    {
-                        if ( sprintf( p, "%4u", i ) <= 0 )
-                        {
-                            rc = RC( rcExe, rcNode, rcExecuting, rcTransfer, rcIncomplete );
-                        }
-                        p += key_offset;
-                    }
-                }
-            }
+            rc = ReadSplitter_MakeKeyBuf( &Fastq3ReadSplitter_key_buf, key_offset );
         }
 
         if ( rc == 0 )
@@ -2447,6 +2733,10 @@ static rc_t Fastq3ReadSplitterFactory_Init( const SRASplitterFactory* cself )
                               FastqArgs.is_platform_cs_native, false, FastqArgs.fasta > 0, false, 
                               false, !FastqArgs.applyClip, FastqArgs.SuppressQualForCSKey, 0,
                               FastqArgs.offset, '\0', 0, 0 );
+        if ( rc == 0 && Fastq3ReadSplitter_key_buf == NULL )
+        {
+            rc = ReadSplitter_MakeKeyBuf( &Fastq3ReadSplitter_key_buf, READ_SPLITTER_KEY_OFFSET );
+        }
     }
     return rc;
 }
@@ -2522,6 +2812,8 @@ typedef struct FastqFormatterSplitter_struct
 {
     const char* accession;
     const FastqReader* reader;
+    const DeflineProg* b_defline;
+    const DeflineProg* q_defline;
     KDataBuffer* b[ 5 ];
     size_t bsz[ 5 ]; /* fifth is for fasta line wrap */
 } FastqFormatterSplitter;
@@ -2605,7 +2897,7 @@ static rc_t FastqFormatterSplitter_DumpByRead( const SRASplitter* cself, spotid_
                         rc = FastqReader_SpotReadInfo( self->reader, readId, NULL, &read_name, &rlabel_sz, NULL, &read_len );
                         if ( rc == 0 )
                         {
-                            rc = Defline_Bind( &def_data, self->accession, &spot, spot_name, sname_sz, spot_group, sgrp_sz,
+                            rc = Defline_Bind( &def_data, &spot, spot_name, sname_sz, spot_group, sgrp_sz,
                                                &spot_len, &readIdx, read_name, rlabel_sz, &read_len );
                         }
                     }
@@ -2613,7 +2905,7 @@ static rc_t FastqFormatterSplitter_DumpByRead( const SRASplitter* cself, spotid_
                     {
                         if ( FastqArgs.b_defline )
                         {
-                            IF_BUF( ( Defline_Build( FastqArgs.b_defline, &def_data, self->b[0]->base,
+                            IF_BUF( ( Defline_Build( self->b_defline, &def_data, self->b[0]->base,
                                       KDataBufferBytes( self->b[0] ), &self->bsz[0] ) ), self->b[0], self->bsz[0] );
                         }
                         else
@@ -2642,7 +2934,7 @@ static rc_t FastqFormatterSplitter_DumpByRead( const SRASplitter* cself, spotid_
                     {
                         if ( FastqArgs.q_defline )
                         {
-                            IF_BUF( ( Defline_Build( FastqArgs.q_defline, &def_data, self->b[2]->base,
+                            IF_BUF( ( Defline_Build( self->q_defline, &def_data, self->b[2]->base,
                                       KDataBufferBytes( self->b[2] ), &self->bsz[2] ) ), self->b[2], self->bsz[2] );
                         }
                         else
@@ -2739,7 +3031,7 @@ static rc_t FastqFormatterSplitter_DumpBySpot( const SRASplitter* cself, spotid_
                                                    &spot_group, &sgrp_sz, &spot_len, NULL );
                         if ( rc == 0 )
                         {
-                            rc = Defline_Bind( &def_data, self->accession, &spot, spot_name,
+                            rc = Defline_Bind( &def_data, &spot, spot_name,
                                                sname_sz, spot_group, sgrp_sz, 
                                                &spot_len, &readId, NULL, 0, &spot_len );
                         }
@@ -2749,7 +3041,7 @@ static rc_t FastqFormatterSplitter_DumpBySpot( const SRASplitter* cself, spotid_
                     {
                         if ( FastqArgs.b_defline )
                         {
-                            IF_BUF( ( Defline_Build( FastqArgs.b_defline, &def_data, self->b[0]->base,
+                            IF_BUF( ( Defline_Build( self->b_defline, &def_data, self->b[0]->base,
                                       KDataBufferBytes( self->b[0] ), &self->bsz[0] ) ), self->b[0], self->bsz[0] );
                         }
                         else
@@ -2762,7 +3054,7 @@ static rc_t FastqFormatterSplitter_DumpBySpot( const SRASplitter* cself, spotid_
                         {
                             if ( FastqArgs.q_defline )
                             {
-                                IF_BUF( ( Defline_Build( FastqArgs.q_defline, &def_data, self->b[2]->base,
+                                IF_BUF( ( Defline_Build( self->q_defline, &def_data, self->b[2]->base,
                                           KDataBufferBytes( self->b[2] ), &self->bsz[2] ) ), self->b[2], self->bsz[2] );
                             }
                             else
@@ -2832,6 +3124,8 @@ typedef struct FastqFormatterFactory_struct
     const char* accession;
     const SRATable* table;
     const FastqReader* reader;
+    DeflineProg* b_defline;
+    DeflineProg* q_defline;
     KDataBuffer buf[ 5 ]; /* fifth is for fasta line wrap */
 } FastqFormatterFactory;
 
@@ -2859,6 +3153,14 @@ static rc_t FastqFormatterFactory_Init( const SRASplitterFactory* cself )
                 rc = KDataBufferMakeBytes( &self->buf[ i ], DATABUFFERINITSIZE );
             }
         }
+        if ( rc == 0 )
+        {
+            rc = DeflineProg_Make( &self->b_defline, FastqArgs.b_defline, self->accession );
+        }
+        if ( rc == 0 )
+        {
+            rc = DeflineProg_Make( &self->q_defline, FastqArgs.q_defline, self->accession );
+        }
     }
     return rc;
 }
@@ -2884,6 +3186,8 @@ static rc_t FastqFormatterFactory_NewObj( const SRASplitterFactory* cself, const
             int i;
             ( (FastqFormatterSplitter*)(*splitter) )->accession = self->accession;
             ( (FastqFormatterSplitter*)(*splitter) )->reader = self->reader;
+            ( (FastqFormatterSplitter*)(*splitter) )->b_defline = self->b_defline;
+            ( (FastqFormatterSplitter*)(*splitter) )->q_defline = self->q_defline;
             for ( i = 0; i < sizeof( self->buf ) / sizeof( self->buf[ 0 ] ); i++ )
             {
                 ( (FastqFormatterSplitter*)(*splitter) )->b[ i ] = &self->buf[ i ];
@@ -2905,6 +3209,8 @@ static void FastqFormatterFactory_Release( const SRASplitterFactory* cself )
         {
             KDataBufferWhack( &self->buf[ i ] );
         }
+        DeflineProg_Release( self->b_defline );
+        DeflineProg_Release( self->q_defline );
     }
 }
 
@@ -3805,6 +4111,7 @@ rc_t SRADumper_Init( SRADumperFmt* fmt )
     fmt->gzip = true;
     fmt->bzip2 = true;
     fmt->split_files = false;
+    fmt->parallel = true;
 
     return 0;
 }
@@ -156,7 +156,7 @@ rc_t add_dyn_string_2_dyn_string( struct dyn_string *self, struct dyn_string *ot
 }
 
 
-rc_t print_2_dyn_string( struct dyn_string * self, const char *fmt, ... )
+rc_t vprint_2_dyn_string( struct dyn_string * self, const char *fmt, va_list args )
 {
     rc_t rc = 0;
     bool not_enough;
@@ -164,14 +164,14 @@ rc_t print_2_dyn_string( struct dyn_string * self, const char *fmt, ... )
     do
     {
         size_t num_writ;
-        va_list args;
-        va_start ( args, fmt );
+        va_list args_copy;
+        va_copy ( args_copy, args );
         rc = string_vprintf ( &(self->data[ self->data_len ]), 
                               self->allocated - ( self->data_len + 1 ),
                               &num_writ,
                               fmt,
-                              args );
-        va_end ( args );
+                              args_copy );
+        va_end ( args_copy );
 
         if ( rc == 0 )
         {
@@ -188,6 +188,17 @@ rc_t print_2_dyn_string( struct dyn_string * self, const char *fmt, ... )
 }
 
 
+rc_t print_2_dyn_string( struct dyn_string * self, const char *fmt, ... )
+{
+    rc_t rc;
+    va_list args;
+    va_start ( args, fmt );
+    rc = vprint_2_dyn_string( self, fmt, args );
+    va_end ( args );
+    return rc;
+}
+
+
 rc_t print_dyn_string( struct dyn_string * self )
 {
     if ( self != NULL )
@@ -32,6 +32,7 @@ extern "C" {
 #endif
 
 #include <klib/rc.h>
+#include <stdarg.h>
 
 struct dyn_string;
 
@@ -45,6 +46,7 @@ char * dyn_string_char( struct dyn_string *self, uint32_t idx );
 rc_t add_string_2_dyn_string( struct dyn_string *self, const char * s );
 rc_t add_dyn_string_2_dyn_string( struct dyn_string *self, struct dyn_string *other );
 rc_t print_2_dyn_string( struct dyn_string * self, const char *fmt, ... );
+rc_t vprint_2_dyn_string( struct dyn_string * self, const char *fmt, va_list args );
 rc_t print_dyn_string( struct dyn_string * self );
 size_t dyn_string_len( struct dyn_string * self );
 
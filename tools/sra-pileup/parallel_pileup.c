@@ -0,0 +1,561 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "parallel_pileup.h"
+#include "dyn_string.h"
+
+#include <klib/rc.h>
+#include <klib/log.h>
+#include <klib/text.h>
+
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+
+#include <vdb/database.h>
+#include <align/reference.h>
+
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* =========================================================================================== */
+
+rc_t add_pileup_source( Vector * sources, const char * path, const char * spot_group )
+{
+    rc_t rc = 0;
+    pileup_source * src = calloc( 1, sizeof *src );
+    if ( src == NULL )
+        rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        src->path = string_dup_measure ( path, NULL );
+        if ( spot_group != NULL )
+            src->spot_group = string_dup_measure ( spot_group, NULL );
+        rc = VectorAppend ( sources, NULL, src );
+        if ( rc != 0 )
+        {
+            LOGERR( klogInt, rc, "VectorAppend() failed" );
+        }
+    }
+    return rc;
+}
+
+
+static void CC release_pileup_source( void * item, void * data )
+{
+    pileup_source * src = item;
+    free( ( void * )src->path );
+    if ( src->spot_group != NULL )
+        free( ( void * )src->spot_group );
+    free( src );
+}
+
+
+void release_pileup_sources( Vector * sources )
+{
+    VectorWhack ( sources, release_pileup_source, NULL );
+}
+
+
+/* =========================================================================================== */
+
+/* the references of all sources, in the order they are first seen */
+typedef struct pileup_reference
+{
+    const char * name;
+    const char * seq_id;
+    uint64_t len;
+} pileup_reference;
+
+
+static void CC release_pileup_reference( void * item, void * data )
+{
+    pileup_reference * ref = item;
+    free( ( void * )ref->name );
+    free( ( void * )ref->seq_id );
+    free( ref );
+}
+
+
+static const pileup_reference * find_pileup_reference( const Vector * refs, const char * name )
+{
+    uint32_t idx, count = VectorLength( refs );
+    for ( idx = 0; idx < count; ++idx )
+    {
+        const pileup_reference * ref = VectorGet ( refs, idx );
+        if ( strcmp( ref->name, name ) == 0 || strcmp( ref->seq_id, name ) == 0 )
+            return ref;
+    }
+    return NULL;
+}
+
+
+static rc_t add_pileup_reference( Vector * refs, const ReferenceObj * refobj )
+{
+    const char * name;
+    rc_t rc = ReferenceObj_Name( refobj, &name );
+    if ( rc != 0 )
+    {
+        LOGERR( klogInt, rc, "ReferenceObj_Name() failed" );
+    }
+    else if ( find_pileup_reference( refs, name ) == NULL )
+    {
+        const char * seq_id;
+        rc = ReferenceObj_SeqId( refobj, &seq_id );
+        if ( rc != 0 )
+        {
+            LOGERR( klogInt, rc, "ReferenceObj_SeqId() failed" );
+        }
+        else
+        {
+            INSDC_coord_len len;
+            rc = ReferenceObj_SeqLength( refobj, &len );
+            if ( rc != 0 )
+            {
+                LOGERR( klogInt, rc, "ReferenceObj_SeqLength() failed" );
+            }
+            else
+            {
+                pileup_reference * ref = calloc( 1, sizeof *ref );
+                if ( ref == NULL )
+                    rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                else
+                {
+                    ref->name = string_dup_measure ( name, NULL );
+                    ref->seq_id = string_dup_measure ( seq_id, NULL );
+                    ref->len = len;
+                    rc = VectorAppend ( refs, NULL, ref );
+                    if ( rc != 0 )
+                        release_pileup_reference( ref, NULL );
+                }
+            }
+        }
+    }
+    return rc;
+}
+
+
+static rc_t collect_references( const VDBManager * vdb_mgr,
+                                VSchema * vdb_schema,
+                                const pileup_source * src,
+                                align_tab_select tab_select,
+                                Vector * refs )
+{
+    const VDatabase *db;
+    rc_t rc = VDBManagerOpenDBRead ( vdb_mgr, &db, vdb_schema, "%s", src->path );
+    if ( rc != 0 )
+    {
+        PLOGERR( klogErr, ( klogErr, rc, "failed to open '$(path)'", "path=%s", src->path ) );
+    }
+    else
+    {
+        const ReferenceList *reflist;
+        uint32_t reflist_options = ereferencelist_4na;
+
+        if ( ( tab_select & primary_ats ) == primary_ats )
+            reflist_options |= ereferencelist_usePrimaryIds;
+        if ( ( tab_select & secondary_ats ) == secondary_ats )
+            reflist_options |= ereferencelist_useSecondaryIds;
+        if ( ( tab_select & evidence_ats ) == evidence_ats )
+            reflist_options |= ereferencelist_useEvidenceIds;
+
+        rc = ReferenceList_MakeDatabase( &reflist, db, reflist_options, 0, NULL, 0 );
+        if ( rc != 0 )
+        {
+            LOGERR( klogInt, rc, "ReferenceList_MakeDatabase() failed" );
+        }
+        else
+        {
+            uint32_t count;
+            rc = ReferenceList_Count( reflist, &count );
+            if ( rc != 0 )
+            {
+                LOGERR( klogInt, rc, "ReferenceList_Count() failed" );
+            }
+            else
+            {
+                uint32_t idx;
+                for ( idx = 0; idx < count && rc == 0; ++idx )
+                {
+                    const ReferenceObj * refobj;
+                    rc = ReferenceList_Get( reflist, &refobj, idx );
+                    if ( rc != 0 )
+                    {
+                        LOGERR( klogInt, rc, "ReferenceList_Get() failed" );
+                    }
+                    else
+                    {
+                        rc = add_pileup_reference( refs, refobj );
+                        ReferenceObj_Release( refobj );
+                    }
+                }
+            }
+            ReferenceList_Release( reflist );
+        }
+        VDatabaseRelease( db );
+    }
+    return rc;
+}
+
+
+/* =========================================================================================== */
+
+typedef struct pileup_slice
+{
+    const char * name;          /* reference-name as the iterator looks it up */
+    uint64_t start;             /* 1-based */
+    uint64_t end;               /* 1-based, inclusive */
+    struct dyn_string * out;    /* collected output, written by the main-thread */
+    rc_t rc;
+    bool done;
+} pileup_slice;
+
+
+static void CC release_pileup_slice( void * item, void * data )
+{
+    pileup_slice * slice = item;
+    free_dyn_string( slice->out );
+    free( ( void * )slice->name );
+    free( slice );
+}
+
+
+/* cut the range start...end ( 1-based, inclusive ) on the reference into slices */
+static rc_t add_slices( Vector * slices, const char * name, uint64_t start, uint64_t end,
+                        uint32_t slice_len )
+{
+    rc_t rc = 0;
+    uint64_t pos = start;
+    while ( rc == 0 && pos <= end )
+    {
+        pileup_slice * slice = calloc( 1, sizeof *slice );
+        if ( slice == NULL )
+            rc = RC( rcApp, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+        else
+        {
+            slice->name = string_dup_measure ( name, NULL );
+            slice->start = pos;
+            slice->end = pos + slice_len - 1;
+            if ( slice->end > end )
+                slice->end = end;
+            rc = VectorAppend ( slices, NULL, slice );
+            if ( rc != 0 )
+                release_pileup_slice( slice, NULL );
+            pos = slice->end + 1;
+        }
+    }
+    return rc;
+}
+
+
+static rc_t make_slices( Vector * slices, const Vector * refs, BSTree * regions,
+                         uint32_t slice_len )
+{
+    rc_t rc = 0;
+    if ( count_ref_regions( regions ) == 0 )
+    {
+        /* the user has not specified a reference-range : use the whole file... */
+        uint32_t idx, count = VectorLength( refs );
+        for ( idx = 0; idx < count && rc == 0; ++idx )
+        {
+            const pileup_reference * ref = VectorGet ( refs, idx );
+            rc = add_slices( slices, ref->name, 1, ref->len, slice_len );
+        }
+    }
+    else
+    {
+        /* same order as foreach_ref_region() in the serial pileup */
+        const struct reference_region * node = get_first_ref_node( regions );
+        while ( node != NULL && rc == 0 )
+        {
+            const char * name = get_ref_node_name( node );
+            const pileup_reference * ref = find_pileup_reference( refs, name );
+            if ( ref != NULL )
+            {
+                uint32_t idx, count = get_ref_node_range_count( node );
+                for ( idx = 0; idx < count && rc == 0; ++idx )
+                {
+                    const struct reference_range * range = get_ref_range( node, idx );
+                    uint64_t start = get_ref_range_start( range );
+                    uint64_t end = get_ref_range_end( range );
+                    if ( start == 0 ) start = 1;
+                    if ( end == 0 || end > ref->len ) end = ref->len;
+                    rc = add_slices( slices, name, start, end, slice_len );
+                }
+            }
+            node = get_next_ref_node( node );
+        }
+    }
+    return rc;
+}
+
+
+/* =========================================================================================== */
+
+typedef struct parallel_ctx
+{
+    const pileup_options * options;
+    BSTree * regions;
+    on_pileup_slice on_slice;
+    void * data;
+    Vector slices;
+    KLock * lock;
+    KCondition * slice_done;    /* a worker has finished a slice */
+    KCondition * slice_written; /* the main-thread has written a slice */
+    uint32_t next_slice;        /* the next slice to be taken by a worker */
+    uint32_t next_write;        /* the next slice to be written by the main-thread */
+    uint32_t max_ahead;         /* limits the memory held by finished, but not yet written slices */
+    bool abort;
+} parallel_ctx;
+
+
+static rc_t pileup_one_slice( parallel_ctx * ctx, pileup_slice * slice, uint32_t idx,
+                              pileup_options * options )
+{
+    BSTree tree;
+    rc_t rc = allocated_dyn_string ( &slice->out, 64 * 1024 );
+    BSTreeInit( &tree );
+    if ( rc == 0 )
+        rc = add_region( &tree, slice->name, slice->start, slice->end ); /* ref_regions.c */
+    if ( rc == 0 )
+    {
+        options->out = slice->out;
+        options->omit_header = ( ctx->options->omit_header || idx > 0 );
+        rc = ctx->on_slice( &tree, options, ctx->data );
+    }
+    free_ref_regions( &tree );
+    return rc;
+}
+
+
+static rc_t CC pileup_worker( const KThread * self, void * data )
+{
+    parallel_ctx * ctx = data;
+    pileup_options options = *( ctx->options );
+    uint32_t count = VectorLength( &ctx->slices );
+    rc_t rc = 0;
+
+    /* the skiplist keeps the position of the walk, every worker needs its own */
+    if ( ctx->options->skiplist != NULL )
+        options.skiplist = skiplist_make( ctx->regions );
+
+    while ( rc == 0 )
+    {
+        pileup_slice * slice = NULL;
+        uint32_t idx = 0;
+
+        rc = KLockAcquire ( ctx->lock );
+        if ( rc == 0 )
+        {
+            while ( !ctx->abort && ctx->next_slice < count &&
+                    ctx->next_slice >= ctx->next_write + ctx->max_ahead )
+            {
+                KConditionWait ( ctx->slice_written, ctx->lock );
+            }
+            if ( !ctx->abort && ctx->next_slice < count )
+            {
+                idx = ctx->next_slice++;
+                slice = VectorGet ( &ctx->slices, idx );
+            }
+            KLockUnlock ( ctx->lock );
+        }
+
+        if ( slice == NULL )
+            break;
+
+        rc = pileup_one_slice( ctx, slice, idx, &options );
+
+        /* the main-thread has to see the slice as done, even if it failed */
+        KLockAcquire ( ctx->lock );
+        slice->rc = rc;
+        slice->done = true;
+        if ( rc != 0 )
+            ctx->abort = true;
+        KConditionBroadcast ( ctx->slice_done );
+        KLockUnlock ( ctx->lock );
+    }
+
+    if ( options.skiplist != NULL )
+        skiplist_release( options.skiplist );
+    return rc;
+}
+
+
+/* runs on the main-thread: write the slices in order as soon as they are done */
+static rc_t write_slices( parallel_ctx * ctx )
+{
+    rc_t rc = 0;
+    uint32_t idx, count = VectorLength( &ctx->slices );
+    for ( idx = 0; idx < count && rc == 0; ++idx )
+    {
+        pileup_slice * slice = VectorGet ( &ctx->slices, idx );
+
+        rc = KLockAcquire ( ctx->lock );
+        if ( rc == 0 )
+        {
+            while ( !slice->done )
+                KConditionWait ( ctx->slice_done, ctx->lock );
+            KLockUnlock ( ctx->lock );
+        }
+
+        if ( rc == 0 )
+            rc = slice->rc;
+        if ( rc == 0 )
+            rc = print_dyn_string( slice->out );
+        free_dyn_string( slice->out );
+        slice->out = NULL;
+
+        KLockAcquire ( ctx->lock );
+        ctx->next_write = idx + 1;
+        if ( rc != 0 )
+            ctx->abort = true;
+        KConditionBroadcast ( ctx->slice_written );
+        KLockUnlock ( ctx->lock );
+    }
+    return rc;
+}
+
+
+/* let the workers run out of slices */
+static void stop_workers( parallel_ctx * ctx )
+{
+    KLockAcquire ( ctx->lock );
+    ctx->abort = true;
+    KConditionBroadcast ( ctx->slice_written );
+    KLockUnlock ( ctx->lock );
+}
+
+
+static rc_t run_workers( parallel_ctx * ctx, uint32_t threads )
+{
+    Vector workers;
+    uint32_t idx;
+    rc_t rc = 0;
+
+    VectorInit ( &workers, 0, threads );
+    for ( idx = 0; idx < threads && rc == 0; ++idx )
+    {
+        KThread * thread;
+        rc = KThreadMake ( &thread, pileup_worker, ctx );
+        if ( rc != 0 )
+        {
+            LOGERR( klogInt, rc, "KThreadMake() failed" );
+        }
+        else
+        {
+            rc = VectorAppend ( &workers, NULL, thread );
+            if ( rc != 0 )
+            {
+                rc_t status;
+                stop_workers( ctx );
+                KThreadWait ( thread, &status );
+                KThreadRelease ( thread );
+            }
+        }
+    }
+
+    if ( rc == 0 )
+        rc = write_slices( ctx );
+
+    if ( rc != 0 )
+        stop_workers( ctx );
+
+    for ( idx = 0; idx < VectorLength( &workers ); ++idx )
+    {
+        KThread * thread = VectorGet ( &workers, idx );
+        rc_t status;
+        rc_t rc1 = KThreadWait ( thread, &status );
+        if ( rc1 == 0 )
+            rc1 = status;
+        if ( rc == 0 )
+            rc = rc1;
+        KThreadRelease ( thread );
+    }
+    VectorWhack ( &workers, NULL, NULL );
+    return rc;
+}
+
+
+rc_t parallel_pileup( const VDBManager * vdb_mgr,
+                      VSchema * vdb_schema,
+                      const Vector * sources,
+                      BSTree * regions,
+                      const pileup_options * options,
+                      uint32_t slice_len,
+                      on_pileup_slice on_slice,
+                      void * data )
+{
+    parallel_ctx ctx;
+    Vector refs;
+    uint32_t idx, count = VectorLength( sources );
+    rc_t rc = 0;
+
+    memset( &ctx, 0, sizeof ctx );
+    ctx.options = options;
+    ctx.regions = regions;
+    ctx.on_slice = on_slice;
+    ctx.data = data;
+    ctx.max_ahead = options->threads * 2;
+
+    /* (1) the names and lengths of the references, to cut them into slices */
+    VectorInit ( &refs, 0, 64 );
+    for ( idx = 0; idx < count && rc == 0; ++idx )
+        rc = collect_references( vdb_mgr, vdb_schema, VectorGet ( sources, idx ), options->cmn.tab_select, &refs );
+
+    VectorInit ( &ctx.slices, 0, 1024 );
+    if ( rc == 0 )
+        rc = make_slices( &ctx.slices, &refs, regions, slice_len );
+
+    /* (2) let the workers pile up the slices, and write them in order */
+    if ( rc == 0 )
+    {
+        rc = KLockMake ( &ctx.lock );
+        if ( rc != 0 )
+        {
+            LOGERR( klogInt, rc, "KLockMake() failed" );
+        }
+    }
+    if ( rc == 0 )
+    {
+        rc = KConditionMake ( &ctx.slice_done );
+        if ( rc == 0 )
+            rc = KConditionMake ( &ctx.slice_written );
+        if ( rc != 0 )
+        {
+            LOGERR( klogInt, rc, "KConditionMake() failed" );
+        }
+    }
+    if ( rc == 0 )
+        rc = run_workers( &ctx, options->threads );
+
+    if ( ctx.slice_written != NULL ) KConditionRelease ( ctx.slice_written );
+    if ( ctx.slice_done != NULL ) KConditionRelease ( ctx.slice_done );
+    if ( ctx.lock != NULL ) KLockRelease ( ctx.lock );
+    VectorWhack ( &ctx.slices, release_pileup_slice, NULL );
+    VectorWhack ( &refs, release_pileup_reference, NULL );
+    return rc;
+}
@@ -0,0 +1,72 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_parallel_pileup_
+#define _h_parallel_pileup_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "pileup_options.h"
+
+#include <klib/vector.h>
+#include <vdb/manager.h>
+#include <vdb/schema.h>
+
+/* one input-argument ( accession or path ), collected before the pileup starts */
+typedef struct pileup_source
+{
+    const char * path;
+    const char * spot_group;    /* can be NULL */
+} pileup_source;
+
+rc_t add_pileup_source( Vector * sources, const char * path, const char * spot_group );
+void release_pileup_sources( Vector * sources );
+
+
+/* called by a worker-thread for each slice:
+   the slice is a regions-tree with exactly one reference and one range,
+   the options are the worker's own copy, with the output-buffer set */
+typedef rc_t ( CC * on_pileup_slice ) ( BSTree * slice, pileup_options * options, void * data );
+
+/* splits the requested regions ( or all references of the sources if there are none )
+   into slices of slice_len bases, lets options->threads workers call on_slice for them
+   and writes the collected output of the slices in order via KOutMsg() */
+rc_t parallel_pileup( const VDBManager * vdb_mgr,
+                      VSchema * vdb_schema,
+                      const Vector * sources,
+                      BSTree * regions,
+                      const pileup_options * options,
+                      uint32_t slice_len,
+                      on_pileup_slice on_slice,
+                      void * data );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*  _h_parallel_pileup_ */
@@ -27,6 +27,7 @@
 #include <klib/out.h>
 
 #include "ref_walker_0.h"
+#include "pileup_out.h"
 #include "4na_ascii.h"
 
 static uint32_t percent( uint32_t v1, uint32_t v2 )
@@ -63,7 +64,7 @@ static rc_t CC walk_index_exit_ref_pos( walk_data * data )
     if ( ic->forward + ic->reverse == 0 )
         return 0;
     else
-        return KOutMsg( "%s\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n", 
+        return pileup_out( data->options, "%s\t%u\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n",
                      data->ref_name, data->ref_pos + 1, 
                      ic->base_counts[ 0 ], ic->base_counts[ 1 ], ic->base_counts[ 2 ], ic->base_counts[ 3 ],
                      ic->inserts, ic->deletes, percent( ic->forward, ic->reverse ) );
@@ -52,6 +52,11 @@ typedef struct pileup_options
     uint32_t function;  /* sra_pileup_samtools, sra_pileup_counters, sra_pileup_stat, 
                            sra_pileup_report_ref, sra_pileup_report_ref_ext, sra_pileup_debug, etc */
     struct skiplist * skiplist;     /* from ref_regions.h */
+    uint32_t threads;               /* number of worker-threads, 0 or 1 means serial */
+
+    /* used by the workers of a parallel pileup ( see parallel_pileup.c ) */
+    struct dyn_string * out;        /* output is collected here instead of being written via KOutMsg() */
+    bool omit_header;               /* only the first slice prints a header-line */
 } pileup_options;
 
 
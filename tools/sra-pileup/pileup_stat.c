@@ -28,6 +28,7 @@
 #include <klib/sort.h>
 
 #include "ref_walker_0.h"
+#include "pileup_out.h"
 #include "4na_ascii.h"
 
 static uint32_t percent( uint32_t v1, uint32_t v2 )
@@ -236,9 +237,11 @@ static uint32_t percentil( tlen_array * a, uint32_t p )
 }
 
 
-static rc_t print_header_line( void )
+static rc_t print_header_line( pileup_options *options )
 {
-    return KOutMsg( "\nREFNAME----\tREFPOS\tREFBASE\tDEPTH\tSTRAND%%\tTL+#0\tTL+10%%\tTL+MED\tTL+90%%\tTL-#0\tTL-10%%\tTL-MED\tTL-90%%\n\n" );
+    if ( options->omit_header )
+        return 0;
+    return pileup_out( options, "\nREFNAME----\tREFPOS\tREFBASE\tDEPTH\tSTRAND%%\tTL+#0\tTL+10%%\tTL+MED\tTL+90%%\tTL-#0\tTL-10%%\tTL-MED\tTL-90%%\n\n" );
 }
 
 
@@ -278,11 +281,11 @@ static rc_t CC walk_stat_exit_ref_pos( walk_data * data )
     stat_counters * counters = data->data;
 
     /* REF-NAME, REF-POS, REF-BASE, DEPTH */
-    rc_t rc = KOutMsg( "%s\t%u\t%c\t%u\t", data->ref_name, data->ref_pos + 1, c, data->depth );
+    rc_t rc = pileup_out( data->options, "%s\t%u\t%c\t%u\t", data->ref_name, data->ref_pos + 1, c, data->depth );
 
     /* STRAND-ness */
     if ( rc == 0 )
-        rc = KOutMsg( "%u%%\t", percent( counters->pos.alignment_count, counters->neg.alignment_count ) );
+        rc = pileup_out( data->options, "%u%%\t", percent( counters->pos.alignment_count, counters->neg.alignment_count ) );
 
     /* TLEN-Statistic for sliding window, only starting/ending placements */
     if ( rc == 0 )
@@ -291,13 +294,13 @@ static rc_t CC walk_stat_exit_ref_pos( walk_data * data )
         if ( a->members > 1 )
             ksort_uint32_t ( a->values, a->members );
 
-        rc = KOutMsg( "%u\t%u\t%u\t%u\t", a->zeros, percentil( a, 10 ), medium( a ), percentil( a, 90 ) );
+        rc = pileup_out( data->options, "%u\t%u\t%u\t%u\t", a->zeros, percentil( a, 10 ), medium( a ), percentil( a, 90 ) );
         if ( rc == 0 )
         {
             a = &counters->neg.tlen_w;
             if ( a->members > 1 )
                 ksort_uint32_t ( a->values, a->members );
-            rc = KOutMsg( "%u\t%u\t%u\t%u\t", a->zeros, percentil( a, 10 ), medium( a ), percentil( a, 90 ) );
+            rc = pileup_out( data->options, "%u\t%u\t%u\t%u\t", a->zeros, percentil( a, 10 ), medium( a ), percentil( a, 90 ) );
         }
     }
 
@@ -309,7 +312,7 @@ static rc_t CC walk_stat_exit_ref_pos( walk_data * data )
 */
 
     if ( rc == 0 )
-        rc = KOutMsg( "\n" );
+        rc = pileup_out( data->options, "\n" );
 
     return rc;
 }
@@ -360,7 +363,7 @@ rc_t walk_stat( ReferenceIterator *ref_iter, pileup_options *options )
     walk_funcs funcs;
     stat_counters counters;
 
-    rc_t rc = print_header_line();
+    rc_t rc = print_header_line( options );
     if ( rc == 0 )
         rc = prepare_stat_counters( &counters, 1024 );
     if ( rc == 0 )
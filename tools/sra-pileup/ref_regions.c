@@ -780,13 +780,15 @@ bool skiplist_is_skip_position( struct skiplist * list, uint64_t pos )
         struct skiplist_ref_node * cur_node = list->current;
         if ( cur_node != NULL )
         {
+            /* loop: the walk may enter the reference in the middle ( parallel slices ) */
             const struct skip_range * curr_skip_range = cur_node->current_skip_range;
-            if ( curr_skip_range != NULL )
+            while ( curr_skip_range != NULL )
             {
                 if ( pos < curr_skip_range->start ) return false;
                 if ( pos <= curr_skip_range->end ) return true;
                 cur_node->current_id++;
                 cur_node->current_skip_range = VectorGet ( &( cur_node->skip_ranges ), cur_node->current_id );
+                curr_skip_range = cur_node->current_skip_range;
             }
         }
     }
@@ -41,6 +41,8 @@
 #include "pileup_indels.h"
 #include "pileup_stat.h"
 #include "pileup_v2.h"
+#include "pileup_out.h"
+#include "parallel_pileup.h"
 
 #include <kapp/main.h>
 
@@ -105,6 +107,8 @@
 
 #define OPTION_NGC "ngc"
 
+#define OPTION_THREADS "threads"
+
 #define OPTION_FUNC    "function"
 #define ALIAS_FUNC     NULL
 
@@ -120,6 +124,9 @@
 #define FUNC_DELETES    "deletes"
 #define FUNC_INDELS     "indels"
 
+/* a parallel pileup cuts the references into slices of this size */
+#define PARALLEL_SLICE_LEN  200000
+
 enum
 {
     sra_pileup_samtools = 0,
@@ -182,6 +189,9 @@ static const char * func_usage[]            = { "alternative functionality", NUL
 
 static const char * ngc_usage[] = { "path to ngc file", NULL };
 
+static const char * threads_usage[]         = { "number of worker-threads, default is 1",
+                                                "( pileup, count, mismatch and index )", NULL };
+
 OptDef MyOptions[] =
 {
     /*name,           	alias,         	hfkt,	usage-help,		maxcount, needs value, required */
@@ -197,6 +207,7 @@ OptDef MyOptions[] =
     { OPTION_MERGE,		NULL,			NULL,	merge_usage,	1,        true,        false },
     { OPTION_FUNC,		ALIAS_FUNC,		NULL,	func_usage,		1,        true,        false },
     { OPTION_NGC,       NULL,           NULL,   ngc_usage, 1, true, false },
+    { OPTION_THREADS,	NULL,			NULL,	threads_usage,	1,        true,        false },
 };
 
 /* =========================================================================================== */
@@ -282,6 +293,8 @@ static rc_t get_pileup_options( Args * args, pileup_options *opts )
 {
     rc_t rc = get_common_options( args, &opts->cmn ); /* cmdline_cmn.h */
     opts->function = sra_pileup_samtools; /* above */
+    opts->out = NULL;
+    opts->omit_header = false;
 
     if ( rc == 0 )
         rc = get_uint32_option( args, OPTION_MINMAPQ, &opts->minmapq, 0 );
@@ -291,6 +304,9 @@ static rc_t get_pileup_options( Args * args, pileup_options *opts )
 
     if ( rc == 0 )
         rc = get_uint32_option( args, OPTION_MERGE, &opts->merge_dist, 10000 );
+
+    if ( rc == 0 )
+        rc = get_uint32_option( args, OPTION_THREADS, &opts->threads, 1 );
         
     if ( rc == 0 )
         rc = get_bool_option( args, OPTION_DUPS, &opts->process_dups, false );
@@ -399,6 +415,7 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine ( NULL, OPTION_MIN_M, NULL, min_m_usage );
     HelpOptionLine ( NULL, OPTION_MERGE, NULL, merge_usage );
     HelpOptionLine ( ALIAS_NOQUAL, OPTION_NOQUAL, NULL, no_qual_usage );
+    HelpOptionLine ( NULL, OPTION_THREADS, "count", threads_usage );
 
     HelpOptionLine ( NULL, "function ref",      NULL, func_ref_usage );
     HelpOptionLine ( NULL, "function ref-ex",   NULL, func_ref_ex_usage );
@@ -849,7 +866,7 @@ static rc_t walk_position( ReferenceIterator *ref_iter,
 
 							/* only one KOutMsg() per line... */
 							if ( rc == 0 )
-								rc = KOutMsg( "%s\n", dyn_string_char( line, 0 ) );
+								rc = pileup_out( options, "%s\n", dyn_string_char( line, 0 ) );
 
 							if ( GetRCState( rc ) == rcDone )
 								rc = 0;
@@ -1399,12 +1416,106 @@ static void CC cur_id_vector_entry_whack( void *item, void *data )
 }
 
 
+/* walk the "loaded" ref-iterator ===> perform the pileup */
+static rc_t walk_pileup( ReferenceIterator *ref_iter, pileup_options *options )
+{
+    rc_t rc;
+    switch( options->function )
+    {
+        case sra_pileup_stat        : rc = walk_stat( ref_iter, options ); break;
+        case sra_pileup_counters    : rc = walk_counters( ref_iter, options ); break;
+        case sra_pileup_debug       : rc = walk_debug( ref_iter, options ); break;
+        case sra_pileup_mismatch    : rc = walk_mismatches( ref_iter, options ); break;
+        case sra_pileup_index       : rc = walk_index( ref_iter, options ); break;
+        case sra_pileup_varcount    : rc = walk_varcount( ref_iter, options ); break;
+        case sra_pileup_indels      : rc = walk_indels( ref_iter, options ); break;
+        default :  rc = walk_ref_iter( ref_iter, options ); break;
+    }
+    return rc;
+}
+
+
+/* =========================================================================================== */
+
+/* the functions that do not carry state from one reference-position to the next
+   can be cut into slices, stat keeps a sliding window and a running average */
+static bool is_parallel_pileup( const pileup_options *options )
+{
+    if ( options->threads < 2 )
+        return false;
+    switch( options->function )
+    {
+        case sra_pileup_samtools    :
+        case sra_pileup_counters    :
+        case sra_pileup_mismatch    :
+        case sra_pileup_index       : return true;
+    }
+    return false;
+}
+
+
+static rc_t CC on_source( const char * path, const char * spot_group, void * data )
+{
+    return add_pileup_source( data, path, spot_group ); /* parallel_pileup.c */
+}
+
+
+typedef struct slice_ctx
+{
+    const AlignMgr *almgr;
+    PlacementRecordExtendFuncs *cb_block;
+    const VDBManager *vdb_mgr;
+    VSchema *vdb_schema;
+    const Vector *sources;
+} slice_ctx;
+
+
+/* called by the workers of parallel_pileup() for each slice,
+   every slice gets its own ref-iterator and cursors */
+static rc_t CC on_slice( BSTree * slice, pileup_options * options, void * data )
+{
+    slice_ctx * sctx = data;
+    foreach_arg_ctx arg_ctx;
+    Vector cur_ids_vector;
+    rc_t rc;
+
+    VectorInit ( &cur_ids_vector, 0, 20 );
+    arg_ctx.options = options;
+    arg_ctx.vdb_mgr = sctx->vdb_mgr;
+    arg_ctx.vdb_schema = sctx->vdb_schema;
+    arg_ctx.ranges = slice;
+    arg_ctx.cursor_ids = &cur_ids_vector;
+
+    rc = AlignMgrMakeReferenceIterator ( sctx->almgr, &arg_ctx.ref_iter, sctx->cb_block, options->minmapq );
+    if ( rc != 0 )
+    {
+        LOGERR( klogInt, rc, "AlignMgrMakeReferenceIterator() failed" );
+    }
+    else
+    {
+        uint32_t idx, count = VectorLength( sctx->sources );
+        for ( idx = 0; idx < count && rc == 0; ++idx )
+        {
+            const pileup_source * src = VectorGet ( sctx->sources, idx );
+            rc = on_argument( src->path, src->spot_group, &arg_ctx );
+        }
+        if ( rc == 0 )
+            rc = walk_pileup( arg_ctx.ref_iter, options );
+        ReferenceIteratorRelease( arg_ctx.ref_iter );
+    }
+    VectorWhack ( &cur_ids_vector, cur_id_vector_entry_whack, NULL );
+    return rc;
+}
+
+
 static rc_t pileup_main( Args * args, pileup_options *options )
 {
     foreach_arg_ctx arg_ctx;
     pileup_callback_data cb_data;
+    PlacementRecordExtendFuncs cb_block;
     KDirectory * dir = NULL;
     Vector cur_ids_vector;
+    bool parallel = is_parallel_pileup( options );
 
     /* (1) make the align-manager ( necessary to make a ReferenceIterator... ) */
     rc_t rc = AlignMgrMakeRead ( &cb_data.almgr );
@@ -1422,8 +1533,6 @@ static rc_t pileup_main( Args * args, pileup_options *options )
     /* (2) make the reference-iterator */
     if ( rc == 0 )
     {
-        PlacementRecordExtendFuncs cb_block;
-
         cb_block.data = &cb_data;
         cb_block.destroy = NULL;
         cb_block.populate = populate_tooldata;
@@ -1534,32 +1643,50 @@ static rc_t pileup_main( Args * args, pileup_options *options )
             check_ref_regions( &regions, options->merge_dist ); /* sanitize input, merge slices... */
             options->skiplist = skiplist_make( &regions ); /* create skiplist for neighboring slices */
 
-            arg_ctx.ranges = &regions;
-            rc = foreach_argument( args, dir, options->div_by_spotgrp, &empty, on_argument, &arg_ctx ); /* cmdline_cmn.c */
-            if ( empty )
+            if ( parallel )
             {
-                Usage ( args );
-                rc = RC ( rcApp, rcArgv, rcAccessing, rcSelf, rcInsufficient );
+                /* collect the arguments, each slice adds all of them to it's own ref-iter */
+                Vector sources;
+                VectorInit ( &sources, 0, 5 );
+                rc = foreach_argument( args, dir, options->div_by_spotgrp, &empty, on_source, &sources ); /* cmdline_cmn.c */
+                if ( empty )
+                {
+                    Usage ( args );
+                    rc = RC ( rcApp, rcArgv, rcAccessing, rcSelf, rcInsufficient );
+                }
+                else if ( rc == 0 )
+                {
+                    slice_ctx sctx;
+
+                    sctx.almgr = cb_data.almgr;
+                    sctx.cb_block = &cb_block;
+                    sctx.vdb_mgr = arg_ctx.vdb_mgr;
+                    sctx.vdb_schema = arg_ctx.vdb_schema;
+                    sctx.sources = &sources;
+                    rc = parallel_pileup( arg_ctx.vdb_mgr, arg_ctx.vdb_schema, &sources, &regions, options,
+                                          PARALLEL_SLICE_LEN, on_slice, &sctx ); /* parallel_pileup.c */
+                }
+                release_pileup_sources( &sources );
+            }
+            else
+            {
+                arg_ctx.ranges = &regions;
+                rc = foreach_argument( args, dir, options->div_by_spotgrp, &empty, on_argument, &arg_ctx ); /* cmdline_cmn.c */
+                if ( empty )
+                {
+                    Usage ( args );
+                    rc = RC ( rcApp, rcArgv, rcAccessing, rcSelf, rcInsufficient );
+                }
             }
             free_ref_regions( &regions );
         }
     }
 
     /* (6) walk the "loaded" ref-iterator ===> perform the pileup */
-    if ( rc == 0 )
+    if ( rc == 0 && !parallel )
     {
         /* ============================================== */
-        switch( options->function )
-        {
-            case sra_pileup_stat        : rc = walk_stat( arg_ctx.ref_iter, options ); break;
-            case sra_pileup_counters    : rc = walk_counters( arg_ctx.ref_iter, options ); break;
-            case sra_pileup_debug       : rc = walk_debug( arg_ctx.ref_iter, options ); break;
-            case sra_pileup_mismatch    : rc = walk_mismatches( arg_ctx.ref_iter, options ); break;
-            case sra_pileup_index       : rc = walk_index( arg_ctx.ref_iter, options ); break;
-            case sra_pileup_varcount    : rc = walk_varcount( arg_ctx.ref_iter, options ); break;
-			case sra_pileup_indels      : rc = walk_indels( arg_ctx.ref_iter, options ); break;
-            default :  rc = walk_ref_iter( arg_ctx.ref_iter, options ); break;
-        }
+        rc = walk_pileup( arg_ctx.ref_iter, options );
         /* ============================================== */
     }
 
@@ -42,23 +42,29 @@
 #define OPTION_ID_ATTR         	"id_attr"
 #define OPTION_FEATURE_TYPE    	"feature_type"
 #define OPTION_MODE            	"mode"
+#define OPTION_THREADS         	"threads"
 
 #define ALIAS_ID_ATTR          	"i"
 #define ALIAS_FEATURE_TYPE     	"f"
 #define ALIAS_MODE     			"m"
+#define ALIAS_THREADS  			"t"
 
 #define DEFAULT_ID_ATTR         "gene_id"
 #define DEFAULT_FEATURE_TYPE    "exon"
+#define DEFAULT_THREADS         1
+#define MAX_THREADS             64
 
 static const char * id_attr_usage[] 		= { "id-attr (default gene_id)", NULL };
 static const char * feature_type_usage[] 	= { "feature-type (default exon)", NULL };
 static const char * mode_usage[] 			= { "output-mode (norm, debug)", NULL };
+static const char * threads_usage[] 		= { "count references and runs in parallel with that many threads (default 1)", NULL };
 
 OptDef sra_seq_count_options[] =
 {
     { OPTION_ID_ATTR, 		ALIAS_ID_ATTR,			NULL, id_attr_usage,		1, true, false },
     { OPTION_FEATURE_TYPE, 	ALIAS_FEATURE_TYPE, 	NULL, feature_type_usage, 	1, true, false },
-    { OPTION_MODE, 			ALIAS_MODE, 			NULL, mode_usage, 			1, true, false }	
+    { OPTION_MODE, 			ALIAS_MODE, 			NULL, mode_usage, 			1, true, false },
+    { OPTION_THREADS, 		ALIAS_THREADS, 			NULL, threads_usage, 		1, true, false }
 };
 
 const char UsageDefaultName[] = "sra-seq-count";
@@ -67,7 +73,10 @@ rc_t CC UsageSummary ( const char * progname )
 {
     return KOutMsg ( 	"\n"
 						"Usage:\n"
-						"  %s <sra-accession> <gtf-file> [options]\n"
+						"  %s <sra-accession> [<sra-accession> ...] <gtf-file> [options]\n"
+						"\n"
+						"  with more than one accession a count-matrix is produced:\n"
+						"  one row per feature, one column per accession\n"
 						"\n", progname );
 }
 
@@ -91,6 +100,7 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine ( ALIAS_ID_ATTR,			OPTION_ID_ATTR,			NULL, 		id_attr_usage );
     HelpOptionLine ( ALIAS_FEATURE_TYPE, 	OPTION_FEATURE_TYPE, 	NULL, 		feature_type_usage );
     HelpOptionLine ( ALIAS_MODE, 			OPTION_MODE, 			NULL, 		mode_usage );
+    HelpOptionLine ( ALIAS_THREADS, 		OPTION_THREADS, 		"count", 	threads_usage );
 
     KOutMsg ( "\n" );	
     HelpOptionsStandard ();
@@ -111,6 +121,22 @@ static rc_t get_str_option( const Args * args, const char * option_name, const c
 }
 
 
+static rc_t get_int_option( const Args * args, const char * option_name, int * dst, int default_value )
+{
+    uint32_t count;
+    rc_t rc = ArgsOptionCount( args, option_name, &count );
+	(*dst) = default_value;
+    if ( ( rc == 0 )&&( count > 0 ) )
+	{
+		const char * s;
+        rc = ArgsOptionValue( args, option_name, 0, (const void **)&s );
+		if ( rc == 0 )
+			(*dst) = atoi( s );
+	}
+    return rc;
+}
+
+
 static rc_t gather_options( const Args * args, struct sra_seq_count_options * options )
 {
 	rc_t rc;
@@ -133,17 +159,39 @@ static rc_t gather_options( const Args * args, struct sra_seq_count_options * op
 		}
 	}
 	
+	if ( rc == 0 )
+	{
+		rc = get_int_option( args, OPTION_THREADS, &options->threads, DEFAULT_THREADS );
+		if ( rc == 0 )
+		{
+			if ( options -> threads < 1 )
+				options -> threads = 1;
+			else if ( options -> threads > MAX_THREADS )
+				options -> threads = MAX_THREADS;
+		}
+	}
+	
 	if ( rc == 0 )
 	{
 		uint32_t count;
 		rc = ArgsParamCount( args, &count );
 		if ( rc == 0 )
 		{
-			if ( count == 2 )
+			if ( count >= 2 )
 			{
-				rc = ArgsParamValue( args, 0, (const void **)&options->sra_accession );
+				/* all parameters but the last one are accessions, the last one is the gtf-file */
+				options -> sra_accessions = calloc( count - 1, sizeof *( options -> sra_accessions ) );
+				if ( options -> sra_accessions == NULL )
+					rc = RC ( rcApp, rcArgv, rcAccessing, rcMemory, rcExhausted );
+				else
+				{
+					uint32_t idx;
+					for ( idx = 0; rc == 0 && idx < count - 1; ++idx )
+						rc = ArgsParamValue( args, idx, (const void **)&options->sra_accessions[ idx ] );
+					options -> sra_accession_count = count - 1;
+				}
 				if ( rc == 0 )
-					rc = ArgsParamValue( args, 1, (const void **)&options->gtf_file );
+					rc = ArgsParamValue( args, count - 1, (const void **)&options->gtf_file );
 				if ( rc == 0 )
 					options -> valid = true;
 			}
@@ -159,13 +207,15 @@ static rc_t gather_options( const Args * args, struct sra_seq_count_options * op
 
 static rc_t report_options( const struct sra_seq_count_options * options )
 {
-	rc_t rc = KOutMsg( "accession    : %s\n", options->sra_accession );
+	rc_t rc = KOutMsg( "accession    : %s\n", options->sra_accessions[ 0 ] );
 	if ( rc == 0 )
 		rc =  KOutMsg( "gtf-file     : %s\n", options->gtf_file );
 	if ( rc == 0 )
 		rc =  KOutMsg( "id-attr      : %s\n", options->id_attrib );
 	if ( rc == 0 )
 		rc =  KOutMsg( "feature-type : %s\n", options->feature_type );
+	if ( rc == 0 )
+		rc =  KOutMsg( "threads      : %d\n", options->threads );
 	if ( rc == 0 )
 	{
 		switch ( options->output_mode )
@@ -191,12 +241,15 @@ rc_t CC KMain ( int argc, char *argv [] )
 		rc = gather_options( args, &options );
 		if ( rc == 0 && options.valid )
 		{
-			rc = report_options( &options );
+			/* with more than one accession the output is a count-matrix, without preamble */
+			if ( options.sra_accession_count == 1 )
+				rc = report_options( &options );
 			if ( rc == 0 )
 			{
 				rc = matching( &options );	/* here we are calling into C++ */
 			}
 		}
+		free( ( void * )options.sra_accessions );
         ArgsWhack ( args );
     }
     return rc;
@@ -38,11 +38,13 @@ extern "C" {
 
 struct sra_seq_count_options
 {
-    const char * sra_accession;
+    const char ** sra_accessions;
+    int sra_accession_count;
     const char * gtf_file;
     const char * id_attrib;
     const char * feature_type;
 	int output_mode;
+	int threads;
 	bool valid;
 };
 
@@ -27,7 +27,8 @@
 #ifndef _hpp_seq_ranges_
 #define _hpp_seq_ranges_
 
-#include <list>
+#include <vector>
+#include <algorithm>
 
 namespace seq_ranges {
 
@@ -191,9 +192,9 @@ class range
 };
 
 
-bool compare_ranges ( const range * first, const range * second )
+inline bool compare_ranges ( const range &first, const range &second )
 {
-	return ( first -> get_start() < second -> get_start() );
+	return ( first.get_start() < second.get_start() );
 }
 
 
@@ -217,42 +218,26 @@ struct ranges_relation
 class ranges
 {
 	private :
-		std::list< range * > range_list;
-		long count;
+		std::vector< range > range_list;
 		
 	public :
-		ranges( void ) : count( 0 ) {}
-		~ranges( void ) { clear(); }
+		ranges( void ) {}
 		
-		void clear( void )
-		{
-			while ( !range_list.empty() )
-			{
-				range * r = range_list.front();
-				range_list.pop_front();
-				if ( r != NULL ) delete r;
-			}
-			count = 0;
-		}
+		void clear( void ) { range_list.clear(); }
 		
-		void add( range * r ){ if ( r != NULL ) { range_list.push_back( r ); count++; } }
-		void add( const range &r ){ add( new range( r ) ); }
+		void add( const range &r ){ range_list.push_back( r ); }
 
 		void merge( const range &r1 )
 		{
 			bool merged = false;
-			std::list< range * >::iterator it;
+			std::vector< range >::iterator it;
 			for ( it = range_list.begin(); it != range_list.end() && !merged; ++it )
-			{
-				range * r = *it;
-				if ( r != NULL )
-					merged = r -> merge( r1 );
-			}
+				merged = it -> merge( r1 );
 			if ( !merged ) add( r1 );
 		}
 		
-		void sort( void ) { range_list.sort( compare_ranges ); }
-		long get_count( void ) { return count; }
+		void sort( void ) { std::sort( range_list.begin(), range_list.end(), compare_ranges ); }
+		long get_count( void ) const { return range_list.size(); }
 		
 		void compare_sample( const ranges &sample, ranges_relation &res ) const
 		{
@@ -260,15 +245,13 @@ class ranges
 			bool done = false;
 			
 			// we take each range of the sample and compare it against each range of self
-			std::list< range * >::const_iterator sample_it;
+			std::vector< range >::const_iterator sample_it;
 			for ( sample_it = sample.range_list.begin(); sample_it != sample.range_list.end() && !done; ++sample_it )
 			{
-				const range * sample_range = *sample_it;
-				std::list< range * >::const_iterator pattern_it;
+				std::vector< range >::const_iterator pattern_it;
 				for ( pattern_it = range_list.begin(); pattern_it != range_list.end() && !done; ++pattern_it )	
 				{
-					const range * pattern_range( *pattern_it );
-					enum e_range_relation rr = pattern_range -> range_relation( *sample_range );
+					enum e_range_relation rr = pattern_it -> range_relation( *sample_it );
 					switch( rr )
 					{
 						case rr_before 	: break;
@@ -285,12 +268,9 @@ class ranges
 		
 		void print( std::ostream &stream ) const
 		{
-			std::list< range * >::const_iterator it;
+			std::vector< range >::const_iterator it;
 			for ( it = range_list.begin(); it != range_list.end(); ++it )
-			{
-				range * r = *it;
-				if ( r != NULL ) stream << *r << " ";
-			}
+				stream << *it << " ";
 		}		
 
 		friend std::ostream& operator<< ( std::ostream &stream, const ranges &other )
@@ -301,6 +281,98 @@ class ranges
 
 };
 
+
+/* -----------------------------------------------------------------------
+	interval_index:
+
+	answers "which of the added ranges intersect a given range" without
+	scanning all of them: the ranges are sorted by start and seen as an
+	implicit balanced tree ( the middle of each sub-array is its root ).
+	Every root keeps the largest end of its subtree, a query skips every
+	subtree that ends before the given range and every right subtree
+	starting after it. A single long range only keeps its own ancestors
+	from being skipped, not all ranges after it.
+	
+	every range carries a caller-defined value ( e.g. the index of a feature )
+   ----------------------------------------------------------------------- */
+
+class interval_index
+{
+	private :
+		struct entry
+		{
+			range r;
+			size_t value;
+			
+			entry( const range &r_, size_t value_ ) : r( r_ ), value( value_ ) {}
+			bool operator< ( const entry &other ) const { return r.get_start() < other.r.get_start(); }
+		};
+		
+		std::vector< entry > entries;
+		std::vector< long > max_end;	/* max_end[ mid ] : largest end in the subtree rooted at mid */
+		
+		/* returns the largest end in entries[ lo, hi ), 0 if empty: positions are 1-based */
+		long build_subtree( size_t lo, size_t hi )
+		{
+			if ( lo >= hi ) return 0;
+			size_t mid = lo + ( hi - lo ) / 2;
+			long m = entries[ mid ].r.get_end();
+			long left = build_subtree( lo, mid );
+			long right = build_subtree( mid + 1, hi );
+			if ( left > m ) m = left;
+			if ( right > m ) m = right;
+			max_end[ mid ] = m;
+			return m;
+		}
+		
+		void query_subtree( size_t lo, size_t hi, const range &r, std::vector< size_t > &res ) const
+		{
+			while ( lo < hi )
+			{
+				size_t mid = lo + ( hi - lo ) / 2;
+				if ( max_end[ mid ] < r.get_start() )
+					return;		/* nothing in here reaches the given range */
+				query_subtree( lo, mid, r, res );
+				if ( entries[ mid ].r.get_start() > r.get_end() )
+					return;		/* neither mid nor anything right of it starts early enough */
+				if ( entries[ mid ].r.get_end() >= r.get_start() )
+					res.push_back( entries[ mid ].value );
+				lo = mid + 1;
+			}
+		}
+		
+	public :
+		void add( const range &r, size_t value ) { entries.push_back( entry( r, value ) ); }
+		
+		/* has to be called once after all ranges are added, before any query */
+		void build( void )
+		{
+			std::stable_sort( entries.begin(), entries.end() );
+			max_end.resize( entries.size() );
+			build_subtree( 0, entries.size() );
+		}
+		
+		bool empty( void ) const { return entries.empty(); }
+		
+		/* appends the values of all ranges intersecting r to res, ordered by start */
+		void query( const range &r, std::vector< size_t > &res ) const
+		{
+			query_subtree( 0, entries.size(), r, res );
+		}
+		
+		/* the union of all ranges, as sorted non-overlapping ranges */
+		void spans( std::vector< range > &res ) const
+		{
+			res.clear();
+			std::vector< entry >::const_iterator it;
+			for ( it = entries.begin(); it != entries.end(); ++it )
+			{
+				if ( res.empty() || !res.back().merge( it -> r ) )
+					res.push_back( it -> r );
+			}
+		}
+};
+
 };  // namespace seq_ranges
 
 #endif // _hpp_seq_ranges_
@@ -36,9 +36,12 @@
 #include <string>
 #include <stdexcept>
 #include <vector>
-#include <list>
+#include <map>
 #include <algorithm>
 
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+
 #include "options.h"
 #include "range.hpp"
 
@@ -67,11 +70,10 @@ class feature
 		const char strand;		
 		ranges feature_ranges;
 		range outer;
-		long counter;
 
 	public :
 		feature( const feature_range &fr ) : ref_name( fr.ref_name ), feature_id( fr.feature_id ),
-				strand( fr.strand ), outer( fr.ft_range ), counter( 0 )
+				strand( fr.strand ), outer( fr.ft_range )
 		{
 			feature_ranges.add( fr.ft_range );
 		}
@@ -87,7 +89,7 @@ class feature
 			return res;
 		}
 
-		void debug_report ( void )
+		void debug_report ( long counter ) const
 		{
 			std::cout << "FEATURE: " << feature_id << " ( refname: " << ref_name << " ) strand = '" << strand << "' " << outer << std::endl;
 			std::cout << feature_ranges << std::endl;
@@ -95,32 +97,33 @@ class feature
 			std::cout << std::endl;
 		}
 
-		void report ( int output_mode )
+		/* the counter lives outside of the feature, so that the features can be shared by concurrent counting */
+		void report ( std::ostream &stream, int output_mode, long counter ) const
 		{
 			if ( counter > 0 )
 			{
 				if ( output_mode == SSC_MODE_NORMAL )
 				{
-					std::cout << feature_id << "\t" << counter << std::endl;
+					stream << feature_id << "\t" << counter << "\n";
 				}
 				else
 				{
-					std::cout << ref_name << "." << outer << "(" << feature_ranges.get_count() << ") "
-						<< feature_id << "\t" << counter << std::endl;
+					stream << ref_name << "." << outer << "(" << feature_ranges.get_count() << ") "
+						<< feature_id << "\t" << counter << "\n";
 				}
 			}
 		}
 
 		void sort_ranges( void ) { feature_ranges.sort(); }		
-		void get_ref_name( std::string &s ) { s = ref_name; }
-		void get_outer_range( range &r ) { r = outer; }
+		void get_ref_name( std::string &s ) const { s = ref_name; }
+		void get_outer_range( range &r ) const { r = outer; }
+		const range &get_outer_range( void ) const { return outer; }
 
 		/* does this feature end before the given range */
 		bool ends_before( const range &r ) const { return outer.ends_before( r ); }
-		bool is_ref( const std::string &r_name ) { return ( ref_name == r_name ); }
-		long start( void ) { return outer.get_start(); }
-		
-		void check( const range &r ) { if ( outer.intersect( r ) ) counter++; }
+		bool is_ref( const std::string &r_name ) const { return ( ref_name == r_name ); }
+		long start( void ) const { return outer.get_start(); }
+		const std::string &get_id( void ) const { return feature_id; }
 };
 
 
@@ -365,13 +368,50 @@ class global_counter
 				too_low_qual( 0 ), not_aligned( 0 ), not_unique( 0 ) {}
 
 		void inc_refs( void ) { refs++; }		
-		void inc_total_alignments( void ) { total_alignments++; }
+		void add_total_alignments( long n ) { total_alignments += n; }
 		void inc_no_feature( void ) { no_feature++; }
 		void inc_ambiguous( void ) { ambiguous++; }
 		void inc_too_low_qual( void ) { too_low_qual++; }
 		void inc_not_aligned( void ) { not_aligned++; }
 		void inc_not_unique( void ) { not_unique++; }
 		
+		/* the references are counted separately, their counters are summed up for the report */
+		void add( const global_counter &other )
+		{
+			refs += other.refs;
+			total_alignments += other.total_alignments;
+			no_feature += other.no_feature;
+			ambiguous += other.ambiguous;
+			too_low_qual += other.too_low_qual;
+			not_aligned += other.not_aligned;
+			not_unique += other.not_unique;
+		}
+		
+		/* the counters as rows of the count-matrix */
+		static const int row_count = 7;
+
+		static const char * row_name( int row )
+		{
+			static const char * names[ row_count ] = { "__no_feature", "__ambiguous", "__too_low_aQual",
+				"__not_aligned", "__alignment_not_unique", "__total", "__refs" };
+			return names[ row ];
+		}
+
+		long row_value( int row ) const
+		{
+			switch ( row )
+			{
+				case 0 : return no_feature;
+				case 1 : return ambiguous;
+				case 2 : return too_low_qual;
+				case 3 : return not_aligned;
+				case 4 : return not_unique;
+				case 5 : return total_alignments;
+				case 6 : return refs;
+			}
+			return 0;
+		}
+
 		void report( void )
 		{
 			std::cout << std::endl;
@@ -387,178 +427,357 @@ class global_counter
 };
 
 
-class feature_list
+/* -----------------------------------------------------------------------
+	feature_set:
+
+	all features of the gtf-file, grouped by reference ( in the order in
+	which the references appear in the gtf-file ) and indexed by their
+	outer range. Read-only after load(), can be shared between threads.
+   ----------------------------------------------------------------------- */
+
+class feature_set
 {
+	public :
+		struct reference
+		{
+			std::string name;
+			std::vector< size_t > features;	/* indices into feature_set::features, in gtf-order */
+			interval_index index;
+			std::vector< range > spans;		/* union of the outer ranges of all features */
+		};
+
 	private :
-		const std::string &ref_name;
-		int output_mode;
-		std::list< feature * > flist;
+		std::vector< feature * > features;
+		std::vector< reference > refs;
 
 		void clear( void )
 		{
-			while ( !flist.empty() )
-			{
-				feature * f = flist.front();
-				flist.pop_front();
-				if ( f != NULL ) delete f;
-			}
+			for ( size_t i = 0; i < features.size(); ++i )
+				delete features[ i ];
+			features.clear();
+			refs.clear();
 		}
 
-		void add( feature * f )
-		{
-			flist.push_back( f );
-		}
-		
 	public :
-		feature_list( const std::string &ref_name_, int output_mode_, feature * f )
-			: ref_name( ref_name_ ), output_mode( output_mode_ ) { add( f ); }
-		~feature_list( void ) { clear(); }
+		feature_set( void ) {}
+		~feature_set( void ) { clear(); }
 
-		bool empty( void ) { return flist.empty(); }
-		
-		void remove_all_features_before( const range &al_range )
+		void load( gtf_iter &gtf_it )
 		{
-			bool done = flist.empty();
-			while ( !done )
+			std::map< std::string, size_t > ref_lookup;
+			feature * f = gtf_it.next_feature();
+			while ( f != NULL )
 			{
-				feature * f = flist.front();
-				if ( f -> ends_before( al_range ) )
+				std::string ref_name;
+				f -> get_ref_name( ref_name );
+				std::map< std::string, size_t >::iterator it = ref_lookup.find( ref_name );
+				if ( it == ref_lookup.end() )
 				{
-					flist.pop_front();
-					f -> report( output_mode );
-					done = flist.empty();
-					delete f;
+					it = ref_lookup.insert( std::make_pair( ref_name, refs.size() ) ).first;
+					refs.push_back( reference() );
+					refs.back().name = ref_name;
 				}
-				else
-					done = true;
+				reference &ref = refs[ it -> second ];
+				ref.index.add( f -> get_outer_range(), features.size() );
+				ref.features.push_back( features.size() );
+				features.push_back( f );
+				f = gtf_it.next_feature();
+			}
+
+			for ( size_t i = 0; i < refs.size(); ++i )
+			{
+				refs[ i ].index.build();
+				refs[ i ].index.spans( refs[ i ].spans );
 			}
 		}
 
-		void load_all_features_starting_inside( const range &al_range, gtf_iter &gtf_it )
+		size_t feature_count( void ) const { return features.size(); }
+		const feature &get_feature( size_t idx ) const { return *features[ idx ]; }
+		size_t ref_count( void ) const { return refs.size(); }
+		const reference &get_ref( size_t idx ) const { return refs[ idx ]; }
+};
+
+
+/* -----------------------------------------------------------------------
+	ref_result:
+
+	what counting one reference of one run produced
+   ----------------------------------------------------------------------- */
+
+struct ref_result
+{
+	bool found;
+	std::string error;
+	global_counter counter;
+	
+	ref_result( void ) : found( false ) {}
+};
+
+
+/* -----------------------------------------------------------------------
+	count_ref:
+
+	counts the primary alignments of one reference against its features.
+	Only the spans covered by features are fetched from the run, the
+	alignments are matched against the features via the interval-index.
+	Each feature belongs to exactly one reference, so concurrent calls for
+	different references write to different counters.
+	The total is still every primary alignment of the reference, not only
+	the ones inside of the fetched spans.
+   ----------------------------------------------------------------------- */
+
+static void count_ref( ngs::ReadCollection &run, const feature_set &features, size_t ref_idx,
+					   std::vector< long > &counters, ref_result &res )
+{
+	const feature_set::reference &fref = features.get_ref( ref_idx );
+	ngs::Reference ref = run.getReference ( fref.name );
+	res.found = true;
+	res.counter.inc_refs();
+	res.counter.add_total_alignments( ref.getAlignmentCount( ngs::Alignment::primaryAlignment ) );
+
+	std::vector< size_t > hits;
+	long prev_end = 0;
+	std::vector< range >::const_iterator span;
+	for ( span = fref.spans.begin(); span != fref.spans.end(); ++span )
+	{
+		ngs::AlignmentIterator al_iter = ref.getAlignmentSlice( span -> get_start() - 1, /* slices are 0-based ! */
+																span -> get_end() - span -> get_start() + 1,
+																ngs::Alignment::primaryAlignment );
+		while ( al_iter.nextAlignment() )
 		{
-			bool done = false;
-			while ( !done )
+			int64_t  pos = al_iter.getAlignmentPosition() + 1; /* al_iter returns 0-based ! */
+			uint64_t len = al_iter.getAlignmentLength();
+			
+			/* an alignment reaching into the previous span has been counted there already */
+			if ( pos <= prev_end )
+				continue;
+
+			const range al_range( pos, pos + len - 1 );
+			
+			hits.clear();
+			fref.index.query( al_range, hits );
+			for ( size_t i = 0; i < hits.size(); ++i )
+				counters[ hits[ i ] ]++;
+		}
+		prev_end = span -> get_end();
+	}
+}
+
+
+/* -----------------------------------------------------------------------
+	run_counts:
+
+	the counters of one run: one per feature, one result per reference.
+	The features themselves are shared by all runs.
+   ----------------------------------------------------------------------- */
+
+class run_counts
+{
+	private :
+		const std::string accession;
+		const feature_set &features;
+		std::vector< long > counters;
+		std::vector< ref_result > results;
+
+	public :
+		std::string error;	/* the run could not be opened */
+
+		run_counts( const std::string &accession_, const feature_set &features_ )
+			: accession( accession_ ), features( features_ ), counters( features_.feature_count(), 0 ),
+			  results( features_.ref_count() )
+		{ }
+
+		const std::string &get_accession( void ) const { return accession; }
+		long get_counter( size_t feature_idx ) const { return counters[ feature_idx ]; }
+
+		void count( ngs::ReadCollection &run, size_t ref_idx )
+		{
+			try
 			{
-				done = !gtf_it.peek_next_feature_is_ref( ref_name );
-				if ( !done )
-				{
-					range r;
-					done = !gtf_it.peek_next_feature_range( r );
-					if ( !done )
-					{
-						if ( r.ends_before( al_range ) )
-						{
-							/* we can skip this feature! */
-							feature * f = gtf_it.next_feature();
-							delete f;
-						}
-						else if ( r.starts_after( al_range ) )
-						{
-							/* we are done, this feature if for alignments that come later */
-							done = true;
-						}
-						else
-						{
-							feature * f = gtf_it.next_feature();
-							if ( f != NULL ) add( f );
-						}
-					}
-				}
+				count_ref( run, features, ref_idx, counters, results[ ref_idx ] );
+			}
+			catch ( ngs::ErrorMsg e )
+			{
+				/* if the reference is not in the run we silently skip it */
+				if ( results[ ref_idx ].found )
+					results[ ref_idx ].error = e.what();
 			}
 		}
-		
-		void count_matches_between_alignment_and_features( const range &al_range )
+
+		void get_total( global_counter &total ) const
+		{
+			for ( size_t r = 0; r < results.size(); ++r )
+				total.add( results[ r ].counter );
+		}
+
+		/* references in gtf-order, the features of each reference in gtf-order */
+		void report( int output_mode ) const
 		{
-			std::list< feature * >::iterator it;
-			for ( it = flist.begin(); it != flist.end(); ++it )
+			for ( size_t r = 0; r < results.size(); ++r )
 			{
-				feature * f = *it;
-				if ( f != NULL )
+				const ref_result &res = results[ r ];
+				if ( !res.found )
+					continue;
+				
+				const feature_set::reference &fref = features.get_ref( r );
+				std::cout << "\nprocessing ref: " << fref.name << "\n";
+				std::cout << "-------------------------------------------\n";
+				for ( size_t i = 0; i < fref.features.size(); ++i )
 				{
-					f -> check( al_range );
+					size_t idx = fref.features[ i ];
+					features.get_feature( idx ).report( std::cout, output_mode, counters[ idx ] );
 				}
+				if ( !res.error.empty() )
+					std::cout << "error in ref " << fref.name << " : " << res.error << "\n";
 			}
+			global_counter total;
+			get_total( total );
+			total.report();
 		}
 };
 
 
-class iter_window
+/* -----------------------------------------------------------------------
+	count_pool:
+
+	counts all references of all runs with a pool of threads. The jobs
+	( one per reference and run ) are handed out run by run, every thread
+	keeps its own handle to the run it is working on.
+   ----------------------------------------------------------------------- */
+
+class count_pool
 {
 	private :
-		ngs::ReadCollection &run;	
-		gtf_iter &gtf_it;
-		int output_mode;
-		global_counter counter;
-		
-	public :
-		iter_window( ngs::ReadCollection &run_, gtf_iter &gtf_it_, int output_mode_ )
-			: run( run_ ), gtf_it( gtf_it_ ), output_mode( output_mode_ ) {}
+		std::vector< run_counts * > &runs;
+		const size_t refs_per_run;
+		size_t next_job;
+		KLock * lock;
 
-		void walk( void )
+		static rc_t CC worker( const KThread * self, void * data )
 		{
-			feature * f = gtf_it.next_feature();
-			while ( f != NULL )
+			( ( count_pool * ) data ) -> work();
+			return 0;
+		}
+
+		bool take_job( size_t &job )
+		{
+			KLockAcquire( lock );
+			job = next_job;
+			bool res = ( next_job < runs.size() * refs_per_run );
+			if ( res ) next_job++;
+			KLockUnlock( lock );
+			return res;
+		}
+
+		void work( void )
+		{
+			size_t job;
+			size_t run_idx = runs.size();
+			ngs::ReadCollection * run = NULL;
+			while ( take_job( job ) )
 			{
-				/* get the name of the reference of the fist feature in here... */
-				std::string ref_name;
-				f -> get_ref_name( ref_name );
-				try
+				run_counts &counts = *runs[ job / refs_per_run ];
+				if ( run_idx != job / refs_per_run )
 				{
-					ngs::Reference ref = run.getReference ( ref_name );
+					run_idx = job / refs_per_run;
+					delete run;
+					run = NULL;
 					try
 					{
-						bool done = false;
-						feature_list flist( ref_name, output_mode, f );
-						ngs::AlignmentIterator al_iter = ref.getAlignments( ngs::Alignment::primaryAlignment );
-
-						std::cout << std::endl << "processing ref: " << ref_name << std::endl;
-						std::cout << "-------------------------------------------" << std::endl;
-						counter.inc_refs();
-						
-						/* now walk all alignments of this al_iter */
-						while ( al_iter.nextAlignment() && !done )
-						{
-							int64_t  pos = al_iter.getAlignmentPosition() + 1; /* al_iter returns 0-based ! */
-							uint64_t len = al_iter.getAlignmentLength();
-							
-							const range al_range( pos, pos + len - 1 );
-							
-							/* remove and report all features that end before this alignment */
-							flist.remove_all_features_before( al_range );
-							flist.load_all_features_starting_inside( al_range, gtf_it );
-							
-							/* now we can count matches between the feature-list and this alignment */
-							flist.count_matches_between_alignment_and_features( al_range );
-							
-							/* look if we have to cancel the loop if the feature-list is empty
-							   and we have no more features in this reference */
-							if ( flist.empty() )
-							{
-								done = ( gtf_it.peek_next_feature_start() == 0 );
-								if ( !done )
-									done = !gtf_it.peek_next_feature_is_ref( ref_name );
-							}
-							counter.inc_total_alignments();
-						}
-						f = gtf_it.forward_to_next_ref( ref_name );
+						run = new ngs::ReadCollection( ncbi::NGS::openReadCollection( counts.get_accession() ) );
 					}
 					catch ( ngs::ErrorMsg e )
 					{
-						std::cout << "error in ref " << ref_name << " : " << e.what() << std::endl;
-						f = NULL;
+						KLockAcquire( lock );
+						if ( counts.error.empty() )
+							counts.error = e.what();
+						KLockUnlock( lock );
 					}
 				}
-				catch ( ngs::ErrorMsg e )
-				{
-					f = gtf_it.forward_to_next_ref( ref_name );
-				}
+				if ( run != NULL )
+					counts.count( *run, job % refs_per_run );
+			}
+			delete run;
+		}
 
+	public :
+		count_pool( std::vector< run_counts * > &runs_, size_t refs_per_run_ )
+			: runs( runs_ ), refs_per_run( refs_per_run_ ), next_job( 0 ), lock( NULL )
+		{
+			if ( KLockMake( &lock ) != 0 )
+				throw ngs::ErrorMsg( "cannot make lock" );
+		}
+		~count_pool( void ) { KLockRelease( lock ); }
+
+		void count( int threads )
+		{
+			std::vector< KThread * > workers;
+			for ( int i = 1; i < threads && ( size_t )i < runs.size() * refs_per_run; ++i )
+			{
+				KThread * t;
+				if ( KThreadMake( &t, worker, this ) == 0 )
+					workers.push_back( t );
+			}
+			
+			/* the calling thread is a worker too */
+			work();
+
+			for ( size_t i = 0; i < workers.size(); ++i )
+			{
+				rc_t status;
+				KThreadWait( workers[ i ], &status );
+				KThreadRelease( workers[ i ] );
 			}
-			counter.report();
 		}
 };
 
 
+/* -----------------------------------------------------------------------
+	report_matrix:
+
+	one row per feature ( in gtf-order ), one column per run, followed by
+	the global counters of each run
+   ----------------------------------------------------------------------- */
+
+static void report_matrix( const feature_set &features, const std::vector< run_counts * > &runs )
+{
+	std::cout << "feature";
+	for ( size_t c = 0; c < runs.size(); ++c )
+		std::cout << "\t" << runs[ c ] -> get_accession();
+	std::cout << "\n";
+
+	for ( size_t r = 0; r < features.ref_count(); ++r )
+	{
+		const feature_set::reference &fref = features.get_ref( r );
+		for ( size_t i = 0; i < fref.features.size(); ++i )
+		{
+			size_t idx = fref.features[ i ];
+			std::cout << features.get_feature( idx ).get_id();
+			for ( size_t c = 0; c < runs.size(); ++c )
+				std::cout << "\t" << runs[ c ] -> get_counter( idx );
+			std::cout << "\n";
+		}
+	}
+
+	std::vector< global_counter > totals( runs.size() );
+	for ( size_t c = 0; c < runs.size(); ++c )
+		runs[ c ] -> get_total( totals[ c ] );
+	for ( int row = 0; row < global_counter::row_count; ++row )
+	{
+		std::cout << global_counter::row_name( row );
+		for ( size_t c = 0; c < runs.size(); ++c )
+			std::cout << "\t" << totals[ c ].row_value( row );
+		std::cout << "\n";
+	}
+
+	for ( size_t c = 0; c < runs.size(); ++c )
+	{
+		if ( !runs[ c ] -> error.empty() )
+			std::cerr << "cannot open " << runs[ c ] -> get_accession() << " because " << runs[ c ] -> error << std::endl;
+	}
+}
+
+
 int matching( const struct sra_seq_count_options * options )
 {
 	int res = 0;
@@ -569,20 +788,36 @@ int matching( const struct sra_seq_count_options * options )
 	/* create the ngs-iterator, which delivers references and alignments */
 	try
 	{
-		ngs::ReadCollection run ( ncbi::NGS::openReadCollection( options->sra_accession ) );
+		/* with a single run: open it up front, to report a bad accession before the gtf-file is read */
+		if ( options->sra_accession_count == 1 )
+		{
+			ngs::ReadCollection run ( ncbi::NGS::openReadCollection( options->sra_accessions[ 0 ] ) );
+		}
 		
-		/* create the gtf-iterator, which delivers gtf-features */		
+		/* create the gtf-iterator, which delivers gtf-features, and index all of them once for all runs */
 		gtf_iter gtf_it( options->gtf_file, id_attr, feature_type );
+		feature_set features;
+		features.load( gtf_it );
 		
-		/* create a iterator window that walks both iterators to count alignments for the features */
-		iter_window window( run, gtf_it, options->output_mode );
-		
-		/* walk the window... */
-		window.walk();
+		std::vector< run_counts * > runs;
+		for ( int i = 0; i < options->sra_accession_count; ++i )
+			runs.push_back( new run_counts( options->sra_accessions[ i ], features ) );
+
+		/* count the alignments of all references of all runs for the features */
+		count_pool pool( runs, features.ref_count() );
+		pool.count( options->threads );
+
+		if ( runs.size() == 1 )
+			runs[ 0 ] -> report( options->output_mode );
+		else
+			report_matrix( features, runs );
+
+		for ( size_t i = 0; i < runs.size(); ++i )
+			delete runs[ i ];
 	}
 	catch ( ngs::ErrorMsg e )
 	{
-		std::cout << "cannot open " << options->sra_accession << " because " << e.what() << std::endl;
+		std::cout << "cannot open " << options->sra_accessions[ 0 ] << " because " << e.what() << std::endl;
 	}
 	return res;
 }
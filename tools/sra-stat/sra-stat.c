@@ -54,6 +54,9 @@
 #include <klib/rc.h>
 #include <klib/sort.h> /* ksort */
 
+#include <kproc/lock.h> /* KLock */
+#include <kproc/thread.h> /* KThread */
+
 #include <sra/sraschema.h> /* VDBManagerMakeSRASchema */
 
 #include <vdb/blob.h> /* VBlobCellData */
@@ -78,6 +81,12 @@
 #include <string.h>
 #include <time.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h> /* base counting */
+#elif defined(__SSE2__)
+#include <emmintrin.h> /* base counting */
+#endif
+
 #define DISP_RC2(rc, name, msg) (void)((rc == 0) ? 0 : \
     PLOGERR(klogInt, (klogInt, rc, \
         "$(name): $(msg)", "name=%s,msg=%s", name, msg)))
@@ -315,6 +324,7 @@ typedef struct srastat_parms {
     bool print_arcinfo;
     bool statistics; /* calculate average and stdev */
     bool test; /* test stdev */
+    uint32_t threads; /* number of threads scanning the table */
 
     const XMLLogger *logger;
 
@@ -598,8 +608,176 @@ static rc_t BasesRelease(Bases *self) {
     return rc;
 }
 
+/* Base counting: a block of elements of one encoding is counted at once.
+   code[] are the values of A, C, G, T; every other value <= max_code is N.
+   Returns the number of elements counted:
+   less than len when the element at that position is > max_code. */
+typedef struct BasesEncoding {
+    unsigned char code[4];
+    unsigned char max_code;
+    unsigned char map[16]; /* value -> index in Bases::cnt */
+} BasesEncoding;
+
+static const BasesEncoding BASES_x2na = /* x2na:bin, x2cs:bin */
+{ { 0, 1, 2, 3 }, 4,
+  { 0, 1, 2, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, } };
+
+static const BasesEncoding BASES_4na = /* 4na:bin */
+{ { 1, 2, 4, 8 }, 15,
+  { 4, 0, 1, 4, 2, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, } };
+/*  0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15
+       A  C     G           T                    N  */
+
+#if defined(__AVX2__)
+
+static size_t BasesCountBlocks(uint64_t *cnt,
+    const unsigned char *b, size_t len, const BasesEncoding *e)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i vmax = _mm256_set1_epi8((char)e->max_code);
+    __m256i c[4];
+    size_t done = 0;
+    int k = 0;
+
+    for (k = 0; k < 4; ++k) {
+        c[k] = _mm256_set1_epi8((char)e->code[k]);
+    }
+
+    /* byte counters can take at most 255 blocks before being summed up */
+    while (len - done >= 32) {
+        __m256i acc[4];
+        size_t blocks = (len - done) / 32;
+        size_t j = 0;
+        uint64_t acgt = 0;
+
+        if (blocks > 255) {
+            blocks = 255;
+        }
+        for (k = 0; k < 4; ++k) {
+            acc[k] = zero;
+        }
+
+        for (j = 0; j < blocks; ++j) {
+            const __m256i v
+                = _mm256_loadu_si256((const __m256i*)(b + done + j * 32));
+            if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                    _mm256_min_epu8(v, vmax), v)) != -1)
+            {
+                break;
+            }
+            for (k = 0; k < 4; ++k) {
+                acc[k] = _mm256_sub_epi8(acc[k], _mm256_cmpeq_epi8(v, c[k]));
+            }
+        }
+
+        for (k = 0; k < 4; ++k) {
+            const __m256i s = _mm256_sad_epu8(acc[k], zero);
+            uint64_t n = (uint64_t)_mm256_extract_epi64(s, 0)
+                + (uint64_t)_mm256_extract_epi64(s, 1)
+                + (uint64_t)_mm256_extract_epi64(s, 2)
+                + (uint64_t)_mm256_extract_epi64(s, 3);
+            cnt[k] += n;
+            acgt += n;
+        }
+        cnt[4] += j * 32 - acgt;
+        done += j * 32;
+
+        if (j < blocks) {
+            break; /* the invalid element is located by the scalar loop */
+        }
+    }
+
+    return done;
+}
+
+#elif defined(__SSE2__)
+
+static size_t BasesCountBlocks(uint64_t *cnt,
+    const unsigned char *b, size_t len, const BasesEncoding *e)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i vmax = _mm_set1_epi8((char)e->max_code);
+    __m128i c[4];
+    size_t done = 0;
+    int k = 0;
+
+    for (k = 0; k < 4; ++k) {
+        c[k] = _mm_set1_epi8((char)e->code[k]);
+    }
+
+    /* byte counters can take at most 255 blocks before being summed up */
+    while (len - done >= 16) {
+        __m128i acc[4];
+        size_t blocks = (len - done) / 16;
+        size_t j = 0;
+        uint64_t acgt = 0;
+
+        if (blocks > 255) {
+            blocks = 255;
+        }
+        for (k = 0; k < 4; ++k) {
+            acc[k] = zero;
+        }
+
+        for (j = 0; j < blocks; ++j) {
+            const __m128i v
+                = _mm_loadu_si128((const __m128i*)(b + done + j * 16));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(v, vmax), v))
+                != 0xFFFF)
+            {
+                break;
+            }
+            for (k = 0; k < 4; ++k) {
+                acc[k] = _mm_sub_epi8(acc[k], _mm_cmpeq_epi8(v, c[k]));
+            }
+        }
+
+        for (k = 0; k < 4; ++k) {
+            const __m128i s = _mm_sad_epu8(acc[k], zero);
+            uint64_t n = (uint64_t)_mm_cvtsi128_si32(s)
+                + (uint64_t)_mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+            cnt[k] += n;
+            acgt += n;
+        }
+        cnt[4] += j * 16 - acgt;
+        done += j * 16;
+
+        if (j < blocks) {
+            break; /* the invalid element is located by the scalar loop */
+        }
+    }
+
+    return done;
+}
+
+#else
+
+static size_t BasesCountBlocks(uint64_t *cnt,
+    const unsigned char *b, size_t len, const BasesEncoding *e)
+{
+    return 0;
+}
+
+#endif
+
+static size_t BasesCount(uint64_t *cnt,
+    const unsigned char *b, size_t len, const BasesEncoding *e)
+{
+    size_t i = BasesCountBlocks(cnt, b, len, e);
+
+    for (; i < len; ++i) {
+        const unsigned char base = b[i];
+        if (base > e->max_code) {
+            break;
+        }
+        ++cnt[e->map[base]];
+    }
+
+    return i;
+}
+
 static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment,
-    uint32_t * dREAD_LEN, uint8_t * dREAD_TYPE)
+    uint32_t * dREAD_LEN, uint8_t * dREAD_TYPE, size_t max_nreads)
 {
     rc_t rc = 0;
     const void *base = NULL;
@@ -614,7 +792,7 @@ static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment,
     int nreads = 0;
 
     int read = 0;
-    uint32_t nxtRdStart = 0;
+    bitsz_t rdStart = 0;
 
     assert(self);
 
@@ -640,7 +818,7 @@ static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment,
                 rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
             else if (row_bits & 7)
                 rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
-            else if ((row_bits >> 3) > MAX_NREADS * sizeof *dREAD_LEN)
+            else if ((row_bits >> 3) > max_nreads * sizeof *dREAD_LEN)
                 rc = RC(rcExe, rcColumn, rcReading, rcBuffer, rcInsufficient);
             DISP_RC_Read(rc, "READ_LEN", spotid,
                          "after calling VCursorColumnRead");
@@ -663,7 +841,7 @@ static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment,
                 rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
             else if (row_bits & 7)
                 rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
-            else if ((row_bits >> 3) > MAX_NREADS * sizeof * dREAD_TYPE)
+            else if ((row_bits >> 3) > max_nreads * sizeof * dREAD_TYPE)
                 rc = RC(rcExe, rcColumn, rcReading,
                     rcBuffer, rcInsufficient);
             else if (((row_bits >> 3) / sizeof(*dREAD_TYPE)) != nreads)
@@ -711,64 +889,65 @@ static rc_t BasesAdd(Bases *self, int64_t spotid, bool alignment,
     row_bits /= 8;
     bases = base;
 
-    for (i = 0; i < row_bits; ++i) {
-        unsigned char base = bases[i];
-        if ( i == nxtRdStart) {
-            if ( read > nreads )
-                return RC(rcExe, rcNumeral, rcComparing, rcData, rcInvalid);
-            nxtRdStart += dREAD_LEN [ read ++ ];
-            assert ( read > 0 );
-            if ( ( (dREAD_TYPE[read-1] & SRA_READ_TYPE_BIOLOGICAL) == 0 )
-                    /* skip non-biological reads */
-                 ||
-                 ( dREAD_LEN [ read - 1 ] == 0 )
-                    /* skip empty reads */
-               )
-            {
-                if ( dREAD_LEN [ read - 1 ] > 0 )
-                    i += dREAD_LEN [ read - 1 ];
-                -- i; /* here i can become negative: it should be signed */
-                continue;                
-            }
+    /* only biological reads are counted: every one as a single block */
+    for (read = 0; read < nreads && rdStart < row_bits; ++read) {
+        const BasesEncoding * e = alignment ? &BASES_4na : &BASES_x2na;
+        bitsz_t len = dREAD_LEN [ read ];
+        size_t counted = 0;
+
+        if ( ( dREAD_TYPE [ read ] & SRA_READ_TYPE_BIOLOGICAL ) == 0
+            || len == 0 )
+        {
+            rdStart += len;
+            continue;
         }
 
-        if ( alignment ) {
-            const unsigned char x [16]
-                = { 4, 0, 1, 4, 2, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, };
-            /*      0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15
-                       A  C     G           T                    N  */
-            if (base > 15) {
-                rc = RC(rcExe, rcColumn, rcReading, rcData, rcInvalid);
+        if ( rdStart + len > row_bits )
+            len = row_bits - rdStart;
+
+        counted = BasesCount(self->cnt, bases + rdStart, len, e);
+        if (counted < len) {
+            const unsigned char base = bases [ rdStart + counted ];
+            i = rdStart + counted;
+            rc = RC(rcExe, rcColumn, rcReading, rcData, rcInvalid);
+            if ( alignment ) {
                 PLOGERR(klogInt, (klogErr, rc, "Invalid RAW_READ column "
                     "value '$(base)' while VCursorCellDataDirect"
                     "(spotid=$(spotid), index=$(i))",
                     "base=%d,spotid=%lu,i=%lu", base, spotid, i));
-                BasesRelease(self);
-                return rc;
             }
-            assert ( base < sizeof x / sizeof x [ 0 ] );
-            base = x [  base ];
-        }
-
-        if (base > 4) {
-            const char * name = self->basesType == ebtCSREAD ? "CSREAD"
-                : self->basesType == ebtREAD ? "READ" : "RAW_READ";
-            rc = RC(rcExe, rcColumn, rcReading, rcData, rcInvalid);
-            PLOGERR(klogInt, (klogErr, rc,
-               "Invalid READ column value '$(base)' while VCursorCellDataDirect"
-               "($(name), spotid=$(spotid), index=$(i))",
-               "base=%d,name=%s,spotid=%lu,i=%lu",
-               base, name, spotid, i));
+            else {
+                const char * name = self->basesType == ebtCSREAD ? "CSREAD"
+                    : self->basesType == ebtREAD ? "READ" : "RAW_READ";
+                PLOGERR(klogInt, (klogErr, rc,
+                   "Invalid READ column value '$(base)' while "
+                   "VCursorCellDataDirect($(name), spotid=$(spotid), "
+                   "index=$(i))", "base=%d,name=%s,spotid=%lu,i=%lu",
+                   base, name, spotid, i));
+            }
             BasesRelease(self);
             return rc;
         }
 
-        ++self->cnt[base];
+        rdStart += dREAD_LEN [ read ];
     }
 
+    if ( rdStart < row_bits ) /* bases after the last read */
+        return RC(rcExe, rcNumeral, rcComparing, rcData, rcInvalid);
+
     return 0;
 }
 
+static void BasesMerge(Bases *self, const Bases *other) {
+    int i = 0;
+
+    assert(self && other);
+
+    for (i = 0; i < 5; ++i) {
+        self->cnt[i] += other->cnt[i];
+    }
+}
+
 static rc_t BasesPrint(const Bases *self,
     uint64_t base_count, const char* indent)
 {
@@ -896,6 +1075,35 @@ static void StatisticsAdd(Statistics* self, double value) {
     self->q += ((double)value - a_1) * ((double)value - self->a);
 }
 
+/* Merges statistics of two disjoint sets of values:
+   Chan et al. pairwise update of the mean and of the sum of squared diffs */
+static void StatisticsMerge(Statistics* self, const Statistics* other) {
+    double n = 0;
+    double delta = 0;
+
+    assert(self && other);
+
+    if (other->n == 0) {
+        return;
+    }
+
+    if (self->n == 0) {
+        *self = *other;
+        return;
+    }
+
+    if (other->variable || other->prev_val != self->prev_val) {
+        self->variable = true;
+    }
+
+    n = (double)self->n + other->n;
+    delta = other->a - self->a;
+
+    self->a += delta * other->n / n;
+    self->q += other->q + delta * delta * ((double)self->n * other->n / n);
+    self->n += other->n;
+}
+
 static double StatisticsAverage(const Statistics* self) {
     assert(self);
 
@@ -939,6 +1147,38 @@ void SraStatsTotalAdd(SraStatsTotal* self,
     }
 }
 
+/* Adds the counters of a part of the table scanned separately */
+static
+void SraStatsTotalMerge(SraStatsTotal* self, const SraStatsTotal* other) {
+    uint32_t i = 0;
+
+    assert(self && other);
+
+    self->spot_count          += other->spot_count;
+    self->spot_count_mates    += other->spot_count_mates;
+    self->BIO_BASE_COUNT      += other->BIO_BASE_COUNT;
+    self->bio_len_mates       += other->bio_len_mates;
+    self->BASE_COUNT          += other->BASE_COUNT;
+    self->bad_spot_count      += other->bad_spot_count;
+    self->bad_bio_len         += other->bad_bio_len;
+    self->filtered_spot_count += other->filtered_spot_count;
+    self->filtered_bio_len    += other->filtered_bio_len;
+    self->total_cmp_len       += other->total_cmp_len;
+
+    if (other->variable_nreads || other->nreads != self->nreads) {
+        self->variable_nreads = true;
+    }
+
+    if (!self->variable_nreads && self->stats != NULL && other->stats != NULL)
+    {
+        for (i = 0; i < self->nreads; ++i) {
+            StatisticsMerge(self->stats + i, other->stats + i);
+        }
+    }
+
+    BasesMerge(&self->bases_count, &other->bases_count);
+}
+
 static
 void SraStatsTotalAdd2(SraStatsTotal* self, uint32_t* values) {
     uint32_t i = 0;
@@ -3030,12 +3270,158 @@ int64_t CC srastats_sort ( const BSTNode *item, const BSTNode *n )
     return srastats_cmp(ss->spot_group,n);
 }
 
-static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
-    SraStatsTotal* total, const Ctx * ctx, const VTable *vtbl)
+static
+void SraStatsAdd(SraStats* self, const SraStats* other)
 {
+    assert(self && other);
+
+    self->spot_count          += other->spot_count;
+    self->spot_count_mates    += other->spot_count_mates;
+    self->bio_len             += other->bio_len;
+    self->bio_len_mates       += other->bio_len_mates;
+    self->total_len           += other->total_len;
+    self->bad_spot_count      += other->bad_spot_count;
+    self->bad_bio_len         += other->bad_bio_len;
+    self->filtered_spot_count += other->filtered_spot_count;
+    self->filtered_bio_len    += other->filtered_bio_len;
+    self->total_cmp_len       += other->total_cmp_len;
+}
+
+/* The table scan is cut into jobs: ranges of spots of the SEQUENCE table,
+   then ranges of rows for the Bases statistics.
+   Every worker thread takes the next job and adds it to its own SpotScan,
+   SpotScans are merged into the totals when all jobs are done. */
+#define SCAN_JOB_ROWS 262144
+
+typedef enum {
+    esjSPOTS,
+    esjALIGNMENT_BASES,
+    esjSEQUENCE_BASES,
+    esjCOUNT
+} ESpotScanJob;
+
+typedef struct SpotScanJobs {
+    KLock * lock;
+
+    int64_t next [ esjCOUNT ];
+    int64_t stop [ esjCOUNT ];
+
+    bool abort;
+
+    const KLoadProgressbar * pr;
+
+    /* READ_LEN of the first spot: used to check fixedReadLength */
+    int g_nreads;
+    const uint32_t * g_dREAD_LEN;
+} SpotScanJobs;
+
+typedef struct SpotScan {
+    const srastat_parms * pb;
+    SpotScanJobs * jobs;
+
+    const VCursor * curs;
+    uint32_t idxPRIMARY_ALIGNMENT_ID;
+    uint32_t idxRD_FILTER;
+    uint32_t idxREAD_LEN;
+    uint32_t idxREAD_TYPE;
+    uint32_t idxSPOT_GROUP;
+
+    /* capacity of the READ buffers */
+    size_t max_nreads;
+    uint32_t * dREAD_LEN;
+    uint8_t  * dREAD_TYPE;
+    uint8_t  * dRD_FILTER;
+    size_t max_spot_group;
+    char     * dSPOT_GROUP;
+
+    uint64_t * g_totalREAD_LEN;   /* sum(READ_LEN[i]) */
+    uint64_t * g_nonZeroLenReads;
+
+    bool bad_read_filter;
+    bool fixedNReads;
+    bool fixedReadLength;
+    bool hasSPOT_GROUP;
+
+    BSTree tr;                    /* SraStats nodes of this scan */
+    SraStatsTotal total;
+
+    uint64_t progress;            /* processed rows not reported yet */
+
+    KThread * thread;
+    rc_t rc;
+} SpotScan;
+
+static rc_t SpotScanGrow(SpotScan * self, size_t max_nreads) {
     rc_t rc = 0;
+    size_t old = 0;
+
+    assert(self);
+
+    old = self -> max_nreads;
+    if ( max_nreads <= old )
+        return 0;
 
-    const VCursor *curs = NULL;
+    if ( rc == 0 ) {
+        uint32_t * tmp = realloc ( self -> dREAD_LEN,
+            max_nreads * sizeof * self -> dREAD_LEN );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else
+            self -> dREAD_LEN = tmp;
+    }
+    if ( rc == 0 ) {
+        uint8_t * tmp = realloc ( self -> dREAD_TYPE,
+            max_nreads * sizeof * self -> dREAD_TYPE );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else
+            self -> dREAD_TYPE = tmp;
+    }
+    if ( rc == 0 ) {
+        uint8_t * tmp = realloc ( self -> dRD_FILTER,
+            max_nreads * sizeof * self -> dRD_FILTER );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else
+            self -> dRD_FILTER = tmp;
+    }
+    if ( rc == 0 ) {
+        uint64_t * tmp = realloc ( self -> g_totalREAD_LEN,
+            max_nreads * sizeof * self -> g_totalREAD_LEN );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else {
+            self -> g_totalREAD_LEN = tmp;
+            memset ( tmp + old, 0, ( max_nreads - old ) * sizeof * tmp );
+        }
+    }
+    if ( rc == 0 ) {
+        uint64_t * tmp = realloc ( self -> g_nonZeroLenReads,
+            max_nreads * sizeof * self -> g_nonZeroLenReads );
+        if ( tmp == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+        else {
+            self -> g_nonZeroLenReads = tmp;
+            memset ( tmp + old, 0, ( max_nreads - old ) * sizeof * tmp );
+        }
+    }
+
+    if ( rc == 0 ) {
+        self -> max_nreads = max_nreads;
+        DBGMSG ( DBG_APP, DBG_COND_1,
+            ( "Reallocated buffers for %zu READS\n", max_nreads ) );
+    }
+    else
+        DBGMSG ( DBG_APP, DBG_COND_1,
+            ( "Failed to reallocate buffers for %zu READS\n", max_nreads ) );
+
+    return rc;
+}
+
+static rc_t SpotScanInit(SpotScan * self, SpotScanJobs * jobs,
+    const srastat_parms * pb, const Ctx * ctx, const VTable * vtbl)
+{
+    rc_t rc = 0;
 
     const char PRIMARY_ALIGNMENT_ID[] = "PRIMARY_ALIGNMENT_ID";
     const char RD_FILTER [] = "RD_FILTER";
@@ -3043,709 +3429,737 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
     const char READ_TYPE [] = "READ_TYPE";
     const char SPOT_GROUP[] = "SPOT_GROUP";
 
-    uint32_t idxPRIMARY_ALIGNMENT_ID = 0;
-    uint32_t idxRD_FILTER = 0;
-    uint32_t idxREAD_LEN = 0;
-    uint32_t idxREAD_TYPE = 0;
-    uint32_t idxSPOT_GROUP = 0;
-
-    int g_nreads = 0;
-    int64_t  n_spots = 0;
-    int64_t start = 0;
-    int64_t stop  = 0;
+    assert(self && jobs && pb && ctx && vtbl);
 
-    /* filled with dREAD_LEN[i] for (spotid == start);
-       used to check fixedReadLength */
-    uint64_t * g_totalREAD_LEN
-        = calloc ( MAX_NREADS, sizeof * g_totalREAD_LEN );
-    uint64_t * g_nonZeroLenReads
-        = calloc ( MAX_NREADS, sizeof * g_nonZeroLenReads );
-    uint32_t * g_dREAD_LEN = calloc ( MAX_NREADS, sizeof * g_dREAD_LEN );
-    if ( g_totalREAD_LEN == NULL || g_nonZeroLenReads == NULL ||
-         g_dREAD_LEN == NULL )
-    {
+    memset(self, 0, sizeof *self);
+    self -> pb = pb;
+    self -> jobs = jobs;
+    self -> fixedNReads = self -> fixedReadLength = true;
+    BSTreeInit(&self->tr);
+
+    self -> max_spot_group = 1000;
+    self -> dSPOT_GROUP = calloc ( self -> max_spot_group, 1 );
+    if ( self -> dSPOT_GROUP == NULL )
         rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
-        DBGMSG ( DBG_APP, DBG_COND_1,
-            ( "Failed to allocate buffers for %zu READS\n", MAX_NREADS ) );
+    else {
+        string_copy_measure ( self -> dSPOT_GROUP, self -> max_spot_group,
+                              "NULL" );
+        rc = SpotScanGrow ( self, MAX_NREADS );
     }
-    else
-        DBGMSG ( DBG_APP, DBG_COND_1,
-            ( "Allocated buffers for %zu READS\n", MAX_NREADS ) );
-
-    rc = VTableCreateCachedCursorRead(vtbl, &curs, DEFAULT_CURSOR_CAPACITY);
-    DISP_RC(rc, "Cannot VTableCreateCachedCursorRead");
 
     if (rc == 0) {
-        rc = VCursorPermitPostOpenAdd(curs);
+        rc = VTableCreateCachedCursorRead(vtbl, &self->curs,
+                                          DEFAULT_CURSOR_CAPACITY);
+        DISP_RC(rc, "Cannot VTableCreateCachedCursorRead");
+    }
+    if (rc == 0) {
+        rc = VCursorPermitPostOpenAdd(self->curs);
         DISP_RC(rc, "Cannot VCursorPermitPostOpenAdd");
     }
-
     if (rc == 0) {
-        rc = VCursorOpen(curs);
+        rc = VCursorOpen(self->curs);
         DISP_RC(rc, "Cannot VCursorOpen");
     }
-
-    assert(pb && vtbl && tr && total);
-
     if (rc == 0) {
         const char* name = READ_LEN;
-        rc = VCursorAddColumn(curs, &idxREAD_LEN, "%s", name);
+        rc = VCursorAddColumn(self->curs, &self->idxREAD_LEN, "%s", name);
         DISP_RC2(rc, name, "while calling VCursorAddColumn");
     }
     if (rc == 0) {
         const char* name = READ_TYPE;
-        rc = VCursorAddColumn(curs, &idxREAD_TYPE, "%s", name);
+        rc = VCursorAddColumn(self->curs, &self->idxREAD_TYPE, "%s", name);
         DISP_RC2(rc, name, "while calling VCursorAddColumn");
     }
-
     if (rc == 0) {
-        {
-            const char* name = SPOT_GROUP;
-            rc = VCursorAddColumn(curs, &idxSPOT_GROUP, "%s", name);
-            if (columnUndefined(rc)) {
-                idxSPOT_GROUP = 0;
-                rc = 0;
-            }
-            DISP_RC2(rc, name, "while calling VCursorAddColumn");
+        const char* name = SPOT_GROUP;
+        rc = VCursorAddColumn(self->curs, &self->idxSPOT_GROUP, "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxSPOT_GROUP = 0;
+            rc = 0;
         }
-        if (rc == 0) {
-            if (rc == 0) {
-                const char* name = RD_FILTER;
-                rc = VCursorAddColumn(curs, &idxRD_FILTER, "%s", name);
-                if (columnUndefined(rc)) {
-                    idxRD_FILTER = 0;
-                    rc = 0;
-                }
-                DISP_RC2(rc, name, "while calling VCursorAddColumn");
-            }
-/*          if (rc == 0) {
-                const char* name = CMP_READ;
-                rc = SRATableOpenColumnRead
-                    (tbl, &cCMP_READ, name, "INSDC:dna:text");
-                if (GetRCState(rc) == rcNotFound)
-                {   rc = 0; }
-                DISP_RC2(rc, name, "while calling SRATableOpenColumnRead");
-            } */
-            if (rc == 0) {
-                const char* name = PRIMARY_ALIGNMENT_ID;
-                rc = VCursorAddColumn(curs, &idxPRIMARY_ALIGNMENT_ID,
-                    "%s", name);
-                if (columnUndefined(rc)) {
-                    idxPRIMARY_ALIGNMENT_ID = 0;
-                    rc = 0;
-                }
-                DISP_RC2(rc, name, "while calling VCursorAddColumn");
-            }
-            if (rc == 0) {
-                int64_t first = 0;
-                uint64_t count = 0;
-                int64_t spotid;
-                pb->hasSPOT_GROUP = 0;
-                rc = VCursorIdRange(curs, 0, &first, &count);
-                DISP_RC(rc, "VCursorIdRange() failed");
-                if (rc == 0) {
-                    rc = BasesInit(&total->bases_count, ctx, vtbl, pb);
-                }
-                if (rc == 0) {
-                    const KLoadProgressbar *pr = NULL;
-                    bool bad_read_filter = false;
-                    bool fixedNReads = true;
-                    bool fixedReadLength = true;
-
-                    uint32_t * dREAD_LEN
-                        = calloc ( MAX_NREADS, sizeof * dREAD_LEN );
-                    uint8_t * dREAD_TYPE
-                        = calloc ( MAX_NREADS, sizeof * dREAD_TYPE );
-                    uint8_t * dRD_FILTER
-                        = calloc ( MAX_NREADS, sizeof * dRD_FILTER );
-                    size_t MAX_SPOT_GROUP = 1000;
-                    char * dSPOT_GROUP
-                        = calloc ( MAX_SPOT_GROUP, sizeof * dSPOT_GROUP );
-                    if ( dREAD_LEN  == NULL || dREAD_TYPE  == NULL ||
-                         dRD_FILTER == NULL || dSPOT_GROUP == NULL )
-                    {
-                        rc = RC ( rcExe, rcStorage,
-                                  rcAllocating, rcMemory, rcExhausted );
-                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Failed to allocate "
-                            "cursor buffers for READ_LEN %zu\n", MAX_NREADS ) );
-                    }
-                    else {
-                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Allocated cursor "
-                                "buffers for %zu READS\n", MAX_NREADS ) );
-                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Allocated "
-                                "buffer for SPOT_GROUP[%zu]\n",
-                                MAX_SPOT_GROUP ) );
-                        string_copy_measure ( dSPOT_GROUP, MAX_SPOT_GROUP,
-                                              "NULL" );
-                    }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+    if (rc == 0) {
+        const char* name = RD_FILTER;
+        rc = VCursorAddColumn(self->curs, &self->idxRD_FILTER, "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxRD_FILTER = 0;
+            rc = 0;
+        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+    if (rc == 0) {
+        const char* name = PRIMARY_ALIGNMENT_ID;
+        rc = VCursorAddColumn(self->curs, &self->idxPRIMARY_ALIGNMENT_ID,
+            "%s", name);
+        if (columnUndefined(rc)) {
+            self->idxPRIMARY_ALIGNMENT_ID = 0;
+            rc = 0;
+        }
+        DISP_RC2(rc, name, "while calling VCursorAddColumn");
+    }
+    if (rc == 0) {
+        rc = BasesInit(&self->total.bases_count, ctx, vtbl, pb);
+    }
 
-                    if (pb->start > 0) {
-                        start = pb->start;
-                        if (start < first) {
-                            start = first;
-                        }
-                    }
-                    else {
-                        start = first;
-                    }
+    return rc;
+}
 
-                    if (pb->stop > 0) {
-                        stop = pb->stop;
-                        if ( ( uint64_t ) stop > first + count) {
-                            stop = first + count;
-                        }
-                    }
-                    else {
-                        stop = first + count;
-                    }
+static rc_t SpotScanRelease(SpotScan * self) {
+    rc_t rc = 0;
 
-                    for (spotid = start; spotid < stop && rc == 0; ++spotid) {
-                        SraStats* ss;
+    assert(self);
 
-                        const void* base;
-                        bitsz_t boff, row_bits;
-                        int nreads;
+    BSTreeWhack(&self->tr, bst_whack_free, NULL);
+    SraStatsTotalFree(&self->total);
+    RELEASE(VCursor, self->curs);
 
-                        rc = Quitting();
-                        if (rc != 0) {
-                            LOGMSG(klogWarn, "Interrupted");
-                        }
+    free ( self -> dREAD_LEN );
+    free ( self -> dREAD_TYPE );
+    free ( self -> dRD_FILTER );
+    free ( self -> dSPOT_GROUP );
+    free ( self -> g_totalREAD_LEN );
+    free ( self -> g_nonZeroLenReads );
 
-                        if (rc == 0 && pb->progress && pr == NULL) {
-                            uint64_t b = total->bases_count.stopSEQUENCE + 1
-                                       - total->bases_count.startSEQUENCE;
-                            if ( total->bases_count.stopALIGNMENT > 0 )
-                                b +=  total->bases_count.stopALIGNMENT + 1
-                                    - total->bases_count.startALIGNMENT;
-                            rc = KLoadProgressbar_Make(&pr,
-                                                       stop + 1 - start + b);
-                            if (rc != 0) {
-                                DISP_RC(rc, "cannot initialize progress bar");
-                                rc = 0;
-                                pr = NULL;
-                            }
-                            else if (stop - start > 99) {
-                                KLoadProgressbar_Process(pr, 0, true);
-                            }
-                        }
+    memset(self, 0, sizeof *self);
 
-                        if (rc == 0) {
-                            rc = VCursorColumnRead(curs, spotid,
-                                idxREAD_LEN, &base, &boff, &row_bits);
-                            DISP_RC_Read(rc, READ_LEN, spotid,
-                                "while calling VCursorColumnRead");
-                        }
-                        if (rc == 0) {
-                            if (boff & 7) {
-                                rc = RC(rcExe, rcColumn, rcReading,
-                                    rcOffset, rcInvalid);
-                            }
-                            else if (row_bits & 7) {
-                                rc = RC(rcExe, rcColumn, rcReading,
-                                    rcSize, rcInvalid);
-                            }
-                            else if ( ( row_bits >> 3 )
-                                 > MAX_NREADS * sizeof * dREAD_LEN )
-                            {
-                                size_t oldMAX_NREADS = MAX_NREADS;
-                                MAX_NREADS =
-                                    ( row_bits >> 3 ) / sizeof * dREAD_LEN
-                                    + 1000;
-                                if ( rc == 0 ) {
-                                    uint32_t * tmp = realloc ( dREAD_LEN,
-                                        MAX_NREADS * sizeof * dREAD_LEN );
-                                    if ( tmp == NULL ) {
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    }
-                                    else
-                                        dREAD_LEN = tmp;
-                                }
-                                if ( rc == 0 ) {
-                                    uint8_t * tmp = realloc ( dREAD_TYPE,
-                                        MAX_NREADS * sizeof * dREAD_TYPE );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else
-                                        dREAD_TYPE = tmp;
-                                }
-                                if ( rc == 0 ) {
-                                    uint8_t * tmp = realloc ( dRD_FILTER,
-                                        MAX_NREADS * sizeof * dRD_FILTER );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else
-                                        dRD_FILTER = tmp;
-                                }
-                                if ( rc == 0 ) {
-                                    uint64_t * tmp = realloc ( g_totalREAD_LEN,
-                                        MAX_NREADS * sizeof * g_totalREAD_LEN );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_totalREAD_LEN = tmp;
-                                        memset (
-                                            g_totalREAD_LEN + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_totalREAD_LEN
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 ) {
-                                    uint64_t * tmp = realloc ( g_totalREAD_LEN,
-                                        MAX_NREADS * sizeof * g_totalREAD_LEN );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_totalREAD_LEN = tmp;
-                                        memset (
-                                            g_totalREAD_LEN + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_totalREAD_LEN
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 ) {
-                                    uint64_t * tmp = realloc ( g_nonZeroLenReads,
-                                        MAX_NREADS * sizeof * g_nonZeroLenReads );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_nonZeroLenReads = tmp;
-                                        memset (
-                                            g_nonZeroLenReads + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_nonZeroLenReads
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 ) {
-                                    uint32_t * tmp = realloc ( g_dREAD_LEN,
-                                        MAX_NREADS * sizeof * g_dREAD_LEN );
-                                    if ( tmp == NULL )
-                                        rc = RC ( rcExe, rcStorage,
-                                          rcAllocating, rcMemory, rcExhausted );
-                                    else {
-                                        g_dREAD_LEN = tmp;
-                                        memset (
-                                            g_dREAD_LEN + oldMAX_NREADS, 0,
-                                            ( MAX_NREADS - oldMAX_NREADS ) * sizeof * g_dREAD_LEN
-                                        );
-                                    }
-                                }
-                                if ( rc == 0 )
-                                    DBGMSG ( DBG_APP, DBG_COND_1, ( 
-                                        "Reallocated buffers "
-                                        "for %zu READS\n", MAX_NREADS ) );
-                                else
-                                    DBGMSG ( DBG_APP, DBG_COND_1, ( "Failed to "
-                                        "reallocate buffers for %zu READS\n",
-                                        MAX_NREADS ) );
-                            }
-                            DISP_RC_Read(rc, READ_LEN, spotid,
-                                "after calling VCursorColumnRead");
-                        }
-                        if (rc == 0) {
-                            int i, bio_len, bio_count, bad_cnt, filt_cnt;
-                            memmove(dREAD_LEN, ((const char*)base) + (boff>>3),
-                                    ( size_t ) row_bits >> 3);
-                            nreads
-                                = (int) ((row_bits >> 3) / sizeof(*dREAD_LEN));
-                            if (spotid == start) {
-                                g_nreads = nreads;
-                                if (pb->statistics) {
-                                    rc = SraStatsTotalMakeStatistics
-                                        (total, g_nreads);
-                                }
-                            }
-                            else if (g_nreads != nreads) {
-                                fixedNReads = false;
-                            }
+    return rc;
+}
 
-                            if (rc == 0) {
-                                rc = VCursorColumnRead(curs, spotid,
-                                    idxREAD_TYPE, &base, &boff, &row_bits);
-                                DISP_RC_Read(rc, READ_TYPE, spotid,
-                                    "while calling VCursorColumnRead");
-                                if (rc == 0) {
-                                    if (boff & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcOffset, rcInvalid);
-                                    }
-                                    else if (row_bits & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcSize, rcInvalid);
-                                    }
-                                    else if ((row_bits >> 3) >
-                                        MAX_NREADS * sizeof * dREAD_TYPE)
-                                    {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcBuffer, rcInsufficient);
-                                    }
-                                    else if ((row_bits >> 3) !=  nreads) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcData, rcIncorrect);
-                                    }
-                                    DISP_RC_Read(rc, READ_TYPE, spotid,
-                                        "after calling VCursorColumnRead");
-                                }
-                            }
-                            if (rc == 0) {
-                                memmove(dREAD_TYPE,
-                                    ((const char*)base) + (boff >> 3),
-                                    ( size_t ) row_bits >> 3);
-                                if (idxSPOT_GROUP != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxSPOT_GROUP, &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, SPOT_GROUP, spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (rc == 0) {
-                                        if (row_bits > 0) {
-                                            int n = row_bits >> 3;
-                                            if (boff & 7) {
-                                                rc = RC(rcExe, rcColumn,
-                                                    rcReading,
-                                                    rcOffset, rcInvalid);
-                                            }
-                                            else if (row_bits & 7) {
-                                                rc = RC(rcExe, rcColumn,
-                                                    rcReading,
-                                                    rcSize, rcInvalid); }
-                                            else if ( n  > MAX_SPOT_GROUP ) {
-                                                char * tmp = NULL;
-                                                MAX_SPOT_GROUP = n + 1000;
-                                                tmp = realloc ( dSPOT_GROUP,
-                                                    MAX_SPOT_GROUP );
-                                                if ( tmp == NULL ) {
-                                                    rc = RC ( rcExe, rcStorage,
-                                                     rcAllocating, rcMemory, rcExhausted );
-                                                    DBGMSG ( DBG_APP, DBG_COND_1,
-                                                        ( "Failed to reallocate "
-                                                        "buffer for SPOT_GROUP[%zu]\n",
-                                                        MAX_SPOT_GROUP ) );
-                                                }
-                                                else {
-                                                    DBGMSG ( DBG_APP, DBG_COND_1,
-                                                        ( "Reallocated "
-                                                        "buffer for SPOT_GROUP[%zu]\n",
-                                                        MAX_SPOT_GROUP ) );
-                                                    dSPOT_GROUP = tmp;
-                                                }
-                                            }
-                                            DISP_RC_Read(rc, SPOT_GROUP, spotid,
-                                               "after calling VCursorColumnRead"
-                                               );
-                                            if (rc == 0) {
-                                                bitsz_t n = row_bits >> 3;
-                                                memmove(dSPOT_GROUP,
-                                                  ((const char*)base)+(boff>>3),
-                                                  ( size_t ) row_bits>>3);
-                                                dSPOT_GROUP[n]='\0';
-                                                if (n > 1 ||
-                                                    (n == 1 && dSPOT_GROUP[0]))
-                                                {
-                                                    pb -> hasSPOT_GROUP = 1;
-                                                }
-                                            }
-                                        }
-                                        else {
-                                            dSPOT_GROUP[0]='\0';
-                                        }
-                                    }
-                                    else {
-                                        break;
-                                    }
-                                }
-                            }
-                            if (rc == 0) {
-                                uint64_t cmp_len = 0; /* CMP_READ */
-                                if (idxRD_FILTER != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxRD_FILTER, &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, RD_FILTER, spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (rc == 0) {
-                                        bitsz_t size = row_bits >> 3;
-                                        if (boff & 7) {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcOffset, rcInvalid); }
-                                        else if (row_bits & 7) {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcSize, rcInvalid);
-                                        }
-                                        else if (size >
-                                            MAX_NREADS * sizeof * dRD_FILTER)
-                                        {
-                                            rc = RC(rcExe, rcColumn, rcReading,
-                                                rcBuffer, rcInsufficient);
-                                        }
-                                        DISP_RC_Read(rc, RD_FILTER, spotid,
-                                            "after calling VCursorColumnRead");
-                                        if (rc == 0) {
-                                            memmove(dRD_FILTER,
-                                                ((const char*)base) + (boff>>3),
-                                                ( size_t ) size);
-                                            if (size < nreads) {
-                             /* RD_FILTER is expected to have nreads elements */
-                                                if (size == 1) {
-                             /* fill all RD_FILTER elements with RD_FILTER[0] */
-                                                    int i = 0;
-                                                    for (i = 1; i < nreads;
-                                                        ++i)
-                                                    {
-                                                        memmove(dRD_FILTER + i,
-                                                  ((const char*)base)+(boff>>3),
-                                                  1);
-                                                    }
-                                                    if
-                                                     (!bad_read_filter)
-                                                    {
-                                                        bad_read_filter = true;
-                                                        PLOGMSG(klogWarn,
-                                                            (klogWarn,
-             "RD_FILTER column size is 1 but it is expected to be $(n)",
-                                                            "n=%d", nreads));
-                                                    }
-                                                }
-                                                else {
-                                  /* something really bad with RD_FILTER column:
-                                     let's pretend it does not exist */
-                                                    idxRD_FILTER = 0;
-                                                    bad_read_filter = true;
-                                                    PLOGMSG(klogWarn,
-                                                        (klogWarn,
-             "RD_FILTER column size is $(real) but it is expected to be $(exp)",
-                                                        "real=%d,exp=%d",
-                                                        size, nreads));
-                                                }
-                                            }
-                                        }
-                                    }
-                                    else {
-                                        break;
-                                    }
-                                }
-                                if (idxPRIMARY_ALIGNMENT_ID != 0) {
-                                    rc = VCursorColumnRead(curs, spotid,
-                                        idxPRIMARY_ALIGNMENT_ID,
-                                        &base, &boff, &row_bits);
-                                    DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID,
-                                        spotid,
-                                        "while calling VCursorColumnRead");
-                                    if (boff & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcOffset, rcInvalid); }
-                                    else if (row_bits & 7) {
-                                        rc = RC(rcExe, rcColumn, rcReading,
-                                            rcSize, rcInvalid);
-                                    }
-                                    DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID,
-                                       spotid,
-                                       "after calling calling VCursorColumnRead"
-                                       );
-                                    if (rc == 0) {
-                                        int i = 0;
-                                        const int64_t* pii = base;
-                                        assert(nreads);
-                                        for (i = 0; i < nreads; ++i) {
-                                            if (pii[i] == 0) {
-                                                cmp_len += dREAD_LEN[i];
-                                            }
-                                        }
-                                    }
-                                }
-
-                                ss = (SraStats*)BSTreeFind
-                                    (tr, dSPOT_GROUP, srastats_cmp);
-                                if (ss == NULL) {
-                                    ss = calloc(1, sizeof(*ss));
-                                    if (ss == NULL) {
-                                        rc = RC(rcExe, rcStorage, rcAllocating,
-                                            rcMemory, rcExhausted);
-                                        break;
-                                    }
-                                    else {
-                                        strcpy(ss->spot_group, dSPOT_GROUP);
-                                        BSTreeInsert
-                                            (tr, (BSTNode*)ss, srastats_sort);
-                                    }
-                                }
-                                ++ss->spot_count;
-                                ++total->spot_count;
-
-                                ss->total_cmp_len += cmp_len;
-                                total->total_cmp_len += cmp_len;
-
-                                if (pb->statistics) {
-                                    SraStatsTotalAdd(total, dREAD_LEN, nreads);
-                                }
-                                for (bio_len = bio_count = i = bad_cnt
-                                        = filt_cnt = 0;
-                                    (i < nreads) && (rc == 0); i++)
-                                {
-                                    if ( i >= MAX_NREADS ) {
-                                        rc = RC ( rcExe, rcData, rcProcessing,
-                                                  rcBuffer, rcInsufficient );
-                                        break;
-                                    }
-                                    if (dREAD_LEN[i] > 0) {
-                                        g_totalREAD_LEN[i] += dREAD_LEN[i];
-                                        ++g_nonZeroLenReads[i];
-                                    }
-                                    if (spotid == start) {
-                                        g_dREAD_LEN[i] = dREAD_LEN[i];
-                                    }
-                                    else if (g_dREAD_LEN[i] != dREAD_LEN[i]) {
-                                        fixedReadLength = false;
-                                    }
-
-                                    if (dREAD_LEN[i] > 0) {
-                                        bool biological = false;
-                                        ss->total_len += dREAD_LEN[i];
-                                        total->BASE_COUNT += dREAD_LEN[i];
-                                        if ((dREAD_TYPE[i]
-                                            & SRA_READ_TYPE_BIOLOGICAL) != 0)
-                                        {
-                                            biological = true;
-                                            bio_len += dREAD_LEN[i];
-                                            bio_count++;
-                                        }
-                                        if (idxRD_FILTER != 0) {
-                                            switch (dRD_FILTER[i]) {
-                                                case SRA_READ_FILTER_PASS:
-                                                    break;
-                                                case SRA_READ_FILTER_REJECT:
-                                                case SRA_READ_FILTER_CRITERIA:
-                                                    if (biological) {
-                                                        ss->bad_bio_len
-                                                            += dREAD_LEN[i];
-                                                        total->bad_bio_len
-                                                            += dREAD_LEN[i];
-                                                    }
-                                                    bad_cnt++;
-                                                    break;
-                                                case SRA_READ_FILTER_REDACTED:
-                                                    if (biological) {
-                                                        ss->filtered_bio_len
-                                                            += dREAD_LEN[i];
-                                                        total->filtered_bio_len
-                                                            += dREAD_LEN[i];
-                                                    }
-                                                    filt_cnt++;
-                                                    break;
-                                                default:
-                                                    rc = RC(rcExe, rcColumn,
-                                                        rcReading,
-                                                        rcData, rcUnexpected);
-                                                    PLOGERR(klogInt,
-                                                        (klogInt, rc,
-    "spot=$(spot), read=$(read), READ_FILTER=$(val)", "spot=%lu,read=%d,val=%d",
-                                                        spotid, i,
-                                                        dRD_FILTER[i]));
-                                                    break;
-                                            }
-                                        }
-                                    }
-                                }
-                                ss->bio_len += bio_len;
-                                total->BIO_BASE_COUNT += bio_len;
-                                if (bio_count > 1) {
-                                    ++ss->spot_count_mates;
-                                    ++total->spot_count_mates;
-                                    ss->bio_len_mates += bio_len;
-                                    total->bio_len_mates += bio_len;
-                                }
-                                if (bad_cnt) {
-                                    ss->bad_spot_count++;
-                                    total->bad_spot_count++;
-                                }
-                                if (filt_cnt) {
-                                    ss->filtered_spot_count++;
-                                    total->filtered_spot_count++;
-                                }
-                            }
+/* Reads a column of one byte or four bytes elements
+   into the beginning of dst [ max_nreads ] */
+static rc_t SpotScanReadColumn(SpotScan * self, int64_t spotid, uint32_t idx,
+    const char * name, void * dst, size_t elem_size, size_t * nelem)
+{
+    const void* base = NULL;
+    bitsz_t boff = 0, row_bits = 0;
 
-                            if (rc == 0 && pb->progress) {
-                                KLoadProgressbar_Process(pr, 1, false);
-                            }
-                        }
-                    } /* for (spotid = start; spotid <= stop && rc == 0;
-                              ++spotid) */
+    rc_t rc = VCursorColumnRead(self->curs, spotid,
+        idx, &base, &boff, &row_bits);
+    DISP_RC_Read(rc, name, spotid, "while calling VCursorColumnRead");
+    if (rc == 0) {
+        if (boff & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+        }
+        else if (row_bits & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+        }
+        else if ( ( row_bits >> 3 ) > self -> max_nreads * elem_size ) {
+            rc = RC(rcExe, rcColumn, rcReading, rcBuffer, rcInsufficient);
+        }
+        DISP_RC_Read(rc, name, spotid, "after calling VCursorColumnRead");
+    }
+    if (rc == 0) {
+        memmove(dst, ((const char*)base) + (boff >> 3),
+                ( size_t ) row_bits >> 3);
+        *nelem = ( size_t ) ( row_bits >> 3 ) / elem_size;
+    }
+    return rc;
+}
 
-                    for (spotid = total->bases_count.startALIGNMENT;
-                         !pb->quick &&
-                           spotid < total->bases_count.stopALIGNMENT && rc == 0;
-                         ++spotid)
-                    {
-                        rc = BasesAdd(&total->bases_count, spotid, true,
-                            dREAD_LEN, dREAD_TYPE);
-                        if ( rc == 0 && pb->progress )
-                            KLoadProgressbar_Process ( pr, 1, false );
-                        rc = Quitting();
-                        if (rc != 0)
-                            LOGMSG(klogWarn, "Interrupted");
-                    }
+static rc_t SpotScanSpot(SpotScan * self, int64_t spotid) {
+    rc_t rc = 0;
 
-                    for (spotid = total->bases_count.startSEQUENCE;
-                         !pb->quick &&
-                           spotid < total->bases_count.stopSEQUENCE && rc == 0;
-                         ++spotid)
-                    {
-                        rc = BasesAdd(&total->bases_count, spotid, false,
-                            dREAD_LEN, dREAD_TYPE);
-                        if ( rc == 0 && pb->progress )
-                            KLoadProgressbar_Process ( pr, 1, false );
-                        rc = Quitting();
-                        if (rc != 0)
-                            LOGMSG(klogWarn, "Interrupted");
-                    }
+    const char PRIMARY_ALIGNMENT_ID[] = "PRIMARY_ALIGNMENT_ID";
+    const char RD_FILTER [] = "RD_FILTER";
+    const char READ_LEN  [] = "READ_LEN";
+    const char READ_TYPE [] = "READ_TYPE";
+    const char SPOT_GROUP[] = "SPOT_GROUP";
 
-                    if (rc == 0) {
-                        BasesFinalize(&total->bases_count);
-                        pb->variableReadLength = !fixedReadLength;
-
-              /* --- g_totalREAD_LEN[i] is sum(READ_LEN[i]) for all spots --- */
-                        if (fixedNReads) {
-                            int i = 0;
-                            if (stop >= start) {
-                                n_spots = stop - start;
-                            }
-                            if (n_spots > 0) {
-                                for (i = 0; i < g_nreads && rc == 0; ++i) {
-                                    if (fixedReadLength) {
-                                        assert(g_totalREAD_LEN[i] / n_spots
-                                            == g_dREAD_LEN[i]);
-                                    }
-                                }
-                            }
-                        }
+    const void* base = NULL;
+    bitsz_t boff = 0, row_bits = 0;
+    size_t n = 0;
+    int nreads = 0;
+
+    uint64_t cmp_len = 0; /* CMP_READ */
+    SraStats* ss = NULL;
+    SraStatsTotal* total = &self->total;
+    const SpotScanJobs * jobs = self->jobs;
+    int i, bio_len, bio_count, bad_cnt, filt_cnt;
+
+    rc = VCursorColumnRead(self->curs, spotid,
+        self->idxREAD_LEN, &base, &boff, &row_bits);
+    DISP_RC_Read(rc, READ_LEN, spotid, "while calling VCursorColumnRead");
+    if (rc == 0) {
+        if (boff & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+        }
+        else if (row_bits & 7) {
+            rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+        }
+        else if ( ( row_bits >> 3 )
+             > self -> max_nreads * sizeof * self -> dREAD_LEN )
+        {
+            rc = SpotScanGrow ( self,
+                ( row_bits >> 3 ) / sizeof * self -> dREAD_LEN + 1000 );
+        }
+        DISP_RC_Read(rc, READ_LEN, spotid, "after calling VCursorColumnRead");
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    memmove(self->dREAD_LEN, ((const char*)base) + (boff>>3),
+            ( size_t ) row_bits >> 3);
+    nreads = (int) ((row_bits >> 3) / sizeof(*self->dREAD_LEN));
+    if (jobs->g_nreads != nreads) {
+        self->fixedNReads = false;
+    }
+
+    rc = SpotScanReadColumn(self, spotid, self->idxREAD_TYPE, READ_TYPE,
+        self->dREAD_TYPE, sizeof * self->dREAD_TYPE, &n);
+    if (rc == 0 && n != nreads) {
+        rc = RC(rcExe, rcColumn, rcReading, rcData, rcIncorrect);
+        DISP_RC_Read(rc, READ_TYPE, spotid, "after calling VCursorColumnRead");
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (self->idxSPOT_GROUP != 0) {
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxSPOT_GROUP, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, SPOT_GROUP, spotid,
+            "while calling VCursorColumnRead");
+        if (rc == 0) {
+            if (row_bits > 0) {
+                n = row_bits >> 3;
+                if (boff & 7) {
+                    rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+                }
+                else if (row_bits & 7) {
+                    rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+                }
+                else if ( n + 1 > self -> max_spot_group ) {
+                    char * tmp = realloc ( self -> dSPOT_GROUP, n + 1000 );
+                    if ( tmp == NULL ) {
+                        rc = RC ( rcExe, rcStorage,
+                                  rcAllocating, rcMemory, rcExhausted );
+                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Failed to reallocate "
+                            "buffer for SPOT_GROUP[%zu]\n", n + 1000 ) );
                     }
-                    if (rc == 0) {
-                        KLoadProgressbar_Release(pr, true);
-                        pr = NULL;
+                    else {
+                        self -> max_spot_group = n + 1000;
+                        DBGMSG ( DBG_APP, DBG_COND_1, ( "Reallocated "
+                            "buffer for SPOT_GROUP[%zu]\n",
+                            self -> max_spot_group ) );
+                        self -> dSPOT_GROUP = tmp;
                     }
+                }
+                DISP_RC_Read(rc, SPOT_GROUP, spotid,
+                   "after calling VCursorColumnRead");
+                if (rc == 0) {
+                    memmove(self->dSPOT_GROUP,
+                        ((const char*)base) + (boff>>3), n);
+                    self->dSPOT_GROUP[n]='\0';
+                    if (n > 1 || (n == 1 && self->dSPOT_GROUP[0])) {
+                        self->hasSPOT_GROUP = true;
+                    }
+                }
+            }
+            else {
+                self->dSPOT_GROUP[0]='\0';
+            }
+        }
+        if (rc != 0) {
+            return rc;
+        }
+    }
+
+    if (self->idxRD_FILTER != 0) {
+        rc = SpotScanReadColumn(self, spotid, self->idxRD_FILTER, RD_FILTER,
+            self->dRD_FILTER, sizeof * self->dRD_FILTER, &n);
+        if (rc != 0) {
+            return rc;
+        }
+        if (n < nreads) {
+            /* RD_FILTER is expected to have nreads elements */
+            if (n == 1) {
+                /* fill all RD_FILTER elements with RD_FILTER[0] */
+                memset(self->dRD_FILTER + 1, self->dRD_FILTER[0], nreads - 1);
+                if (!self->bad_read_filter) {
+                    self->bad_read_filter = true;
+                    PLOGMSG(klogWarn, (klogWarn,
+                        "RD_FILTER column size is 1 but it is expected to be $(n)",
+                        "n=%d", nreads));
+                }
+            }
+            else {
+                /* something really bad with RD_FILTER column:
+                   let's pretend it does not exist */
+                self->idxRD_FILTER = 0;
+                self->bad_read_filter = true;
+                PLOGMSG(klogWarn, (klogWarn,
+                    "RD_FILTER column size is $(real) but it is expected to be $(exp)",
+                    "real=%d,exp=%d", n, nreads));
+            }
+        }
+    }
+
+    if (self->idxPRIMARY_ALIGNMENT_ID != 0) {
+        rc = VCursorColumnRead(self->curs, spotid,
+            self->idxPRIMARY_ALIGNMENT_ID, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID, spotid,
+            "while calling VCursorColumnRead");
+        if (rc == 0) {
+            if (boff & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+            }
+            else if (row_bits & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+            }
+            DISP_RC_Read(rc, PRIMARY_ALIGNMENT_ID, spotid,
+               "after calling calling VCursorColumnRead");
+        }
+        if (rc != 0) {
+            return rc;
+        }
+        else {
+            const int64_t* pii = base;
+            assert(nreads);
+            for (i = 0; i < nreads; ++i) {
+                if (pii[i] == 0) {
+                    cmp_len += self->dREAD_LEN[i];
+                }
+            }
+        }
+    }
+
+    ss = (SraStats*)BSTreeFind(&self->tr, self->dSPOT_GROUP, srastats_cmp);
+    if (ss == NULL) {
+        ss = calloc(1, sizeof(*ss));
+        if (ss == NULL) {
+            return RC(rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted);
+        }
+        strcpy(ss->spot_group, self->dSPOT_GROUP);
+        BSTreeInsert(&self->tr, (BSTNode*)ss, srastats_sort);
+    }
+    ++ss->spot_count;
+    ++total->spot_count;
+
+    ss->total_cmp_len += cmp_len;
+    total->total_cmp_len += cmp_len;
+
+    if (self->pb->statistics) {
+        SraStatsTotalAdd(total, self->dREAD_LEN, nreads);
+    }
+    for (bio_len = bio_count = i = bad_cnt = filt_cnt = 0;
+        (i < nreads) && (rc == 0); i++)
+    {
+        uint32_t len = self->dREAD_LEN[i];
+        uint32_t g_len = i < jobs->g_nreads ? jobs->g_dREAD_LEN[i] : 0;
+
+        if (len > 0) {
+            self->g_totalREAD_LEN[i] += len;
+            ++self->g_nonZeroLenReads[i];
+        }
+        if (g_len != len) {
+            self->fixedReadLength = false;
+        }
+
+        if (len > 0) {
+            bool biological = false;
+            ss->total_len += len;
+            total->BASE_COUNT += len;
+            if ((self->dREAD_TYPE[i] & SRA_READ_TYPE_BIOLOGICAL) != 0) {
+                biological = true;
+                bio_len += len;
+                bio_count++;
+            }
+            if (self->idxRD_FILTER != 0) {
+                switch (self->dRD_FILTER[i]) {
+                    case SRA_READ_FILTER_PASS:
+                        break;
+                    case SRA_READ_FILTER_REJECT:
+                    case SRA_READ_FILTER_CRITERIA:
+                        if (biological) {
+                            ss->bad_bio_len += len;
+                            total->bad_bio_len += len;
+                        }
+                        bad_cnt++;
+                        break;
+                    case SRA_READ_FILTER_REDACTED:
+                        if (biological) {
+                            ss->filtered_bio_len += len;
+                            total->filtered_bio_len += len;
+                        }
+                        filt_cnt++;
+                        break;
+                    default:
+                        rc = RC(rcExe, rcColumn, rcReading,
+                            rcData, rcUnexpected);
+                        PLOGERR(klogInt, (klogInt, rc,
+    "spot=$(spot), read=$(read), READ_FILTER=$(val)", "spot=%lu,read=%d,val=%d",
+                            spotid, i, self->dRD_FILTER[i]));
+                        break;
+                }
+            }
+        }
+    }
+    ss->bio_len += bio_len;
+    total->BIO_BASE_COUNT += bio_len;
+    if (bio_count > 1) {
+        ++ss->spot_count_mates;
+        ++total->spot_count_mates;
+        ss->bio_len_mates += bio_len;
+        total->bio_len_mates += bio_len;
+    }
+    if (bad_cnt) {
+        ss->bad_spot_count++;
+        total->bad_spot_count++;
+    }
+    if (filt_cnt) {
+        ss->filtered_spot_count++;
+        total->filtered_spot_count++;
+    }
+
+    return rc;
+}
+
+static void SpotScanProgress(SpotScan * self, bool force) {
+    assert(self);
+
+    if (self->jobs->pr == NULL || self->progress == 0) {
+        return;
+    }
+    if (force || self->progress >= 1024) {
+        KLockAcquire(self->jobs->lock);
+        KLoadProgressbar_Process(self->jobs->pr, self->progress, false);
+        KLockUnlock(self->jobs->lock);
+        self->progress = 0;
+    }
+}
+
+/* Takes the next range of rows; false when nothing is left */
+static bool SpotScanNextJob(SpotScan * self,
+    ESpotScanJob * job, int64_t * from, int64_t * to)
+{
+    bool found = false;
+    SpotScanJobs * jobs = self->jobs;
+    int j = 0;
+
+    KLockAcquire(jobs->lock);
+    for (j = 0; !jobs->abort && j < esjCOUNT && !found; ++j) {
+        if (jobs->next[j] < jobs->stop[j]) {
+            *job  = j;
+            *from = jobs->next[j];
+            *to   = jobs->stop[j] - *from > SCAN_JOB_ROWS
+                  ? *from + SCAN_JOB_ROWS : jobs->stop[j];
+            jobs->next[j] = *to;
+            found = true;
+        }
+    }
+    KLockUnlock(jobs->lock);
+
+    return found;
+}
+
+static rc_t SpotScanRun(SpotScan * self) {
+    rc_t rc = 0;
+    ESpotScanJob job = esjSPOTS;
+    int64_t from = 0, to = 0;
+
+    assert(self);
+
+    while (rc == 0 && SpotScanNextJob(self, &job, &from, &to)) {
+        int64_t spotid;
+        for (spotid = from; spotid < to && rc == 0; ++spotid) {
+            rc = Quitting();
+            if (rc != 0) {
+                LOGMSG(klogWarn, "Interrupted");
+            }
+            else if (job == esjSPOTS) {
+                rc = SpotScanSpot(self, spotid);
+            }
+            else {
+                rc = BasesAdd(&self->total.bases_count, spotid,
+                    job == esjALIGNMENT_BASES, self->dREAD_LEN,
+                    self->dREAD_TYPE, self->max_nreads);
+            }
+            if (rc == 0) {
+                ++self->progress;
+                SpotScanProgress(self, false);
+            }
+        }
+    }
+    SpotScanProgress(self, true);
+
+    if (rc != 0) {
+        KLockAcquire(self->jobs->lock);
+        self->jobs->abort = true;
+        KLockUnlock(self->jobs->lock);
+    }
+
+    self->rc = rc;
+    return rc;
+}
+
+static rc_t CC SpotScanThread(const KThread * thread, void * data) {
+    return SpotScanRun(data);
+}
+
+/* Adds the results of a scan to the totals; the SraStats nodes are moved */
+static void SpotScanMerge(SpotScan * self, BSTree * tr, SraStatsTotal * total,
+    uint64_t * g_totalREAD_LEN, uint64_t * g_nonZeroLenReads)
+{
+    BSTNode * n = NULL;
+    size_t i = 0;
+
+    assert(self && tr && total);
+
+    while ((n = BSTreeFirst(&self->tr)) != NULL) {
+        SraStats * from = (SraStats*)n;
+        SraStats * to = NULL;
+        BSTreeUnlink(&self->tr, n);
+        to = (SraStats*)BSTreeFind(tr, from->spot_group, srastats_cmp);
+        if (to == NULL) {
+            BSTreeInsert(tr, n, srastats_sort);
+        }
+        else {
+            SraStatsAdd(to, from);
+            bst_whack_free(n, NULL);
+        }
+    }
+
+    SraStatsTotalMerge(total, &self->total);
+
+    for (i = 0; i < self->max_nreads; ++i) {
+        g_totalREAD_LEN[i] += self->g_totalREAD_LEN[i];
+        g_nonZeroLenReads[i] += self->g_nonZeroLenReads[i];
+    }
+}
+
+static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
+    SraStatsTotal* total, const Ctx * ctx, const VTable *vtbl)
+{
+    rc_t rc = 0;
+
+    const char READ_LEN  [] = "READ_LEN";
+
+    int g_nreads = 0;
+    int64_t  n_spots = 0;
+    int64_t start = 0;
+    int64_t stop  = 0;
+
+    uint32_t nscans = pb->threads > 1 ? pb->threads : 1;
+    uint32_t s = 0;
+    SpotScan * scans = NULL;
+    SpotScanJobs jobs;
+
+    size_t max_nreads = MAX_NREADS;
+    uint64_t * g_totalREAD_LEN = NULL;
+    uint64_t * g_nonZeroLenReads = NULL;
+    uint32_t * g_dREAD_LEN = NULL;
+
+    bool fixedNReads = true;
+    bool fixedReadLength = true;
+
+    assert(pb && vtbl && tr && total);
+
+    memset(&jobs, 0, sizeof jobs);
+    pb->hasSPOT_GROUP = 0;
+
+    scans = calloc ( nscans, sizeof * scans );
+    if ( scans == NULL )
+        rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+    if (rc == 0) {
+        rc = KLockMake(&jobs.lock);
+        DISP_RC(rc, "Cannot KLockMake");
+    }
+
+    for (s = 0; s < nscans && rc == 0; ++s) {
+        rc = SpotScanInit(&scans[s], &jobs, pb, ctx, vtbl);
+    }
+
+    if (rc == 0) {
+        int64_t first = 0;
+        uint64_t count = 0;
+        rc = VCursorIdRange(scans[0].curs, 0, &first, &count);
+        DISP_RC(rc, "VCursorIdRange() failed");
+        if (rc == 0) {
+            if (pb->start > 0) {
+                start = pb->start;
+                if (start < first) {
+                    start = first;
+                }
+            }
+            else {
+                start = first;
+            }
+
+            if (pb->stop > 0) {
+                stop = pb->stop;
+                if ( ( uint64_t ) stop > first + count) {
+                    stop = first + count;
+                }
+            }
+            else {
+                stop = first + count;
+            }
+        }
+    }
+
+    /* READ_LEN of the first spot: every scan compares its spots with it */
+    if (rc == 0 && start < stop) {
+        const void* base = NULL;
+        bitsz_t boff = 0, row_bits = 0;
+        rc = VCursorColumnRead(scans[0].curs, start,
+            scans[0].idxREAD_LEN, &base, &boff, &row_bits);
+        DISP_RC_Read(rc, READ_LEN, start, "while calling VCursorColumnRead");
+        if (rc == 0) {
+            if (boff & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcOffset, rcInvalid);
+            }
+            else if (row_bits & 7) {
+                rc = RC(rcExe, rcColumn, rcReading, rcSize, rcInvalid);
+            }
+            DISP_RC_Read(rc, READ_LEN, start,
+                "after calling VCursorColumnRead");
+        }
+        if (rc == 0) {
+            g_nreads = (int) ((row_bits >> 3) / sizeof * g_dREAD_LEN);
+            g_dREAD_LEN = calloc ( g_nreads + 1, sizeof * g_dREAD_LEN );
+            if ( g_dREAD_LEN == NULL )
+                rc = RC ( rcExe, rcStorage,
+                          rcAllocating, rcMemory, rcExhausted );
+            else
+                memmove ( g_dREAD_LEN, ((const char*)base) + (boff>>3),
+                          ( size_t ) row_bits >> 3 );
+        }
+        for (s = 0; s < nscans && rc == 0 && pb->statistics; ++s) {
+            rc = SraStatsTotalMakeStatistics(&scans[s].total, g_nreads);
+        }
+        if (rc == 0 && pb->statistics) {
+            rc = SraStatsTotalMakeStatistics(total, g_nreads);
+        }
+    }
+
+    if (rc == 0) {
+        const Bases * bases = &scans[0].total.bases_count;
+
+        jobs.g_nreads = g_nreads;
+        jobs.g_dREAD_LEN = g_dREAD_LEN;
+
+        jobs.next[esjSPOTS] = start;
+        jobs.stop[esjSPOTS] = stop;
+        if (!pb->quick) {
+            jobs.next[esjALIGNMENT_BASES] = bases->startALIGNMENT;
+            jobs.stop[esjALIGNMENT_BASES] = bases->stopALIGNMENT;
+            jobs.next[esjSEQUENCE_BASES] = bases->startSEQUENCE;
+            jobs.stop[esjSEQUENCE_BASES] = bases->stopSEQUENCE;
+        }
+
+        if (pb->progress && start < stop) {
+            uint64_t b = bases->stopSEQUENCE + 1 - bases->startSEQUENCE;
+            if ( bases->stopALIGNMENT > 0 )
+                b += bases->stopALIGNMENT + 1 - bases->startALIGNMENT;
+            rc = KLoadProgressbar_Make(&jobs.pr, stop + 1 - start + b);
+            if (rc != 0) {
+                DISP_RC(rc, "cannot initialize progress bar");
+                rc = 0;
+                jobs.pr = NULL;
+            }
+            else if (stop - start > 99) {
+                KLoadProgressbar_Process(jobs.pr, 0, true);
+            }
+        }
+    }
+
+    if (rc == 0) {
+        /* the calling thread runs the first scan */
+        for (s = 1; s < nscans; ++s) {
+            rc_t r2 = KThreadMake(&scans[s].thread, SpotScanThread, &scans[s]);
+            if (r2 != 0) {
+                DISP_RC(r2, "Cannot KThreadMake: scanning with less threads");
+                scans[s].thread = NULL;
+            }
+        }
+        SpotScanRun(&scans[0]);
+        for (s = 1; s < nscans; ++s) {
+            if (scans[s].thread != NULL) {
+                rc_t r2 = 0;
+                KThreadWait(scans[s].thread, &r2);
+                KThreadRelease(scans[s].thread);
+                scans[s].thread = NULL;
+            }
+        }
+        for (s = 0; s < nscans && rc == 0; ++s) {
+            rc = scans[s].rc;
+        }
+    }
 
-                    free ( dREAD_LEN );
-                    free ( dREAD_TYPE );
-                    free ( dRD_FILTER );
-                    free ( dSPOT_GROUP );
+    if (rc == 0) {
+        for (s = 0; s < nscans; ++s) {
+            if (scans[s].max_nreads > max_nreads) {
+                max_nreads = scans[s].max_nreads;
+            }
+        }
+        g_totalREAD_LEN = calloc ( max_nreads, sizeof * g_totalREAD_LEN );
+        g_nonZeroLenReads = calloc ( max_nreads, sizeof * g_nonZeroLenReads );
+        if ( g_totalREAD_LEN == NULL || g_nonZeroLenReads == NULL )
+            rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
+    }
+
+    if (rc == 0) {
+        for (s = 0; s < nscans; ++s) {
+            SpotScan * scan = &scans[s];
+            SpotScanMerge(scan, tr, total,
+                g_totalREAD_LEN, g_nonZeroLenReads);
+            if (scan->hasSPOT_GROUP) {
+                pb->hasSPOT_GROUP = 1;
+            }
+            if (!scan->fixedNReads) {
+                fixedNReads = false;
+            }
+            if (!scan->fixedReadLength) {
+                fixedReadLength = false;
+            }
+        }
+
+        BasesFinalize(&scans[0].total.bases_count);
+        total->bases_count.basesType = scans[0].total.bases_count.basesType;
+        total->bases_count.finalized = scans[0].total.bases_count.finalized;
+        pb->variableReadLength = !fixedReadLength;
+
+  /* --- g_totalREAD_LEN[i] is sum(READ_LEN[i]) for all spots --- */
+        if (fixedNReads) {
+            int i = 0;
+            if (stop >= start) {
+                n_spots = stop - start;
+            }
+            if (n_spots > 0) {
+                for (i = 0; i < g_nreads && rc == 0; ++i) {
+                    if (fixedReadLength) {
+                        assert(g_totalREAD_LEN[i] / n_spots
+                            == g_dREAD_LEN[i]);
+                    }
                 }
             }
         }
     }
+    if (rc == 0) {
+        KLoadProgressbar_Release(jobs.pr, true);
+        jobs.pr = NULL;
+    }
 
-    RELEASE(VCursor, curs);
+    for (s = 0; s < nscans && scans != NULL; ++s) {
+        rc_t r2 = SpotScanRelease(&scans[s]);
+        if (rc == 0) {
+            rc = r2;
+        }
+    }
+    free(scans);
+    RELEASE(KLock, jobs.lock);
 
     if (pb->test && rc == 0) {
+        const VCursor *curs = NULL;
         uint32_t idx = 0;
         int i = 0;
         int64_t spotid = 0;
 
-        double   * average   = calloc ( MAX_NREADS, sizeof * average   );
-        double   * diff_sq   = calloc ( MAX_NREADS, sizeof * diff_sq   );
-        uint32_t * dREAD_LEN = calloc ( MAX_NREADS, sizeof * dREAD_LEN );
+        double   * average   = calloc ( max_nreads, sizeof * average   );
+        double   * diff_sq   = calloc ( max_nreads, sizeof * diff_sq   );
+        uint32_t * dREAD_LEN = calloc ( max_nreads, sizeof * dREAD_LEN );
         if ( average == NULL || diff_sq == NULL || dREAD_LEN == NULL )
             rc = RC ( rcExe, rcStorage, rcAllocating, rcMemory, rcExhausted );
         SraStatsTotalStatistics2Init(total,
@@ -3780,7 +4194,7 @@ static rc_t sra_stat(srastat_parms* pb, BSTree* tr,
                     idx, &base, &boff, &row_bits);
                 DISP_RC_Read(rc, READ_LEN, spotid,
                     "while calling VCursorColumnRead");
-                if ( ( row_bits >> 3 ) > sizeof dREAD_LEN )
+                if ( ( row_bits >> 3 ) > max_nreads * sizeof * dREAD_LEN )
                     rc = RC ( rcExe, rcColumn, rcReading,
                               rcBuffer, rcInsufficient);
             }
@@ -4001,6 +4415,9 @@ rc_t run(srastat_parms* pb)
 #define ALIAS_TEST     "t"
 #define OPTION_TEST    "test"
 
+#define ALIAS_THREADS  NULL
+#define OPTION_THREADS "threads"
+
 #define ALIAS_XML      "x"
 #define OPTION_XML     "xml"
 
@@ -4023,6 +4440,8 @@ static const char * quick_usage[] = {
    "quick mode: get statistics from metadata;", "do not scan the table", NULL };
 static const char * test_usage[] = {
    "test READ_LEN average and standard deviation calculation", NULL };
+static const char * threads_usage[] = {
+   "scan the table with this number of threads, default is 1", NULL };
 static const char * xml_usage[] = { "output as XML, default is text", NULL };
 static const char * arcinfo_usage[] = { "output archive info, default is off"
                                                                     , NULL };
@@ -4040,6 +4459,7 @@ OptDef Options[] = {
     , { OPTION_STATS   , ALIAS_STATS   , NULL, stats_usage   , 1, false, false }
     , { OPTION_STOP    , ALIAS_STOP    , NULL, stop_usage    , 1, true,  false }
     , { OPTION_TEST    , ALIAS_TEST    , NULL, test_usage    , 1, false, false }
+    , { OPTION_THREADS , ALIAS_THREADS , NULL, threads_usage , 1, true,  false }
     , { OPTION_XML     , ALIAS_XML     , NULL, xml_usage     , 1, false, false }
     , { OPTION_NGC     , ALIAS_NGC     , NULL, ngc_usage     , 1, true, false }
 };
@@ -4084,6 +4504,7 @@ rc_t CC Usage (const Args * args)
     HelpOptionLine(ALIAS_STATS   , OPTION_STATS   , NULL      , stats_usage);
     HelpOptionLine(ALIAS_ALIGN   , OPTION_ALIGN   , "on | off", align_usage);
     HelpOptionLine(ALIAS_PROGRESS, OPTION_PROGRESS, NULL      , progress_usage);
+    HelpOptionLine(ALIAS_THREADS , OPTION_THREADS , "count"   , threads_usage);
     HelpOptionLine(ALIAS_NGC     , OPTION_NGC     , "path"    , ngc_usage);
     XMLLogger_Usage();
 
@@ -4278,6 +4699,23 @@ rc_t CC KMain ( int argc, char *argv [] )
                 }
 
 
+                rc = ArgsOptionCount (args, OPTION_THREADS, &pcount);
+                if (rc != 0) {
+                    break;
+                }
+
+                if (pcount > 0) {
+                    rc = ArgsOptionValue (args, OPTION_THREADS, 0, (const void **)&v);
+                    if (rc != 0) {
+                        break;
+                    }
+                    pb.threads = AsciiToU32 (v, NULL, NULL);
+                    if (pb.threads > 64) {
+                        pb.threads = 64;
+                    }
+                }
+
+
                 rc = ArgsOptionCount(args, OPTION_NGC, &pcount);
                 if (rc != 0)
                     break;
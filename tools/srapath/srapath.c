@@ -38,6 +38,8 @@
 #include <kfs/directory.h>
 #include <kapp/main.h>
 #include <kapp/args.h>
+#include <kproc/lock.h>
+#include <kproc/thread.h>
 
 #include <klib/log.h>
 #include <klib/out.h>
@@ -51,6 +53,7 @@
 
 
 #include <limits.h> /* PATH_MAX */
+#include <stdarg.h> /* va_list */
 
 #ifndef PATH_MAX
 #define PATH_MAX 4096
@@ -120,6 +123,15 @@ static const char * url_usage[] = { "url to be used for cgi-calls", NULL };
 #define OPTION_URL    "url"
 #define ALIAS_URL     "u"
 
+static const char * batch_usage[] = { "resolve accessions with one request "
+    "per COUNT of them: " FUNCTION_RESOLVE " function-only", NULL };
+#define OPTION_BATCH  "batch"
+#define ALIAS_BATCH   "b"
+
+/* accessions not resolved by a batch request are resolved one by one
+   by that many threads */
+#define BATCH_THREADS 8
+
 OptDef ToolOptions[] =
 {                                                    /* needs_value, required */
     { OPTION_FUNC   , ALIAS_FUNC   , NULL, func_usage   ,   1,  true,   false },
@@ -136,6 +148,7 @@ OptDef ToolOptions[] =
     { OPTION_PATH   , ALIAS_PATH   , NULL, path_usage   ,   1,  false,  false },
     { OPTION_CART   , ALIAS_CART   , NULL, cart_usage   ,   1,  true ,  false },
     { OPTION_NGC    , ALIAS_NGC    , NULL, ngc_usage    ,   1,  true ,  false },
+    { OPTION_BATCH  , ALIAS_BATCH  , NULL, batch_usage  ,   1,  true ,  false },
 };
 
 const char UsageDefaultName[] = "srapath";
@@ -196,6 +209,8 @@ rc_t CC Usage( const Args *args )
                 param = "PATH";
             }
         }
+        else if (strcmp(ToolOptions[idx].name, OPTION_BATCH) == 0)
+            param = "COUNT";
 
         HelpOptionLine( ToolOptions[ idx ].aliases, ToolOptions[ idx ].name,
             param, ToolOptions[ idx ].help );
@@ -208,8 +223,54 @@ rc_t CC Usage( const Args *args )
     return rc;
 }
 
-static rc_t KSrvRun_Print(
-    const KSrvRun * self, const char * arg, VQuality preferred)
+/* output of an argument: printed right away when NULL,
+   otherwise kept to be printed in order of arguments */
+typedef struct out_buf {
+    char * s;
+    size_t size;
+    size_t len;
+} out_buf;
+
+static rc_t out_printf ( out_buf * self, const char * fmt, ... ) {
+    rc_t rc = 0;
+    va_list args;
+
+    va_start ( args, fmt );
+    if ( self == NULL )
+        rc = KOutVMsg ( fmt, args );
+    else {
+        while ( true ) {
+            size_t num_writ = 0;
+            va_list cp;
+            va_copy ( cp, args );
+            rc = string_vprintf ( self -> s + self -> len,
+                self -> size - self -> len, & num_writ, fmt, cp );
+            va_end ( cp );
+            if ( rc == 0 ) {
+                self -> len += num_writ;
+                break;
+            }
+            else if ( GetRCState ( rc ) == rcInsufficient ) {
+                size_t size = self -> size == 0 ? 256 : self -> size * 2;
+                char * tmp = realloc ( self -> s, size );
+                if ( tmp == NULL ) {
+                    rc = RC ( rcExe, rcString, rcFormatting, rcMemory, rcExhausted );
+                    break;
+                }
+                self -> s = tmp;
+                self -> size = size;
+            }
+            else
+                break;
+        }
+    }
+    va_end ( args );
+
+    return rc;
+}
+
+static rc_t KSrvRun_Print( const KSrvRun * self, const char * arg,
+    VQuality preferred, out_buf * out )
 {
     const VPath * local = NULL;
     const VPath * remote = NULL;
@@ -241,7 +302,7 @@ static rc_t KSrvRun_Print(
         }
         rc = VPathMakeString(path, &tmp);
         if (rc == 0) {
-            OUTMSG(("%S\n", tmp));
+            out_printf(out, "%S\n", tmp);
             free((void *)tmp);
         }
     }
@@ -251,7 +312,7 @@ static rc_t KSrvRun_Print(
     return rc;
 }
 
-static rc_t KSrvRespFile_Print(const KSrvRespFile * self) {
+static rc_t KSrvRespFile_Print(const KSrvRespFile * self, out_buf * out) {
     const VPath * path = NULL;
     const String * tmp = NULL;
 
@@ -267,7 +328,7 @@ static rc_t KSrvRespFile_Print(const KSrvRespFile * self) {
     if (path != NULL) {
         rc = VPathMakeString(path, &tmp);
         if (rc == 0) {
-            OUTMSG(("%S\n", tmp));
+            out_printf(out, "%S\n", tmp);
             free((void *)tmp);
         }
     }
@@ -276,9 +337,34 @@ static rc_t KSrvRespFile_Print(const KSrvRespFile * self) {
     return rc;
 }
 
+/* quality preference of the service, eQualLast if none */
+static rc_t KService_GetPreferredQuality(KService * service, VQuality * q) {
+    const char * quality = NULL;
+    rc_t rc = KServiceGetQuality(service, &quality);
+    *q = eQualLast;
+    if (rc == 0 && quality != NULL) {
+        const char * msg = NULL;
+        switch (quality[0]) {
+        case 'Z':
+            *q = eQualNo;
+            msg = "Current preference is set to retrieve SRA "
+                "Lite files with simplified base quality scores.";
+            break;
+        case 'R':
+            *q = eQualFull;
+            msg = "Current preference is set to retrieve SRA "
+                "Normalized Format files with full base quality scores.";
+            break;
+        }
+        if (msg != NULL)
+            STSMSG(1, (msg));
+    }
+    return rc;
+}
+
 static rc_t resolve_one_argument( VFSManager * mgr, VResolver * resolver,
     const char * pc, const char * location,
-    const char * cart, const char * ngc )
+    const char * cart, const char * ngc, out_buf * out )
 {
     bool found = true;
     rc_t rc = 0;
@@ -324,29 +410,9 @@ static rc_t resolve_one_argument( VFSManager * mgr, VResolver * resolver,
             rc = KServiceNamesQuery ( service, protocol, & response );
 
             {
-                const char * quality = NULL;
-                rc_t r2 = KServiceGetQuality(service, &quality);
-                if (r2 != 0) {
-                    if (rc == 0)
-                        rc = r2;
-                }
-                else if (quality != NULL) {
-                    const char * msg = NULL;
-                    switch (quality[0]) {
-                    case 'Z':
-                        q = eQualNo;
-                        msg = "Current preference is set to retrieve SRA "
-                            "Lite files with simplified base quality scores.";
-                        break;
-                    case 'R':
-                        q = eQualFull;
-                        msg = "Current preference is set to retrieve SRA "
-                            "Normalized Format files with full base quality scores.";
-                        break;
-                    }
-                    if (msg != NULL)
-                        STSMSG(1, (msg));
-                }
+                rc_t r2 = KService_GetPreferredQuality(service, &q);
+                if (r2 != 0 && rc == 0)
+                    rc = r2;
             }
 
             if ( rc == 0 ) {
@@ -358,7 +424,7 @@ static rc_t resolve_one_argument( VFSManager * mgr, VResolver * resolver,
                 if ( rc == 0 ) {
                     rc = KSrvRunIteratorNextRun ( ri, & run );
                     if ( rc == 0 && run != NULL ) {
-                        rc = KSrvRun_Print ( run, pc, q );
+                        rc = KSrvRun_Print ( run, pc, q, out );
                         found = true;
                     }
                     for ( i = 0; !found && i < l && rc == 0; ++ i ) {
@@ -376,7 +442,7 @@ static rc_t resolve_one_argument( VFSManager * mgr, VResolver * resolver,
                                 break;
                             r2 = KSrvRespFileGetFormat(file, &type);
                             if (r2 != 0 || type != eSFFVdbcache) {
-                                rc = KSrvRespFile_Print(file);
+                                rc = KSrvRespFile_Print(file, out);
                                 found = true;
                             }
                             RELEASE ( KSrvRespFile, file );
@@ -413,7 +479,7 @@ static rc_t resolve_one_argument( VFSManager * mgr, VResolver * resolver,
                 else 
                     rc = VPathMakeString( remote, &s );
                 if ( rc == 0 ) {
-                    OUTMSG(("%S\n", s));
+                    out_printf( out, "%S\n", s );
                     free( ( void* )s );
                 }
                 VPathRelease( local );
@@ -465,14 +531,14 @@ static rc_t resolve_one_argument( VFSManager * mgr, VResolver * resolver,
                         STSMSG( 1, ( "'%s': found in "
                                      "the current directory at '%s'",
                                      pc, resolved ) );
-                        OUTMSG(( "%s\n", resolved ));
+                        out_printf( out, "%s\n", resolved );
                     }
                     else
                     {
                         STSMSG( 1, ( "'%s': cannot resolve "
                                      "in the current directory",
                                      pc ) );
-                        OUTMSG(( "./%s\n", pc ));
+                        out_printf( out, "./%s\n", pc );
                     }
                 }
         }
@@ -483,6 +549,243 @@ static rc_t resolve_one_argument( VFSManager * mgr, VResolver * resolver,
 }
 
 
+typedef struct batch_item {
+    const char * acc;
+    out_buf out;
+    rc_t rc;
+    bool resolved;
+} batch_item;
+
+typedef struct batch_ctx {
+    VFSManager * mgr;
+    VResolver * resolver;
+    const char * location;
+    const char * ngc;
+
+    batch_item * items;
+    uint32_t count;
+
+    KLock * lock;
+    uint32_t next;
+} batch_ctx;
+
+/* the unresolved item a run of the response is for */
+static batch_item * batch_find_run ( batch_ctx * self, const KSrvRun * run ) {
+    batch_item * item = NULL;
+    const VPath * local = NULL;
+    const VPath * remote = NULL;
+
+    if ( KSrvRunQuery ( run, & local, & remote, NULL, NULL ) == 0 ) {
+        const VPath * path = remote != NULL ? remote : local;
+        String id;
+        if ( path != NULL && VPathGetId ( path, & id ) == 0 ) {
+            uint32_t k = 0;
+            for ( k = 0; k < self -> count; ++ k ) {
+                batch_item * i = & self -> items [ k ];
+                if ( ! i -> resolved && string_size ( i -> acc ) == id . size
+                    && memcmp ( i -> acc, id . addr, id . size ) == 0 )
+                {
+                    item = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    VPathRelease ( local );
+    VPathRelease ( remote );
+    return item;
+}
+
+/* resolve all items with one services request: every run is selected
+   and printed like resolve_one_argument does ( quality preference,
+   local before remote ), items without a run are left unresolved */
+static rc_t batch_query ( batch_ctx * self ) {
+    rc_t rc = 0;
+    uint32_t i = 0;
+    VQuality q = eQualLast;
+
+    KService * service = NULL;
+    const KSrvResponse * response = NULL;
+    KSrvRunIterator * ri = NULL;
+
+    rc = KServiceMake ( & service );
+    for ( i = 0; rc == 0 && i < self -> count; ++ i )
+        rc = KServiceAddId ( service, self -> items [ i ] . acc );
+    if ( rc == 0 && self -> location != NULL )
+        rc = KServiceSetLocation ( service, self -> location );
+    if ( rc == 0 ) {
+        uint32_t project = 0;
+        rc = VResolverGetProject ( self -> resolver, & project );
+        if ( rc == 0 && project != 0 )
+            rc = KServiceAddProject ( service, project );
+    }
+    if ( rc == 0 && self -> ngc != NULL ) {
+        rc = KServiceSetNgcFile ( service, self -> ngc );
+        if ( rc != 0 )
+            PLOGERR ( klogErr, ( klogErr, rc,
+                "cannot use '$(ngc)' as ngc file", "ngc=%s", self -> ngc ) );
+    }
+    if ( rc == 0 ) {
+        rc = KServiceNamesQuery ( service, eProtocolHttps, & response );
+        if ( rc != 0 )
+            STSMSG ( 1, ( "batch request failed: %R, "
+                "resolving accessions one by one", rc ) );
+    }
+    if ( rc == 0 )
+        rc = KService_GetPreferredQuality ( service, & q );
+    if ( rc == 0 )
+        rc = KSrvResponseMakeRunIterator ( response, & ri );
+
+    while ( rc == 0 ) {
+        const KSrvRun * run = NULL;
+        batch_item * item = NULL;
+        if ( KSrvRunIteratorNextRun ( ri, & run ) != 0 || run == NULL )
+            break;
+
+        item = batch_find_run ( self, run );
+        if ( item != NULL ) {
+            if ( KSrvRun_Print ( run, item -> acc, q, & item -> out ) == 0
+                && item -> out . len > 0 )
+            {
+                item -> resolved = true;
+            }
+            else
+                item -> out . len = 0;
+        }
+        RELEASE ( KSrvRun, run );
+    }
+
+    RELEASE ( KSrvRunIterator, ri );
+    RELEASE ( KSrvResponse, response );
+    RELEASE ( KService, service );
+
+    return rc;
+}
+
+static rc_t CC batch_worker ( const KThread * self, void * data ) {
+    batch_ctx * ctx = data;
+
+    while ( true ) {
+        batch_item * item = NULL;
+        rc_t rc = KLockAcquire ( ctx -> lock );
+        if ( rc != 0 )
+            return rc;
+        while ( item == NULL && ctx -> next < ctx -> count ) {
+            batch_item * i = & ctx -> items [ ctx -> next ++ ];
+            if ( ! i -> resolved )
+                item = i;
+        }
+        KLockUnlock ( ctx -> lock );
+
+        if ( item == NULL )
+            break;
+
+        item -> rc = resolve_one_argument ( ctx -> mgr, ctx -> resolver,
+            item -> acc, ctx -> location, NULL, ctx -> ngc, & item -> out );
+    }
+
+    return 0;
+}
+
+static rc_t resolve_batch ( batch_ctx * self ) {
+    rc_t rc = 0;
+    uint32_t i = 0, left = 0;
+
+    /* whatever batch request did not resolve is resolved one by one */
+    batch_query ( self );
+
+    for ( i = 0; i < self -> count; ++ i )
+        if ( ! self -> items [ i ] . resolved )
+            ++ left;
+
+    if ( left > 0 ) {
+        KThread * worker [ BATCH_THREADS ];
+        uint32_t n = 0;
+
+        self -> next = 0;
+        for ( n = 0; rc == 0 && n < BATCH_THREADS && n < left; ++ n )
+            rc = KThreadMake ( & worker [ n ], batch_worker, self );
+        if ( rc != 0 )
+            LOGERR ( klogErr, rc, "failed to start resolving thread" );
+        if ( n == 0 )
+            batch_worker ( NULL, self );
+        for ( i = 0; i < n; ++ i ) {
+            KThreadWait ( worker [ i ], NULL );
+            KThreadRelease ( worker [ i ] );
+        }
+        rc = 0;
+    }
+
+    for ( i = 0; i < self -> count; ++ i ) {
+        batch_item * item = & self -> items [ i ];
+        if ( item -> out . len > 0 )
+            OUTMSG ( ( "%.*s", ( int ) item -> out . len, item -> out . s ) );
+        if ( rc == 0 )
+            rc = item -> rc;
+    }
+
+    return rc;
+}
+
+/* resolve parameters by batches of 'batch' accessions,
+   print the results in the order of parameters */
+static rc_t resolve_batches ( Args * args, uint32_t acount, uint32_t batch,
+    VFSManager * mgr, VResolver * resolver,
+    const char * location, const char * ngc )
+{
+    rc_t rc = 0;
+    rc_t r2 = 0;
+    uint32_t first = 0;
+
+    batch_ctx ctx;
+    memset ( & ctx, 0, sizeof ctx );
+    ctx . mgr = mgr;
+    ctx . resolver = resolver;
+    ctx . location = location;
+    ctx . ngc = ngc;
+
+    ctx . items = calloc ( batch, sizeof * ctx . items );
+    if ( ctx . items == NULL )
+        rc = RC ( rcExe, rcArgv, rcProcessing, rcMemory, rcExhausted );
+    else
+        rc = KLockMake ( & ctx . lock );
+
+    for ( first = 0; rc == 0 && first < acount; first += batch ) {
+        uint32_t i = 0;
+
+        ctx . count = acount - first < batch ? acount - first : batch;
+        for ( i = 0; rc == 0 && i < ctx . count; ++ i ) {
+            batch_item * item = & ctx . items [ i ];
+            item -> out . len = 0;
+            item -> rc = 0;
+            item -> resolved = false;
+            rc = ArgsParamValue ( args, first + i, ( const void ** ) & item -> acc );
+            if ( rc != 0 )
+                LOGERR( klogInt, rc, "failed to retrieve parameter value" );
+        }
+
+        if ( rc == 0 ) {
+            rc_t rx = resolve_batch ( & ctx );
+            if ( rx != 0 && r2 == 0 )
+                r2 = rx;
+        }
+    }
+
+    if ( ctx . items != NULL ) {
+        uint32_t i = 0;
+        for ( i = 0; i < batch; ++ i )
+            free ( ctx . items [ i ] . out . s );
+        free ( ctx . items );
+    }
+    RELEASE ( KLock, ctx . lock );
+
+    if ( rc == 0 )
+        rc = r2;
+    return rc;
+}
+
+
 static rc_t resolve_arguments( Args * args )
 {
     uint32_t acount;
@@ -539,6 +842,15 @@ static rc_t resolve_arguments( Args * args )
                     LOGMSG ( klogWarn, "all the options are ignored "
                         "when running '" FUNCTION_RESOLVE "' function" );
 
+                idx = get_uint32_t_option ( args, OPTION_BATCH, 0 );
+                if ( rc == 0 && idx > 0 && acount > 1 ) {
+                    rc_t rx = resolve_batches ( args, acount, idx,
+                        mgr, resolver, location, ngc );
+                    if ( rx != 0 && r2 == 0 )
+                        r2 = rx;
+                    acount = 0;
+                }
+
                 for ( idx = 0; rc == 0 && idx < acount; ++ idx )
                 {
                     const char * pc;
@@ -547,14 +859,14 @@ static rc_t resolve_arguments( Args * args )
                         LOGERR( klogInt, rc, "failed to retrieve parameter value" );
                     else {
                         rc_t rx = resolve_one_argument(
-                            mgr, resolver, pc, location, NULL, ngc );
+                            mgr, resolver, pc, location, NULL, ngc, NULL );
                         if ( rx != 0 && r2 == 0)
                             r2 = rx;
                     }
                 }
                 if (cart != NULL) {
                     rc_t rx = resolve_one_argument(
-                        mgr, resolver, NULL, location, cart, ngc);
+                        mgr, resolver, NULL, location, cart, ngc, NULL);
                     if (rx != 0 && r2 == 0)
                         r2 = rx;
                 }
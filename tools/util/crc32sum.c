@@ -30,6 +30,9 @@
 #include <klib/out.h>
 #include <klib/rc.h>
 #include <kapp/main.h>
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -38,17 +41,91 @@
 #include <ctype.h>
 #include <assert.h>
 
+#define CRC32SUM_BUFSIZE ( 1024 * 1024 )
+#define CRC32SUM_MAX_THREADS 64
+
+/* slice-by-8 tables for the same CRC as CRC32 ():
+   crc32_slice [ k ] [ b ] is CRC32 of byte b followed by k zero bytes */
+static uint32_t crc32_slice [ 8 ] [ 256 ];
+static int crc32_slice_ok;
+
+static
+uint32_t crc32sum_update ( uint32_t crc, const void *data, size_t size )
+{
+    const uint8_t *p = data;
+
+    if ( ! crc32_slice_ok )
+        return CRC32 ( crc, data, size );
+
+    for ( ; size != 0 && ( ( size_t ) p & 7 ) != 0; -- size, ++ p )
+        crc = ( crc << 8 ) ^ crc32_slice [ 0 ] [ ( crc >> 24 ) ^ * p ];
+
+    for ( ; size >= 8; size -= 8, p += 8 )
+    {
+        uint32_t hi = crc ^ ( ( ( uint32_t ) p [ 0 ] << 24 ) | ( ( uint32_t ) p [ 1 ] << 16 ) |
+                              ( ( uint32_t ) p [ 2 ] << 8 ) | ( uint32_t ) p [ 3 ] );
+        crc = crc32_slice [ 7 ] [ hi >> 24 ] ^
+              crc32_slice [ 6 ] [ ( hi >> 16 ) & 0xFF ] ^
+              crc32_slice [ 5 ] [ ( hi >> 8 ) & 0xFF ] ^
+              crc32_slice [ 4 ] [ hi & 0xFF ] ^
+              crc32_slice [ 3 ] [ p [ 4 ] ] ^
+              crc32_slice [ 2 ] [ p [ 5 ] ] ^
+              crc32_slice [ 1 ] [ p [ 6 ] ] ^
+              crc32_slice [ 0 ] [ p [ 7 ] ];
+    }
+
+    for ( ; size != 0; -- size, ++ p )
+        crc = ( crc << 8 ) ^ crc32_slice [ 0 ] [ ( crc >> 24 ) ^ * p ];
+
+    return crc;
+}
+
+static
+void crc32sum_init ( void )
+{
+    static const char probe [] = "123456789 slice-by-8 self check, odd length.";
+    uint32_t i, k;
+
+    CRC32Init ();
+
+    for ( i = 0; i < 256; ++ i )
+    {
+        uint8_t b = ( uint8_t ) i;
+        crc32_slice [ 0 ] [ i ] = CRC32 ( 0, & b, 1 );
+    }
+    for ( k = 1; k < 8; ++ k )
+    {
+        for ( i = 0; i < 256; ++ i )
+        {
+            uint32_t prev = crc32_slice [ k - 1 ] [ i ];
+            crc32_slice [ k ] [ i ] = ( prev << 8 ) ^ crc32_slice [ 0 ] [ prev >> 24 ];
+        }
+    }
+
+    /* tables are only used if they reproduce CRC32 () */
+    crc32_slice_ok = 1;
+    for ( i = 0; i < 8 && crc32_slice_ok; ++ i )
+    {
+        uint32_t seed = 0x9e3779b9 * i;
+        if ( crc32sum_update ( seed, probe + i, sizeof probe - 1 - i ) != CRC32 ( seed, probe + i, sizeof probe - 1 - i ) )
+            crc32_slice_ok = 0;
+    }
+}
+
 static
 int crc32sum_calc ( FILE *in, uint32_t *crc32 )
 {
     int status;
-    char *buff = malloc ( 32 * 1024 );
+    char *buff = malloc ( CRC32SUM_BUFSIZE );
     if ( buff == NULL )
         return errno;
 
+    /* read straight into our buffer */
+    setvbuf ( in, NULL, _IONBF, 0 );
+
     for ( status = 0, * crc32 = 0;; )
     {
-        size_t num_read = fread ( buff, 1, 32 * 1024, in );
+        size_t num_read = fread ( buff, 1, CRC32SUM_BUFSIZE, in );
         if ( num_read == 0 )
         {
             if ( ! feof ( in ) )
@@ -56,7 +133,7 @@ int crc32sum_calc ( FILE *in, uint32_t *crc32 )
             break;
         }
 
-        * crc32 = CRC32 ( * crc32, buff, num_read );
+        * crc32 = crc32sum_update ( * crc32, buff, num_read );
     }
 
     free ( buff );
@@ -64,17 +141,197 @@ int crc32sum_calc ( FILE *in, uint32_t *crc32 )
     return status;
 }
 
+/* one file to checksum, results are reported in the order of jobs */
+typedef struct crc32sum_job crc32sum_job;
+struct crc32sum_job
+{
+    const char *fname;
+    uint32_t prior;
+    uint32_t crc32;
+    int bin;
+    int status;
+    int open_failed;
+    int done;
+};
+
+static
+void crc32sum_job_run ( crc32sum_job *job )
+{
+    FILE *src = fopen ( job -> fname, job -> bin ? "rb" : "r" );
+    if ( src == NULL )
+    {
+        job -> status = errno;
+        job -> open_failed = 1;
+    }
+    else
+    {
+        job -> status = crc32sum_calc ( src, & job -> crc32 );
+        fclose ( src );
+    }
+}
+
+typedef struct crc32sum_pool crc32sum_pool;
+struct crc32sum_pool
+{
+    KLock *lock;
+    KCondition *cond;
+    crc32sum_job *job;
+    uint32_t count;
+    uint32_t next;
+    int quit;
+};
+
+static
+rc_t CC crc32sum_worker ( const KThread *self, void *data )
+{
+    crc32sum_pool *pool = data;
+    rc_t rc = KLockAcquire ( pool -> lock );
+
+    while ( rc == 0 && ! pool -> quit && pool -> next < pool -> count )
+    {
+        crc32sum_job *job = & pool -> job [ pool -> next ++ ];
+        KLockUnlock ( pool -> lock );
+
+        crc32sum_job_run ( job );
+
+        rc = KLockAcquire ( pool -> lock );
+        if ( rc == 0 )
+        {
+            job -> done = 1;
+            KConditionBroadcast ( pool -> cond );
+        }
+    }
+    if ( rc == 0 )
+        KLockUnlock ( pool -> lock );
+
+    return rc;
+}
+
+/* callback reporting a finished job, non-zero stops processing */
+typedef int ( * crc32sum_report ) ( const crc32sum_job *job, void *data );
+
+/* checksums all jobs on up to threads threads, reporting them in order */
+static
+int crc32sum_run ( crc32sum_job *job, uint32_t count, uint32_t threads,
+    crc32sum_report report, void *data )
+{
+    crc32sum_pool pool;
+    KThread *worker [ CRC32SUM_MAX_THREADS ];
+    uint32_t i, started = 0;
+    int status = 0;
+    rc_t rc;
+
+    if ( threads > count )
+        threads = count;
+
+    if ( threads <= 1 )
+    {
+        for ( i = 0; status == 0 && i < count; ++ i )
+        {
+            crc32sum_job_run ( & job [ i ] );
+            status = report ( & job [ i ], data );
+        }
+        return status;
+    }
+
+    memset ( & pool, 0, sizeof pool );
+    pool . job = job;
+    pool . count = count;
+
+    rc = KLockMake ( & pool . lock );
+    if ( rc == 0 )
+        rc = KConditionMake ( & pool . cond );
+    for ( ; rc == 0 && started < threads; ++ started )
+        rc = KThreadMake ( & worker [ started ], crc32sum_worker, & pool );
+
+    if ( rc != 0 )
+    {
+        fprintf ( stderr, "failed to start worker threads\n" );
+        status = EAGAIN;
+    }
+
+    for ( i = 0; status == 0 && i < count; ++ i )
+    {
+        if ( KLockAcquire ( pool . lock ) != 0 )
+        {
+            status = EAGAIN;
+            break;
+        }
+        while ( ! job [ i ] . done )
+            KConditionWait ( pool . cond, pool . lock );
+        KLockUnlock ( pool . lock );
+
+        status = report ( & job [ i ], data );
+    }
+
+    if ( pool . lock != NULL && KLockAcquire ( pool . lock ) == 0 )
+    {
+        pool . quit = 1;
+        KLockUnlock ( pool . lock );
+    }
+    for ( i = 0; i < started; ++ i )
+    {
+        KThreadWait ( worker [ i ], NULL );
+        KThreadRelease ( worker [ i ] );
+    }
+    KConditionRelease ( pool . cond );
+    KLockRelease ( pool . lock );
+
+    return status;
+}
+
+typedef struct crc32sum_check_data crc32sum_check_data;
+struct crc32sum_check_data
+{
+    int mismatches;
+};
+
+static
+int crc32sum_check_report ( const crc32sum_job *job, void *data )
+{
+    crc32sum_check_data *cd = data;
+
+    if ( job -> open_failed )
+    {
+        fprintf ( stderr, "failed to open file '%s': %s\n", job -> fname, strerror ( job -> status ) );
+        return job -> status;
+    }
+
+    if ( job -> status != 0 )
+        fprintf ( stderr, "error processing file '%s': %s\n", job -> fname, strerror ( job -> status ) );
+    else
+    {
+        printf ( "%s: %s\n", job -> fname, ( job -> crc32 == job -> prior ) ? "OK" : "FAILED" );
+        if ( job -> crc32 != job -> prior )
+            ++ cd -> mismatches;
+    }
+    return 0;
+}
+
 static
-int crc32sum_check ( FILE *in, const char *fname )
+void crc32sum_jobs_whack ( crc32sum_job *job, uint32_t count )
 {
-    int cnt, mismatches;
+    uint32_t i;
+    for ( i = 0; i < count; ++ i )
+        free ( ( void * ) job [ i ] . fname );
+    free ( job );
+}
+
+static
+int crc32sum_check ( FILE *in, const char *fname, uint32_t threads )
+{
+    int cnt, status, badly_formatted = 0;
     char line [ 5 * 1024 ];
-    for ( cnt = mismatches = 0; fgets ( line, sizeof line, in ) != NULL; ++ cnt )
+    crc32sum_job *job = NULL;
+    uint32_t count = 0, size = 0;
+    crc32sum_check_data cd;
+
+    /* collect the list first, files are then checked concurrently */
+    for ( cnt = 0; fgets ( line, sizeof line, in ) != NULL; ++ cnt )
     {
         char *p;
-        FILE *src;
-        int status, bin = 0;
-        uint32_t prior, crc32;
+        int bin = 0;
+        uint32_t prior;
 
         if ( line [ 0 ] == 0 )
         {
@@ -89,42 +346,55 @@ int crc32sum_check ( FILE *in, const char *fname )
         prior = strtoul ( line, & p, 16 );
         if ( ( p - line ) != 8 || p [ 0 ] != ' ' )
         {
-            fprintf ( stderr, "badly formatted file '%s'\n", fname );
-            return EINVAL;
+            badly_formatted = 1;
+            break;
         }
 
         if ( p [ 1 ] == '*' )
             bin = 1;
         else if ( p [ 1 ] != ' ' )
         {
-            fprintf ( stderr, "badly formatted file '%s'\n", fname );
-            return EINVAL;
+            badly_formatted = 1;
+            break;
+        }
+
+        if ( count == size )
+        {
+            crc32sum_job *tmp = realloc ( job, ( size = size ? size * 2 : 256 ) * sizeof * job );
+            if ( tmp == NULL )
+            {
+                crc32sum_jobs_whack ( job, count );
+                return ENOMEM;
+            }
+            job = tmp;
         }
- 
-        src = fopen ( p += 2, bin ? "rb" : "r" );
-        if ( src == NULL )
+        memset ( & job [ count ], 0, sizeof job [ count ] );
+        job [ count ] . fname = strdup ( p + 2 );
+        if ( job [ count ] . fname == NULL )
         {
-            status = errno;
-            fprintf ( stderr, "failed to open file '%s': %s\n", p, strerror ( status ) );
-            return status;
+            crc32sum_jobs_whack ( job, count );
+            return ENOMEM;
         }
+        job [ count ] . prior = prior;
+        job [ count ] . bin = bin;
+        ++ count;
+    }
 
-        status = crc32sum_calc ( src, & crc32 );
+    cd . mismatches = 0;
+    status = crc32sum_run ( job, count, threads, crc32sum_check_report, & cd );
+    crc32sum_jobs_whack ( job, count );
 
-        fclose ( src );
+    if ( status != 0 )
+        return status;
 
-        if ( status != 0 )
-            fprintf ( stderr, "error processing file '%s': %s\n", p, strerror ( status ) );
-        else
-        {
-            printf ( "%s: %s\n", p, ( crc32 == prior ) ? "OK" : "FAILED" );
-            if ( crc32 != prior )
-                ++ mismatches;
-        }
+    if ( badly_formatted )
+    {
+        fprintf ( stderr, "badly formatted file '%s'\n", fname );
+        return EINVAL;
     }
 
-    if ( mismatches != 0 )
-        fprintf ( stderr, "WARNING: %d of %d computed checksums did NOT match\n", mismatches, cnt );
+    if ( cd . mismatches != 0 )
+        fprintf ( stderr, "WARNING: %d of %d computed checksums did NOT match\n", cd . mismatches, cnt );
 
     if ( ! feof ( in ) )
         return ferror ( in );
@@ -132,30 +402,37 @@ int crc32sum_check ( FILE *in, const char *fname )
 }
 
 static
-int crc32sum_gen ( FILE *in, const char *fname, int bin )
+int crc32sum_gen_report ( const crc32sum_job *job, void *data )
 {
-    uint32_t crc32;
-    int status = crc32sum_calc ( in, & crc32 );
-    if ( status != 0 )
-        fprintf ( stderr, "error processing file '%s': %s\n", fname, strerror ( status ) );
+    if ( job -> open_failed )
+    {
+        fprintf ( stderr, "failed to open file '%s'\n", job -> fname );
+        return -1;
+    }
+    if ( job -> status != 0 )
+        fprintf ( stderr, "error processing file '%s': %s\n", job -> fname, strerror ( job -> status ) );
     else
-        printf ( "%08x %c%s\n", crc32, bin ? '*' : ' ', fname );
-    return status;
+        printf ( "%08x %c%s\n", job -> crc32, job -> bin ? '*' : ' ', job -> fname );
+    return job -> status;
 }
 
 
-#define OPTION_BINARY "binary"
-#define OPTION_CHECK  "check"
-#define ALIAS_BINARY  "b"
-#define ALIAS_CHECK   "c"
+#define OPTION_BINARY  "binary"
+#define OPTION_CHECK   "check"
+#define OPTION_THREADS "threads"
+#define ALIAS_BINARY   "b"
+#define ALIAS_CHECK    "c"
+#define ALIAS_THREADS  "t"
 
-static const char * binary_usage[] = { "open file in binary mode", NULL };
-static const char * check_usage[]  = { "check CRC32 against given list", NULL };
+static const char * binary_usage[]  = { "open file in binary mode", NULL };
+static const char * check_usage[]   = { "check CRC32 against given list", NULL };
+static const char * threads_usage[] = { "number of files to checksum concurrently, default 1", NULL };
 
 OptDef Options[] =
 {
-    { OPTION_BINARY, ALIAS_BINARY, NULL, binary_usage, 0, false, false },
-    { OPTION_CHECK,  ALIAS_CHECK,  NULL, check_usage,  0, false, false }
+    { OPTION_BINARY,  ALIAS_BINARY,  NULL, binary_usage,  0, false, false },
+    { OPTION_CHECK,   ALIAS_CHECK,   NULL, check_usage,   0, false, false },
+    { OPTION_THREADS, ALIAS_THREADS, NULL, threads_usage, 1, true,  false }
 };
 
 
@@ -193,6 +470,8 @@ rc_t CC Usage ( const Args * args )
 
     HelpOptionLine (ALIAS_CHECK, OPTION_CHECK, NULL, check_usage);
 
+    HelpOptionLine (ALIAS_THREADS, OPTION_THREADS, "count", threads_usage);
+
     HelpOptionsStandard ();
 
     HelpVersion (fullpath, KAppVersion());
@@ -212,6 +491,7 @@ rc_t CC KMain (int argc, char * argv [])
         do
         {
             uint32_t pcount;
+            uint32_t threads;
             int check;
             int bin;
 
@@ -225,6 +505,23 @@ rc_t CC KMain (int argc, char * argv [])
 
             check = (pcount != 0);
 
+            rc = ArgsOptionCount (args, OPTION_THREADS, &pcount);
+            if (rc) break;
+
+            threads = 1;
+            if (pcount != 0)
+            {
+                const char * value;
+                rc = ArgsOptionValue (args, OPTION_THREADS, 0, (const void **)&value);
+                if (rc) break;
+
+                threads = strtoul (value, NULL, 10);
+                if (threads < 1)
+                    threads = 1;
+                else if (threads > CRC32SUM_MAX_THREADS)
+                    threads = CRC32SUM_MAX_THREADS;
+            }
+
             rc = ArgsParamCount (args, &pcount);
             if (rc) break;
 
@@ -232,12 +529,12 @@ rc_t CC KMain (int argc, char * argv [])
             {
                 MiniUsage(args);
             }
-            else
+            else if (check)
             {
                 uint32_t i;
 
-                CRC32Init ();
-           
+                crc32sum_init ();
+
                 for ( i = 0; i < pcount; ++ i )
                 {
 
@@ -255,9 +552,7 @@ rc_t CC KMain (int argc, char * argv [])
                         return -1;
                     }
 
-                    status = check ?
-                        crc32sum_check ( in, fname ):
-                        crc32sum_gen ( in, fname, bin );
+                    status = crc32sum_check ( in, fname, threads );
 
                     fclose ( in );
 
@@ -265,6 +560,28 @@ rc_t CC KMain (int argc, char * argv [])
                         return status;
                 }
             }
+            else
+            {
+                uint32_t i;
+                int status;
+                crc32sum_job *job = calloc ( pcount, sizeof * job );
+                if ( job == NULL )
+                    return ENOMEM;
+
+                crc32sum_init ();
+
+                for ( i = 0; i < pcount; ++ i )
+                {
+                    rc = ArgsParamValue (args, i, (const void **)&job [ i ] . fname);
+                    job [ i ] . bin = bin;
+                }
+
+                status = crc32sum_run ( job, pcount, threads, crc32sum_gen_report, NULL );
+                free ( job );
+
+                if ( status != 0 )
+                    return status;
+            }
         } while (0);
     }
 
@@ -36,9 +36,15 @@
 enum OPTIONS {
     OPT_OUTPUT,     /* temp path */
     OPT_CACHE,      /* vdbcache path */
+    OPT_THREADS,    /* worker threads */
     OPTIONS_COUNT
 };
 
+#define MAX_THREADS 64
+#ifndef ROWS_PER_CHUNK /* test/make-read-filter builds it with tiny chunks */
+#define ROWS_PER_CHUNK (64 * 1024)
+#endif
+
 /* NOTE: Rules for filtering
     Quote:
         Reads that have more than half of quality score values <20 will be
@@ -90,37 +96,53 @@ static FilterReason shouldFilter(uint32_t const len, uint8_t const *const qual)
     return reason;
 }
 
-uint64_t dispositionCount[6];
-uint64_t dispositionBaseCount[6];
-static void updateCounts(FilterReason const reason, uint32_t const length)
+typedef struct Disposition {
+    uint64_t count[6];
+    uint64_t baseCount[6];
+} Disposition;
+
+Disposition disposition;
+
+static void updateCounts(Disposition *const self, FilterReason const reason, uint32_t const length)
 {
     if (reason == keep) {
-        dispositionCount[0] += 1;
-        dispositionBaseCount[0] += length;
+        self->count[0] += 1;
+        self->baseCount[0] += length;
     }
     else {
-        dispositionCount[1] += 1;
-        dispositionBaseCount[1] += length;
+        self->count[1] += 1;
+        self->baseCount[1] += length;
     }
     if ((reason & original_filter) != 0) {
-        dispositionCount[2] += 1;
-        dispositionBaseCount[2] += length;
+        self->count[2] += 1;
+        self->baseCount[2] += length;
     }
     if ((reason & low_quality_count) != 0) {
-        dispositionCount[3] += 1;
-        dispositionBaseCount[3] += length;
+        self->count[3] += 1;
+        self->baseCount[3] += length;
     }
     if ((reason & low_quality_front) != 0) {
-        dispositionCount[4] += 1;
-        dispositionBaseCount[4] += length;
+        self->count[4] += 1;
+        self->baseCount[4] += length;
     }
     if ((reason & low_quality_back) != 0) {
-        dispositionCount[5] += 1;
-        dispositionBaseCount[5] += length;
+        self->count[5] += 1;
+        self->baseCount[5] += length;
+    }
+}
+
+static void mergeCounts(Disposition *const self, Disposition const *const other)
+{
+    int i;
+
+    for (i = 0; i < 6; ++i) {
+        self->count[i] += other->count[i];
+        self->baseCount[i] += other->baseCount[i];
     }
 }
 
 static void computeReadFilter(uint8_t *const out_filter
+                             , Disposition *const disp
                              , CellData const *const filterData
                              , CellData const *const typeData
                              , CellData const *const startData
@@ -157,7 +179,7 @@ static void computeReadFilter(uint8_t *const out_filter
                 if (reason != keep)
                     filt = SRA_READ_FILTER_REJECT;
             }
-            updateCounts(reason, len[i]);
+            updateCounts(disp, reason, len[i]);
         }
         out_filter[i] = filt;
     }
@@ -174,89 +196,373 @@ static bool didReadFilterChange(unsigned const n, uint8_t const *const out, uint
     return false;
 }
 
-int invalidated = -1;
-#include <fcntl.h>
-static void open_invalidated()
+/* MARK: row ids of PRIMARY_ALIGNMENT rows to update in vdbcache */
+typedef struct RowIds {
+    int64_t *id;
+    size_t count;
+    size_t size;
+} RowIds;
+
+RowIds invalidated;
+
+static void appendRowIds(RowIds *const self, size_t const count, int64_t const *const ids)
 {
-    invalidated = open("invalidedRows", O_RDWR | O_APPEND | O_CREAT | O_EXCL, 0700);
-    if (invalidated >= 0)
-        return;
-    LogMsg(klogFatal, "Can't create file for invalidated rows");
-    exit(EX_CANTCREAT);
+    if (self->count + count > self->size) {
+        size_t size = self->size ? self->size : 4096;
+        void *temp;
+
+        while (size < self->count + count)
+            size *= 2;
+        temp = realloc(self->id, size * sizeof(self->id[0]));
+        if (temp == NULL)
+            OUT_OF_MEMORY();
+        self->id = temp;
+        self->size = size;
+    }
+    memmove(self->id + self->count, ids, count * sizeof(ids[0]));
+    self->count += count;
 }
 
-static void invalidateRow(int64_t const row)
+static int cmp_int64_t(void const *A, void const *B);
+
+/** merge sorted per-thread row ids into one sorted vector, sources are freed
+ **/
+static void mergeRowIds(RowIds *const self, unsigned const n, RowIds *const *const src)
 {
-    if (invalidated >= 0) {
-        if (write(invalidated, &row, sizeof(row)) == sizeof(row))
-            return;
-        LogMsg(klogFatal, "Can't record invalidated rows");
-        exit(EX_IOERR);
+    size_t pos[MAX_THREADS];
+    size_t total = 0;
+    unsigned i;
+
+    for (i = 0; i < n; ++i) {
+        pos[i] = 0;
+        total += src[i]->count;
+    }
+    self->id = total ? malloc(total * sizeof(self->id[0])) : NULL;
+    if (total && self->id == NULL)
+        OUT_OF_MEMORY();
+    self->size = total;
+    self->count = 0;
+    while (self->count < total) {
+        unsigned best = n;
+        for (i = 0; i < n; ++i) {
+            if (pos[i] < src[i]->count && (best == n || src[i]->id[pos[i]] < src[best]->id[pos[best]]))
+                best = i;
+        }
+        self->id[self->count++] = src[best]->id[pos[best]++];
+    }
+    for (i = 0; i < n; ++i) {
+        free(src[i]->id);
+        memset(src[i], 0, sizeof(*src[i]));
     }
-    open_invalidated();
-    invalidateRow(row);
 }
 
-static void processCursors(VCursor *const out, VCursor const *const in, bool const haveCache)
+typedef struct InputCursor {
+    VCursor const *curs;
+    uint32_t cid_pr_id;
+    uint32_t cid_read_filter;
+    uint32_t cid_readstart;
+    uint32_t cid_read_type;
+    uint32_t cid_readlen;
+    uint32_t cid_qual;
+} InputCursor;
+
+static void openInputCursor(InputCursor *const self, VTable const *const input, bool const haveCache)
 {
+    VCursor const *in = NULL;
+    {
+        rc_t const rc = VTableCreateCursorRead(input, &in);
+        if (rc != 0) {
+            LogErr(klogFatal, rc, "Failed to create input cursor!");
+            exit(EX_NOINPUT);
+        }
+    }
     /* MARK: input columns */
-    uint32_t const cid_pr_id       = haveCache ? addColumn("PRIMARY_ALIGNMENT_ID", "I64" , in) : 0;
-    uint32_t const cid_read_filter = addColumn("READ_FILTER", "U8" , in);
-    uint32_t const cid_readstart   = addColumn("READ_START" , "I32", in);
-    uint32_t const cid_read_type   = addColumn("READ_TYPE"  , "U8" , in);
-    uint32_t const cid_readlen     = addColumn("READ_LEN"   , "U32", in);
-    uint32_t const cid_qual        = addColumn("QUALITY"    , "U8" , in);
+    self->curs = in;
+    self->cid_pr_id       = haveCache ? addColumn("PRIMARY_ALIGNMENT_ID", "I64" , in) : 0;
+    self->cid_read_filter = addColumn("READ_FILTER", "U8" , in);
+    self->cid_readstart   = addColumn("READ_START" , "I32", in);
+    self->cid_read_type   = addColumn("READ_TYPE"  , "U8" , in);
+    self->cid_readlen     = addColumn("READ_LEN"   , "U32", in);
+    self->cid_qual        = addColumn("QUALITY"    , "U8" , in);
+    openCursor(in, "input");
+}
 
-    /* MARK: output column */
-    uint32_t const cid_rd_filter = addColumn("READ_FILTER", "U8", out);
+/* MARK: a range of rows, computed by a worker and written in order */
+typedef struct FilterChunk {
+    int64_t first;
+    uint64_t count;
+    uint32_t *reads;    /* number of reads in each row */
+    uint8_t *filter;    /* new READ_FILTER of all rows */
+    size_t filter_size;
+    bool done;
+} FilterChunk;
+
+static void computeChunk(  FilterChunk *const chunk
+                         , InputCursor const *const input
+                         , bool const haveCache
+                         , Disposition *const disp
+                         , RowIds *const changed)
+{
+    VCursor const *const in = input->curs;
+    size_t used = 0;
+    uint64_t r;
 
-    int64_t first = 0;
-    uint64_t count = 0;
+    for (r = 0; r < chunk->count; ++r) {
+        int64_t const row = chunk->first + r;
+        CellData const readfilter = cellData("READ_FILTER", input->cid_read_filter, row, in);
+        CellData const readstart  = cellData("READ_START" , input->cid_readstart  , row, in);
+        CellData const readtype   = cellData("READ_TYPE"  , input->cid_read_type  , row, in);
+        CellData const readlen    = cellData("READ_LEN"   , input->cid_readlen    , row, in);
+        CellData const quality    = cellData("QUALITY"    , input->cid_qual       , row, in);
+        uint8_t *out_filter;
+
+        if (used + readfilter.count > chunk->filter_size) {
+            size_t size = chunk->filter_size ? chunk->filter_size : ROWS_PER_CHUNK;
+            void *temp;
+
+            while (size < used + readfilter.count)
+                size *= 2;
+            temp = realloc(chunk->filter, size);
+            if (temp == NULL)
+                OUT_OF_MEMORY();
+            chunk->filter = temp;
+            chunk->filter_size = size;
+        }
+        out_filter = chunk->filter + used;
+        computeReadFilter(out_filter, disp, &readfilter, &readtype, &readstart, &readlen, &quality, row);
+        if (haveCache && didReadFilterChange(readfilter.count, out_filter, readfilter.data)) {
+            CellData const pridData = cellData("PRIMARY_ALIGNMENT_ID", input->cid_pr_id, row, in);
+            appendRowIds(changed, pridData.count, pridData.data);
+        }
+        chunk->reads[r] = readfilter.count;
+        used += readfilter.count;
+    }
+}
+
+static void writeChunk(FilterChunk const *const chunk, uint32_t const cid_rd_filter, VCursor *const out)
+{
+    uint8_t const *out_filter = chunk->filter;
+    uint64_t r;
+
+    for (r = 0; r < chunk->count; ++r) {
+        int64_t const row = chunk->first + r;
+
+        openRow(row, out);
+        writeRow(row, chunk->reads[r], out_filter, cid_rd_filter, out);
+        commitRow(row, out);
+        closeRow(row, out);
+        out_filter += chunk->reads[r];
+    }
+}
+
+static void chunkInit(FilterChunk *const chunk)
+{
+    memset(chunk, 0, sizeof(*chunk));
+    chunk->reads = malloc(ROWS_PER_CHUNK * sizeof(chunk->reads[0]));
+    if (chunk->reads == NULL)
+        OUT_OF_MEMORY();
+}
 
-    uint64_t r = 0;
-    size_t out_filter_count = 0;
-    uint8_t *out_filter = NULL;
+static void chunkWhack(FilterChunk *const chunk)
+{
+    free(chunk->reads);
+    free(chunk->filter);
+}
+
+/* MARK: chunks are taken by workers in order, at most `window` chunks ahead of the writer */
+typedef struct FilterJobs {
+    KLock *lock;
+    KCondition *cond;
+    VTable const *input;
+    bool haveCache;
+    int64_t first;
+    uint64_t count;
+    uint64_t chunks;
+    uint64_t next;      /* next chunk to compute */
+    uint64_t written;   /* chunks written so far */
+    unsigned window;
+    FilterChunk *slot;  /* chunk k is in slot[k % window] */
+} FilterJobs;
+
+typedef struct FilterWorker {
+    FilterJobs *jobs;
+    KThread *thread;
+    Disposition disp;
+    RowIds changed;
+} FilterWorker;
+
+static void lockJobs(FilterJobs *const jobs)
+{
+    rc_t const rc = KLockAcquire(jobs->lock);
+    if (rc) {
+        LogErr(klogFatal, rc, "Failed to acquire lock");
+        exit(EX_SOFTWARE);
+    }
+}
 
-    openCursor(in, "input");    
+static void waitJobs(FilterJobs *const jobs)
+{
+    rc_t const rc = KConditionWait(jobs->cond, jobs->lock);
+    if (rc) {
+        LogErr(klogFatal, rc, "Failed to wait for workers");
+        exit(EX_SOFTWARE);
+    }
+}
+
+static rc_t CC filterWorker(KThread const *const self, void *const data)
+{
+    FilterWorker *const worker = data;
+    FilterJobs *const jobs = worker->jobs;
+    InputCursor input;
+
+    openInputCursor(&input, jobs->input, jobs->haveCache);
+    for ( ; ; ) {
+        uint64_t k;
+        FilterChunk *chunk;
+
+        lockJobs(jobs);
+        while (jobs->next < jobs->chunks && jobs->next >= jobs->written + jobs->window)
+            waitJobs(jobs);
+        if (jobs->next >= jobs->chunks) {
+            KLockUnlock(jobs->lock);
+            break;
+        }
+        k = jobs->next++;
+        KLockUnlock(jobs->lock);
+
+        chunk = &jobs->slot[k % jobs->window];
+        chunk->first = jobs->first + k * ROWS_PER_CHUNK;
+        chunk->count = jobs->first + jobs->count - chunk->first;
+        if (chunk->count > ROWS_PER_CHUNK)
+            chunk->count = ROWS_PER_CHUNK;
+        computeChunk(chunk, &input, jobs->haveCache, &worker->disp, &worker->changed);
+
+        lockJobs(jobs);
+        chunk->done = true;
+        KConditionBroadcast(jobs->cond);
+        KLockUnlock(jobs->lock);
+    }
+    VCursorRelease(input.curs);
+    qsort(worker->changed.id, worker->changed.count, sizeof(worker->changed.id[0]), cmp_int64_t);
+    return 0;
+}
+
+static void processThreaded(  VCursor *const out
+                            , uint32_t const cid_rd_filter
+                            , FilterJobs *const jobs
+                            , unsigned const threads)
+{
+    FilterWorker worker[MAX_THREADS];
+    RowIds *changed[MAX_THREADS];
+    unsigned i;
+    uint64_t k;
+
+    {
+        rc_t rc = KLockMake(&jobs->lock);
+        if (rc == 0)
+            rc = KConditionMake(&jobs->cond);
+        if (rc) {
+            LogErr(klogFatal, rc, "Failed to make lock");
+            exit(EX_SOFTWARE);
+        }
+    }
+    jobs->window = 2 * threads;
+    jobs->slot = calloc(jobs->window, sizeof(jobs->slot[0]));
+    if (jobs->slot == NULL)
+        OUT_OF_MEMORY();
+    for (i = 0; i < jobs->window; ++i)
+        chunkInit(&jobs->slot[i]);
+
+    memset(worker, 0, sizeof(worker));
+    for (i = 0; i < threads; ++i) {
+        rc_t rc;
+
+        worker[i].jobs = jobs;
+        rc = KThreadMake(&worker[i].thread, filterWorker, &worker[i]);
+        if (rc) {
+            LogErr(klogFatal, rc, "Failed to start worker thread");
+            exit(EX_SOFTWARE);
+        }
+    }
+
+    /* MARK: write chunks in row order as they become ready */
+    for (k = 0; k < jobs->chunks; ++k) {
+        FilterChunk *const chunk = &jobs->slot[k % jobs->window];
+
+        lockJobs(jobs);
+        while (!chunk->done)
+            waitJobs(jobs);
+        KLockUnlock(jobs->lock);
+
+        writeChunk(chunk, cid_rd_filter, out);
+
+        lockJobs(jobs);
+        chunk->done = false;
+        ++jobs->written;
+        KConditionBroadcast(jobs->cond);
+        KLockUnlock(jobs->lock);
+    }
+
+    for (i = 0; i < threads; ++i) {
+        KThreadWait(worker[i].thread, NULL);
+        KThreadRelease(worker[i].thread);
+        mergeCounts(&disposition, &worker[i].disp);
+        changed[i] = &worker[i].changed;
+    }
+    mergeRowIds(&invalidated, threads, changed);
+
+    for (i = 0; i < jobs->window; ++i)
+        chunkWhack(&jobs->slot[i]);
+    free(jobs->slot);
+    KConditionRelease(jobs->cond);
+    KLockRelease(jobs->lock);
+}
+
+static void processCursors(VCursor *const out, VTable const *const input, bool const haveCache, unsigned const threads)
+{
+    /* MARK: output column */
+    uint32_t const cid_rd_filter = addColumn("READ_FILTER", "U8", out);
+    FilterJobs jobs;
+
+    memset(&jobs, 0, sizeof(jobs));
+    jobs.input = input;
+    jobs.haveCache = haveCache;
     openCursor(out, "output");
-    
-    count = rowCount(in, &first, cid_qual);
-    assert(first == 1);
-    pLogMsg(klogInfo, "progress: about to process $(rows) rows", "rows=%lu", count);
+    {
+        InputCursor in;
 
-    /* MARK: Main loop over the input */
-    for (r = 0; r < count; ++r) {
-        int64_t const row = 1 + r;
-        CellData const readfilter = cellData("READ_FILTER", cid_read_filter, row, in);
-        CellData const readstart  = cellData("READ_START" , cid_readstart  , row, in);
-        CellData const readtype   = cellData("READ_TYPE"  , cid_read_type  , row, in);
-        CellData const readlen    = cellData("READ_LEN"   , cid_readlen    , row, in);
-        CellData const quality    = cellData("QUALITY"    , cid_qual       , row, in);
-#if 0
-        if ((row & 0xFFFF) == 0) {
-            pLogMsg(klogInfo, "progress: $(row) rows", "row=%li", row);
+        openInputCursor(&in, input, haveCache);
+        jobs.count = rowCount(in.curs, &jobs.first, in.cid_qual);
+        assert(jobs.first == 1);
+        if (threads > 1) {
+            VCursorRelease(in.curs);
         }
-#endif
-        out_filter = growFilterBuffer(out_filter, &out_filter_count, readfilter.count);
-        computeReadFilter(out_filter, &readfilter, &readtype, &readstart, &readlen, &quality, row);
-        if (haveCache && didReadFilterChange(readfilter.count, out_filter, readfilter.data)) {
-            CellData const pridData = cellData("PRIMARY_ALIGNMENT_ID", cid_pr_id, row, in);
-            int64_t const *prid = pridData.data;
-            size_t i;
-            for (i = 0; i < pridData.count; ++i) {
-                invalidateRow(prid[i]);
+        else {
+            FilterChunk chunk;
+            uint64_t r;
+
+            pLogMsg(klogInfo, "progress: about to process $(rows) rows", "rows=%lu", jobs.count);
+            /* MARK: Main loop over the input */
+            chunkInit(&chunk);
+            for (r = 0; r < jobs.count; r += chunk.count) {
+                chunk.first = jobs.first + r;
+                chunk.count = jobs.count - r < ROWS_PER_CHUNK ? jobs.count - r : ROWS_PER_CHUNK;
+                computeChunk(&chunk, &in, haveCache, &disposition, &invalidated);
+                writeChunk(&chunk, cid_rd_filter, out);
             }
+            chunkWhack(&chunk);
+            VCursorRelease(in.curs);
+            qsort(invalidated.id, invalidated.count, sizeof(invalidated.id[0]), cmp_int64_t);
         }
-        openRow(row, out);
-        writeRow(row, readfilter.count, out_filter, cid_rd_filter, out);
-        commitRow(row, out);
-        closeRow(row, out);
+    }
+    if (threads > 1) {
+        jobs.chunks = (jobs.count + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK;
+        pLogMsg(klogInfo, "progress: about to process $(rows) rows with $(threads) threads", "rows=%lu,threads=%u", jobs.count, threads);
+        processThreaded(out, cid_rd_filter, &jobs, threads);
     }
     LogMsg(klogInfo, "progress: done");
     commitCursor(out);
-    free(out_filter);
     VCursorRelease(out);
-    VCursorRelease(in);
 }
 
 static void copyColumn(char const *const column, char const *const table, char const *const source, char const *const dest, VDBManager *const mgr)
@@ -305,17 +611,17 @@ static void saveCounts(char const *const table, char const *const dest, VDBManag
     /* write new STATS/QUALITY */
     {
         KMDataNode *const node = openChildNodeUpdate(stats, "QUALITY");
-        writeChildNode(node, "PHRED_3", sizeof(dispositionBaseCount[1]), &dispositionBaseCount[1]);
-        writeChildNode(node, "PHRED_30", sizeof(dispositionBaseCount[0]), &dispositionBaseCount[0]);
+        writeChildNode(node, "PHRED_3", sizeof(disposition.baseCount[1]), &disposition.baseCount[1]);
+        writeChildNode(node, "PHRED_30", sizeof(disposition.baseCount[0]), &disposition.baseCount[0]);
         KMDataNodeRelease(node);
     }
     /* record stats about the other changes made */
     {
         KMDataNode *node = openNodeUpdate(tbl, "READ_FILTER_CHANGES");
-        writeChildNode(node, "FILTERED_READS", sizeof(dispositionCount[1]), &dispositionCount[1]);
+        writeChildNode(node, "FILTERED_READS", sizeof(disposition.count[1]), &disposition.count[1]);
 #define writeCounts(NAME, N) \
-    writeChildNode(node, NAME "_BASES", sizeof(dispositionBaseCount[N]), &dispositionBaseCount[N]); \
-    writeChildNode(node, NAME "_READS", sizeof(dispositionCount[N]), &dispositionCount[N]);
+    writeChildNode(node, NAME "_BASES", sizeof(disposition.baseCount[N]), &disposition.baseCount[N]); \
+    writeChildNode(node, NAME "_READS", sizeof(disposition.count[N]), &disposition.count[N]);
 
         writeCounts("ORIGINAL_FILTERED", 2);
         writeCounts("TOTAL_LOW_QUALITY", 3);
@@ -329,87 +635,98 @@ static void saveCounts(char const *const table, char const *const dest, VDBManag
     VTableRelease(tbl);
 }
 
-static void updateCacheColumn1(  char const *const type
-                               , char const *const name
-                               , VCursor *const out
-                               , VCursor const *const in
-                               , VCursor const *const gate
-                               , size_t const changedCount
-                               , int64_t const *const changedRows)
+/* MARK: vdbcache columns, rewritten together in one pass */
+typedef struct CacheColumn {
+    char const *type;
+    char const *name;
+    bool all;           /* take every non-empty row from input, not only changed ones */
+    uint32_t cid_gate;
+    uint32_t cid_out;
+    uint32_t cid_in;
+    uint64_t not_empty;
+    uint64_t invalidate;
+} CacheColumn;
+
+static void updateCacheColumns1(  size_t const ncols
+                                , CacheColumn *const cols
+                                , VCursor *const out
+                                , VCursor const *const in
+                                , VCursor const *const gate
+                                , size_t const changedCount
+                                , int64_t const *const changedRows)
 {
-    uint32_t const cid_gate = addColumn(name, type, gate);
-    uint32_t const cid_out = addColumn(name, type, out);
-    uint32_t const cid_in = addColumn2(strlen(name) - 6, name, type, in);
-
     int64_t first = 0;
     uint64_t count = 0;
     uint64_t r;
     size_t i = 0;
+    size_t c;
 
-    uint64_t not_empty = 0;
-    uint64_t invalidate = 0;
+    for (c = 0; c < ncols; ++c) {
+        CacheColumn *const col = &cols[c];
+        col->cid_gate = addColumn(col->name, col->type, gate);
+        col->cid_out = addColumn(col->name, col->type, out);
+        col->cid_in = addColumn2(strlen(col->name) - 6, col->name, col->type, in);
+    }
 
     openCursor(in, "input");
     openCursor(out, "output");
     openCursor(gate, "vdbcache");
 
-    count = rowCount(gate, &first, cid_gate);
-    pLogMsg(klogInfo, "progress: about to process $(rows) rows for $(col)", "rows=%lu,col=%s", count, name);
+    count = rowCount(gate, &first, 0);
+    pLogMsg(klogInfo, "progress: about to process $(rows) rows for $(cols) columns", "rows=%lu,cols=%zu", count, ncols);
 
     for (r = 0; r < count; ++r) {
         int64_t const row = first + r;
-        CellData const gated = cellData(name, cid_gate, row, gate);
-        CellData data = gated;
-        if (gated.count > 0) {
-            bool invalidated = true;
-            if (changedRows) {
-                while (i < changedCount && changedRows[i] < row) {
-                    ++i;
-                }
-                if (i < changedCount && changedRows[i] == row) {
-                    invalidated = true;
-                    ++i;
-                }
-                else
-                    invalidated = false;
-            }
-            if (invalidated) {
-                CellData const orig = cellData(name, cid_in, row, in);
+        bool changed = false;
 
-                assert(gated.count == orig.count);
-                data = orig;
-                ++invalidate;
-            }
-            ++not_empty;
+        while (i < changedCount && changedRows[i] < row) {
+            ++i;
         }
-#if 0
-        if ((row & 0xFFFF) == 0) {
-            pLogMsg(klogInfo, "progress: $(row) rows for $(col)", "row=%li,col=%s", row, name);
+        if (i < changedCount && changedRows[i] == row) {
+            changed = true;
+            ++i;
         }
-#endif
         if (row == first)
             setRow(first, out);
 
         openRow(row, out);
-        writeCell(row, &data, cid_out, out);
+        for (c = 0; c < ncols; ++c) {
+            CacheColumn *const col = &cols[c];
+            CellData const gated = cellData(col->name, col->cid_gate, row, gate);
+            CellData data = gated;
+            if (gated.count > 0) {
+                if (col->all || changed) {
+                    CellData const orig = cellData(col->name, col->cid_in, row, in);
+
+                    assert(gated.count == orig.count);
+                    data = orig;
+                    ++col->invalidate;
+                }
+                ++col->not_empty;
+            }
+            writeCell(row, &data, col->cid_out, out);
+        }
         commitRow(row, out);
         closeRow(row, out);
     }
-    pLogMsg(klogInfo, "column $(name); rows: $(rows); non-empty rows: $(notempty); updated rows: $(updated);", "name=%s,rows=%lu,notempty=%lu,updated=%lu", name, count, not_empty, invalidate);
-    pLogMsg(klogInfo, "progress: done with $(col)", "col=%s", name);
+    for (c = 0; c < ncols; ++c) {
+        CacheColumn const *const col = &cols[c];
+        pLogMsg(klogInfo, "column $(name); rows: $(rows); non-empty rows: $(notempty); updated rows: $(updated);", "name=%s,rows=%lu,notempty=%lu,updated=%lu", col->name, count, col->not_empty, col->invalidate);
+    }
+    LogMsg(klogInfo, "progress: done with vdbcache columns");
     commitCursor(out);
     VCursorRelease(in);
     VCursorRelease(out);
     VCursorRelease(gate);
 }
 
-static void updateCacheColumn(  char const *const type
-                              , char const *const name
-                              , VTable *const outT
-                              , VTable const *const inT
-                              , VTable const *const gateT
-                              , size_t const changedCount
-                              , int64_t const *const changedRows)
+static void updateCacheColumns(  size_t const ncols
+                               , CacheColumn *const cols
+                               , VTable *const outT
+                               , VTable const *const inT
+                               , VTable const *const gateT
+                               , size_t const changedCount
+                               , int64_t const *const changedRows)
 {
     VCursor *out = NULL;
     VCursor const *in = NULL;
@@ -435,7 +752,7 @@ static void updateCacheColumn(  char const *const type
             exit(EX_NOINPUT);
         }
     }
-    updateCacheColumn1(type, name, out, in, gate, changedCount, changedRows);
+    updateCacheColumns1(ncols, cols, out, in, gate, changedCount, changedRows);
 }
 
 static void updateCacheTable(  VTable *const out
@@ -444,20 +761,18 @@ static void updateCacheTable(  VTable *const out
                              , size_t const changedCount
                              , int64_t const *const changedRows)
 {
-    if (changedCount > 0) {
-        static char const *columns[] = {
-            "U8", "RD_FILTER_CACHE",
-            "U32", "SAM_FLAGS_CACHE",
-            NULL
-        };
-        char const *const *col;
-        for (col = columns; *col; ) {
-            char const *const type = *col++;
-            char const *const name = *col++;
-            updateCacheColumn(type, name, out, in, gate, changedCount, changedRows);
-        }
-    }
-    updateCacheColumn("I32", "TEMPLATE_LEN_CACHE", out, in, gate, 0, NULL);
+    CacheColumn columns[] = {
+        { "U8", "RD_FILTER_CACHE", false },
+        { "U32", "SAM_FLAGS_CACHE", false },
+        { "I32", "TEMPLATE_LEN_CACHE", true },
+    };
+    size_t const ncols = sizeof(columns) / sizeof(columns[0]);
+
+    /* without changed rows only TEMPLATE_LEN_CACHE is updated */
+    if (changedCount > 0)
+        updateCacheColumns(ncols, columns, out, in, gate, changedCount, changedRows);
+    else
+        updateCacheColumns(1, columns + ncols - 1, out, in, gate, 0, NULL);
     VTableRelease(out);
     VTableRelease(in);
     VTableRelease(gate);
@@ -537,31 +852,17 @@ static int cmp_int64_t(void const *A, void const *B)
     return a < b ? -1 : b < a ? 1 : 0;
 }
 
+/* invalidated rows are sorted by now */
 static void updateCache(char const *const cachePath, char const *const inPath, VDBManager *const mgr)
 {
-    if (invalidated < 0)
-        updateCache2(cachePath, inPath, 0, NULL, mgr);
-    else {
-        off_t const fsize = invalidated < 0 ? 0 : lseek(invalidated, 0, SEEK_END);
-        if (fsize % sizeof(int64_t) == 0) {
-            void *const map = mmap(NULL, fsize, PROT_READ|PROT_WRITE, MAP_FILE | MAP_PRIVATE, invalidated, 0);
-            close(invalidated);
-            if (map) {
-                qsort(map, fsize / sizeof(int64_t), sizeof(int64_t), cmp_int64_t);
-                updateCache2(cachePath, inPath, fsize / sizeof(int64_t), map, mgr);
-                munmap(map, fsize);
-                return;
-            }
-            LogMsg(klogFatal, "failed to map invalidated rows file");
-            exit(EX_IOERR);
-        }
-        LogMsg(klogFatal, "size of invalidated rows file is not a whole number of row IDs");
-        exit(EX_SOFTWARE);
-    }
+    updateCache2(cachePath, inPath, invalidated.count, invalidated.id, mgr);
+    free(invalidated.id);
+    memset(&invalidated, 0, sizeof(invalidated));
 }
 
 static char const *temporaryDirectory(Args *const args);
 static char const *absolutePath(char const *const path, char const *const wd);
+static unsigned getThreads(Args *const args);
 
 /* MARK: the main action starts here */
 void main_1(int argc, char *argv[])
@@ -572,6 +873,7 @@ void main_1(int argc, char *argv[])
         char const *const input = getParameter(args, wd);
         char const *const cachePath = absolutePath(getOptArgValue(OPT_CACHE, args), wd);
         bool const isActiveCache = checkForActiveCache(cachePath, input);
+        unsigned const threads = getThreads(args);
         char const *const tempDir = temporaryDirectory(args); // also cd's to temp dir
         VDBManager *const mgr = manager();
         VSchema *const schema = makeSchema(mgr); // this schema will get a copy of the input's schema
@@ -583,12 +885,10 @@ void main_1(int argc, char *argv[])
         if (isActiveCache) {
             pLogMsg(klogWarn, "vdbcache should NOT be named $(inpath).vdbcache; rename it or put it in a different directory!!!", "inpath=%s", input);
         }
-        processTables(out, in, cachePath != NULL);
+        processTables(out, in, cachePath != NULL, threads);
         copyColumn("RD_FILTER", noDb ? NULL : "SEQUENCE", TEMP_MAIN_OBJECT_NAME, input, mgr);
         saveCounts(noDb ? NULL : "SEQUENCE", input, mgr);
         if (cachePath) {
-            if (invalidated >= 0)
-                fsync(invalidated);
             updateCache(cachePath, input, mgr);
         }
 
@@ -607,10 +907,9 @@ void main_1(int argc, char *argv[])
     exit(EX_TEMPFAIL);
 }
 
-static void processTables(VTable *const output, VTable const *const input, bool const haveCache)
+static void processTables(VTable *const output, VTable const *const input, bool const haveCache, unsigned const threads)
 {
     VCursor *out = NULL;
-    VCursor const *in = NULL;
     {
         rc_t const rc = VTableCreateCursorWrite(output, &out, kcmInsert);
         if (rc != 0) {
@@ -618,15 +917,8 @@ static void processTables(VTable *const output, VTable const *const input, bool
             exit(EX_CANTCREAT);
         }
     }
-    {
-        rc_t const rc = VTableCreateCursorRead(input, &in);
-        if (rc != 0) {
-            LogErr(klogFatal, rc, "Failed to create input cursor!");
-            exit(EX_NOINPUT);
-        }
-    }
+    processCursors(out, input, haveCache, threads);
     VTableRelease(input);
-    processCursors(out, in, haveCache);
     VTableRelease(output);
 }
 
@@ -676,19 +968,6 @@ static VTable *createOutput(  Args *const args
     return out;
 }
 
-static uint8_t *growFilterBuffer(uint8_t *out_filter, size_t *const out_filter_count, size_t needed)
-{
-    if (*out_filter_count < needed) {
-        free(out_filter);
-        *out_filter_count = needed;
-        pLogMsg(klogInfo, "increasing max read count to $(max)", "max=%zu", needed);
-        out_filter = malloc(needed * sizeof(out_filter[0]));
-        if (out_filter == NULL)
-            OUT_OF_MEMORY();
-    }
-    return out_filter;
-}
-
 static void test(void)
 {
     uint8_t qual[30];
@@ -746,11 +1025,13 @@ static void test(void)
 
 static char const *temp_help[] = { "temp directory to use for scratch space, default: $TMPDIR or $TEMPDIR or $TEMP or $TMP or /tmp", NULL };
 static char const *vdbcache_help[] = { "location of .vdbcache to update", NULL };
+static char const *threads_help[] = { "number of threads computing the filter, default: 1", NULL };
 
 /* MARK: Options array */
 static OptDef Options [] = {
     { "temp", "t", NULL, temp_help, 1, true, false },
-    { "vdbcache", "", NULL, vdbcache_help, 1, true, false }
+    { "vdbcache", "", NULL, vdbcache_help, 1, true, false },
+    { "threads", "", NULL, threads_help, 1, true, false }
 };
 
 /* MARK: Mostly boilerplate from here */
@@ -796,6 +1077,7 @@ rc_t CC Usage ( const Args *args )
     KOutMsg ("Options:\n");
     HelpOptionLine(Options[0].aliases, Options[0].name, "path", Options[0].help);
     HelpOptionLine(Options[1].aliases, Options[1].name, "path", Options[1].help);
+    HelpOptionLine(Options[2].aliases, Options[2].name, "count", Options[2].help);
 
     KOutMsg ("Common options:\n");
     HelpOptionsStandard ();
@@ -844,6 +1126,18 @@ static char const *getOptArgValue(int opt, Args *const args)
     return NULL;
 }
 
+static unsigned getThreads(Args *const args)
+{
+    char const *const value = getOptArgValue(OPT_THREADS, args);
+    int threads = value ? atoi(value) : 1;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    return (unsigned)threads;
+}
+
 static char const *absolutePath(char const *const path, char const *const wd)
 {
     if (path == NULL) return NULL;
@@ -35,6 +35,9 @@
 #include <kdb/manager.h>
 #include <kdb/meta.h>
 #include <kfs/directory.h>
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 #include <klib/log.h>
 #include <klib/out.h>
 #include <klib/rc.h>
@@ -65,7 +68,6 @@ static uint32_t addColumn( char const *const name
                          , char const *const type
                          , VCursor const *const curs);
 static void openCursor(VCursor const *const curs, char const *const name);
-static uint8_t *growFilterBuffer(uint8_t *const out_filter, size_t *const out_filter_count, size_t needed);
 static void openRow(int64_t const row, VCursor const *const out);
 static void writeRow(int64_t const row
                     , uint32_t const reads
@@ -94,7 +96,7 @@ static VTable const *dbOpenTable(char const *const name
 static void tblSchemaInfo(VTable const *tbl, char const **name, VSchema *schema);
 static void dbSchemaInfo(VDatabase const *db, char const **name, VSchema *schema);
 static VTable const *openInput(char const *input, VDBManager const *mgr, bool *noDb, char const **schemaType, VSchema *schema);
-static void processTables(VTable *const output, VTable const *const input, bool const haveCache);
+static void processTables(VTable *const output, VTable const *const input, bool const haveCache, unsigned const threads);
 static VTable *createOutput(Args *const args, VDBManager *const mgr, bool noDb, char const *schemaType, VSchema const *schema);
 static VSchema *makeSchema(VDBManager *mgr);
 
@@ -36,6 +36,9 @@
 #include <kfs/directory.h>
 #include <kfs/file.h>
 #include <kfs/md5.h>
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -104,13 +107,39 @@ int recurse = 0;
 int test = 0;
 int clobber_protections = 0;
 int followlinks = 1;
+uint32_t threads = 1;
 
 rc_t CopyDirectoryToExistingDirectory( const KDirectory *top, const char *inname, KDirectory *targettop, const char *outname );
 rc_t CopyFileToFile( const KDirectory *top, const char *inname, KDirectory *targettop, const char *outname );
+rc_t ScheduleCopyFile( const KDirectory *top, const char *inname, KDirectory *targettop, const char *outname );
 
-#define BUFSIZE 8192
+#define BUFSIZE ( 1024 * 1024 )
+#define MAX_THREADS 64
 
-char buffer[BUFSIZE];
+/*
+ * With --threads > 1 files are handed to a pool of workers
+ * instead of being copied right away; the directory walk
+ * only waits when the queue is full.
+ */
+typedef struct CopyJob CopyJob;
+struct CopyJob {
+  CopyJob *next;
+  const KDirectory *top;
+  KDirectory *targettop;
+  char *inname;
+  char *outname;
+};
+
+static struct {
+  KLock *lock;
+  KCondition *cond;
+  CopyJob *head;
+  CopyJob *tail;
+  uint32_t queued;
+  bool done;
+  uint32_t count;
+  KThread *worker[MAX_THREADS];
+} copyq;
 
 /*
  * out is a pre-allocated buffer.
@@ -215,9 +244,10 @@ rc_t CopyDirectoryFiles( const KDirectory *source, KDirectory *dest ) {
     if (test) {
       fprintf(stderr, "Will copy %s\n", name);
     } else {
-      CopyFileToFile( source, name, dest, (char *)name );
+      ScheduleCopyFile( source, name, dest, name );
     }
   }
+  KNamelistRelease(list);
   return 0;
 }
 
@@ -275,6 +305,7 @@ rc_t CopyFileToFile( const KDirectory *top, const char *inname, KDirectory *targ
   uint32_t mode = 0;
   uint32_t pathtype = 0;
   uint32_t failed = 0;
+  char *buffer = NULL;
 
   if (PathIsMD5File(top, inname)) {
     /* Skip it */
@@ -331,6 +362,12 @@ rc_t CopyFileToFile( const KDirectory *top, const char *inname, KDirectory *targ
     failed = rc;
     goto FAIL;
   }
+
+  buffer = malloc( BUFSIZE );
+  if (buffer == NULL) {
+    failed = RC( rcExe, rcFile, rcCopying, rcMemory, rcExhausted );
+    goto FAIL;
+  }
     
   {  
     uint64_t rpos = 0;
@@ -373,6 +410,8 @@ rc_t CopyFileToFile( const KDirectory *top, const char *inname, KDirectory *targ
   /* Success also, check the value of failed to see if failed */
  FAIL:
 
+  free(buffer);
+
   if (NULL != md5out) {
     KFileRelease((KFile *)md5out);
     md5out = NULL;
@@ -399,6 +438,125 @@ rc_t CopyFileToFile( const KDirectory *top, const char *inname, KDirectory *targ
 
 }  
 
+static
+rc_t CC CopyWorker( const KThread *self, void *data )
+{
+  rc_t rc = KLockAcquire( copyq.lock );
+  while (rc == 0) {
+    CopyJob *job;
+    while (copyq.head == NULL && !copyq.done)
+      KConditionWait( copyq.cond, copyq.lock );
+    job = copyq.head;
+    if (job == NULL)
+      break;
+    copyq.head = job->next;
+    if (copyq.head == NULL)
+      copyq.tail = NULL;
+    KLockUnlock( copyq.lock );
+
+    CopyFileToFile( job->top, job->inname, job->targettop, job->outname );
+
+    KDirectoryRelease( job->top );
+    KDirectoryRelease( job->targettop );
+    free( job );
+
+    rc = KLockAcquire( copyq.lock );
+    if (rc == 0) {
+      --copyq.queued;
+      KConditionBroadcast( copyq.cond );
+    }
+  }
+  if (rc == 0)
+    KLockUnlock( copyq.lock );
+  return rc;
+}
+
+rc_t StartCopyWorkers( void )
+{
+  rc_t rc = 0;
+
+  memset( &copyq, 0, sizeof copyq );
+  if (threads <= 1)
+    return 0;
+
+  rc = KLockMake( &copyq.lock );
+  if (rc == 0)
+    rc = KConditionMake( &copyq.cond );
+  for ( ; rc == 0 && copyq.count < threads; ++copyq.count)
+    rc = KThreadMake( &copyq.worker[copyq.count], CopyWorker, NULL );
+  if (rc != 0)
+    LOGERR ( klogInt, rc, "can't start copy threads" );
+  return rc;
+}
+
+/* waits for all queued copies */
+void FinishCopyWorkers( void )
+{
+  uint32_t i;
+
+  if (copyq.lock != NULL && KLockAcquire( copyq.lock ) == 0) {
+    copyq.done = true;
+    KConditionBroadcast( copyq.cond );
+    KLockUnlock( copyq.lock );
+  }
+  for (i = 0; i < copyq.count; i++) {
+    KThreadWait( copyq.worker[i], NULL );
+    KThreadRelease( copyq.worker[i] );
+  }
+  KConditionRelease( copyq.cond );
+  KLockRelease( copyq.lock );
+  memset( &copyq, 0, sizeof copyq );
+}
+
+/*
+ * copies the file right away without workers,
+ * otherwise queues it, keeping both directories referenced.
+ */
+rc_t ScheduleCopyFile( const KDirectory *top, const char *inname, KDirectory *targettop, const char *outname )
+{
+  rc_t rc;
+  size_t inlen, outlen;
+  CopyJob *job;
+
+  if (copyq.count == 0)
+    return CopyFileToFile( top, inname, targettop, outname );
+
+  inlen = strlen(inname) + 1;
+  outlen = strlen(outname) + 1;
+  job = malloc( sizeof *job + inlen + outlen );
+  if (job == NULL)
+    return RC( rcExe, rcFile, rcCopying, rcMemory, rcExhausted );
+  job->next = NULL;
+  job->inname = (char *)(job + 1);
+  job->outname = job->inname + inlen;
+  memcpy( job->inname, inname, inlen );
+  memcpy( job->outname, outname, outlen );
+
+  KDirectoryAddRef( top );
+  KDirectoryAddRef( targettop );
+  job->top = top;
+  job->targettop = targettop;
+
+  rc = KLockAcquire( copyq.lock );
+  if (rc != 0) {
+    KDirectoryRelease( top );
+    KDirectoryRelease( targettop );
+    free( job );
+    return rc;
+  }
+  while (copyq.queued >= 4 * copyq.count)
+    KConditionWait( copyq.cond, copyq.lock );
+  if (copyq.tail != NULL)
+    copyq.tail->next = job;
+  else
+    copyq.head = job;
+  copyq.tail = job;
+  ++copyq.queued;
+  KConditionBroadcast( copyq.cond );
+  KLockUnlock( copyq.lock );
+  return 0;
+}
+
 /*
  * copies top/inname (a directory) 
  * to targettop/outname, i.e. creates outname as a copy of that directory.
@@ -449,6 +607,7 @@ rc_t CopyDirectoryToExistingDirectory( const KDirectory *top, const char *inname
 #define OPTION_RECURSE  "recursive"
 #define OPTION_PRESERVE "preserve"
 #define OPTION_TEST     "test"
+#define OPTION_THREADS  "threads"
 #define ALIAS_FORCE     "f"
 #define ALIAS_RECURSE   "r"
 #define ALIAS_PRESERVE  "p"
@@ -459,6 +618,7 @@ static const char * recurse_usage[]  = { "Recurses over source directories",
                                          "(directories are ignored otherwise).", NULL };
 static const char * preserve_usage[] = { "force replacement of existing modes on files", " and directories", NULL };
 static const char * test_usage[]     = { "?", NULL };
+static const char * threads_usage[]  = { "number of files to copy concurrently, default 1", NULL };
 
 
 OptDef Options[] = 
@@ -466,7 +626,8 @@ OptDef Options[] =
     { OPTION_FORCE,    ALIAS_FORCE,    NULL, force_usage,    0, false, false },
     { OPTION_RECURSE,  ALIAS_RECURSE,  NULL, recurse_usage,  0, false, false },
     { OPTION_PRESERVE, ALIAS_PRESERVE, NULL, preserve_usage, 0, false, false },
-    { OPTION_TEST,     ALIAS_TEST,     NULL, test_usage,     0, false, false }
+    { OPTION_TEST,     ALIAS_TEST,     NULL, test_usage,     0, false, false },
+    { OPTION_THREADS,  NULL,           NULL, threads_usage,  1, true,  false }
 };
 
 
@@ -506,6 +667,7 @@ rc_t CC Usage (const Args * args)
     HelpOptionLine (ALIAS_PRESERVE, OPTION_PRESERVE, NULL, preserve_usage);
     HelpOptionLine (ALIAS_RECURSE, OPTION_RECURSE, NULL, recurse_usage);
     HelpOptionLine (ALIAS_TEST, OPTION_TEST, NULL, test_usage);
+    HelpOptionLine (NULL, OPTION_THREADS, "count", threads_usage);
 
     HelpOptionsStandard ();
 
@@ -572,7 +734,7 @@ rc_t run (Args * args)
                 pathtype = KDirectoryPathType (top, "%s", sourcename);
                 if ((pathtype & ~kptAlias) == kptFile)
                 {
-                    CopyFileToFile (top, source, targettop, sourcename);
+                    ScheduleCopyFile (top, source, targettop, sourcename);
                 }
                 else if ((pathtype & ~kptAlias) == kptDir)
                 {
@@ -691,7 +853,29 @@ rc_t CC KMain ( int argc, char *argv [] )
 
             clobber_protections = (pcount > 0);
 
-            rc  = run (args);
+            rc = ArgsOptionCount (args, OPTION_THREADS, &pcount);
+            if (rc)
+                break;
+
+            if (pcount > 0)
+            {
+                const char * value;
+
+                rc = ArgsOptionValue (args, OPTION_THREADS, 0, (const void **)&value);
+                if (rc)
+                    break;
+
+                threads = strtoul (value, NULL, 10);
+                if (threads < 1)
+                    threads = 1;
+                else if (threads > MAX_THREADS)
+                    threads = MAX_THREADS;
+            }
+
+            rc = StartCopyWorkers ();
+            if (rc == 0)
+                rc = run (args);
+            FinishCopyWorkers ();
 
         }while (0);
 
@@ -36,6 +36,8 @@
 
 #include <kfs/mmap.h>
 
+#include <kproc/thread.h>
+
 #include <sysalloc.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,6 +48,9 @@
 #define MESSAGE_LIST_BLOCK_SIZE 64
 #define PARSE_ERROR RC ( rcAlign, rcFile, rcParsing, rcFormat, rcIncorrect )
 #define MANDATORY_DATA_FIELDS_NUMBER 8
+#define ERROR_LIST_BLOCK_SIZE 16
+#define DEFAULT_PARSE_THREADS 8
+#define DEFAULT_PARSE_CHUNK_SIZE ( 4 * 1024 * 1024 )
 
 /*=============== VcfDataLine ================*/
 static
@@ -88,6 +93,78 @@ rc_t VcfDataLineWhack(VcfDataLine* self)
     return rc;
 }
 
+static
+bool ParseNumber(const String* value, uint64_t max, uint64_t* number)
+{   /* digits only, with an optional '+' */
+    const char* p = value->addr;
+    const char* end = p + value->size;
+    uint64_t val = 0;
+
+    if (p < end && *p == '+')
+        ++p;
+    if (p == end)
+        return false;
+    for (; p < end; ++p)
+    {
+        if (*p < '0' || *p > '9')
+            return false;
+        val = val * 10 + (*p - '0');
+        if (val > max)
+            return false;
+    }
+    *number = val;
+    return true;
+}
+
+/* store the next data item of the line, returns an error message or NULL */
+static
+const char* VcfDataLineAddItem(VcfDataLine* self, const String* value)
+{
+    const char* error = NULL;
+    uint64_t val;
+
+    switch (self->lastPopulated)
+    {
+    case 0: /*String      chromosome; */
+        self->chromosome = *value;
+        break;
+    case 1: /*uint32_t    position;  */
+        if (ParseNumber(value, UINT32_MAX, &val))
+            self->position = (uint32_t)val;
+        else
+            error = "invalid numeric value for 'position'";
+        break;
+    case 2: /*String      id; */
+        self->id = *value;
+        break;
+    case 3: /*String      refBases; */
+        self->refBases = *value;
+        break;
+    case 4: /*String      altBases;  */
+        self->altBases = *value;
+        break;
+    case 5: /*uint8_t     quality;  */
+        if (ParseNumber(value, UINT8_MAX, &val))
+            self->quality = (uint8_t)val;
+        else
+            error = "invalid numeric value for 'quality'";
+        break;
+    case 6: /*String      filter; */
+        self->filter = *value;
+        break;
+    case 7: /*String      info; */ 
+        self->info = *value;
+        break;
+    default: /* add to the genotypeFields */
+        if (VNamelistAppendString(self->genotypeFields, value) != 0)
+            error = "failed to append a genotype field";
+        break;
+    }
+    
+    ++self->lastPopulated;
+    return error;
+}
+
 /*=============== VcfReader ================*/
 
 struct VcfReader
@@ -95,8 +172,12 @@ struct VcfReader
     char* input;
     size_t inputSize;
     size_t curPos;
+    size_t parseEnd; /* the bison parser sees the meta/header lines and the first data line only */
     VCFParseBlock pb;
     
+    uint32_t threads;
+    size_t chunkSize;
+    
     Vector lines;  /* the element type is VcfDataLine* */
     
     VNamelist* messages;
@@ -118,6 +199,8 @@ static
 rc_t VcfReaderInit(VcfReader* self)
 {
     self->input = NULL;
+    self->threads = DEFAULT_PARSE_THREADS;
+    self->chunkSize = DEFAULT_PARSE_CHUNK_SIZE;
     
     self->pb.self           = self;
     self->pb.input          = Input;
@@ -178,21 +261,24 @@ rc_t VcfReaderMake( const struct VcfReader **pself)
 static size_t Input(VCFParseBlock* pb, char* buf, size_t maxSize)
 {
     VcfReader* self = (VcfReader*)(pb->self);
-    size_t ret = string_copy(buf, maxSize, self->input + self->curPos, self->inputSize - self->curPos);
+    size_t ret = string_copy(buf, maxSize, self->input + self->curPos, self->parseEnd - self->curPos);
     
     self->curPos += ret;
     
     return ret;
 }
-static void Error(VCFParseBlock* pb, const char* message)
+static void AddMessage(VcfReader* self, size_t line_no, size_t column_no, const char* message)
 {
     char buf[1024];
-    VcfReader* self = (VcfReader*)(pb->self);
     string_printf(buf, sizeof(buf), NULL, 
                   "line %d column %d: %s", 
-                  pb->lastToken->line_no, pb->lastToken->column_no, message);
+                  line_no, column_no, message);
     VNamelistAppend(self->messages, buf);
 }
+static void Error(VCFParseBlock* pb, const char* message)
+{
+    AddMessage((VcfReader*)(pb->self), pb->lastToken->line_no, pb->lastToken->column_no, message);
+}
 
 static void AddMetaLine(VCFParseBlock* pb, VCFToken* key, VCFToken* value)
 {
@@ -240,8 +326,10 @@ static void OpenDataLine(VCFParseBlock* pb)
 }
 static void DataItem(VCFParseBlock* pb, VCFToken* value)
 {
-    VcfReader* self = (VcfReader*)(pb->self);
+    VcfReader* self;
     VcfDataLine* line;
+    String item;
+    const char* error;
 
     assert(pb);
     
@@ -251,67 +339,10 @@ static void DataItem(VCFParseBlock* pb, VCFToken* value)
     line = (VcfDataLine*) VectorLast( & self->lines );
     assert(line);
     
-    #define SAVE_TOKEN(field) StringInit( field, self->input + value->tokenStart, value->tokenLength, (uint32_t)string_size(value->tokenText) )
-
-    switch (line->lastPopulated)
-    {
-    case 0: /*String      chromosome; */
-        SAVE_TOKEN(&line->chromosome);
-        break;
-        
-    case 1: /*uint32_t    position;  */
-        {   
-            char* endptr;
-            long val = strtol(value->tokenText, &endptr, 10);
-            if (*endptr || val < 0 || val > UINT32_MAX)
-                Error(pb, "invalid numeric value for 'position'");
-            else
-                line->position = (uint32_t)val;
-                
-            break;
-        }
-    case 2: /*String      id; */
-        SAVE_TOKEN(&line->id);
-        break;
-    case 3: /*String      refBases; */
-        SAVE_TOKEN(&line->refBases);
-        break;
-    case 4: /*String      altBases;  */
-        SAVE_TOKEN(&line->altBases);
-        break;
-    case 5: /*uint8_t     quality;  */
-        {   
-            char* endptr;
-            long val = strtol(value->tokenText, &endptr, 10);
-            if (*endptr || val < 0 || val > UINT8_MAX)
-                Error(pb, "invalid numeric value for 'quality'");
-            else
-                line->quality = (uint32_t)val;
-                
-            break;
-        }
-    case 6: /*String      filter; */
-        SAVE_TOKEN(&line->filter);
-        break;
-    case 7: /*String      info; */ 
-        SAVE_TOKEN(&line->info);
-        break;
-    default: /* add to the genotypeFields */
-        {
-            rc_t rc = 0;
-            String f;
-            SAVE_TOKEN(&f);
-            rc = VNamelistAppendString(line->genotypeFields, &f);
-            if (rc != 0)
-            {
-                SET_RC_FILE_FUNC_LINE(rc);
-                Error(pb, "failed to append a genotype field");
-            }
-            break;
-        }
-    }
-    
-    ++line->lastPopulated;
+    StringInit( &item, self->input + value->tokenStart, value->tokenLength, (uint32_t)string_size(value->tokenText) );
+    error = VcfDataLineAddItem(line, &item);
+    if (error != NULL)
+        Error(pb, error);
 }
 static void CloseDataLine(VCFParseBlock* pb)
 {   
@@ -336,6 +367,250 @@ static void CloseDataLine(VCFParseBlock* pb)
 }
 
 
+/*=============== data line scanner ================*/
+/* Data lines after the first one are not given to the bison parser: they are split 
+   into chunks at line boundaries, and each chunk is scanned for tabs and line ends on a thread of its own.
+   Lines and messages of the chunks are collected in input order. */
+
+typedef struct VcfScanError
+{
+    size_t line;    /* 0-based within the chunk */
+    size_t column;
+    const char* message;
+} VcfScanError;
+
+typedef struct VcfScanChunk
+{
+    KThread* thread;
+    const char* start;
+    const char* end;
+    
+    Vector lines;  /* the element type is VcfDataLine* */
+    size_t lineCount;
+    
+    VcfScanError* errors;
+    uint32_t errorCount;
+    uint32_t errorMax;
+    
+    rc_t rc;
+} VcfScanChunk;
+
+static
+rc_t VcfScanChunkError(VcfScanChunk* self, size_t column, const char* message)
+{
+    if (self->errorCount == self->errorMax)
+    {
+        uint32_t newMax = self->errorMax + ERROR_LIST_BLOCK_SIZE;
+        VcfScanError* errors = realloc(self->errors, newMax * sizeof(VcfScanError));
+        if (errors == NULL)
+            return RC ( rcAlign, rcFile, rcParsing, rcMemory, rcExhausted );
+        self->errors = errors;
+        self->errorMax = newMax;
+    }
+    self->errors[self->errorCount].line = self->lineCount;
+    self->errors[self->errorCount].column = column;
+    self->errors[self->errorCount].message = message;
+    ++self->errorCount;
+    return 0;
+}
+
+static
+rc_t VcfScanDataLine(VcfScanChunk* self, const char* start, size_t size)
+{
+    VcfDataLine* line = NULL;
+    const char* end = start + size;
+    const char* p = start;
+    rc_t rc;
+    
+    if (size > 0 && *start == '#')
+        return VcfScanChunkError(self, 1, "meta or header line among the data lines");
+    
+    rc = VcfDataLineMake(&line);
+    if (rc == 0)
+    {
+        rc = VectorAppend(&self->lines, NULL, line);
+        if (rc != 0)
+            VcfDataLineWhack(line);
+    }
+    
+    while (rc == 0 && p < end)
+    {   /* consecutive tabs do not make empty items */
+        const char* tab = memchr(p, '\t', end - p);
+        const char* itemEnd = tab == NULL ? end : tab;
+        if (itemEnd > p)
+        {
+            String item;
+            const char* error;
+            StringInit(&item, p, itemEnd - p, (uint32_t)(itemEnd - p));
+            error = VcfDataLineAddItem(line, &item);
+            if (error != NULL)
+                rc = VcfScanChunkError(self, p - start + 1, error);
+        }
+        p = itemEnd + 1;
+    }
+    
+    if (rc == 0 && line->lastPopulated < MANDATORY_DATA_FIELDS_NUMBER)
+        rc = VcfScanChunkError(self, size + 1, "one or more of the 8 mandatory columns are missing");
+    
+    return rc;
+}
+
+static
+rc_t CC VcfScanChunkRun(const KThread* thread, void* data)
+{
+    VcfScanChunk* self = (VcfScanChunk*)data;
+    const char* p = self->start;
+    rc_t rc = 0;
+    
+    while (rc == 0 && p < self->end)
+    {
+        const char* nl = memchr(p, '\n', self->end - p);
+        const char* lineEnd = nl == NULL ? self->end : nl;
+        size_t size = lineEnd - p;
+        
+        if (size > 0 && p[size - 1] == '\r')
+            --size;
+        rc = VcfScanDataLine(self, p, size);
+        
+        ++self->lineCount;
+        p = lineEnd + 1;
+    }
+    
+    self->rc = rc;
+    return rc;
+}
+
+static
+rc_t VcfReaderScanDataLines(VcfReader* self)
+{
+    const char* start = self->input + self->parseEnd;
+    const char* end = self->input + self->inputSize;
+    size_t size = end - start;
+    uint32_t chunkCount = self->threads;
+    VcfScanChunk* chunks;
+    rc_t rc = 0;
+    uint32_t i;
+    
+    if (size == 0)
+        return 0;
+    
+    if (self->chunkSize > 0 && size / self->chunkSize + 1 < chunkCount)
+        chunkCount = (uint32_t)(size / self->chunkSize + 1);
+    if (chunkCount == 0)
+        chunkCount = 1;
+    
+    chunks = calloc(chunkCount, sizeof(VcfScanChunk));
+    if (chunks == NULL)
+        return RC ( rcAlign, rcFile, rcParsing, rcMemory, rcExhausted );
+    
+    /* split at line boundaries */
+    for (i = 0; i < chunkCount; ++i)
+    {
+        chunks[i].start = i == 0 ? start : chunks[i - 1].end;
+        if (i + 1 == chunkCount)
+            chunks[i].end = end;
+        else
+        {
+            const char* p = start + size / chunkCount * (i + 1);
+            if (p <= chunks[i].start)
+                chunks[i].end = chunks[i].start;
+            else
+            {
+                const char* nl = memchr(p - 1, '\n', end - p + 1);
+                chunks[i].end = nl == NULL ? end : nl + 1;
+            }
+        }
+        VectorInit( &chunks[i].lines, 0, LINE_VECTOR_BLOCK_SIZE );
+    }
+    
+    if (chunkCount == 1)
+        rc = VcfScanChunkRun(NULL, &chunks[0]);
+    else
+    {
+        for (i = 0; i < chunkCount; ++i)
+        {
+            rc_t rc2 = KThreadMake(&chunks[i].thread, VcfScanChunkRun, &chunks[i]);
+            if (rc2 != 0)
+            {   /* scan it on this thread then */
+                chunks[i].thread = NULL;
+                VcfScanChunkRun(NULL, &chunks[i]);
+            }
+        }
+        for (i = 0; i < chunkCount; ++i)
+        {
+            if (chunks[i].thread != NULL)
+            {
+                rc_t status;
+                KThreadWait(chunks[i].thread, &status);
+                KThreadRelease(chunks[i].thread);
+            }
+        }
+    }
+    
+    /* collect lines and messages in input order */
+    {
+        size_t line_no = 1;
+        const char* p;
+        for (p = self->input; p < start; ++p)
+        {
+            if (*p == '\n')
+                ++line_no;
+        }
+        
+        for (i = 0; i < chunkCount; ++i)
+        {
+            VcfScanChunk* chunk = &chunks[i];
+            uint32_t j;
+            
+            if (rc == 0)
+                rc = chunk->rc;
+            for (j = 0; rc == 0 && j < chunk->errorCount; ++j)
+                AddMessage(self, line_no + chunk->errors[j].line, chunk->errors[j].column, chunk->errors[j].message);
+            for (j = 0; rc == 0 && j < VectorLength(&chunk->lines); ++j)
+            {
+                rc = VectorAppend(&self->lines, NULL, VectorGet(&chunk->lines, j));
+                if (rc == 0)
+                    VectorSet(&chunk->lines, j, NULL);
+            }
+            line_no += chunk->lineCount;
+            
+            VectorWhack( &chunk->lines, WhackLineVectorElement, NULL );
+            free(chunk->errors);
+        }
+    }
+    
+    free(chunks);
+    return rc;
+}
+
+/* the end of the first data line: meta/header lines and that line go to the bison parser */
+static
+size_t VcfReaderParseEnd(const VcfReader* self)
+{
+    const char* p = self->input;
+    const char* end = self->input + self->inputSize;
+    bool data = false;
+    
+    while (p < end && !data)
+    {
+        const char* nl = memchr(p, '\n', end - p);
+        data = (*p != '#');
+        p = nl == NULL ? end : nl + 1;
+    }
+    return p - self->input;
+}
+
+rc_t VcfReaderSetThreads( VcfReader* self, uint32_t threads, size_t chunkSize )
+{
+    if ( self == NULL )
+        return RC ( rcAlign, rcFile, rcUpdating, rcSelf, rcNull );
+        
+    self->threads = threads == 0 ? 1 : threads;
+    self->chunkSize = chunkSize;
+    
+    return 0;
+}
+
 rc_t VcfReaderParse( struct VcfReader *self, struct KFile* inputFile, const struct VNamelist** messages)
 {
     rc_t rc = 0;
@@ -378,11 +653,14 @@ rc_t VcfReaderParse( struct VcfReader *self, struct KFile* inputFile, const stru
                 {
                     string_copy(self->input, self->inputSize+1, ptr, self->inputSize);
                     self->curPos = 0;
+                    self->parseEnd = VcfReaderParseEnd(self);
                     VCFScan_yylex_init(&self->pb, false);
                     
                     if (VCF_parse(&self->pb) == 0)
                         rc = PARSE_ERROR;
                     else
+                        rc = VcfReaderScanDataLines(self);
+                    if (rc == 0)
                     {
                         VNameListCount ( self->messages, &messageCount );       
                         if (messageCount > 0)
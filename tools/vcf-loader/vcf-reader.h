@@ -87,6 +87,18 @@ rc_t VcfReaderMake( const VcfReader** self );
  */
 rc_t VcfReaderParse( VcfReader* self, struct KFile* file, const struct VNamelist** messages );
 
+/* SetThreads
+ *  Data lines are scanned in parallel: split into chunks of at least chunkSize bytes, 
+ *  on up to this many threads. The default is 8 threads, 4 MB chunks.
+ *
+ *  self [ IN ] the reader object
+ *
+ *  threads [ IN ] the maximum number of threads, 0 is the same as 1
+ *
+ *  chunkSize [ IN ] the minimum size of a chunk, 0 = as many chunks as threads
+ */
+rc_t VcfReaderSetThreads( VcfReader* self, uint32_t threads, size_t chunkSize );
+
 /* Whack
  *  releases object obtained from VcfReaderMake
  */
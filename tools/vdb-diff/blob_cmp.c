@@ -0,0 +1,357 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#include "blob_cmp.h"
+
+#include <kdb/table.h>
+#include <kdb/column.h>
+#include <klib/namelist.h>
+#include <kproc/lock.h>
+#include <vdb/database.h>
+#include <vdb/vdb-priv.h> /* VTableOpenKTableRead */
+
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOB_CMP_CHUNK ( 64 * 1024 )
+
+typedef struct blob_range
+{
+    int64_t first;
+    int64_t end;
+    bool equal;
+} blob_range;
+
+struct blob_cmp
+{
+    /* every physical column of the table: col[ 0 ][ i ] and col[ 1 ][ i ] have the same name */
+    uint32_t count;
+    const KColumn ** col[ 2 ];
+
+    /* the compared row-ranges, sorted and not overlapping */
+    blob_range * ranges;
+    uint32_t range_count;
+    uint32_t range_size;
+
+    /* guards the ranges and the buffers, the comparison of all columns shares them */
+    KLock * lock;
+
+    char buf[ 2 ][ BLOB_CMP_CHUNK ];
+};
+
+static bool same_schema_type( const VTable * tab_1, const VTable * tab_2 )
+{
+    char ts_1[ 1024 ];
+    char ts_2[ 1024 ];
+    rc_t rc = VTableTypespec( tab_1, ts_1, sizeof ts_1 );
+    if ( rc == 0 )
+        rc = VTableTypespec( tab_2, ts_2, sizeof ts_2 );
+    return ( rc == 0 && strcmp( ts_1, ts_2 ) == 0 );
+}
+
+/* columns of a table inside a database can be computed from other tables of it */
+static bool is_standalone( const VTable * tab )
+{
+    const VDatabase * db = NULL;
+    rc_t rc = VTableOpenParentRead( tab, &db );
+    if ( rc == 0 && db != NULL )
+    {
+        VDatabaseRelease( db );
+        return false;
+    }
+    return ( rc == 0 );
+}
+
+static uint32_t count_physical_columns( const KTable * ktab )
+{
+    uint32_t count = 0;
+    KNamelist * names;
+    if ( KTableListCol( ktab, &names ) == 0 )
+    {
+        if ( KNamelistCount( names, &count ) != 0 )
+            count = 0;
+        KNamelistRelease( names );
+    }
+    return count;
+}
+
+static void release_columns( struct blob_cmp * self )
+{
+    uint32_t i;
+    for ( i = 0; i < self -> count; ++i )
+    {
+        KColumnRelease( self -> col[ 0 ][ i ] );
+        KColumnRelease( self -> col[ 1 ][ i ] );
+    }
+    free( self -> col[ 0 ] );
+    self -> count = 0;
+}
+
+/* opens every physical column of ktab_1 in both tables, false if their sets of columns differ */
+static bool open_physical_columns( struct blob_cmp * self, const KTable * ktab_1, const KTable * ktab_2 )
+{
+    bool res = false;
+    KNamelist * names;
+    if ( KTableListCol( ktab_1, &names ) == 0 )
+    {
+        uint32_t count;
+        if ( KNamelistCount( names, &count ) == 0 && count > 0 &&
+             count == count_physical_columns( ktab_2 ) )
+        {
+            self -> col[ 0 ] = calloc( 2 * count, sizeof self -> col[ 0 ][ 0 ] );
+            if ( self -> col[ 0 ] != NULL )
+            {
+                uint32_t i;
+                self -> col[ 1 ] = self -> col[ 0 ] + count;
+                res = true;
+                for ( i = 0; i < count && res; ++i )
+                {
+                    const char * name;
+                    res = ( KNamelistGet( names, i, &name ) == 0 &&
+                            KTableOpenColumnRead( ktab_1, &( self -> col[ 0 ][ i ] ), "%s", name ) == 0 );
+                    if ( res )
+                    {
+                        self -> count = i + 1;
+                        res = ( KTableOpenColumnRead( ktab_2, &( self -> col[ 1 ][ i ] ), "%s", name ) == 0 );
+                    }
+                }
+                if ( !res )
+                    release_columns( self );
+            }
+        }
+        KNamelistRelease( names );
+    }
+    return res;
+}
+
+rc_t blob_cmp_make( struct blob_cmp ** self, const VTable * tab_1, const VTable * tab_2 )
+{
+    rc_t rc = 0;
+    *self = NULL;
+    if ( same_schema_type( tab_1, tab_2 ) && is_standalone( tab_1 ) && is_standalone( tab_2 ) )
+    {
+        const KTable * ktab_1;
+        if ( VTableOpenKTableRead( tab_1, &ktab_1 ) == 0 )
+        {
+            const KTable * ktab_2;
+            if ( VTableOpenKTableRead( tab_2, &ktab_2 ) == 0 )
+            {
+                struct blob_cmp * o = calloc( 1, sizeof *o );
+                if ( o == NULL )
+                    rc = RC( rcExe, rcNoTarg, rcConstructing, rcMemory, rcExhausted );
+                else if ( open_physical_columns( o, ktab_1, ktab_2 ) )
+                {
+                    rc = KLockMake( &( o -> lock ) );
+                    if ( rc == 0 )
+                        *self = o;
+                    else
+                        blob_cmp_destroy( o );
+                }
+                else
+                    free( o );
+                KTableRelease( ktab_2 );
+            }
+            KTableRelease( ktab_1 );
+        }
+    }
+    return rc;
+}
+
+void blob_cmp_destroy( struct blob_cmp * self )
+{
+    if ( self != NULL )
+    {
+        release_columns( self );
+        KLockRelease( self -> lock );
+        free( self -> ranges );
+        free( self );
+    }
+}
+
+static bool blob_bytes_equal( struct blob_cmp * self, const KColumnBlob * blob_1, const KColumnBlob * blob_2 )
+{
+    size_t offset = 0;
+    for ( ;; )
+    {
+        size_t num_read_1, remaining_1, num_read_2, remaining_2;
+        rc_t rc = KColumnBlobRead( blob_1, offset, self -> buf[ 0 ], BLOB_CMP_CHUNK, &num_read_1, &remaining_1 );
+        if ( rc == 0 )
+            rc = KColumnBlobRead( blob_2, offset, self -> buf[ 1 ], BLOB_CMP_CHUNK, &num_read_2, &remaining_2 );
+        if ( rc != 0 || num_read_1 != num_read_2 || remaining_1 != remaining_2 )
+            return false;
+        if ( memcmp( self -> buf[ 0 ], self -> buf[ 1 ], num_read_1 ) != 0 )
+            return false;
+        if ( remaining_1 == 0 || num_read_1 == 0 )
+            return ( remaining_1 == 0 );
+        offset += num_read_1;
+    }
+}
+
+/* compares the blobs of one physical column holding row_id, narrows [ *first, *end ) to the
+   rows both blobs have in common: on any error the rows are not equal, decoding will report it */
+static bool blob_cmp_pair( struct blob_cmp * self, const KColumn * col_1, const KColumn * col_2,
+                           int64_t row_id, int64_t * first, int64_t * end )
+{
+    bool equal = false;
+    bool ranged = false;
+    const KColumnBlob * blob_1;
+    if ( KColumnOpenBlobRead( col_1, &blob_1, row_id ) == 0 )
+    {
+        const KColumnBlob * blob_2;
+        if ( KColumnOpenBlobRead( col_2, &blob_2, row_id ) == 0 )
+        {
+            int64_t first_1, first_2;
+            uint32_t count_1, count_2;
+            if ( KColumnBlobIdRange( blob_1, &first_1, &count_1 ) == 0 &&
+                 KColumnBlobIdRange( blob_2, &first_2, &count_2 ) == 0 )
+            {
+                int64_t end_1 = first_1 + count_1;
+                int64_t end_2 = first_2 + count_2;
+                if ( first_1 > *first ) *first = first_1;
+                if ( first_2 > *first ) *first = first_2;
+                if ( end_1 < *end ) *end = end_1;
+                if ( end_2 < *end ) *end = end_2;
+                ranged = true;
+                /* different blob-boundaries: decode the rows both blobs have in common */
+                if ( first_1 == first_2 && count_1 == count_2 )
+                    equal = blob_bytes_equal( self, blob_1, blob_2 );
+            }
+            KColumnBlobRelease( blob_2 );
+        }
+        KColumnBlobRelease( blob_1 );
+    }
+    if ( !ranged )
+    {
+        /* the answer is for this row only */
+        if ( row_id > *first ) *first = row_id;
+        if ( row_id + 1 < *end ) *end = row_id + 1;
+    }
+    return equal;
+}
+
+/* a row is equal only if the blobs of every physical column holding it are identical:
+   the answer holds for all rows these blobs have in common */
+static void blob_cmp_blobs( struct blob_cmp * self, int64_t row_id, blob_range * r )
+{
+    uint32_t i;
+    r -> first = INT64_MIN;
+    r -> end = INT64_MAX;
+    r -> equal = true;
+    for ( i = 0; i < self -> count && r -> equal; ++i )
+        r -> equal = blob_cmp_pair( self, self -> col[ 0 ][ i ], self -> col[ 1 ][ i ],
+                                    row_id, &( r -> first ), &( r -> end ) );
+    if ( row_id < r -> first || row_id >= r -> end )
+    {
+        r -> first = row_id;
+        r -> end = row_id + 1;
+        r -> equal = false;
+    }
+}
+
+/* index of the first range ending after row_id */
+static uint32_t blob_cmp_find( const struct blob_cmp * self, int64_t row_id )
+{
+    uint32_t lo = 0;
+    uint32_t hi = self -> range_count;
+    while ( lo < hi )
+    {
+        uint32_t mid = lo + ( hi - lo ) / 2;
+        if ( self -> ranges[ mid ] . end <= row_id )
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* looks up the range holding row_id, compares the blobs holding it if it is not known yet */
+static rc_t blob_cmp_lookup( struct blob_cmp * self, int64_t row_id, blob_range * r )
+{
+    uint32_t idx = blob_cmp_find( self, row_id );
+    if ( idx < self -> range_count && self -> ranges[ idx ] . first <= row_id )
+        *r = self -> ranges[ idx ];
+    else
+    {
+        blob_cmp_blobs( self, row_id, r );
+
+        /* keep the ranges apart, whatever the blobs of another row have narrowed them to */
+        if ( idx > 0 && r -> first < self -> ranges[ idx - 1 ] . end )
+            r -> first = self -> ranges[ idx - 1 ] . end;
+        if ( idx < self -> range_count && r -> end > self -> ranges[ idx ] . first )
+            r -> end = self -> ranges[ idx ] . first;
+
+        if ( self -> range_count >= self -> range_size )
+        {
+            uint32_t new_size = self -> range_size > 0 ? self -> range_size * 2 : 1024;
+            blob_range * ranges = realloc( self -> ranges, new_size * sizeof *ranges );
+            if ( ranges == NULL )
+                return RC( rcExe, rcNoTarg, rcComparing, rcMemory, rcExhausted );
+            self -> ranges = ranges;
+            self -> range_size = new_size;
+        }
+        memmove( &( self -> ranges[ idx + 1 ] ), &( self -> ranges[ idx ] ),
+                 ( self -> range_count - idx ) * sizeof self -> ranges[ 0 ] );
+        self -> ranges[ idx ] = *r;
+        self -> range_count++;
+    }
+    return 0;
+}
+
+void blob_cmp_pos_init( blob_cmp_pos * pos )
+{
+    memset( pos, 0, sizeof *pos );
+}
+
+bool blob_cmp_row_equal( struct blob_cmp * self, blob_cmp_pos * pos, int64_t row_id )
+{
+    if ( self == NULL )
+        return false;
+    if ( row_id < pos -> first || row_id >= pos -> end )
+    {
+        blob_range r;
+        rc_t rc;
+
+        KLockAcquire( self -> lock );
+        rc = blob_cmp_lookup( self, row_id, &r );
+        KLockUnlock( self -> lock );
+
+        if ( rc != 0 )
+        {
+            /* not cached: decoding will answer it */
+            r . first = row_id;
+            r . end = row_id + 1;
+            r . equal = false;
+        }
+        pos -> first = r . first;
+        pos -> end = r . end;
+        pos -> equal = r . equal;
+        if ( r . equal )
+            pos -> blobs_equal++;
+        else
+            pos -> blobs_different++;
+    }
+    return pos -> equal;
+}
@@ -0,0 +1,83 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#ifndef _h_blob_cmp_
+#define _h_blob_cmp_
+
+#include <klib/rc.h>
+#include <vdb/table.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************************************************************
+blob-cmp compares the physical blobs of a table in both tables:
+a row is equal only if the blobs holding it are byte-identical in
+every physical column, because a readable column can be computed
+from several of them ( READ from .READ and .ALTREAD ). It exists
+only if both tables have the same schema-type and the same set of
+physical columns, and are not part of a database, where columns can
+be computed from other tables.
+One blob-cmp is made per pair of tables and shared by the comparison
+of all columns, concurrent ones included: every pair of blobs is read
+and compared only once.
+********************************************************************/
+struct blob_cmp;
+
+/*
+ * the rows a caller has looked up last, and how many different ranges
+ * of rows it has found stored in identical/different blobs
+*/
+typedef struct blob_cmp_pos
+{
+    int64_t first;
+    int64_t end;
+    bool equal;
+    uint64_t blobs_equal;
+    uint64_t blobs_different;
+} blob_cmp_pos;
+
+void blob_cmp_pos_init( blob_cmp_pos * pos );
+
+/*
+ * *self is NULL if the tables cannot be compared by blobs
+*/
+rc_t blob_cmp_make( struct blob_cmp ** self, const VTable * tab_1, const VTable * tab_2 );
+
+void blob_cmp_destroy( struct blob_cmp * self );
+
+/*
+ * is the row stored in identical blobs of all physical columns in both tables?
+ * the answer is cached in self for all rows of the compared blobs, and in pos
+ * for the caller, every caller uses its own pos
+*/
+bool blob_cmp_row_equal( struct blob_cmp * self, blob_cmp_pos * pos, int64_t row_id );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -27,10 +27,66 @@
 #include "cmn.h"
 #include <klib/log.h>
 #include <klib/out.h>
+#include <klib/printf.h>
+
+#include <sysalloc.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+rc_t cmn_out_msg( cmn_out * out, const char * fmt, ... )
+{
+    char buffer[ 4096 ];
+    size_t num_writ;
+    rc_t rc;
+    va_list list;
+
+    va_start( list, fmt );
+    rc = string_vprintf( buffer, sizeof buffer, &num_writ, fmt, list );
+    va_end( list );
+
+    if ( rc == 0 )
+    {
+        if ( out == NULL )
+            rc = KOutMsg( "%s", buffer );
+        else
+        {
+            if ( out -> len + num_writ > out -> size )
+            {
+                size_t new_size = out -> size > 0 ? out -> size * 2 : sizeof buffer;
+                char * temp;
+                while ( new_size < out -> len + num_writ )
+                    new_size *= 2;
+                temp = realloc( out -> buf, new_size );
+                if ( temp == NULL )
+                    return RC( rcExe, rcBuffer, rcWriting, rcMemory, rcExhausted );
+                out -> buf = temp;
+                out -> size = new_size;
+            }
+            memmove( out -> buf + out -> len, buffer, num_writ );
+            out -> len += num_writ;
+        }
+    }
+    return rc;
+}
+
+rc_t cmn_out_print( const cmn_out * out, size_t len )
+{
+    if ( len == 0 )
+        return 0;
+    return KOutMsg( "%.*s", ( uint32_t )len, out -> buf );
+}
+
+void cmn_out_release( cmn_out * out )
+{
+    free( out -> buf );
+    out -> buf = NULL;
+    out -> len = out -> size = 0;
+}
 
 rc_t cmn_diff_column( const col_pair * pair,
                       const VCursor * cur_1, const VCursor * cur_2,
-                      int64_t row_id,  bool * res )
+                      int64_t row_id,  bool * res, cmn_out * out )
 {
     uint32_t elem_bits_1, boff_1, row_len_1;
     const void * base_1;
@@ -61,21 +117,21 @@ rc_t cmn_diff_column( const col_pair * pair,
             if ( elem_bits_1 != elem_bits_2 )
             {
                 *res = false;
-                rc = KOutMsg( "%s[ %ld ].elem_bits %u != %u\n", pair->name, row_id, elem_bits_1, elem_bits_2 );
+                rc = cmn_out_msg( out, "%s[ %ld ].elem_bits %u != %u\n", pair->name, row_id, elem_bits_1, elem_bits_2 );
             }
 
             if ( row_len_1 != row_len_2 )
             {
                 *res = false;
                 if ( rc == 0 )
-                    rc = KOutMsg( "%s[ %ld ].row_len %u != %u\n", pair->name, row_id, row_len_1, row_len_2 );
+                    rc = cmn_out_msg( out, "%s[ %ld ].row_len %u != %u\n", pair->name, row_id, row_len_1, row_len_2 );
             }
 
             if ( boff_1 != 0 || boff_2 != 0 )
             {
                 *res = false;
                 if ( rc == 0 )
-                    rc = KOutMsg( "%s[ %ld ].bit_offset: %u, %u\n", pair->name, row_id, boff_1, boff_2 );
+                    rc = cmn_out_msg( out, "%s[ %ld ].bit_offset: %u, %u\n", pair->name, row_id, boff_1, boff_2 );
             }
             
             if ( *res )
@@ -84,7 +140,7 @@ rc_t cmn_diff_column( const col_pair * pair,
                 if ( num_bits & 0x07 )
                 {
                     if ( rc == 0 )
-                        rc = KOutMsg( "%s[ %ld ].bits_total %% 8 = %u\n", pair->name, row_id, ( num_bits % 8 ) );
+                        rc = cmn_out_msg( out, "%s[ %ld ].bits_total %% 8 = %u\n", pair->name, row_id, ( num_bits % 8 ) );
                 }
                 else
                 {
@@ -93,7 +149,7 @@ rc_t cmn_diff_column( const col_pair * pair,
                     if ( cmp != 0 )
                     {
                         if ( rc == 0 )
-                            rc = KOutMsg( "%s[ %ld ] differ\n", pair->name, row_id );
+                            rc = cmn_out_msg( out, "%s[ %ld ] differ\n", pair->name, row_id );
                         *res = false;
                     }
                 }
@@ -37,9 +37,27 @@
 extern "C" {
 #endif
 
+/********************************************************************
+the messages of a column-diff are printed via KOutMsg ( out == NULL ),
+or collected in a buffer if columns are compared concurrently
+********************************************************************/
+typedef struct cmn_out
+{
+    char * buf;
+    size_t len;
+    size_t size;
+} cmn_out;
+
+rc_t cmn_out_msg( cmn_out * out, const char * fmt, ... );
+
+/* prints the first len bytes of the buffer */
+rc_t cmn_out_print( const cmn_out * out, size_t len );
+
+void cmn_out_release( cmn_out * out );
+
 rc_t cmn_diff_column( const col_pair * pair,
                       const VCursor * cur_1, const VCursor * cur_2,
-                      int64_t row_id,  bool * res );
+                      int64_t row_id,  bool * res, cmn_out * out );
 
 rc_t cmn_make_num_gen( const VCursor * cur_1, const VCursor * cur_2,
                        int idx_1, int idx_2,
@@ -30,9 +30,13 @@
 #include <klib/num-gen.h>
 #include <vdb/cursor.h>
 #include <klib/progressbar.h>
+#include <kproc/thread.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
 
 #include "coldefs.h"
 #include "cmn.h"
+#include "blob_cmp.h"
 
 #include <sysalloc.h>
 #include <stdlib.h>
@@ -40,17 +44,75 @@
 
 rc_t Quitting( void );  /* because we cannot include <kapp/main.h> where it is defined! */
 
-static rc_t cbc_diff_column_iter( const col_pair * pair, const VCursor * cur_1, const VCursor * cur_2,
+/********************************************************************
+the outcome of comparing one column: if columns are compared concurrently
+the messages are collected in 'out', together with the position after
+every differing row, to be printed in column-order with the same
+max-err cut-off as the sequential comparison
+********************************************************************/
+typedef struct cbc_column
+{
+    col_pair * pair;
+    cmn_out out;
+    size_t * diff_pos;          /* out.len after the n-th differing row */
+    uint64_t * diff_checked;    /* rows checked up to the n-th differing row */
+    uint32_t diff_count;
+    uint32_t diff_size;
+    uint64_t rows_checked;
+    blob_cmp_pos blobs;         /* the blob-ranges of the table-pair this column went through */
+    rc_t rc;
+    bool done;
+} cbc_column;
+
+static rc_t cbc_column_mark_diff( cbc_column * col )
+{
+    if ( col -> diff_count >= col -> diff_size )
+    {
+        uint32_t new_size = col -> diff_size > 0 ? col -> diff_size * 2 : 16;
+        size_t * pos = realloc( col -> diff_pos, new_size * sizeof *pos );
+        uint64_t * checked;
+        if ( pos == NULL )
+            return RC( rcExe, rcNoTarg, rcComparing, rcMemory, rcExhausted );
+        col -> diff_pos = pos;
+        checked = realloc( col -> diff_checked, new_size * sizeof *checked );
+        if ( checked == NULL )
+            return RC( rcExe, rcNoTarg, rcComparing, rcMemory, rcExhausted );
+        col -> diff_checked = checked;
+        col -> diff_size = new_size;
+    }
+    col -> diff_pos[ col -> diff_count ] = col -> out . len;
+    col -> diff_checked[ col -> diff_count ] = col -> rows_checked;
+    col -> diff_count++;
+    return 0;
+}
+
+static void cbc_column_release( cbc_column * col )
+{
+    cmn_out_release( &( col -> out ) );
+    free( col -> diff_pos );
+    free( col -> diff_checked );
+}
+
+static rc_t cbc_print_summary( const struct diff_ctx * dctx, const cbc_column * col,
+                               uint64_t rows_checked, uint64_t rows_different )
+{
+    rc_t rc = KOutMsg( "\n%,lu rows checked, %,lu rows differ\n", rows_checked, rows_different );
+    if ( rc == 0 && dctx -> blobs )
+        rc = KOutMsg( "%,lu blobs identical, %,lu blobs decoded\n", col -> blobs . blobs_equal, col -> blobs . blobs_different );
+    return rc;
+}
+
+/* out == NULL: sequential, messages and summary are printed right away */
+static rc_t cbc_diff_column_iter( cbc_column * col, const VCursor * cur_1, const VCursor * cur_2,
                                   const struct diff_ctx * dctx, const struct num_gen_iter * iter,
-                                  unsigned long int * diffs )
+                                  struct blob_cmp * blobs, cmn_out * out, unsigned long int * diffs )
 {
     rc_t rc = 0;
     struct progressbar * progress = NULL;
     int64_t row_id;
-    uint64_t rows_checked = 0;
     uint64_t rows_different = 0;
     
-    if ( dctx -> show_progress )
+    if ( dctx -> show_progress && out == NULL )
         make_progressbar( &progress, 2 );
 
     while ( ( rc == 0 ) && ( num_gen_iterator_next( iter, &row_id, &rc ) ) && ( *diffs < dctx -> max_err ) )
@@ -60,16 +122,18 @@ static rc_t cbc_diff_column_iter( const col_pair * pair, const VCursor * cur_1,
         {
             bool col_equal = true;
 
-            if ( pair != NULL )
-                rc = cmn_diff_column( pair, cur_1, cur_2, row_id,  &col_equal );
+            /* rows stored in identical blobs do not have to be decoded */
+            if ( col -> pair != NULL && !blob_cmp_row_equal( blobs, &( col -> blobs ), row_id ) )
+                rc = cmn_diff_column( col -> pair, cur_1, cur_2, row_id,  &col_equal, out );
 
+            col -> rows_checked++;
             if ( !col_equal )
             {
-                if ( rc == 0 )	rc = KOutMsg( "\n" );
+                if ( rc == 0 )	rc = cmn_out_msg( out, "\n" );
                 rows_different++;
                 ( *diffs )++;
+                if ( rc == 0 && out != NULL ) rc = cbc_column_mark_diff( col );
             }
-            rows_checked++;
 
             if ( progress != NULL )
             {
@@ -81,17 +145,19 @@ static rc_t cbc_diff_column_iter( const col_pair * pair, const VCursor * cur_1,
         } /* if (!Quitting) */
     } /* while ( num_gen_iterator_next() ) */
 
-    if ( rc == 0 )
-        rc = KOutMsg( "\n%,lu rows checked, %,lu rows differ\n", rows_checked, rows_different );
+    if ( rc == 0 && out == NULL )
+        rc = cbc_print_summary( dctx, col, col -> rows_checked, rows_different );
 
     if ( progress != NULL ) destroy_progressbar( progress );
 	
 	return rc;
 }
 
-static rc_t cbc_diff_column( col_pair * pair, const VCursor * cur_1, const VCursor * cur_2,
-                             const struct diff_ctx * dctx, unsigned long int *diffs )
+static rc_t cbc_diff_column( cbc_column * col, const VCursor * cur_1, const VCursor * cur_2,
+                             const struct diff_ctx * dctx, struct blob_cmp * blobs,
+                             cmn_out * out, unsigned long int *diffs )
 {
+    col_pair * pair = col -> pair;
     rc_t rc = VCursorAddColumn( cur_1, &( pair -> idx[ 0 ] ), "%s", pair -> name );
     if ( rc != 0 )
     {
@@ -133,7 +199,7 @@ static rc_t cbc_diff_column( col_pair * pair, const VCursor * cur_1, const VCurs
                         else if ( iter != NULL )
                         {
                             /* *************************************************************** */
-                            rc = cbc_diff_column_iter( pair, cur_1, cur_2, dctx, iter, diffs );
+                            rc = cbc_diff_column_iter( col, cur_1, cur_2, dctx, iter, blobs, out, diffs );
                             /* *************************************************************** */
                             num_gen_iterator_destroy( iter );
                         }
@@ -146,45 +212,244 @@ static rc_t cbc_diff_column( col_pair * pair, const VCursor * cur_1, const VCurs
     return rc;
 }
 
-rc_t cbc_diff_columns( const col_defs * defs, const VTable * tab_1, const VTable * tab_2,
-                       const struct diff_ctx * dctx, const char * tablename, unsigned long int *diffs )
+static rc_t cbc_compare_column( cbc_column * col, const VTable * tab_1, const VTable * tab_2,
+                                const struct diff_ctx * dctx, struct blob_cmp * blobs,
+                                cmn_out * out, unsigned long int *diffs )
+{
+    const VCursor * cur_1;
+    rc_t rc = VTableCreateCursorRead( tab_1, &cur_1 );
+    if ( rc != 0 )
+    {
+        LOGERR ( klogInt, rc, "VTableCreateCursorRead( acc #1 ) failed" );
+    }
+    else
+    {
+        const VCursor * cur_2;
+        rc = VTableCreateCursorRead( tab_2, &cur_2 );
+        if ( rc != 0 )
+        {
+            LOGERR ( klogInt, rc, "VTableCreateCursorRead( acc #2 ) failed" );
+        }
+        else
+        {
+            /* *************************************************************** */
+            rc = cbc_diff_column( col, cur_1, cur_2, dctx, blobs, out, diffs );
+            /* *************************************************************** */
+            VCursorRelease( cur_2 );
+        }
+        VCursorRelease( cur_1 );
+    }
+    return rc;
+}
+
+static rc_t cbc_diff_columns_sequential( cbc_column * cols, uint32_t count, const VTable * tab_1, const VTable * tab_2,
+                                         const struct diff_ctx * dctx, struct blob_cmp * blobs,
+                                         const char * tablename, unsigned long int *diffs )
 {
     rc_t rc = 0;
     uint32_t i;
-    uint32_t count = VectorLength( &( defs -> cols ) );
     for ( i = 0; i < count && rc == 0 && ( *diffs < dctx -> max_err ); ++i )
     {
-        col_pair * pair = VectorGet( &( defs -> cols ), i );
-        if ( pair != NULL )
+        if ( cols[ i ] . pair != NULL )
+        {
+            rc = KOutMsg( "comparing column '%s.%s'\n", tablename, cols[ i ] . pair -> name );
+            if ( rc == 0 )
+                rc = cbc_compare_column( &cols[ i ], tab_1, tab_2, dctx, blobs, NULL, diffs );
+        }
+    }
+    return rc;
+}
+
+/********************************************************************
+concurrent comparison: the workers take the next column, this thread
+prints the columns in order as soon as they are done
+********************************************************************/
+typedef struct cbc_jobs
+{
+    const VTable * tab_1;
+    const VTable * tab_2;
+    const struct diff_ctx * dctx;
+    struct blob_cmp * blobs;
+    cbc_column * cols;
+    uint32_t count;
+    uint32_t next;
+    bool stop;
+    KLock * lock;
+    KCondition * done_cond;
+} cbc_jobs;
+
+static rc_t CC cbc_worker( const KThread * self, void * data )
+{
+    cbc_jobs * jobs = data;
+    for ( ;; )
+    {
+        cbc_column * col = NULL;
+        KLockAcquire( jobs -> lock );
+        while ( !jobs -> stop && jobs -> next < jobs -> count && col == NULL )
+        {
+            col = &( jobs -> cols[ jobs -> next++ ] );
+            if ( col -> pair == NULL )
+                col = NULL;
+        }
+        KLockUnlock( jobs -> lock );
+        if ( col == NULL )
+            break;
+        else
+        {
+            unsigned long int diffs = 0;
+            col -> rc = cbc_compare_column( col, jobs -> tab_1, jobs -> tab_2, jobs -> dctx, jobs -> blobs,
+                                          &( col -> out ), &diffs );
+        }
+        KLockAcquire( jobs -> lock );
+        col -> done = true;
+        KConditionBroadcast( jobs -> done_cond );
+        KLockUnlock( jobs -> lock );
+    }
+    return 0;
+}
+
+/* prints a finished column, cut off where the sequential comparison would have stopped */
+static rc_t cbc_print_column( cbc_column * col, const struct diff_ctx * dctx,
+                              const char * tablename, unsigned long int *diffs )
+{
+    rc_t rc = KOutMsg( "comparing column '%s.%s'\n", tablename, col -> pair -> name );
+    if ( rc == 0 )
+    {
+        unsigned long int budget = dctx -> max_err - *diffs;
+        if ( col -> diff_count > budget )
         {
-            rc = KOutMsg( "comparing column '%s.%s'\n", tablename, pair -> name );
+            rc = cmn_out_print( &( col -> out ), col -> diff_pos[ budget - 1 ] );
             if ( rc == 0 )
+                rc = cbc_print_summary( dctx, col, col -> diff_checked[ budget - 1 ], budget );
+            *diffs += budget;
+        }
+        else
+        {
+            rc = cmn_out_print( &( col -> out ), col -> out . len );
+            if ( rc == 0 )
+                rc = col -> rc;
+            if ( rc == 0 )
+                rc = cbc_print_summary( dctx, col, col -> rows_checked, col -> diff_count );
+            *diffs += col -> diff_count;
+        }
+    }
+    return rc;
+}
+
+static rc_t cbc_diff_columns_concurrent( cbc_column * cols, uint32_t count, const VTable * tab_1, const VTable * tab_2,
+                                         const struct diff_ctx * dctx, struct blob_cmp * blobs,
+                                         const char * tablename, unsigned long int *diffs )
+{
+    cbc_jobs jobs;
+    rc_t rc;
+
+    memset( &jobs, 0, sizeof jobs );
+    jobs . tab_1 = tab_1;
+    jobs . tab_2 = tab_2;
+    jobs . dctx = dctx;
+    jobs . blobs = blobs;
+    jobs . cols = cols;
+    jobs . count = count;
+
+    rc = KLockMake( &jobs . lock );
+    if ( rc != 0 )
+    {
+        LOGERR ( klogInt, rc, "KLockMake() failed" );
+    }
+    else
+    {
+        rc = KConditionMake( &jobs . done_cond );
+        if ( rc != 0 )
+        {
+            LOGERR ( klogInt, rc, "KConditionMake() failed" );
+        }
+        else
+        {
+            uint32_t n_threads = dctx -> threads < count ? dctx -> threads : count;
+            KThread ** threads = calloc( n_threads, sizeof *threads );
+            if ( threads == NULL )
+                rc = RC( rcExe, rcNoTarg, rcComparing, rcMemory, rcExhausted );
+            else
             {
-                const VCursor * cur_1;
-                rc = VTableCreateCursorRead( tab_1, &cur_1 );
-                if ( rc != 0 )
+                uint32_t i;
+                for ( i = 0; i < n_threads && rc == 0; ++i )
                 {
-                    LOGERR ( klogInt, rc, "VTableCreateCursorRead( acc #1 ) failed" );
+                    rc = KThreadMake( &threads[ i ], cbc_worker, &jobs );
+                    if ( rc != 0 )
+                        LOGERR ( klogInt, rc, "KThreadMake() failed" );
                 }
-                else
+
+                for ( i = 0; i < count && rc == 0 && ( *diffs < dctx -> max_err ); ++i )
                 {
-                    const VCursor * cur_2;
-                    rc = VTableCreateCursorRead( tab_2, &cur_2 );
-                    if ( rc != 0 )
+                    cbc_column * col = &cols[ i ];
+                    if ( col -> pair != NULL )
                     {
-                        LOGERR ( klogInt, rc, "VTableCreateCursorRead( acc #2 ) failed" );
+                        KLockAcquire( jobs . lock );
+                        while ( !col -> done )
+                            KConditionWait( jobs . done_cond, jobs . lock );
+                        KLockUnlock( jobs . lock );
+
+                        rc = cbc_print_column( col, dctx, tablename, diffs );
                     }
-                    else
+                }
+
+                KLockAcquire( jobs . lock );
+                jobs . stop = true;
+                KLockUnlock( jobs . lock );
+
+                for ( i = 0; i < n_threads; ++i )
+                {
+                    if ( threads[ i ] != NULL )
                     {
-                        /* *************************************************************** */
-                        rc = cbc_diff_column( pair, cur_1, cur_2, dctx, diffs );
-                        /* *************************************************************** */
-                        VCursorRelease( cur_2 );
+                        KThreadWait( threads[ i ], NULL );
+                        KThreadRelease( threads[ i ] );
                     }
-                    VCursorRelease( cur_1 );
                 }
+                free( threads );
             }
+            KConditionRelease( jobs . done_cond );
         }
+        KLockRelease( jobs . lock );
+    }
+    return rc;
+}
+
+rc_t cbc_diff_columns( const col_defs * defs, const VTable * tab_1, const VTable * tab_2,
+                       const struct diff_ctx * dctx, const char * tablename, unsigned long int *diffs )
+{
+    rc_t rc = 0;
+    uint32_t count = VectorLength( &( defs -> cols ) );
+    cbc_column * cols = calloc( count > 0 ? count : 1, sizeof *cols );
+    if ( cols == NULL )
+    {
+        rc = RC( rcExe, rcNoTarg, rcComparing, rcMemory, rcExhausted );
+        LOGERR ( klogInt, rc, "calloc() failed" );
+    }
+    else
+    {
+        uint32_t i;
+        struct blob_cmp * blobs = NULL;
+        for ( i = 0; i < count; ++i )
+        {
+            cols[ i ] . pair = VectorGet( &( defs -> cols ), i );
+            blob_cmp_pos_init( &( cols[ i ] . blobs ) );
+        }
+
+        /* the blobs are compared once for the table, not once for every column */
+        if ( dctx -> blobs )
+            rc = blob_cmp_make( &blobs, tab_1, tab_2 );
+        if ( rc == 0 )
+        {
+            if ( dctx -> threads > 1 && count > 1 )
+                rc = cbc_diff_columns_concurrent( cols, count, tab_1, tab_2, dctx, blobs, tablename, diffs );
+            else
+                rc = cbc_diff_columns_sequential( cols, count, tab_1, tab_2, dctx, blobs, tablename, diffs );
+        }
+        blob_cmp_destroy( blobs );
+
+        for ( i = 0; i < count; ++i )
+            cbc_column_release( &cols[ i ] );
+        free( cols );
     }
     return rc;
 }
@@ -33,6 +33,7 @@
 
 #include "coldefs.h"
 #include "cmn.h"
+#include "blob_cmp.h"
 
 #include <sysalloc.h>
 #include <stdlib.h>
@@ -42,7 +43,7 @@ rc_t Quitting( void );  /* because we cannot include <kapp/main.h> where it is d
 
 static rc_t rbr_diff_columns_iter( const col_defs * defs, const VCursor * cur_1, const VCursor * cur_2,
                                    const struct diff_ctx * dctx, const struct num_gen_iter * iter,
-                                   unsigned long int *diffs )
+                                   struct blob_cmp * blobs, unsigned long int *diffs )
 {
 	uint32_t column_count;
 	rc_t rc = col_defs_count( defs, &column_count );
@@ -56,7 +57,9 @@ static rc_t rbr_diff_columns_iter( const col_defs * defs, const VCursor * cur_1,
 		int64_t row_id;
 		uint64_t rows_checked = 0;
 		uint64_t rows_different = 0;
+		blob_cmp_pos pos;
 		
+		blob_cmp_pos_init( &pos );
 		if ( dctx -> show_progress )
 			make_progressbar( &progress, 2 );
 	
@@ -66,15 +69,17 @@ static rc_t rbr_diff_columns_iter( const col_defs * defs, const VCursor * cur_1,
 			if ( rc == 0 )
 			{
 				bool row_equal = true;
+				/* a row stored in identical blobs does not need to be decoded */
+				bool blobs_equal = blob_cmp_row_equal( blobs, &pos, row_id );
 				
 				uint32_t col_id;
-				for ( col_id = 0; col_id < column_count && rc == 0; ++col_id )
+				for ( col_id = 0; col_id < column_count && rc == 0 && !blobs_equal; ++col_id )
 				{
 					col_pair * pair = VectorGet( &( defs -> cols ), col_id );
 					if ( pair != NULL )
 					{
                         bool col_equal;
-                        rc = cmn_diff_column( pair, cur_1, cur_2, row_id,  &col_equal );
+                        rc = cmn_diff_column( pair, cur_1, cur_2, row_id,  &col_equal, NULL );
                         if ( !col_equal )
                         {
                             row_equal = false;
@@ -104,6 +109,9 @@ static rc_t rbr_diff_columns_iter( const col_defs * defs, const VCursor * cur_1,
 			rc = KOutMsg( "\n%,lu rows checked ( %d columns each ), %,lu rows differ\n",
 				rows_checked, column_count, rows_different );
 
+		if ( rc == 0 && blobs != NULL )
+			rc = KOutMsg( "%,lu blobs identical, %,lu blobs decoded\n", pos . blobs_equal, pos . blobs_different );
+
 		if ( progress != NULL )
 			destroy_progressbar( progress );
 			
@@ -172,9 +180,16 @@ rc_t rbr_diff_columns( col_defs * defs, const VTable * tab_1, const VTable * tab
                                 }
                                 else if ( iter != NULL )
                                 {
-                                    /* *************************************************************** */
-                                    rc = rbr_diff_columns_iter( defs, cur_1, cur_2, dctx, iter, diffs );
-                                    /* *************************************************************** */
+                                    struct blob_cmp * blobs = NULL;
+                                    if ( dctx -> blobs )
+                                        rc = blob_cmp_make( &blobs, tab_1, tab_2 );
+                                    if ( rc == 0 )
+                                    {
+                                        /* *************************************************************** */
+                                        rc = rbr_diff_columns_iter( defs, cur_1, cur_2, dctx, iter, blobs, diffs );
+                                        /* *************************************************************** */
+                                    }
+                                    blob_cmp_destroy( blobs );
                                     num_gen_iterator_destroy( iter );
                                 }
                                 num_gen_destroy( rows_to_diff );
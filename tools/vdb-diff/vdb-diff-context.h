@@ -62,6 +62,12 @@ extern "C" {
 #define OPTION_COLUMNWISE   "col-by-col"
 #define ALIAS_COLUMNWISE    "c"
 
+#define OPTION_BLOBS        "blobs"
+#define ALIAS_BLOBS         "b"
+
+#define OPTION_THREADS      "threads"
+#define ALIAS_THREADS       "t"
+
 struct diff_ctx
 {
     const char * src1;
@@ -75,6 +81,8 @@ struct diff_ctx
 	bool show_progress;
 	bool intersect;
     bool columnwise;
+    bool blobs;
+    uint32_t threads;
 };
 
 void init_diff_ctx( struct diff_ctx * dctx );
@@ -57,6 +57,8 @@ static const char * maxerr_usage[] = { "max errors im comparing (default = 1)",
 static const char * intersect_usage[] = { "intersect column-set from both runs", NULL };
 static const char * exclude_usage[] = { "exclude these columns from comapring", NULL };
 static const char * columnwise_usage[] = { "exclude these columns from comapring", NULL };
+static const char * blobs_usage[] = { "compare physical blobs first, decode and compare only rows of blobs that differ", NULL };
+static const char * threads_usage[] = { "compare that many columns concurrently (col-by-col only, default = 1)", NULL };
 
 OptDef MyOptions[] =
 {
@@ -67,7 +69,9 @@ OptDef MyOptions[] =
 	{ OPTION_MAXERR, 		ALIAS_MAXERR,		NULL, 	maxerr_usage,		1, 	true, 	false },
 	{ OPTION_INTERSECT,		ALIAS_INTERSECT,	NULL, 	intersect_usage,	1, 	false, 	false },
 	{ OPTION_EXCLUDE,		ALIAS_EXCLUDE,		NULL, 	exclude_usage,		1, 	true, 	false },
-    { OPTION_COLUMNWISE,    ALIAS_COLUMNWISE,   NULL,   columnwise_usage,   1,  false,  false }
+    { OPTION_COLUMNWISE,    ALIAS_COLUMNWISE,   NULL,   columnwise_usage,   1,  false,  false },
+    { OPTION_BLOBS,         ALIAS_BLOBS,        NULL,   blobs_usage,        1,  false,  false },
+    { OPTION_THREADS,       ALIAS_THREADS,      NULL,   threads_usage,      1,  true,   false }
 };
 
 const char UsageDefaultName[] = "vdb-diff";
@@ -106,6 +110,8 @@ rc_t CC Usage ( const Args * args )
 	HelpOptionLine ( ALIAS_INTERSECT, 	OPTION_INTERSECT,   NULL,			intersect_usage );
 	HelpOptionLine ( ALIAS_EXCLUDE, 	OPTION_EXCLUDE,   	"column-set",	exclude_usage );
 	HelpOptionLine ( ALIAS_COLUMNWISE, 	OPTION_COLUMNWISE, 	NULL,	        columnwise_usage );
+	HelpOptionLine ( ALIAS_BLOBS, 		OPTION_BLOBS, 		NULL,	        blobs_usage );
+	HelpOptionLine ( ALIAS_THREADS, 	OPTION_THREADS, 	"count",        threads_usage );
 
     HelpOptionsStandard ();
     HelpVersion ( fullpath, KAppVersion() );
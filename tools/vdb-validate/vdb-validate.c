@@ -59,6 +59,8 @@
 #include <kfs/tar.h>
 #include <kfs/file.h> /* KFileRelease */
 
+#include <kproc/thread.h> /* KThread */
+
 #include <insdc/insdc.h>
 #include <insdc/sra.h>
 #include <sra/srapath.h>
@@ -98,6 +100,9 @@
 
 #define SDC_ROW_CHUNK_MAX 8ull*1024ull*1024ull
 
+/* row ranges shorter than that are not split between threads */
+#define ROWS_PER_THREAD_MIN 64ull*1024ull
+
 #if 0
 #define DBG_MSG(args) KOutMsg args
 #else
@@ -774,6 +779,9 @@ struct vdb_validate_params
     bool consist_check;
     bool exhaustive;
 
+    /* number of threads walking the rows of integrity checks */
+    uint32_t threads;
+
     // data integrity checks parameters
     bool sdc_enabled;
     bool sdc_sec_rows_in_percent;
@@ -1228,9 +1236,9 @@ typedef struct id_pair_s {
     int64_t second;
 } id_pair_t;
 
-static size_t work_chunk(uint64_t const count)
+static size_t work_chunk(uint64_t const count, uint32_t const parts)
 {
-    size_t const max = memory_suggestion / (sizeof(id_pair_t));
+    size_t const max = memory_suggestion / (sizeof(id_pair_t) * parts);
     size_t chunk = (size_t)count;
 
 #if 1
@@ -1471,7 +1479,131 @@ static rc_t ric_align_generic(int64_t const startId,
     return 0;
 }
 
-static rc_t ric_align_ref_and_align(char const dbname[],
+/* number of parts a row range is cut into to be checked by threads */
+static uint32_t thread_parts(uint32_t const threads, uint64_t const count)
+{
+    uint64_t const max = count / (ROWS_PER_THREAD_MIN);
+
+    if (threads <= 1 || max <= 1)
+        return 1;
+    return max < threads ? (uint32_t)max : threads;
+}
+
+/* a part of a referential integrity check:
+   every thread but the calling one opens its own cursors */
+typedef struct ric_part_s {
+    VTable const *atbl;
+    VTable const *btbl;
+    ColumnInfo aci;
+    ColumnInfo bci;
+    int64_t startId;
+    uint64_t count;
+    size_t chunk;
+    KThread *thread;
+    rc_t rc;
+} ric_part_t;
+
+static rc_t ric_part_check(ric_part_t *const self,
+                           VCursor const *const acurs,
+                           VCursor const *const bcurs)
+{
+    rc_t rc;
+    void *scratch = NULL;
+    id_pair_t *const pair = malloc(sizeof(id_pair_t) * self->chunk);
+
+    if (pair == NULL)
+        return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+
+    rc = ric_align_generic(self->startId, self->count, self->chunk, pair,
+                           &scratch, acurs, &self->aci, bcurs, &self->bci);
+    if (scratch)
+        free(scratch);
+    free(pair);
+    return rc;
+}
+
+static rc_t CC ric_part_thread(const KThread *self, void *data)
+{
+    ric_part_t *const part = data;
+    VCursor const *acurs = NULL;
+    VCursor const *bcurs = NULL;
+    rc_t rc = VTableCreateCursorRead(part->atbl, &acurs);
+
+    if (rc == 0)
+        rc = VCursorAddColumn(acurs, &part->aci.idx, "%s", part->aci.name);
+    if (rc == 0)
+        rc = VCursorOpen(acurs);
+    if (rc == 0)
+        rc = VTableCreateCursorRead(part->btbl, &bcurs);
+    if (rc == 0)
+        rc = VCursorAddColumn(bcurs, &part->bci.idx, "%s", part->bci.name);
+    if (rc == 0)
+        rc = VCursorOpen(bcurs);
+    if (rc == 0)
+        rc = ric_part_check(part, acurs, bcurs);
+
+    VCursorRelease(bcurs);
+    VCursorRelease(acurs);
+    part->rc = rc;
+    return rc;
+}
+
+/* checks rows [startId, startId + count) of acurs against bcurs;
+ * with more than one thread the range is cut into parts,
+ * the first one and those whose thread can not be started are checked
+ * on the calling thread with the given cursors.
+ * The result is the one of the first failed part */
+static rc_t ric_align_ranges(uint32_t const threads,
+                             int64_t const startId,
+                             uint64_t const count,
+                             VTable const *const atbl,
+                             VCursor const *const acurs,
+                             ColumnInfo const *const aci,
+                             VTable const *const btbl,
+                             VCursor const *const bcurs,
+                             ColumnInfo const *const bci)
+{
+    rc_t rc = 0;
+    uint32_t const n = thread_parts(threads, count);
+    uint64_t const per_part = (count + n - 1) / n;
+    uint32_t i;
+    ric_part_t *const part = calloc(n, sizeof(part[0]));
+
+    if (part == NULL)
+        return RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+
+    for (i = 0; i < n; ++i) {
+        part[i].atbl = atbl;
+        part[i].btbl = btbl;
+        part[i].aci = *aci;
+        part[i].bci = *bci;
+        part[i].startId = startId + i * per_part;
+        part[i].count = i + 1 < n ? per_part : count - i * per_part;
+        part[i].chunk = work_chunk(part[i].count, n);
+    }
+    for (i = 1; i < n; ++i) {
+        if (KThreadMake(&part[i].thread, ric_part_thread, &part[i]) != 0) {
+            /* check it on this thread then */
+            part[i].thread = NULL;
+            part[i].rc = ric_part_check(&part[i], acurs, bcurs);
+        }
+    }
+    part[0].rc = ric_part_check(&part[0], acurs, bcurs);
+    for (i = 1; i < n; ++i) {
+        if (part[i].thread != NULL) {
+            KThreadWait(part[i].thread, NULL);
+            KThreadRelease(part[i].thread);
+        }
+    }
+    for (i = 0; i < n && rc == 0; ++i)
+        rc = part[i].rc;
+
+    free(part);
+    return rc;
+}
+
+static rc_t ric_align_ref_and_align(uint32_t const threads,
+                                    char const dbname[],
                                     VTable const *ref,
                                     VTable const *align,
                                     int which)
@@ -1513,53 +1645,38 @@ static rc_t ric_align_ref_and_align(char const dbname[],
                 "reference table can not be read", "name=%s", dbname));
     }
     if (rc == 0) {
-        size_t const chunk = work_chunk(count);
-        id_pair_t *const pair = malloc(sizeof(id_pair_t) * chunk);
+        rc = ric_align_ranges(threads, startId, count,
+                              align, acurs, &aci, ref, bcurs, &bci);
 
-        if (pair) {
-            void *scratch = NULL;
-
-            rc = ric_align_generic(startId, count, chunk, pair, &scratch,
-                                   acurs, &aci, bcurs, &bci);
-            if (scratch)
-                free(scratch);
-
-            if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-                    "Database '$(name)': failed referential "
-                    "integrity check", "name=%s", dbname));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcInconsistent)
-                (void)PLOGERR(klogErr, (klogErr, rc,
+        if (GetRCObject(rc) == rcMemory && GetRCState(rc) == rcExhausted)
+            (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
+                " referential integrity could not be checked, skipped",
+                "name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Database '$(name)': failed referential "
+                "integrity check", "name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcInconsistent)
+            (void)PLOGERR(klogErr, (klogErr, rc,
  "Database '$(name)': column '$(idcol)' failed referential integrity check",
  "name=%s,idcol=%s", dbname, id_col_name));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcTooBig)
-                (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
-                         " referential integrity could not be checked, skipped",
-                         "name=%s", dbname));
-            else if (rc)
-                (void)PLOGERR(klogErr, (klogErr, rc,
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcTooBig)
+            (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
+                     " referential integrity could not be checked, skipped",
+                     "name=%s", dbname));
+        else if (rc)
+            (void)PLOGERR(klogErr, (klogErr, rc,
 "Database '$(name)': reference table can not be read", "name=%s", dbname));
-
-            free(pair);
-        }
-        else
-            rc = RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
-
-        if (GetRCObject(rc) == rcMemory && GetRCState(rc) == rcExhausted) {
-            rc = 0;
-            (void)PLOGERR(klogWarn, (klogWarn, rc, "Database '$(name)':"
-                " referential integrity could not be checked, skipped",
-                "name=%s", dbname));
-        }
     }
     VCursorRelease(acurs);
     VCursorRelease(bcurs);
     return rc;
 }
 
-static rc_t ric_align_seq_and_pri(char const dbname[],
+static rc_t ric_align_seq_and_pri(uint32_t const threads,
+                                  char const dbname[],
                                   VTable const *seq,
                                   VTable const *pri)
 {
@@ -1595,47 +1712,170 @@ static rc_t ric_align_seq_and_pri(char const dbname[],
                 "sequence table can not be read", "name=%s", dbname));
     }
     if (rc == 0) {
-        size_t const chunk = work_chunk(count);
-        id_pair_t *const pair = malloc((sizeof(id_pair_t)+sizeof(int64_t)) * chunk);
-
-        if (pair) {
-            void *scratch = NULL;
+        rc = ric_align_ranges(threads, startId, count,
+                              pri, acurs, &aci, seq, bcurs, &bci);
 
-            rc = ric_align_generic(startId, count, chunk, pair, &scratch,
-                                   acurs, &aci, bcurs, &bci);
-            if (scratch)
-                free(scratch);
-
-            if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-                    "Database '$(name)': failed referential "
-                    "integrity check", "name=%s", dbname));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcInconsistent)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-"Database '$(name)': column 'SEQ_SPOT_ID' failed referential integrity check",
-"name=%s", dbname));
-            else if (GetRCObject(rc) == (enum RCObject)rcData &&
-                     GetRCState(rc) == rcTooBig)
-                (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
-                         " referential integrity could not be checked, skipped",
-                         "name=%s", dbname));
-            else if (rc)
-                (void)PLOGERR(klogErr, (klogErr, rc,
-"Database '$(name)': sequence table can not be read", "name=%s", dbname));
-
-            free(pair);
-        }
-        else
+        if (GetRCObject(rc) == rcMemory && GetRCState(rc) == rcExhausted)
             (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
                          " referential integrity could not be checked, skipped",
                          "name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData && GetRCState(rc) == rcUnexpected)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+                "Database '$(name)': failed referential "
+                "integrity check", "name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcInconsistent)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+"Database '$(name)': column 'SEQ_SPOT_ID' failed referential integrity check",
+"name=%s", dbname));
+        else if (GetRCObject(rc) == (enum RCObject)rcData &&
+                 GetRCState(rc) == rcTooBig)
+            (void)PLOGERR(klogWarn, (klogWarn, rc = 0, "Database '$(name)':"
+                     " referential integrity could not be checked, skipped",
+                     "name=%s", dbname));
+        else if (rc)
+            (void)PLOGERR(klogErr, (klogErr, rc,
+"Database '$(name)': sequence table can not be read", "name=%s", dbname));
     }
     VCursorRelease(acurs);
     VCursorRelease(bcurs);
     return rc;
 }
 
+/* data integrity check of SEQUENCE rows [first, first + count):
+   PRIMARY_ALIGNMENT_ID and READ_LEN have the same length,
+   CMP_READ holds the bases of the unaligned reads */
+static rc_t sdc_seq_rows(char const dbname[],
+                         VCursor const *seq_cursor,
+                         uint32_t seq_pa_id_idx,
+                         uint32_t seq_read_len_idx,
+                         uint32_t seq_cmp_read_idx,
+                         int64_t first,
+                         int64_t count)
+{
+    rc_t rc = 0;
+    int64_t i;
+
+    for ( i = 0; i < count; ++i )
+    {
+        int64_t seq_row_id = i + first;
+
+        const void * data_ptr = NULL;
+        uint32_t data_len;
+        const int64_t * p_seq_pa_id;
+        const uint32_t * p_seq_read_len;
+        uint32_t seq_pa_id_len;
+
+        uint64_t sum_unaligned_read_len;
+        uint32_t j;
+
+        // SEQUENCE:PRIMARY_ALIGNMENT_ID
+        rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_pa_id_idx, NULL, (const void**)&p_seq_pa_id, NULL, &seq_pa_id_len );
+        if ( rc != 0 || p_seq_pa_id == NULL )
+        {
+            if (rc == 0)
+                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                    "VCursorCellDataDirect() failed on SEQUENCE table, PRIMARY_ALIGNMENT_ID column, spot_id: $(SPOT_ID)",
+                                    "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
+            break;
+        }
+
+        // SEQUENCE:READ_LEN
+        rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_read_len_idx, NULL, (const void**)&p_seq_read_len, NULL, &data_len );
+        if ( rc != 0 || p_seq_read_len == NULL )
+        {
+            if (rc == 0)
+                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                    "VCursorCellDataDirect() failed on SEQUENCE table, READ_LEN column, spot_id: $(SPOT_ID)",
+                                    "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
+            break;
+        }
+        if ( seq_pa_id_len != data_len )
+        {
+            rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                        "SEQUENCE:$(SEQ_SPOT_ID) PRIMARY_ALIGNMENT_ID length ($(SEQ_PA_LEN)) does not match SEQUENCE:$(SEQ_SPOT_ID) READ_LEN length ($(SEQ_READ_LEN_LEN))",
+                        "name=%s,SEQ_SPOT_ID=%ld,SEQ_PA_LEN=%u,SEQ_READ_LEN_LEN=%u", dbname, seq_row_id, seq_pa_id_len, data_len));
+            break;
+        }
+
+        sum_unaligned_read_len = 0;
+        for ( j = 0; j < seq_pa_id_len; ++j )
+        {
+            if ( p_seq_pa_id[j] == 0 )
+            {
+                sum_unaligned_read_len += p_seq_read_len[j];
+            }
+        }
+
+        // SEQUENCE:CMP_READ
+        rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_cmp_read_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
+        if ( rc != 0 /*|| data_ptr == NULL*/ )
+        {
+            if (rc == 0)
+                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                                    "VCursorCellDataDirect() failed on SEQUENCE table, CMP_READ column, spot_id: $(SPOT_ID)",
+                                    "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
+            break;
+        }
+
+        if ( sum_unaligned_read_len != data_len )
+        {
+            rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
+            (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                        "SEQUENCE:$(SEQ_SPOT_ID) CMP_READ length ($(CMD_READ_LEN)) does not match sum of unaligned READ_LEN values ($(SUM_UNALIGNED_READ_LEN))",
+                        "name=%s,SEQ_SPOT_ID=%ld,CMD_READ_LEN=%u,SUM_UNALIGNED_READ_LEN=%lu", dbname, seq_row_id, data_len, sum_unaligned_read_len));
+            break;
+        }
+    }
+
+    return rc;
+}
+
+/* a part of the SEQUENCE rows:
+   every thread but the calling one opens its own cursor */
+typedef struct sdc_seq_part_s {
+    char const *dbname;
+    VTable const *seq;
+    int64_t first;
+    int64_t count;
+    KThread *thread;
+    rc_t rc;
+} sdc_seq_part_t;
+
+static rc_t CC sdc_seq_part_thread(const KThread *self, void *data)
+{
+    sdc_seq_part_t *const part = data;
+    VCursor const *seq_cursor = NULL;
+    uint32_t seq_read_len_idx;
+    uint32_t seq_cmp_read_idx;
+    uint32_t seq_pa_id_idx;
+    rc_t rc = VTableCreateCursorRead(part->seq, &seq_cursor);
+
+    if (rc == 0)
+        rc = VCursorAddColumn(seq_cursor, &seq_read_len_idx, "%s", "READ_LEN");
+    if (rc == 0)
+        rc = VCursorAddColumn(seq_cursor, &seq_cmp_read_idx, "%s", "CMP_READ");
+    if (rc == 0)
+        rc = VCursorAddColumn(seq_cursor, &seq_pa_id_idx, "%s", "PRIMARY_ALIGNMENT_ID");
+    if (rc == 0)
+        rc = VCursorOpen(seq_cursor);
+    if (rc != 0)
+        (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
+                    "alignment table SEQUENCE can not be read", "name=%s", part->dbname));
+    else
+        rc = sdc_seq_rows(part->dbname, seq_cursor, seq_pa_id_idx,
+                          seq_read_len_idx, seq_cmp_read_idx,
+                          part->first, part->count);
+
+    VCursorRelease(seq_cursor);
+    part->rc = rc;
+    return rc;
+}
+
 /* referential integrity and data checks for sequence, primary and secondary alignment tables */
 static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
                           char const dbname[],
@@ -2082,7 +2322,8 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
 
     if ( rc == 0 )
     {
-        int64_t i;
+        uint32_t i;
+        uint32_t n;
         int64_t i_count;
         uint64_t seq_row_lmit;
         // set limits from params
@@ -2095,79 +2336,52 @@ static rc_t ridc_align_seq_pri_sec(const vdb_validate_params *pb,
 
         i_count = MIN(seq_row_lmit, seq_row_count);
 
-        for ( i = 0; i < i_count; ++i )
+        n = thread_parts(pb->threads, i_count);
+        if (n == 1)
+            rc = sdc_seq_rows(dbname, seq_cursor, seq_pa_id_idx,
+                              seq_read_len_idx, seq_cmp_read_idx,
+                              seq_id_first, i_count);
+        else
         {
-            int64_t seq_row_id = i + seq_id_first;
+            int64_t const per_part = (i_count + n - 1) / n;
+            sdc_seq_part_t *const part = calloc(n, sizeof(part[0]));
 
-            const void * data_ptr = NULL;
-            uint32_t data_len;
-            const int64_t * p_seq_pa_id;
-            const uint32_t * p_seq_read_len;
-            uint32_t seq_pa_id_len;
-
-            uint64_t sum_unaligned_read_len;
-            uint32_t j;
-
-            // SEQUENCE:PRIMARY_ALIGNMENT_ID
-            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_pa_id_idx, NULL, (const void**)&p_seq_pa_id, NULL, &seq_pa_id_len );
-            if ( rc != 0 || p_seq_pa_id == NULL )
-            {
-                if (rc == 0)
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                        "VCursorCellDataDirect() failed on SEQUENCE table, PRIMARY_ALIGNMENT_ID column, spot_id: $(SPOT_ID)",
-                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
-                break;
-            }
-
-            // SEQUENCE:READ_LEN
-            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_read_len_idx, NULL, (const void**)&p_seq_read_len, NULL, &data_len );
-            if ( rc != 0 || p_seq_read_len == NULL )
-            {
-                if (rc == 0)
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                        "VCursorCellDataDirect() failed on SEQUENCE table, READ_LEN column, spot_id: $(SPOT_ID)",
-                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
-                break;
-            }
-            if ( seq_pa_id_len != data_len )
-            {
-                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                            "SEQUENCE:$(SEQ_SPOT_ID) PRIMARY_ALIGNMENT_ID length ($(SEQ_PA_LEN)) does not match SEQUENCE:$(SEQ_SPOT_ID) READ_LEN length ($(SEQ_READ_LEN_LEN))",
-                            "name=%s,SEQ_SPOT_ID=%ld,SEQ_PA_LEN=%u,SEQ_READ_LEN_LEN=%u", dbname, seq_row_id, seq_pa_id_len, data_len));
-                break;
-            }
-
-            sum_unaligned_read_len = 0;
-            for ( j = 0; j < seq_pa_id_len; ++j )
+            if (part == NULL)
+                rc = RC(rcExe, rcDatabase, rcValidating, rcMemory, rcExhausted);
+            else
             {
-                if ( p_seq_pa_id[j] == 0 )
+                for ( i = 0; i < n; ++i )
                 {
-                    sum_unaligned_read_len += p_seq_read_len[j];
+                    part[i].dbname = dbname;
+                    part[i].seq = seq;
+                    part[i].first = seq_id_first + i * per_part;
+                    part[i].count = i + 1 < n ? per_part : i_count - i * per_part;
                 }
-            }
-
-            // SEQUENCE:CMP_READ
-            rc = VCursorCellDataDirect ( seq_cursor, seq_row_id, seq_cmp_read_idx, NULL, (const void**)&data_ptr, NULL, &data_len );
-            if ( rc != 0 /*|| data_ptr == NULL*/ )
-            {
-                if (rc == 0)
-                    rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                                        "VCursorCellDataDirect() failed on SEQUENCE table, CMP_READ column, spot_id: $(SPOT_ID)",
-                                        "name=%s,SPOT_ID=%ld", dbname, seq_row_id));
-                break;
-            }
-
-            if ( sum_unaligned_read_len != data_len )
-            {
-                rc = RC(rcExe, rcDatabase, rcValidating, rcData, rcInconsistent);
-                (void)PLOGERR(klogErr, (klogErr, rc, "Database '$(name)': "
-                            "SEQUENCE:$(SEQ_SPOT_ID) CMP_READ length ($(CMD_READ_LEN)) does not match sum of unaligned READ_LEN values ($(SUM_UNALIGNED_READ_LEN))",
-                            "name=%s,SEQ_SPOT_ID=%ld,CMD_READ_LEN=%u,SUM_UNALIGNED_READ_LEN=%lu", dbname, seq_row_id, data_len, sum_unaligned_read_len));
-                break;
+                for ( i = 1; i < n; ++i )
+                {
+                    if (KThreadMake(&part[i].thread, sdc_seq_part_thread, &part[i]) != 0)
+                    {   // check it on this thread then
+                        part[i].thread = NULL;
+                        part[i].rc = sdc_seq_rows(dbname, seq_cursor, seq_pa_id_idx,
+                                                  seq_read_len_idx, seq_cmp_read_idx,
+                                                  part[i].first, part[i].count);
+                    }
+                }
+                // the first part is checked here, with the cursor that is open already
+                part[0].rc = sdc_seq_rows(dbname, seq_cursor, seq_pa_id_idx,
+                                          seq_read_len_idx, seq_cmp_read_idx,
+                                          part[0].first, part[0].count);
+                for ( i = 1; i < n; ++i )
+                {
+                    if (part[i].thread != NULL)
+                    {
+                        KThreadWait(part[i].thread, NULL);
+                        KThreadRelease(part[i].thread);
+                    }
+                }
+                for ( i = 0; i < n && rc == 0; ++i )
+                    rc = part[i].rc;
+                free(part);
             }
         }
     }
@@ -2191,7 +2405,7 @@ static rc_t dbric_align(const vdb_validate_params *pb,
     rc_t rc = 0;
 
     if ((rc == 0 || exhaustive) && (pri != NULL && seq != NULL)) {
-        rc_t rc2 = ric_align_seq_and_pri(dbname, seq, pri);
+        rc_t rc2 = ric_align_seq_and_pri(pb->threads, dbname, seq, pri);
 
         if (rc2 == 0) {
             (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
@@ -2203,7 +2417,7 @@ static rc_t dbric_align(const vdb_validate_params *pb,
         }
     }
     if ((rc == 0 || exhaustive) && (pri != NULL && ref != NULL)) {
-        rc_t rc2 = ric_align_ref_and_align(dbname, ref, pri, 0);
+        rc_t rc2 = ric_align_ref_and_align(pb->threads, dbname, ref, pri, 0);
 
         if (rc2 == 0) {
             (void)PLOGMSG(klogInfo, (klogInfo, "Database '$(dbname)': "
@@ -2909,6 +3123,12 @@ static const char *USAGE_SDC_PLEN_THOLD[] =
 #define OPTION_NGC "ngc"
 static const char *USAGE_NGC[] = { "path to ngc file", NULL };
 
+#define OPTION_THREADS "threads"
+#define MAX_THREADS 64
+static const char *USAGE_THREADS[] =
+{ "Number of threads checking referential integrity of databases, default 1",
+  NULL };
+
 static const char *USAGE_DRI[] =
 { "Do not check data referential integrity for databases", NULL };
 
@@ -2927,6 +3147,7 @@ static OptDef options [] =
   , { OPTION_REF_INT , ALIAS_REF_INT , NULL, USAGE_REF_INT , 1, true , false }
   , { OPTION_CNS_CHK , ALIAS_CNS_CHK , NULL, USAGE_CNS_CHK , 1, true , false }
   , { OPTION_NGC     , NULL          , NULL, USAGE_NGC     , 1, true , false }
+  , { OPTION_THREADS , NULL          , NULL, USAGE_THREADS , 1, true , false }
 
     /* secondary alignment table data check options */
   , { OPTION_SDC_SEC_ROWS, NULL      , NULL, USAGE_SDC_SEC_ROWS, 1, true , false }
@@ -2989,6 +3210,7 @@ rc_t CC Usage ( const Args * args )
     HelpOptionLine(NULL          , OPTION_SDC_SEQ_ROWS, "rows"    , USAGE_SDC_SEQ_ROWS);
     HelpOptionLine(NULL          , OPTION_SDC_PLEN_THOLD, "threshold", USAGE_SDC_PLEN_THOLD);
     HelpOptionLine(NULL          , OPTION_NGC           , "path", USAGE_NGC);
+    HelpOptionLine(NULL          , OPTION_THREADS       , "count", USAGE_THREADS);
 
 /*
 #define NUM_LISTABLE_OPTIONS \
@@ -3027,6 +3249,7 @@ rc_t parse_args ( vdb_validate_params *pb, Args *args )
     pb -> sdc_seq_rows.number = 100000;
     pb -> sdc_pa_len_thold_in_percent = true;
     pb -> sdc_pa_len_thold.percent = 0.01;
+    pb -> threads = 1;
 
   {
     rc = ArgsOptionCount(args, OPTION_CNS_CHK, &cnt);
@@ -3310,6 +3533,33 @@ rc_t parse_args ( vdb_validate_params *pb, Args *args )
         }
     }
 
+/* OPTION_THREADS */
+    {
+        rc = ArgsOptionCount(args, OPTION_THREADS, &cnt);
+        if (rc != 0) {
+            LOGERR(klogErr, rc, "Failure to get '" OPTION_THREADS "' argument");
+            return rc;
+        }
+        if (cnt != 0) {
+            uint64_t value;
+            rc = ArgsOptionValue(args, OPTION_THREADS, 0, (const void **)&dummy);
+            if (rc != 0) {
+                LOGERR(klogErr, rc,
+                    "Failure to get '" OPTION_THREADS "' argument");
+                return rc;
+            }
+            value = string_to_U64 ( dummy, string_size ( dummy ), &rc );
+            if (rc == 0 && value == 0)
+                rc = RC(rcExe, rcArgv, rcParsing, rcParam, rcInvalid);
+            if (rc != 0) {
+                LOGERR(klogErr, rc,
+                    "'" OPTION_THREADS "' has illegal value (has to be 1 or more)");
+                return rc;
+            }
+            pb -> threads = value > MAX_THREADS ? MAX_THREADS : (uint32_t)value;
+        }
+    }
+
     if ( pb -> blob_crc || pb -> index_chk )
         pb -> md5_chk = pb -> md5_chk_explicit;
 
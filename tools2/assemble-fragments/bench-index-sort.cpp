@@ -0,0 +1,164 @@
+/* ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+
+/* Benchmark for the radix sort used by reorder-ir.
+ * Generates a synthetic index of N records with well-mixed 64 bit keys,
+ * sorts it with each requested number of worker threads, and reports throughput.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include "utility.hpp"
+#include "index-sort.hpp"
+
+#include <unistd.h>
+
+static uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+/// duplicates is the number of records sharing each key, like mates sharing a spot name
+static void generate(IndexRow *const index, uint64_t const N, unsigned const duplicates)
+{
+    for (auto i = uint64_t(0); i < N; ++i) {
+        union {
+            uint8_t u8[8];
+            uint64_t u64;
+        } h;
+        h.u64 = splitmix64(i / duplicates);
+        std::copy(h.u8, h.u8 + 8, index[i].key);
+        index[i].row = int64_t(i + 1);
+    }
+}
+
+static bool isSorted(IndexRow const *const index, uint64_t const N)
+{
+    for (auto i = uint64_t(1); i < N; ++i) {
+        if (IndexRow::keyLess(index[i], index[i - 1]))
+            return false;
+    }
+    return true;
+}
+
+using namespace utility;
+
+namespace benchIndexSort {
+    static void usage(CommandLine const &commandLine, bool error) {
+        (error ? std::cerr : std::cout)
+        << "usage: " << commandLine.program[0] << " [-count=<records>] [-duplicates=<n>] [-threads=<n>[,<n>...]]" << std::endl
+        << "defaults: -count=100000000 -duplicates=2 -threads=1,2,4,... up to the number of online CPUs" << std::endl;
+        exit(error ? 3 : 0);
+    }
+    
+    static std::vector<int> parseThreads(std::string const &list) {
+        auto result = std::vector<int>();
+        auto start = size_t(0);
+        
+        while (start < list.size()) {
+            auto const comma = list.find(',', start);
+            auto const item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+            auto const value = atoi(item.c_str());
+            if (value > 0)
+                result.push_back(value);
+            if (comma == std::string::npos)
+                break;
+            start = comma + 1;
+        }
+        return result;
+    }
+    
+    static int main(CommandLine const &commandLine) {
+        auto N = uint64_t(100000000);
+        auto duplicates = 2u;
+        auto threads = std::vector<int>();
+        
+        for (auto && arg : commandLine.argument) {
+            if (arg == "-help" || arg == "-h" || arg == "-?") {
+                usage(commandLine, false);
+            }
+            if (arg.substr(0, 7) == "-count=") {
+                N = strtoull(arg.substr(7).c_str(), nullptr, 10);
+                continue;
+            }
+            if (arg.substr(0, 12) == "-duplicates=") {
+                duplicates = unsigned(atoi(arg.substr(12).c_str()));
+                continue;
+            }
+            if (arg.substr(0, 9) == "-threads=") {
+                threads = parseThreads(arg.substr(9));
+                continue;
+            }
+            usage(commandLine, true);
+        }
+        if (N == 0 || duplicates == 0)
+            usage(commandLine, true);
+        if (threads.empty()) {
+            auto const cpus = int(sysconf(_SC_NPROCESSORS_ONLN));
+            for (auto i = 1; i < cpus; i *= 2)
+                threads.push_back(i);
+            threads.push_back(cpus > 1 ? cpus : 1);
+        }
+        
+        auto const index = reinterpret_cast<IndexRow *>(malloc(N * sizeof(IndexRow)));
+        auto const scratch = reinterpret_cast<IndexRow *>(malloc(N * sizeof(IndexRow)));
+        if (index == NULL || scratch == NULL) {
+            perror("error: insufficient memory for benchmark index");
+            exit(1);
+        }
+        
+        std::cout << "records\tthreads\tseconds\tMrecords/s" << std::endl;
+        for (auto && workers : threads) {
+            generate(index, N, duplicates);
+            
+            auto const start = std::chrono::steady_clock::now();
+            radixSortIndex(N, index, scratch, workers);
+            auto const stop = std::chrono::steady_clock::now();
+            auto const seconds = std::chrono::duration<double>(stop - start).count();
+            
+            if (!isSorted(scratch, N)) {
+                std::cerr << "error: output is not sorted with " << workers << " threads" << std::endl;
+                return 1;
+            }
+            std::cout << N << '\t' << workers << '\t' << seconds << '\t' << (N / seconds / 1.0e6) << std::endl;
+        }
+        free(scratch);
+        free(index);
+        return 0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    return benchIndexSort::main(CommandLine(argc, argv));
+}
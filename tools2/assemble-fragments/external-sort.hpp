@@ -0,0 +1,286 @@
+/* ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+
+#ifndef __EXTERNAL_SORT_HPP_INCLUDED__
+#define __EXTERNAL_SORT_HPP_INCLUDED__ 1
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <cassert>
+
+#include <unistd.h>
+#include <pthread.h>
+
+/** \class ExternalSort
+ * \brief A multi-threaded external merge sort of fixed-width records
+ *
+ * Records are collected in memory up to the memory budget; a full buffer is
+ * sorted in parallel and spilled to an (unlinked) temporary file. When all
+ * records have been added, the spilled runs are merged and returned in order.
+ * If nothing was spilled, the records never leave memory.
+ *
+ * T must be trivially copyable. Less must provide `bool operator()(T const &, T const &) const`
+ * and `void update()`. update() is called before every sort and before the final merge;
+ * it may refresh state used by the comparison, but it must not change the relative order
+ * of any records that were already compared.
+ */
+template <typename T, typename Less>
+class ExternalSort {
+    struct Run {
+        FILE *fp;           ///< null if the run is in memory
+        T const *cur;
+        T const *end;
+        std::vector<T> block;
+        
+        Run(T const *beg, T const *end) : fp(nullptr), cur(beg), end(end) {}
+        explicit Run(FILE *fp) : fp(fp), cur(nullptr), end(nullptr) {}
+        
+        bool fill(size_t const blockSize) {
+            if (cur != end) return true;
+            if (fp == nullptr) return false;
+            block.resize(blockSize);
+            auto const nread = fread(block.data(), sizeof(T), blockSize, fp);
+            if (nread == 0) {
+                if (ferror(fp))
+                    throw std::runtime_error("failed to read temporary sort file");
+                fclose(fp);
+                fp = nullptr;
+                std::vector<T>().swap(block);
+                return false;
+            }
+            cur = block.data();
+            end = cur + nread;
+            return true;
+        }
+    };
+    
+    Less &less;
+    size_t const capacity;      ///< records per in-memory buffer
+    unsigned const threads;
+    std::string const tempDir;
+    std::vector<T> buffer;
+    std::vector<Run> runs;
+    std::vector<unsigned> heap; ///< indices into runs, ordered by each run's current record
+    uint64_t added;
+    uint64_t consumed;
+    bool merging;
+    
+    /// a chunk to sort, or two adjacent sorted chunks to merge; the argument of a sort thread
+    struct Task {
+        T *first;
+        T *middle;          ///< null for a sort
+        T *last;
+        Less const *cmp;
+        
+        Task(T *first, T *middle, T *last, Less const *cmp) : first(first), middle(middle), last(last), cmp(cmp) {}
+        
+        static void *worker(void *vp) {
+            auto const &self = *reinterpret_cast<Task const *>(vp);
+            if (self.middle)
+                std::inplace_merge(self.first, self.middle, self.last, std::cref(*self.cmp));
+            else
+                std::sort(self.first, self.last, std::cref(*self.cmp));
+            return nullptr;
+        }
+    };
+    
+    /// runs every task on its own thread, the first on the calling thread; a task whose thread can't be made runs on the calling thread too
+    static void runTasks(std::vector<Task> &tasks) {
+        auto tids = std::vector<pthread_t>();
+        
+        for (auto i = size_t(1); i < tasks.size(); ++i) {
+            pthread_t tid = 0;
+            
+            if (pthread_create(&tid, nullptr, Task::worker, &tasks[i]) == 0)
+                tids.push_back(tid);
+            else
+                Task::worker(&tasks[i]);
+        }
+        if (!tasks.empty())
+            Task::worker(&tasks[0]);
+        // tasks must outlive every thread that is using them
+        for (auto && tid : tids)
+            pthread_join(tid, nullptr);
+    }
+    
+    /// sorts [beg, end) in parallel: the chunks are sorted on separate threads, then merged pairwise, also on separate threads
+    void sort(T *const beg, T *const end) {
+        auto const N = size_t(end - beg);
+        auto const chunks = std::max(size_t(1), std::min(size_t(threads), N / 4096));
+        auto const &cmp = less;
+        
+        if (chunks == 1) {
+            std::sort(beg, end, std::cref(cmp));
+            return;
+        }
+        
+        auto bounds = std::vector<T *>();
+        for (auto i = size_t(0); i <= chunks; ++i)
+            bounds.push_back(beg + N * i / chunks);
+        {
+            auto tasks = std::vector<Task>();
+            for (auto i = size_t(0); i < chunks; ++i)
+                tasks.emplace_back(bounds[i], nullptr, bounds[i + 1], &cmp);
+            runTasks(tasks);
+        }
+        while (bounds.size() > 2) {
+            auto tasks = std::vector<Task>();
+            auto next = std::vector<T *>();
+            auto i = size_t(0);
+            
+            for ( ; i + 2 < bounds.size(); i += 2) {
+                tasks.emplace_back(bounds[i], bounds[i + 1], bounds[i + 2], &cmp);
+                next.push_back(bounds[i]);
+            }
+            if (i + 1 < bounds.size())
+                next.push_back(bounds[i]); ///< the odd chunk out waits for the next round
+            next.push_back(end);
+            runTasks(tasks);
+            bounds.swap(next);
+        }
+    }
+    
+    FILE *tempFile() const {
+        auto path = tempDir + "/external-sort.XXXXXX";
+        auto const fd = mkstemp(&path[0]);
+        if (fd < 0)
+            throw std::runtime_error("failed to create temporary sort file in " + tempDir + ": " + strerror(errno));
+        unlink(path.c_str());
+        auto const fp = fdopen(fd, "w+b");
+        if (fp == nullptr) {
+            close(fd);
+            throw std::runtime_error("failed to open temporary sort file");
+        }
+        return fp;
+    }
+    
+    void spill() {
+        if (buffer.empty()) return;
+        
+        less.update();
+        sort(buffer.data(), buffer.data() + buffer.size());
+        
+        auto const fp = tempFile();
+        if (fwrite(buffer.data(), sizeof(T), buffer.size(), fp) != buffer.size() || fflush(fp) != 0)
+            throw std::runtime_error("failed to write temporary sort file");
+        rewind(fp);
+        runs.emplace_back(fp);
+        buffer.clear();
+    }
+    
+    static std::string defaultTempDir() {
+        auto const env = getenv("TMPDIR");
+        return std::string(env && env[0] ? env : "/tmp");
+    }
+    
+    bool heapLess(unsigned const a, unsigned const b) const {
+        // std heap functions make a max-heap
+        return less(*runs[b].cur, *runs[a].cur);
+    }
+    
+public:
+    ExternalSort(Less &less, size_t const memoryBudget, std::string const &tempDir, unsigned const threads)
+    : less(less)
+    , capacity(std::max(size_t(1), memoryBudget / sizeof(T)))
+    , threads(std::max(1u, threads))
+    , tempDir(tempDir.empty() ? defaultTempDir() : tempDir)
+    , added(0)
+    , consumed(0)
+    , merging(false)
+    {}
+    ~ExternalSort() {
+        for (auto && run : runs) {
+            if (run.fp)
+                fclose(run.fp);
+        }
+    }
+    
+    void add(T const &item) {
+        assert(!merging);
+        if (buffer.capacity() == 0)
+            buffer.reserve(capacity);
+        buffer.push_back(item);
+        ++added;
+        if (buffer.size() >= capacity)
+            spill();
+    }
+    
+    uint64_t size() const { return added; }
+    unsigned spills() const { return unsigned(runs.size()); }
+    double position() const { return added ? double(consumed) / added : 1.0; }
+    
+    /// call after the last add; switches from adding records to reading them in sorted order
+    void finish() {
+        assert(!merging);
+        merging = true;
+        
+        if (runs.empty()) {
+            less.update();
+            sort(buffer.data(), buffer.data() + buffer.size());
+            runs.emplace_back(buffer.data(), buffer.data() + buffer.size());
+        }
+        else {
+            spill();
+            std::vector<T>().swap(buffer);
+            less.update();
+        }
+        
+        auto const blockSize = std::max(size_t(4096), capacity / runs.size());
+        for (auto i = 0u; i < runs.size(); ++i) {
+            if (runs[i].fill(blockSize))
+                heap.push_back(i);
+        }
+        std::make_heap(heap.begin(), heap.end(), [this](unsigned a, unsigned b) { return heapLess(a, b); });
+    }
+    
+    /// gets the next record in sorted order; returns false when all records have been read
+    bool next(T &item) {
+        assert(merging);
+        if (heap.empty()) return false;
+        
+        auto const cmp = [this](unsigned a, unsigned b) { return heapLess(a, b); };
+        auto const blockSize = std::max(size_t(4096), capacity / runs.size());
+        
+        std::pop_heap(heap.begin(), heap.end(), cmp);
+        auto &run = runs[heap.back()];
+        item = *run.cur++;
+        ++consumed;
+        if (run.fill(blockSize))
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        else
+            heap.pop_back();
+        return true;
+    }
+};
+
+#endif // __EXTERNAL_SORT_HPP_INCLUDED__
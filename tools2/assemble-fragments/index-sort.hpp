@@ -0,0 +1,292 @@
+/* ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+
+#ifndef __INDEX_SORT_HPP_INCLUDED__
+#define __INDEX_SORT_HPP_INCLUDED__ 1
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cassert>
+#include <pthread.h>
+
+/** \struct IndexRow
+ * \brief An 8 byte sort key and the row it came from
+ */
+struct IndexRow {
+    uint8_t key[8];
+    int64_t row;
+    
+    uint64_t key64() const {
+        return *reinterpret_cast<uint64_t const *>(&key[0]);
+    }
+    static bool keyLess(IndexRow const &a, IndexRow const &b) {
+        for (auto i = 0; i < 8; ++i) {
+            if (a.key[i] < b.key[i]) return true;
+            if (a.key[i] > b.key[i]) return false;
+        }
+        return false;
+    }
+    static bool rowLess(IndexRow const &a, IndexRow const &b) {
+        return a.row < b.row;
+    }
+};
+
+/** \struct WorkUnit
+ * \brief One MSD radix pass over a range of the index
+ *
+ * The pass is a counting sort: one scan to build the histogram of the bins,
+ * one scan to scatter the records into the other buffer. Each non-empty bin
+ * becomes a work unit of the next level, with the buffers swapped.
+ */
+struct WorkUnit {
+    /// number of passes needed to consume all 64 bits of the key
+    static int const LEVELS = 10;
+    
+    IndexRow *beg;
+    IndexRow *end;
+    IndexRow *out;
+    int level;
+    
+    WorkUnit() : beg(0), end(0), out(0), level(-1) {}
+    WorkUnit(IndexRow *const beg, IndexRow *const end, IndexRow *const scratch, int const level)
+    : beg(beg)
+    , end(end)
+    , out(scratch)
+    , level(level)
+    {}
+    size_t size() const { return end - beg; }
+    
+    /// all of the key bits have been used, all of the keys in the unit are equal
+    bool exhausted() const { return level >= LEVELS; }
+    
+    void process(std::vector<WorkUnit> &result) const
+    {
+        static int const BPL[LEVELS] = { 1, 3, 4, 8, 8, 8, 8, 8, 8, 8 };
+        static int const KPL[LEVELS] = { 0, 0, 0, 1, 2, 3, 4, 5, 6, 7 };
+        static int const SPL[LEVELS] = { 7, 4, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+        assert(level < LEVELS);
+
+        auto const bins = 1 << BPL[level];
+        auto const m = bins - 1;
+        auto const k = KPL[level];
+        auto const s = SPL[level];
+        size_t start[256];
+        size_t count[256];
+        
+        std::fill(count, count + bins, 0);
+        for (auto i = beg; i != end; ++i)
+            ++count[(i->key[k] >> s) & m];
+        
+        // start[bin] is the end of the bin; next[bin] is where the next record goes
+        size_t next[256];
+        {
+            auto total = size_t(0);
+            for (auto bin = 0; bin < bins; ++bin) {
+                next[bin] = total;
+                total += count[bin];
+                start[bin] = total;
+            }
+            assert(total == size());
+        }
+        for (auto i = beg; i != end; ++i)
+            out[next[(i->key[k] >> s) & m]++] = *i;
+        
+        for (auto bin = 0; bin < bins; ++bin) {
+            auto const begin = (bin > 0 ? start[bin - 1] : 0);
+            auto const size = start[bin] - begin;
+            
+            if (size > 0)
+                result.push_back(WorkUnit(out + begin, out + begin + size, beg + begin, level + 1));
+        }
+    }
+};
+
+struct Context {
+    IndexRow *const src;
+    IndexRow *const srcEnd;
+    IndexRow *const out;
+    IndexRow *const outEnd;
+    size_t const smallSize; // chunk size above which more work units may be produced, else the sort is done in one shot
+    
+    pthread_mutex_t mutex; // protects the entire structure against mutation by other threads
+    pthread_cond_t cond_running;
+    unsigned running; // count of number of work units being processed, work units which might produce more work units; this is to prevent workers from quiting early, when the queue is empty but might not stay empty
+    unsigned next; // next work unit to be processed; the queue is considered empty when next == queue.size()
+    std::vector<WorkUnit> queue; // the queue is only ever appended to
+    
+    Context(IndexRow *Src, IndexRow *Out, size_t count, size_t smallSize)
+    : src(Src)
+    , srcEnd(src + count)
+    , out(Out)
+    , outEnd(out + count)
+    , smallSize(smallSize)
+    , mutex(PTHREAD_MUTEX_INITIALIZER)
+    , cond_running(PTHREAD_COND_INITIALIZER)
+    , running(0)
+    , next(0)
+    {
+        queue.push_back(WorkUnit(src, srcEnd, out, 0));
+    }
+    
+    void run(void) {
+        auto newWork = std::vector<WorkUnit>();
+        
+        newWork.reserve(256);
+        
+        pthread_mutex_lock(&mutex);
+        for ( ;; ) {
+            if (next < queue.size()) {
+                auto const unit = queue[next++];
+                ++running;
+                
+                // the mutex is released before processing the work unit
+                pthread_mutex_unlock(&mutex);
+                {
+                    newWork.clear();
+                    if (unit.size() <= smallSize || unit.exhausted()) {
+                        // sort in one shot
+                        std::sort(unit.beg, unit.end, IndexRow::keyLess);
+                        if (unit.beg >= src && unit.end <= srcEnd)
+                            std::copy(unit.beg, unit.end, out + (unit.beg - src));
+                    }
+                    else {
+                        // partial sort, can generate more work units
+                        unit.process(newWork);
+                    }
+                }
+                // the mutex is re-acquired after processing the work unit
+                pthread_mutex_lock(&mutex);
+                std::copy(newWork.begin(), newWork.end(), std::back_inserter(queue));
+
+                --running;
+                pthread_cond_broadcast(&cond_running);
+            }
+            else if (running > 0) {
+                pthread_cond_wait(&cond_running, &mutex);
+            }
+            else
+                break;
+            // it is an invariant that the mutex is held by the current thread regardless of the code path taken
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+    
+    static void *worker(void *p)
+    {
+        static_cast<Context *>(p)->run();
+        return nullptr;
+    }
+};
+
+#if __APPLE__
+#include <sys/sysctl.h>
+
+/* want one worker thread per physical core
+ * could go with one per logical but that would just make bus contention worse
+ * the bottleneck is I/O to memory
+ */
+static inline int getWorkerCount()
+{
+    size_t len;
+    
+    auto physCPU = int32_t(0);
+    len = sizeof(physCPU);
+    if (sysctlbyname("hw.physicalcpu", &physCPU, &len, 0, 0) == 0 && physCPU > 0) {
+        return physCPU;
+    }
+    return 1;
+}
+
+/* This tries to take into account that different caches are shared amongst
+ * different numbers of cores. It picks based on the largest cache per core.
+ *
+ * The idea is that, once a workunit fits entirely into cache, it's not
+ * productive to break it down into smaller workunits. Instead, sort it
+ * completely, in-place, on one thread.
+ */
+static size_t getSmallSize(int const workers)
+{
+    size_t len;
+    /* these two are layed out as
+     * [0]: RAM; [1]: L1 cache; [2]: L2 cache; etc.
+     * an entry is 0 if there is no cache at that level
+     */
+    uint64_t cacheSize[16] = {0};
+    // gives the number of logical cores which share a cache level
+    uint64_t cacheSharing[16] = {0};
+    
+    len = sizeof(cacheSharing);
+    sysctlbyname("hw.cacheconfig", cacheSharing, &len, 0, 0);
+    sysctlbyname("hw.cachesize", cacheSize, &len, 0, 0);
+    
+    auto cache = size_t(0);
+    auto const N = len / sizeof(cacheSize[0]);
+    for (auto i = N < 4 ? N : 4; i; ) {
+        auto j = --i;
+        if (j < 2)
+            break;
+        if (cacheSize[j] == 0 || cacheSharing[j] == 0)
+            continue;
+        auto const cache1 = cacheSize[j] / cacheSharing[j];
+        if (cache < cache1)
+            cache = cache1;
+    }
+    cache /= sizeof(IndexRow);
+    return (cache < 32 * 1024) ? (32 * 1024) : cache;
+}
+#else
+static inline int getWorkerCount()
+{
+    return 2;
+}
+static size_t getSmallSize(int const workers)
+{
+    return (64 * 1024) / workers;
+}
+#endif
+
+/// sorts N records of index by key, the sorted result is put into scratch; the contents of index are destroyed
+static void radixSortIndex(uint64_t const N, IndexRow *const index, IndexRow *const scratch, int const workers)
+{
+    auto const smallSize = getSmallSize(workers);
+    auto context = Context(index, scratch, N, smallSize);
+    auto tids = std::vector<pthread_t>();
+    
+    for (auto i = 1; i < workers; ++i) {
+        pthread_t tid = 0;
+        
+        if (pthread_create(&tid, nullptr, Context::worker, &context) == 0)
+            tids.push_back(tid);
+    }
+    Context::worker(&context);
+    // context must outlive every thread that is using it
+    for (auto && tid : tids)
+        pthread_join(tid, nullptr);
+}
+
+#endif // __INDEX_SORT_HPP_INCLUDED__
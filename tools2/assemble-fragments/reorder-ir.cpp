@@ -37,6 +37,7 @@
 #include "utility.hpp"
 #include "vdb.hpp"
 #include "writer.hpp"
+#include "index-sort.hpp"
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -90,25 +91,6 @@ static void randomizeSBox(void) {
     }
 }
 
-struct IndexRow {
-    uint8_t key[8];
-    VDB::Cursor::RowID row;
-    
-    uint64_t key64() const {
-        return *reinterpret_cast<uint64_t const *>(&key[0]);
-    }
-    static bool keyLess(IndexRow const &a, IndexRow const &b) {
-        for (auto i = 0; i < 8; ++i) {
-            if (a.key[i] < b.key[i]) return true;
-            if (a.key[i] > b.key[i]) return false;
-        }
-        return false;
-    }
-    static bool rowLess(IndexRow const &a, IndexRow const &b) {
-        return a.row < b.row;
-    }
-};
-
 static IndexRow makeIndexRow(VDB::Cursor::RowID row, VDB::Cursor::RawData const &group, VDB::Cursor::RawData const &name)
 {
     IndexRow y;
@@ -131,201 +113,6 @@ static IndexRow makeIndexRow(VDB::Cursor::RowID row, VDB::Cursor::RawData const
     return y;
 }
 
-struct WorkUnit {
-    IndexRow *beg;
-    IndexRow *end;
-    IndexRow *out;
-    int level;
-    
-    WorkUnit() : beg(0), end(0), out(0), level(-1) {}
-    WorkUnit(IndexRow *const beg, IndexRow *const end, IndexRow *const scratch, int const level)
-    : beg(beg)
-    , end(end)
-    , out(scratch)
-    , level(level)
-    {}
-    size_t size() const { return end - beg; }
-    
-    void process(std::vector<WorkUnit> &result) const
-    {
-        static int const BPL[] = { 1, 3, 4, 8, 8, 8, 8, 8, 8, 8 };
-        static int const KPL[] = { 0, 0, 0, 1, 2, 3, 4, 5, 6, 7 };
-        static int const SPL[] = { 7, 4, 0, 0, 0, 0, 0, 0, 0, 0 };
-
-        assert(level < sizeof(BPL)/sizeof(BPL[0]));
-
-        auto const bins = 1 << BPL[level];
-        auto const m = bins - 1;
-        auto const k = KPL[level];
-        auto const s = SPL[level];
-        size_t start[256];
-        IndexRow *cur = out;
-        
-        for (auto bin = 0; bin < bins; ++bin) {
-            for (auto i = beg; i != end; ++i) {
-                auto const key = (i->key[k] >> s) & m;
-                if (key == bin)
-                    *cur++ = *i;
-            }
-            start[bin] = cur - out;
-        }
-        
-        for (auto bin = 0; bin < bins; ++bin) {
-            auto const begin = (bin > 0 ? start[bin - 1] : 0);
-            auto const count = start[bin] - begin;
-            
-            if (count > 0) {
-                assert(level + 1 < sizeof(BPL)/sizeof(BPL[0]));
-                result.push_back(WorkUnit(out + begin, out + begin + count, beg + begin, level + 1));
-            }
-        }
-    }
-};
-
-struct Context {
-    IndexRow *const src;
-    IndexRow *const srcEnd;
-    IndexRow *const out;
-    IndexRow *const outEnd;
-    size_t const smallSize; // chunk size above which more work units may be produced, else the sort is done in one shot
-    
-    pthread_mutex_t mutex; // protects the entire structure against mutation by other threads
-    pthread_cond_t cond_running;
-    unsigned running; // count of number of work units being processed, work units which might produce more work units; this is to prevent workers from quiting early, when the queue is empty but might not stay empty
-    unsigned next; // next work unit to be processed; the queue is considered empty when next == queue.size()
-    std::vector<WorkUnit> queue; // the queue is only ever appended to
-    
-    Context(IndexRow *Src, IndexRow *Out, size_t count, size_t smallSize)
-    : src(Src)
-    , srcEnd(src + count)
-    , out(Out)
-    , outEnd(out + count)
-    , next(0)
-    , running(0)
-    , smallSize(smallSize)
-    , mutex(PTHREAD_MUTEX_INITIALIZER)
-    , cond_running(PTHREAD_COND_INITIALIZER)
-    {
-        queue.push_back(WorkUnit(src, srcEnd, out, 0));
-    }
-    
-    void run(void) {
-        auto newWork = std::vector<WorkUnit>();
-        
-        newWork.reserve(256);
-        
-        pthread_mutex_lock(&mutex);
-        for ( ;; ) {
-            if (next < queue.size()) {
-                auto const unit = queue[next++];
-                ++running;
-                
-                // the mutex is released before processing the work unit
-                pthread_mutex_unlock(&mutex);
-                {
-                    newWork.clear();
-                    if (unit.size() <= smallSize) {
-                        // sort in one shot
-                        std::sort(unit.beg, unit.end, IndexRow::keyLess);
-                        if (unit.beg >= src && unit.end <= srcEnd)
-                            std::copy(unit.beg, unit.end, out + (unit.beg - src));
-                    }
-                    else {
-                        // partial sort, can generate more work units
-                        unit.process(newWork);
-                    }
-                }
-                // the mutex is re-acquired after processing the work unit
-                pthread_mutex_lock(&mutex);
-                std::copy(newWork.begin(), newWork.end(), std::back_inserter(queue));
-
-                --running;
-                pthread_cond_signal(&cond_running);
-            }
-            else if (running > 0) {
-                pthread_cond_wait(&cond_running, &mutex);
-            }
-            else
-                break;
-            // it is an invariant that the mutex is held by the current thread regardless of the code path taken
-        }
-        pthread_mutex_unlock(&mutex);
-    }
-};
-
-static void *worker(void *p)
-{
-    static_cast<Context *>(p)->run();
-    return nullptr;
-}
-
-#if __APPLE__
-#include <sys/sysctl.h>
-
-/* want one worker thread per physical core
- * could go with one per logical but that would just make bus contention worse
- * the bottleneck is I/O to memory
- */
-static int getWorkerCount()
-{
-    size_t len;
-    
-    auto physCPU = int32_t(0);
-    len = sizeof(physCPU);
-    if (sysctlbyname("hw.physicalcpu", &physCPU, &len, 0, 0) == 0 && physCPU > 0) {
-        return physCPU;
-    }
-    return 1;
-}
-
-/* This tries to take into account that different caches are shared amongst
- * different numbers of cores. It picks based on the largest cache per core.
- *
- * The idea is that, once a workunit fits entirely into cache, it's not
- * productive to break it down into smaller workunits. Instead, sort it
- * completely, in-place, on one thread.
- */
-static size_t getSmallSize(int const workers)
-{
-    size_t len;
-    /* these two are layed out as
-     * [0]: RAM; [1]: L1 cache; [2]: L2 cache; etc.
-     * an entry is 0 if there is no cache at that level
-     */
-    uint64_t cacheSize[16] = {0};
-    // gives the number of logical cores which share a cache level
-    uint64_t cacheSharing[16] = {0};
-    
-    len = sizeof(cacheSharing);
-    sysctlbyname("hw.cacheconfig", cacheSharing, &len, 0, 0);
-    sysctlbyname("hw.cachesize", cacheSize, &len, 0, 0);
-    
-    auto cache = size_t(0);
-    auto const N = len / sizeof(cacheSize[0]);
-    for (auto i = N < 4 ? N : 4; i; ) {
-        auto j = --i;
-        if (j < 2)
-            break;
-        if (cacheSize[j] == 0 || cacheSharing[j] == 0)
-            continue;
-        auto const cache1 = cacheSize[j] / cacheSharing[j];
-        if (cache < cache1)
-            cache = cache1;
-    }
-    cache /= sizeof(IndexRow);
-    return (cache < 32 * 1024) ? (32 * 1024) : cache;
-}
-#else
-static int getWorkerCount()
-{
-    return 2;
-}
-static size_t getSmallSize(int const workers)
-{
-    return (64 * 1024) / workers;
-}
-#endif
-
 static void sortIndex(uint64_t const N, IndexRow *const index)
 {
     auto const scratch = reinterpret_cast<IndexRow *>(malloc(N * sizeof(IndexRow)));
@@ -333,19 +120,7 @@ static void sortIndex(uint64_t const N, IndexRow *const index)
         perror("error: insufficient memory to create temporary index");
         exit(1);
     }
-    {
-        auto const workers = getWorkerCount();
-        auto const smallSize = getSmallSize(workers);
-        auto context = Context(index, scratch, N, smallSize);
-        
-        for (auto i = 1; i < workers; ++i) {
-            pthread_t tid = 0;
-            
-            pthread_create(&tid, nullptr, worker, &context);
-            pthread_detach(tid);
-        }
-        worker(&context);
-    }
+    radixSortIndex(N, index, scratch, getWorkerCount());
     uint64_t keys = 1;
     {
         auto last = scratch->key64();
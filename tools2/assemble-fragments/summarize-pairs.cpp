@@ -40,6 +40,7 @@
 #include "vdb.hpp"
 #include "writer.hpp"
 #include "fragment.hpp"
+#include "external-sort.hpp"
 
 using namespace utility;
 
@@ -346,7 +347,67 @@ struct ContigPair { ///< a pair of contigs that are *known* to be joined, e.g. t
     }
 };
 
-static int process(VDB::Writer const &out, LineBuffer &ifs)
+/// the same order as `sort -k1,1 -k2n,2n -k3n,3n -k4,4 -k5n,5n -k6n,6n` (in the C locale) gives to the text form
+struct ContigPairOrder {
+    std::vector<unsigned> refRank;
+    std::vector<unsigned> groupRank;
+    
+    static std::vector<unsigned> ranks(strings_map const &names) {
+        auto const N = names.count();
+        auto byName = std::vector<std::pair<std::string, unsigned>>();
+        auto result = std::vector<unsigned>(N);
+        
+        byName.reserve(N);
+        for (auto i = decltype(N)(0); i < N; ++i)
+            byName.emplace_back(names[i], i);
+        std::sort(byName.begin(), byName.end());
+        for (auto i = decltype(N)(0); i < N; ++i)
+            result[byName[i].second] = i;
+        return result;
+    }
+    /// new names can only appear between existing ones, so previously sorted records stay in order
+    void update() {
+        refRank = ranks(references);
+        groupRank = ranks(groups);
+    }
+    bool operator ()(ContigPair const &a, ContigPair const &b) const {
+        if (a.first.ref != b.first.ref) return refRank[a.first.ref] < refRank[b.first.ref];
+        if (a.first.start != b.first.start) return a.first.start < b.first.start;
+        if (a.first.end != b.first.end) return a.first.end < b.first.end;
+        if (a.second.ref != b.second.ref) return refRank[a.second.ref] < refRank[b.second.ref];
+        if (a.second.start != b.second.start) return a.second.start < b.second.start;
+        if (a.second.end != b.second.end) return a.second.end < b.second.end;
+        return groupRank[a.group] < groupRank[b.group]; ///< sort's last-resort comparison of the whole line
+    }
+};
+
+typedef ExternalSort<ContigPair, ContigPairOrder> ContigPairSort;
+
+/// contig pairs parsed from the sorted text output of `map`
+struct TextSource {
+    LineBuffer &in;
+    
+    explicit TextSource(LineBuffer &in) : in(in) {}
+    ContigPair next() { return ContigPair(in); }
+    double position() const { return in.position(); }
+};
+
+/// contig pairs in their sorted binary form, straight from `map-reduce`
+struct SortedSource {
+    ContigPairSort &in;
+    
+    explicit SortedSource(ContigPairSort &in) : in(in) {}
+    ContigPair next() {
+        auto result = ContigPair();
+        if (!in.next(result))
+            result.count = 0;
+        return result;
+    }
+    double position() const { return in.position(); }
+};
+
+template <typename Source>
+static int process(VDB::Writer const &out, Source &ifs)
 {
     auto active = std::vector<ContigPair>();
     
@@ -361,7 +422,7 @@ static int process(VDB::Writer const &out, LineBuffer &ifs)
     auto report = freq;
 
     for ( ; ; ) {
-        auto pair = ContigPair(ifs);
+        auto pair = ifs.next();
         auto const isEOF = pair.count == 0;
         
         if ((!active.empty() && (pair.first.ref != ref || pair.first.start >= end)) || isEOF) {
@@ -535,13 +596,21 @@ static int reduce(FILE *out, std::string const &source)
     ContigPair::setup(writer);
 
     writer.beginWriting();
-    auto const result = process(writer, in);
+    auto pairs = TextSource(in);
+    auto const result = process(writer, pairs);
     writer.endWriting();
     
     return result;
 }
 
-static int map(FILE *out, std::string const &run)
+static struct {
+    size_t memory = size_t(1024) << 20;
+    std::string temp;
+    unsigned threads = 2;
+} sortOptions;
+
+template <typename F>
+static void mapPairs(std::string const &run, F &&f)
 {
     auto const mgr = VDB::Manager();
     auto const inDb = mgr[run];
@@ -557,16 +626,49 @@ static int map(FILE *out, std::string const &run)
             for (auto && two : fragment.detail) {
                 if (two.readNo != 2 || !two.aligned) continue;
                 
-                ContigPair(one, two, fragment.group).write(out);
+                f(ContigPair(one, two, fragment.group));
             }
         }
     }
+}
+
+static int map(FILE *out, std::string const &run)
+{
+    mapPairs(run, [&](ContigPair const &pair) { pair.write(out); });
     return 0;
 }
 
+/// map, sort and reduce in one process; the contig pairs are never converted to text
+static int mapReduce(FILE *out, std::string const &run)
+{
+    auto order = ContigPairOrder();
+    ContigPairSort sorter(order, sortOptions.memory, sortOptions.temp, sortOptions.threads);
+    
+    mapPairs(run, [&](ContigPair const &pair) { sorter.add(pair); });
+    std::cerr << "info: sorting " << sorter.size() << " contig pairs; " << sorter.spills() << " runs spilled to disk" << std::endl;
+    sorter.finish();
+    
+    auto const writer = VDB::Writer(out);
+    
+    writer.destination("IR.vdb");
+    writer.schema("aligned-ir.schema.text", "NCBI:db:IR:raw");
+    writer.info("summarize-pairs", "1.0.0");
+    
+    ContigPair::setup(writer);
+    
+    writer.beginWriting();
+    auto pairs = SortedSource(sorter);
+    auto const result = process(writer, pairs);
+    writer.endWriting();
+    
+    return result;
+}
+
 namespace pairsStatistics {
     static void usage(CommandLine const &commandLine, bool error) {
-        (error ? std::cerr : std::cout) << "usage: " << commandLine.program[0] << " [-out=<path>] (map <sra run> | reduce <pairs>)" << std::endl;
+        (error ? std::cerr : std::cout)
+        << "usage: " << commandLine.program[0] << " [-out=<path>] (map <sra run> | reduce <pairs>)" << std::endl
+        << "       " << commandLine.program[0] << " [-out=<path>] [-memory=<MB>] [-temp=<dir>] [-threads=<n>] map-reduce <sra run>" << std::endl;
         exit(error ? 3 : 0);
     }
     
@@ -584,11 +686,31 @@ namespace pairsStatistics {
                 outPath = arg.substr(5);
                 continue;
             }
+            if (arg.substr(0, 8) == "-memory=") {
+                auto const mb = strtoul(arg.substr(8).c_str(), nullptr, 10);
+                if (mb == 0)
+                    usage(commandLine, true);
+                sortOptions.memory = size_t(mb) << 20;
+                continue;
+            }
+            if (arg.substr(0, 6) == "-temp=") {
+                sortOptions.temp = arg.substr(6);
+                continue;
+            }
+            if (arg.substr(0, 9) == "-threads=") {
+                auto const n = atoi(arg.substr(9).c_str());
+                if (n <= 0)
+                    usage(commandLine, true);
+                sortOptions.threads = unsigned(n);
+                continue;
+            }
             if (verb == nullptr) {
                 if (arg == "map")
                     verb = &map;
                 else if (arg == "reduce")
                     verb = &reduce;
+                else if (arg == "map-reduce")
+                    verb = &mapReduce;
                 else
                     usage(commandLine, true);
                 continue;
@@ -0,0 +1,64 @@
+#!/bin/sh
+# ===========================================================================
+#
+#                            PUBLIC DOMAIN NOTICE
+#               National Center for Biotechnology Information
+#
+#  This software/database is a "United States Government Work" under the
+#  terms of the United States Copyright Act.  It was written as part of
+#  the author's official duties as a United States Government employee and
+#  thus cannot be copyrighted.  This software/database is freely available
+#  to the public for use. The National Library of Medicine and the U.S.
+#  Government have not placed any restriction on its use or reproduction.
+#
+#  Although all reasonable efforts have been taken to ensure the accuracy
+#  and reliability of the software and data, the NLM and the U.S.
+#  Government do not and cannot warrant the performance or results that
+#  may be obtained by using this software or data. The NLM and the U.S.
+#  Government disclaim all warranties, express or implied, including
+#  warranties of performance, merchantability or fitness for any particular
+#  purpose.
+#
+#  Please cite the author in any work or product based on this material.
+#
+# ===========================================================================
+#
+# summarize-pairs map-reduce must write the same contigs as
+# map | sort | reduce. The sort gets 1 MB, much less than the contig pairs
+# of the test data, so it spills several runs and merges them.
+#
+# usage: test-map-reduce.sh [<contigs of test data>]
+# general-loader must be in PATH, INCLUDE and SCHEMA as for load-sra.sh
+
+N=${1:-2000}
+INCLUDE=${INCLUDE:-include}
+SCHEMA=${SCHEMA:-../shared/schema}
+TEMP=test-map-reduce.$$
+LOAD="general-loader --log-level=err --include=${INCLUDE} --schema=${SCHEMA}/aligned-ir.schema.text"
+
+fail() {
+    echo "test-map-reduce: $1"
+    rm -rf $TEMP
+    exit 1
+}
+
+rm -rf $TEMP ; mkdir -p $TEMP || fail "can not make $TEMP"
+
+perl generate-test-data.pl -n $N | ./text2ir | $LOAD --target=$TEMP/test.IR || fail "text2ir failed"
+./reorder-ir $TEMP/test.IR | $LOAD --target=$TEMP/test.sorted.IR || fail "reorder-ir failed"
+./filter-ir $TEMP/test.sorted.IR | $LOAD --target=$TEMP/test.filtered.IR || fail "filter-ir failed"
+
+./summarize-pairs map $TEMP/test.filtered.IR > $TEMP/pairs || fail "map failed"
+LC_ALL=C sort -k1,1 -k2n,2n -k3n,3n -k4,4 -k5n,5n -k6n,6n $TEMP/pairs | ./summarize-pairs reduce - > $TEMP/expected || fail "reduce failed"
+
+./summarize-pairs -memory=1 -temp=$TEMP -threads=4 map-reduce $TEMP/test.filtered.IR > $TEMP/actual 2> $TEMP/stderr || fail "map-reduce failed"
+
+# the merge has to have something to merge
+SPILLED=`sed -n 's/.* \([0-9][0-9]*\) runs spilled to disk$/\1/p' $TEMP/stderr`
+[ "${SPILLED:-0}" -ge 2 ] || fail "expected several runs spilled to disk, got '${SPILLED}'"
+
+cmp -s $TEMP/expected $TEMP/actual || fail "map-reduce differs from map | sort | reduce"
+
+echo "test-map-reduce: $SPILLED runs merged, output matches map | sort | reduce"
+rm -rf $TEMP
+exit 0
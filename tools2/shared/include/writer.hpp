@@ -77,7 +77,76 @@ namespace VDB {
             logMesg,
             progressMesg
         };
-        FILE *stream;
+        /** \class Output
+         * \brief Collects the serialized events in a large contiguous buffer
+         *
+         * Events are only handed to stdio when the buffer fills or is flushed,
+         * so a row of many small cells costs one memcpy per field instead of
+         * several locked fwrite calls. The bytes written are the same either way.
+         * A capacity of 0 writes every field straight through with fwrite.
+         */
+        class Output {
+            FILE *fp;
+            char *buffer;
+            size_t used;
+            size_t capacity;
+            
+            Output(Output const &) = delete;
+            Output &operator =(Output const &) = delete;
+        public:
+            explicit Output(FILE *const fp, size_t const capacity)
+            : fp(fp)
+            , buffer(capacity > 0 ? new char[capacity] : nullptr)
+            , used(0)
+            , capacity(capacity)
+            {}
+            Output(Output &&other)
+            : fp(other.fp)
+            , buffer(other.buffer)
+            , used(other.used)
+            , capacity(other.capacity)
+            {
+                other.buffer = nullptr;
+                other.used = other.capacity = 0;
+            }
+            ~Output() {
+                drain();
+                delete [] buffer;
+            }
+            
+            /// same contract as fwrite, returns count if everything was accepted
+            size_t write(void const *const data, size_t const elsize, size_t const count) {
+                auto const size = elsize * count;
+                if (used + size > capacity) {
+                    if (!drain())
+                        return 0;
+                    if (size > capacity)
+                        return fwrite(data, elsize, count, fp);
+                }
+                std::copy(static_cast<char const *>(data), static_cast<char const *>(data) + size, buffer + used);
+                used += size;
+                return count;
+            }
+            
+            /// hands the buffered events to stdio with one fwrite
+            bool drain() {
+                if (used == 0) return true;
+                auto const size = used;
+                used = 0;
+                return fwrite(buffer, 1, size, fp) == size;
+            }
+            
+            bool resize(size_t const newCapacity) {
+                if (!drain()) return false;
+                delete [] buffer;
+                buffer = newCapacity > 0 ? new char[newCapacity] : nullptr;
+                capacity = newCapacity;
+                return true;
+            }
+            
+            FILE *file() const { return fp; }
+        };
+        mutable Output stream;
 
         class Version {
             int major = 0;
@@ -99,7 +168,7 @@ namespace VDB {
         
         class StreamHeader {
             friend Writer;
-            bool write(FILE *const stream) const
+            bool write(Output &stream) const
             {
                 struct h {
                     char sig[8];
@@ -108,7 +177,7 @@ namespace VDB {
                     uint32_t size;
                     uint32_t packing;
                 } const h = { { 'N', 'C', 'B', 'I', 'g', 'n', 'l', 'd' }, 1, 2, sizeof(struct h), 0 };
-                return fwrite(&h, sizeof(h), 1, stream) == 1;
+                return stream.write(&h, sizeof(h), 1) == 1;
             }
         public:
             StreamHeader() {};
@@ -118,9 +187,9 @@ namespace VDB {
             friend Writer;
             uint32_t eid;
 
-            bool write(FILE *const stream) const
+            bool write(Output &stream) const
             {
-                return fwrite(&eid, sizeof(eid), 1, stream) == 1;
+                return stream.write(&eid, sizeof(eid), 1) == 1;
             }
         public:
             SimpleEvent(EventCode const code, unsigned const id) : eid((code << 24) + id) {}
@@ -131,14 +200,14 @@ namespace VDB {
             uint32_t eid;
             std::string const &str;
 
-            bool write(FILE *const stream) const {
+            bool write(Output &stream) const {
                 uint32_t const zero = 0;
                 auto const size = (uint32_t)str.size();
                 auto const padding = (4 - (size & 3)) & 3;
-                return fwrite(&eid, sizeof(eid), 1, stream) == 1
-                    && fwrite(&size, sizeof(size), 1, stream) == 1
-                    && fwrite(str.data(), 1, size, stream) == size
-                    && fwrite(&zero, 1, padding, stream) == padding;
+                return stream.write(&eid, sizeof(eid), 1) == 1
+                    && stream.write(&size, sizeof(size), 1) == 1
+                    && stream.write(str.data(), 1, size) == size
+                    && stream.write(&zero, 1, padding) == padding;
             }
         public:
             String1Event(EventCode const code, unsigned const id, std::string const &str)
@@ -153,18 +222,18 @@ namespace VDB {
             std::string const &str1;
             std::string const &str2;
 
-            bool write(FILE *const stream) const {
+            bool write(Output &stream) const {
                 uint32_t const zero = 0;
                 auto const size1 = (uint32_t)str1.size();
                 auto const size2 = (uint32_t)str2.size();
                 auto const size = size1 + size2;
                 auto const padding = (4 - (size & 3)) & 3;
-                return fwrite(&eid, sizeof(eid), 1, stream) == 1
-                    && fwrite(&size1, sizeof(size1), 1, stream) == 1
-                    && fwrite(&size2, sizeof(size2), 1, stream) == 1
-                    && fwrite(str1.data(), 1, size1, stream) == size1
-                    && fwrite(str2.data(), 1, size2, stream) == size2
-                    && fwrite(&zero, 1, padding, stream) == padding;
+                return stream.write(&eid, sizeof(eid), 1) == 1
+                    && stream.write(&size1, sizeof(size1), 1) == 1
+                    && stream.write(&size2, sizeof(size2), 1) == 1
+                    && stream.write(str1.data(), 1, size1) == size1
+                    && stream.write(str2.data(), 1, size2) == size2
+                    && stream.write(&zero, 1, padding) == padding;
             }
         public:
             String2Event(EventCode const code, unsigned const id, std::string const &str_1, std::string const &str_2)
@@ -181,16 +250,16 @@ namespace VDB {
             uint32_t bits;
             std::string const &name;
             
-            bool write(FILE *const stream) const {
+            bool write(Output &stream) const {
                 uint32_t const zero = 0;
                 auto const size = (uint32_t)name.size();
                 auto const padding = (4 - (size & 3)) & 3;
-                return fwrite(&eid, sizeof(eid), 1, stream) == 1
-                    && fwrite(&tid, sizeof(tid), 1, stream) == 1
-                    && fwrite(&bits, sizeof(bits), 1, stream) == 1
-                    && fwrite(&size, sizeof(size), 1, stream) == 1
-                    && fwrite(name.data(), 1, size, stream) == size
-                    && fwrite(&zero, 1, padding, stream) == padding;
+                return stream.write(&eid, sizeof(eid), 1) == 1
+                    && stream.write(&tid, sizeof(tid), 1) == 1
+                    && stream.write(&bits, sizeof(bits), 1) == 1
+                    && stream.write(&size, sizeof(size), 1) == 1
+                    && stream.write(name.data(), 1, size) == size
+                    && stream.write(&zero, 1, padding) == padding;
             }
         public:
             ColumnEvent(EventCode const code, unsigned const cid, unsigned const tid_, unsigned const elemBits, std::string const &str)
@@ -210,18 +279,18 @@ namespace VDB {
             uint32_t percent;
             std::string const &message;
 
-            bool write(FILE *const stream) const {
+            bool write(Output &stream) const {
                 uint32_t const zero = 0;
                 auto const size = (uint32_t)message.size();
                 auto const padding = (4 - (size & 3)) & 3;
-                return fwrite(&eid, sizeof(eid), 1, stream) == 1
-                    && fwrite(&version, sizeof(version), 1, stream) == 1
-                    && fwrite(&timestamp, sizeof(timestamp), 1, stream) == 1
-                    && fwrite(&pid, sizeof(pid), 1, stream) == 1
-                    && fwrite(&size, sizeof(size), 1, stream) == 1
-                    && fwrite(&percent, sizeof(percent), 1, stream) == 1
-                    && fwrite(message.data(), 1, size, stream) == size
-                    && fwrite(&zero, 1, padding, stream) == padding;
+                return stream.write(&eid, sizeof(eid), 1) == 1
+                    && stream.write(&version, sizeof(version), 1) == 1
+                    && stream.write(&timestamp, sizeof(timestamp), 1) == 1
+                    && stream.write(&pid, sizeof(pid), 1) == 1
+                    && stream.write(&size, sizeof(size), 1) == 1
+                    && stream.write(&percent, sizeof(percent), 1) == 1
+                    && stream.write(message.data(), 1, size) == size
+                    && stream.write(&zero, 1, padding) == padding;
             }
             static uint32_t now() {
                 auto tm = time(nullptr);
@@ -255,10 +324,10 @@ namespace VDB {
             uint32_t const zero = 0;
             auto const size = elsize * count;
             auto const padding = (4 - (size & 3)) & 3;
-            return fwrite(&eid, sizeof(eid), 1, stream) == 1
-                && fwrite(&count, sizeof(count), 1, stream) == 1
-                && fwrite(data, elsize, count, stream) == count
-                && fwrite(&zero, 1, padding, stream) == padding;
+            return stream.write(&eid, sizeof(eid), 1) == 1
+                && stream.write(&count, sizeof(count), 1) == 1
+                && stream.write(data, elsize, count) == count
+                && stream.write(&zero, 1, padding) == padding;
         }
         template <typename T>
         bool write(EventCode const code, unsigned const cid, uint32_t const count, T const *data) const
@@ -267,10 +336,10 @@ namespace VDB {
             uint32_t const zero = 0;
             auto const size = sizeof(T) * count;
             auto const padding = (4 - (size & 3)) & 3;
-            return fwrite(&eid, sizeof(eid), 1, stream) == 1
-                && fwrite(&count, sizeof(count), 1, stream) == 1
-                && fwrite(data, sizeof(T), count, stream) == count
-                && fwrite(&zero, 1, padding, stream) == padding;
+            return stream.write(&eid, sizeof(eid), 1) == 1
+                && stream.write(&count, sizeof(count), 1) == 1
+                && stream.write(data, sizeof(T), count) == count
+                && stream.write(&zero, 1, padding) == padding;
         }
         template <typename T>
         bool write(EventCode const code, unsigned const cid, T const &data) const
@@ -282,11 +351,19 @@ namespace VDB {
             return write(code, cid, (uint32_t)data.size(), (uint32_t)sizeof(std::string::value_type), data.data());
         }
     public:
-        Writer(FILE *const stream_)
-        : stream(stream_)
+        enum { defaultBufferSize = 1024 * 1024 };
+        
+        Writer(FILE *const stream_, size_t const bufferSize = defaultBufferSize)
+        : stream(stream_, bufferSize)
         {
             StreamHeader().write(stream);
         }
+        
+        /// the size of the event buffer; 0 writes each field of each event through stdio as it is made
+        bool setBufferSize(size_t const bufferSize) const
+        {
+            return stream.resize(bufferSize);
+        }
 
         bool logMessage(std::string const &message) const
         {
@@ -388,11 +465,12 @@ namespace VDB {
         
         bool endWriting() const
         {
-            return SimpleEvent(endStream, 0).write(stream);
+            return SimpleEvent(endStream, 0).write(stream) && stream.drain();
         }
         
-        auto flush() const -> decltype(fflush(stream)) {
-            return fflush(stream);
+        auto flush() const -> decltype(fflush(stream.file())) {
+            stream.drain();
+            return fflush(stream.file());
         }
     };
 }
@@ -513,8 +591,10 @@ public:
         return Table(*this, t);
     }
     
-    Writer2(FILE *const stream)
-    : VDB::Writer(stream)
+    using VDB::Writer::setBufferSize;
+
+    Writer2(FILE *const stream, size_t const bufferSize = defaultBufferSize)
+    : VDB::Writer(stream, bufferSize)
     , nextTable(0)
     , nextColumn(0)
     {
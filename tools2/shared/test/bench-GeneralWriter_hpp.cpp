@@ -0,0 +1,106 @@
+#include "../include/writer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <iostream>
+
+/* Compares the per-cell stdio path (buffer size 0) with the buffered event path.
+ * Both must produce identical streams.
+ */
+
+static double run(FILE *const output, size_t const bufferSize, unsigned const rows) {
+    auto const start = std::chrono::steady_clock::now();
+    {
+        auto writer = Writer2(output, bufferSize);
+
+        writer.destination("dummy.file.vdb");
+        writer.schema("dummy.schema.text", "dummy:db");
+        writer.info("bench-GeneralWriter_hpp", "1.0.0");
+
+        writer.addTable("RAW", {
+            { "READ_GROUP", sizeof(char) },
+            { "NAME", sizeof(char) },
+            { "READNO", sizeof(int32_t) },
+            { "SEQUENCE", sizeof(char) },
+            { "REFERENCE", sizeof(char) },
+            { "CIGAR", sizeof(char) },
+            { "STRAND", sizeof(char) },
+            { "POSITION", sizeof(int32_t) },
+        });
+        writer.beginWriting();
+
+        auto const &table = writer.table("RAW");
+        auto const &group = table.column("READ_GROUP");
+        auto const &name = table.column("NAME");
+        auto const &readNo = table.column("READNO");
+        auto const &sequence = table.column("SEQUENCE");
+        auto const &reference = table.column("REFERENCE");
+        auto const &cigar = table.column("CIGAR");
+        auto const &strand = table.column("STRAND");
+        auto const &position = table.column("POSITION");
+        auto const groupName = std::string("GROUP1");
+        auto const seq = std::string(101, 'A');
+        auto const ref = std::string("chr1");
+        auto const cig = std::string("101M");
+        char spotName[32];
+
+        for (auto i = 0u; i < rows; ++i) {
+            auto const n = snprintf(spotName, sizeof(spotName), "SPOT.%u", i >> 1);
+            int32_t const rn = (i & 1) + 1;
+            int32_t const pos = int32_t(i * 7);
+
+            group.setValue(groupName);
+            name.setValue(unsigned(n), spotName);
+            readNo.setValue(rn);
+            sequence.setValue(seq);
+            reference.setValue(ref);
+            cigar.setValue(cig);
+            strand.setValue((i & 1) ? '-' : '+');
+            position.setValue(pos);
+            table.closeRow();
+        }
+        writer.endWriting();
+        writer.flush();
+    }
+    auto const stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+static std::vector<char> contents(FILE *const fp) {
+    auto result = std::vector<char>();
+    char buffer[64 * 1024];
+
+    rewind(fp);
+    for ( ; ; ) {
+        auto const nread = fread(buffer, 1, sizeof(buffer), fp);
+        if (nread == 0) break;
+        result.insert(result.end(), buffer, buffer + nread);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    auto const rows = argc > 1 ? unsigned(strtoul(argv[1], nullptr, 10)) : 10000000u;
+    auto const unbuffered = tmpfile();
+    auto const buffered = tmpfile();
+
+    if (unbuffered == nullptr || buffered == nullptr) {
+        std::cerr << "can't create temporary files" << std::endl;
+        exit(1);
+    }
+    auto const t0 = run(unbuffered, 0, rows);
+    auto const t1 = run(buffered, VDB::Writer::defaultBufferSize, rows);
+
+    std::cout << "rows\tper-cell seconds\tbuffered seconds\tspeedup" << std::endl;
+    std::cout << rows << '\t' << t0 << '\t' << t1 << '\t' << (t0 / t1) << std::endl;
+
+    if (contents(unbuffered) != contents(buffered)) {
+        std::cerr << "buffered stream differs from per-cell stream" << std::endl;
+        return 1;
+    }
+    fclose(unbuffered);
+    fclose(buffered);
+    return 0;
+}